@@ -0,0 +1,127 @@
+/*
+ * @brief Interrupt to main loop event queue
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+#include "AppEvent.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define APP_EVENT_QUEUE_MASK    (APP_EVENT_QUEUE_SIZE - 1)
+
+/* Each slot holds one packed event, 0 (APP_EVENT_NONE) marks it free. Writing
+   the whole word is what publishes the event to the consumer. */
+static volatile uint32_t EventSlot[APP_EVENT_QUEUE_SIZE];
+/* Next slot to reserve, advanced by producers with LDREX/STREX */
+static volatile uint32_t EventHead;
+/* Next slot to consume, only written by the main loop */
+static volatile uint32_t EventTail;
+static volatile uint32_t EventDropped;
+static uint32_t EventDroppedReported;
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static INLINE uint32_t AppEvent_Pack(APP_EVENT_ID_T Id, uint8_t Port, uint16_t Arg)
+{
+	return ((uint32_t) Arg << 16) | ((uint32_t) Port << 8) | (uint32_t) Id;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Post an event */
+bool AppEvent_Post(APP_EVENT_ID_T Id, uint8_t Port, uint16_t Arg)
+{
+	uint32_t head;
+
+	do {
+		head = __LDREXW((uint32_t *) &EventHead);
+		if ((head - EventTail) >= APP_EVENT_QUEUE_SIZE) {
+			__CLREX();
+			EventDropped++;
+			return false;
+		}
+	} while (__STREXW(head + 1, (uint32_t *) &EventHead));
+
+	EventSlot[head & APP_EVENT_QUEUE_MASK] = AppEvent_Pack(Id, Port, Arg);
+	return true;
+}
+
+/* Take the oldest event */
+bool AppEvent_Get(APP_EVENT_T *Event)
+{
+	uint32_t tail = EventTail;
+	uint32_t word = EventSlot[tail & APP_EVENT_QUEUE_MASK];
+
+	if (word == APP_EVENT_NONE) {
+		uint32_t dropped = EventDropped;
+		if (dropped == EventDroppedReported) {
+			return false;
+		}
+		EventDroppedReported = dropped;
+		Event->Id = APP_EVENT_OVERFLOW;
+		Event->Port = 0;
+		Event->Arg = 0;
+		return true;
+	}
+
+	EventSlot[tail & APP_EVENT_QUEUE_MASK] = APP_EVENT_NONE;
+	/* Slot must read as free before producers may reuse it */
+	__DMB();
+	EventTail = tail + 1;
+
+	Event->Id = (uint8_t) word;
+	Event->Port = (uint8_t) (word >> 8);
+	Event->Arg = (uint16_t) (word >> 16);
+	return true;
+}
+
+/* Sleep until the next interrupt if nothing is pending */
+void AppEvent_WaitForEvent(void)
+{
+	__disable_irq();
+	if ((EventSlot[EventTail & APP_EVENT_QUEUE_MASK] == APP_EVENT_NONE) &&
+		(EventDropped == EventDroppedReported)) {
+		/* A pending interrupt wakes WFI even with PRIMASK set; the handler
+		   then runs as soon as interrupts are enabled again. */
+		__WFI();
+	}
+	__enable_irq();
+}
+
+/* Dropped event count */
+uint32_t AppEvent_GetDroppedCount(void)
+{
+	return EventDropped;
+}
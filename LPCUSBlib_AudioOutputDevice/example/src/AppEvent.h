@@ -0,0 +1,119 @@
+/*
+ * @brief Interrupt to main loop event queue
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+#ifndef _APP_EVENT_H_
+#define _APP_EVENT_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_Event Event queue
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * Interrupt handlers post small events (SETUP received, control transfer
+ * complete, sample rate change) to this queue and the main loop dispatches
+ * them, sleeping with __WFI() whenever the queue is empty.
+ *
+ * Any interrupt priority may post; slots are reserved with LDREX/STREX so no
+ * interrupt masking is needed on the producer side. The main loop is the
+ * only consumer. Because it runs in thread mode, every handler that reserved
+ * a slot has finished writing it before the consumer looks at it again.
+ * @{
+ */
+
+/** Number of queued events, must be a power of 2 */
+#define APP_EVENT_QUEUE_SIZE    16
+
+/**
+ * @brief Event identifiers
+ */
+typedef enum {
+	APP_EVENT_NONE = 0,				/*!< Empty slot marker, never posted */
+	APP_EVENT_USB_SETUP,			/*!< SETUP packet received on control endpoint */
+	APP_EVENT_USB_XFER_COMPLETE,	/*!< Non isochronous transfer completed, Arg = endpoint | direction */
+	APP_EVENT_AUDIO_RATE_CHANGE,	/*!< Host selected a new sample frequency */
+	APP_EVENT_OVERFLOW,				/*!< One or more events were dropped, poll everything */
+	APP_EVENT_TELEMETRY,			/*!< Telemetry period elapsed on this port */
+	APP_EVENT_NETWORK,				/*!< Network sink needs polling on this port */
+} APP_EVENT_ID_T;
+
+/**
+ * @brief Event record
+ */
+typedef struct {
+	uint8_t  Id;		/*!< One of APP_EVENT_ID_T */
+	uint8_t  Port;		/*!< USB port the event belongs to */
+	uint16_t Arg;		/*!< Event specific argument */
+} APP_EVENT_T;
+
+/**
+ * @brief	Post an event, callable from any interrupt priority or thread mode
+ * @param	Id		: Event identifier
+ * @param	Port	: USB port number
+ * @param	Arg		: Event specific argument
+ * @return	true if queued, false if the queue was full and the event dropped
+ */
+bool AppEvent_Post(APP_EVENT_ID_T Id, uint8_t Port, uint16_t Arg);
+
+/**
+ * @brief	Take the oldest event from the queue, main loop only
+ * @param	Event	: Pointer to event record to fill
+ * @return	true if an event was returned, false if the queue is empty
+ * @note	After events were dropped, a single APP_EVENT_OVERFLOW is returned
+ *			once the queue has drained.
+ */
+bool AppEvent_Get(APP_EVENT_T *Event);
+
+/**
+ * @brief	Sleep until the next interrupt if no event is pending, main loop only
+ * @return	Nothing
+ * @note	The queue is checked with interrupts masked so an event posted
+ *			between the check and __WFI() still wakes the core.
+ */
+void AppEvent_WaitForEvent(void);
+
+/**
+ * @brief	Number of events dropped because the queue was full
+ * @return	Dropped event count since reset
+ */
+uint32_t AppEvent_GetDroppedCount(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_EVENT_H_ */
@@ -31,350 +31,703 @@
  */
 
 #include "AudioOutputDevice.h"
-#include "max98357a.h"
+#include "AudioSink.h"
+#include "AppEvent.h"
+#include "Timebase.h"
+#include "Telemetry.h"
+#include "Midi.h"
+#include "MassStorage.h"
+#include "Network.h"
+#include "Capture.h"
+#include "Latency.h"
+#include "AudioRates.h"
+#include "BootProfile.h"
+#include "CopyBench.h"
+#include "dma_copy.h"
+#include "MemoryLayout.h"
+#include "LayoutBench.h"
 
 #if defined(USB_DEVICE_ROM_DRIVER)
 #include "usbd_adcuser.h"
 #endif
-/** LPCUSBlib Audio Class driver interface configuration and state information. This structure is
- *  passed to all Audio Class driver functions, so that multiple instances of the same class
- *  within a device can be differentiated from one another.
- */
-USB_ClassInfo_Audio_Device_t Speaker_Audio_Interface = {
-	.Config = {
-		.StreamingInterfaceNumber = 1,
-
-		.DataOUTEndpointNumber    = AUDIO_STREAM_EPNUM,
-		.DataOUTEndpointSize      = AUDIO_STREAM_EPSIZE,
-		.PortNumber = 0,
-	},
-};
-
 /** Max Sample Frequency. */
 #define AUDIO_MAX_SAMPLE_FREQ   48000
 /** if audio buffer count is over this value, i2s will run in higher speed */
-#define AUDIO_SPEEP_UP_TRIGGER			(audio_buffer_size*5/8)
+#define AUDIO_SPEEP_UP_TRIGGER(a)		((a)->BufferSize*5/8)
 /** if audio buffer count is under this value, i2s will run in normal speed */
-#define AUDIO_NORMAL_SPEED_TRIGGER	(audio_buffer_size*3/8)
-/** Current audio sampling frequency of the streaming audio endpoint. */
-uint32_t CurrentAudioSampleFrequency = AUDIO_MAX_SAMPLE_FREQ;
+#define AUDIO_NORMAL_SPEED_TRIGGER(a)	((a)->BufferSize*3/8)
+/** USB port whose SOF drives the timebase and whose events get stamped */
+#define AUDIO_TIMEBASE_PORT     0
 
 /**
  * Audio API
  */
-/** Audio max packet count. */
-#define AUDIO_MAX_PC    10
-PRAGMA_ALIGN_4
-uint8_t audio_buffer[2048*2] ATTR_ALIGNED(4);
-uint32_t audio_buffer_size = 0;
-uint32_t audio_buffer_rd_index = 0;
-uint32_t audio_buffer_wr_index = 0;
-uint32_t audio_buffer_count = 0;
+/** Ring size: the largest working size plus room for one ISO packet written past the wrap point */
+#define AUDIO_RING_SIZE ((AUDIO_MAX_SAMPLE_FREQ * 4 * AUDIO_MAX_PC / 1000) * 2 + USB_DATA_BUFFER_TEM_LENGTH)
 
+/** One audio function. Each USB controller owns one of these together with its
+ *  own I2S port, so the two functions share no ring, index or rate state.
+ */
 typedef struct {
-	uint8_t BITRATE;
-	struct {
-		uint8_t X,Y;
-	} RATEUP;
-	struct {
-		uint8_t X,Y;
-	} RATEDOWN;
-} I2S_RATE_CONFIG;
-
-static uint32_t I2S_SpeedConfig_index;
-#if defined(__LPC18XX__ )
-/** USB Audio Speed config table if I2S peripheral speed = 180Mhz 
- *	Manual find and set for closest match freq */
-I2S_RATE_CONFIG I2S_SpeedConfig[] = 
-{
-	/* BITRATE	RATE_Up(x,y)	RATE_Down(x,y) */
-	/* 8000 */
-	{0x3F,	{0x2D,	0xF7},	{0x02,	0x0B}},
-	/* 11025 */
-	{0x3F,	{0x40,	0xFF},	{0x01,	0x04}},
-	/* 16000 unsupport */
-	{0,	{0,	0},	{0,	0}},
-	/* 22050 */
-	{0x3F,	{0x80,	0xFF},	{0x01,	0x02}},
-	/* 32000 unsupport */
-	{0,	{0,	0},	{0,	0}},
-	/* 44100 */
-	{0x3E,	{0xF4,	0xF7},	{0x51,	0x52}},
-	/* 48000 */
-	{0x39,	{0x62,	0x63},	{0xC3,	0xC5}}
-	
-};
-#elif defined(__LPC43XX__ )
-/** USB Audio Speed config table if I2S peripheral speed = 204Mhz 
- *	Manual find and set for closest match freq */
-I2S_RATE_CONFIG I2S_SpeedConfig[] = 
-{
-	/* BITRATE	RATE_Up(x,y)	RATE_Down(x,y) */
-	/* 8000 */
-	{0x3F,	{0x20,	0xC1},	{0x16,	0x89}},
-	/* 11025 */
-	{0x3F,	{0x1D,	0x83},	{0x38,	0xFD}},
-	/* 16000 */
-	{0x3f,	{0x3f,	0xc1},	{0x35,	0xA5}},
-	/* 22050 */
-	{0x3F,	{0x3A,	0x83},	{0x55,	0xC0}},
-	/* 32000 */
-	{0x3f,	{0x85,	0xCF},	{0x7C,	0xC1}},
-	/* 44100 */
-	{0x3F,	{0x74,	0x83},	{0xC9,	0xE3}},
-	/* 48000 */
-	{0x3F,	{0xD5,	0xDD},	{0x85,	0x8A}}
-	
+	USB_ClassInfo_Audio_Device_t Interface;	/**< Class driver instance, PortNumber selects the USB controller */
+	LPC_I2S_T *I2S;							/**< I2S port fed by this function */
+	IRQn_Type I2SIRQ;						/**< Interrupt of that I2S port */
+	bool CodecPort;							/**< The board codec bring-up finds the output stage of this port */
+	const AUDIO_SINK_T *Sink;				/**< Output stage, NULL until the bring-up found one, or when there is none */
+	int16_t Volume;							/**< Feature unit volume, in 1/256 dB */
+	bool Mute;								/**< Feature unit mute */
+	volatile uint16_t Gain;					/**< Q15 software gain of the I2S refill, the part the sink does not do */
+	uint32_t SampleFrequency;				/**< Current sampling frequency of the streaming endpoint */
+#ifdef USB_AUDIO_2DOT0
+	uint8_t ClockSource;					/**< Clock source picked by the clock selector */
+	uint32_t ClockFrequency[AUDIO_CLOCK_SOURCES];	/**< Sampling frequency of each clock source */
+#endif
+	const AUDIO_RATE_T *Rate;				/**< Registry entry of SampleFrequency, NULL while stopped */
+	bool DoubleSpeed;						/**< I2S running on the RATEUP divider */
+	uint32_t Sample;						/**< Last sample sent, repeated on underrun */
+	uint32_t BufferSize;					/**< Working size of Buffer for the current rate */
+	uint32_t RdIndex;
+	uint32_t WrIndex;
+	uint32_t Count;
+	/* Statistics, reported through the telemetry channel */
+	uint32_t Underruns;						/**< I2S refills that found the ring empty */
+	uint32_t Overruns;						/**< Ring resets on ISO overrun */
+	uint32_t IsoPackets;					/**< ISO OUT packets received */
+	uint32_t RateSwitches;					/**< I2S divider changes */
+	uint32_t FillMin;						/**< Lowest Count since the last snapshot */
+	uint32_t FillMax;						/**< Highest Count since the last snapshot */
+	uint32_t I2SMaxCycles;					/**< Longest I2S service since the last snapshot */
+	uint32_t IsoMaxCycles;					/**< Longest ISO buffer callback since the last snapshot */
+#if (AUDIO_LATENCY_PROBE)
+	uint32_t MarkerIndex;					/**< Ring offset of the latency marker, AUDIO_NO_MARKER if none */
+#endif
+	uint8_t *Buffer;						/**< AUDIO_RING_SIZE bytes in the bank MemoryLayout.h picks for the port */
+} AUDIO_INSTANCE_T;
+
+/** MarkerIndex value when no latency marker is in the ring */
+#define AUDIO_NO_MARKER         0xFFFFFFFF
+
+/** Number of audio functions. The ROM driver glue only serves USB0. */
+#if defined(USB_DEVICE_ROM_DRIVER)
+#define AUDIO_INSTANCE_COUNT    1
+#else
+#define AUDIO_INSTANCE_COUNT    2
+#endif
+
+/** Playback rings, each in the bank its USB controller writes, see MemoryLayout.h */
+PRAGMA_ALIGN_4
+static uint8_t Audio_Ring0[AUDIO_RING_SIZE] ATTR_ALIGNED(4) LAYOUT_PLAYBACK_RING0;
+#if (AUDIO_INSTANCE_COUNT > 1)
+PRAGMA_ALIGN_4
+static uint8_t Audio_Ring1[AUDIO_RING_SIZE] ATTR_ALIGNED(4) LAYOUT_PLAYBACK_RING1;
+#endif
+
+/** LPCUSBlib Audio Class driver interface configuration and state information, one entry per
+ *  USB controller: USB0 runs at high speed into I2S0, USB1 at full speed into I2S1. The class
+ *  driver structure is passed to all Audio Class driver functions, so that multiple instances
+ *  of the same class within a device can be differentiated from one another.
+ */
+static AUDIO_INSTANCE_T Audio_Instance[AUDIO_INSTANCE_COUNT] = {
+	{
+		.Interface = {
+			.Config = {
+				.StreamingInterfaceNumber = 1,
+
+				.DataOUTEndpointNumber    = AUDIO_STREAM_EPNUM,
+				.DataOUTEndpointSize      = AUDIO_STREAM_EPSIZE,
+				.PortNumber = 0,
+			},
+		},
+		.I2S = LPC_I2S0,
+		.I2SIRQ = I2S0_IRQn,
+		.CodecPort = true,
+		.Volume = AUDIO_SINK_VOLUME_MAX,
+		.Gain = AUDIO_SINK_UNITY_GAIN,
+		.Buffer = Audio_Ring0,
+		.SampleFrequency = AUDIO_MAX_SAMPLE_FREQ,
+#ifdef USB_AUDIO_2DOT0
+		.ClockSource = AUDIO_CLOCK_SOURCE_48K,
+		.ClockFrequency = {[AUDIO_CLOCK_SOURCE_48K] = 48000, [AUDIO_CLOCK_SOURCE_44K1] = 44100},
+#endif
+	},
+#if (AUDIO_INSTANCE_COUNT > 1)
+	{
+		.Interface = {
+			.Config = {
+				.StreamingInterfaceNumber = 1,
+
+				.DataOUTEndpointNumber    = AUDIO_STREAM_EPNUM,
+				.DataOUTEndpointSize      = AUDIO_STREAM_EPSIZE,
+				.PortNumber = 1,
+			},
+		},
+		.I2S = LPC_I2S1,
+		.I2SIRQ = I2S1_IRQn,
+		.Volume = AUDIO_SINK_VOLUME_MAX,
+		.Gain = AUDIO_SINK_UNITY_GAIN,
+		.Buffer = Audio_Ring1,
+		.SampleFrequency = AUDIO_MAX_SAMPLE_FREQ,
+#ifdef USB_AUDIO_2DOT0
+		.ClockSource = AUDIO_CLOCK_SOURCE_48K,
+		.ClockFrequency = {[AUDIO_CLOCK_SOURCE_48K] = 48000, [AUDIO_CLOCK_SOURCE_44K1] = 44100},
+#endif
+	},
+#endif
 };
+
+#if !defined(USB_DEVICE_ROM_DRIVER)
+/** USB port whose device task is running, selects the instance for the port less library events */
+static uint8_t Audio_ServicePort;
 #endif
-Status I2S_RateFind(LPC_I2S_T *I2Sx, I2S_AUDIO_FORMAT_T *audio_format, I2S_RATE_CONFIG *I2S_Config)
-{
-	uint32_t pClk;
-	uint32_t x, y;
-	uint64_t divider;
-	uint16_t dif;
-	uint16_t x_divide = 0, y_divide_down = 0, y_divide_up = 0;
-	uint32_t N;
-	uint32_t err, ErrorOptimal_down = 0xFFFF, ErrorOptimal_up = 0xFFFF;
 
-	pClk = (uint64_t)Chip_Clock_GetRate(CLK_APB1_I2S);
+/** Codec bring-up outcome already reported */
+static bool Audio_CodecReported;
 
-	/* find N that make x/y <= 1 -> divider <= 2^16 */
-	for (N = 64; N > 0; N--) {
-		/* divider is a fixed point number with 16 fractional bits */
-		divider = (((uint64_t)(audio_format->SampleRate) * 2 * (audio_format->WordWidth) * 2) << 16) * N / pClk;
-		if (divider < (1 << 16)) {
-			break;
-		}
-	}
-	if (N == 0) {
-		return ERROR;
-	}
-	//divider *= N;
-	for (y = 255; y > 0; y--) {
-		x = y * divider;
-		if (x & (0xFF000000)) {
-			continue;
-		}
-		dif = x & 0xFFFF;
-		if (dif > 0x8000) {
-			/* mark this case to plus 1 to x value */
-			err = (0x10000 - dif);
-			/* in this case x = 255 + 1 */
-			if((x & 0x00FF0000) == 0x00FF0000) continue;
-			if (err < ErrorOptimal_up ) {
-				ErrorOptimal_up = err;
-				y_divide_up = y;
-			}
-		}
-		else {
-			err = dif;
-			if (err < ErrorOptimal_down) {
-				ErrorOptimal_down = err;
-				y_divide_down = y;
-			}
+#if defined(USB_DEVICE_ROM_DRIVER)
+/** Current audio sampling frequency of the ROM driver streaming endpoint (USB0). */
+uint32_t CurrentAudioSampleFrequency = AUDIO_MAX_SAMPLE_FREQ;
+#endif
+
+/** Returns the audio function bound to a USB port, NULL if the port has none */
+static AUDIO_INSTANCE_T *Audio_FromPort(uint8_t corenum)
+{
+	uint32_t i;
+
+	for (i = 0; i < AUDIO_INSTANCE_COUNT; i++) {
+		if (Audio_Instance[i].Interface.Config.PortNumber == corenum) {
+			return &Audio_Instance[i];
 		}
 	}
-	I2S_Config->BITRATE = N - 1;
-	x_divide = ((uint64_t)y_divide_up * (audio_format->SampleRate) * 2 * (audio_format->WordWidth) * N * 2) / pClk;
-	x_divide += 1;
-	if (x_divide >= 256) {
-		x_divide = 0xFF;
-	}
-	if (x_divide == 0) {
-		x_divide = 1;
+	return NULL;
+}
+
+static void Audio_ResetRing(AUDIO_INSTANCE_T *Audio)
+{
+	Audio->Count = 0;
+	Audio->WrIndex = 0;
+	Audio->RdIndex = 0;
+#if (AUDIO_LATENCY_PROBE)
+	Audio->MarkerIndex = AUDIO_NO_MARKER;
+#endif
+}
+
+#if (AUDIO_LATENCY_PROBE)
+/** Latency probe: marks the first frame of the packet just received, once per probe interval */
+static void Audio_InjectMarker(AUDIO_INSTANCE_T *Audio, uint32_t Arrival)
+{
+	uint8_t corenum = Audio->Interface.Config.PortNumber;
+	uint8_t paths = 1 << LATENCY_PATH_ISO_TO_I2S;
+	uint16_t frame;
+	uint32_t offset;
+
+#if (AUDIO_CAPTURE_FUNCTION)
+	if (Capture_IsStreaming(corenum)) {
+		paths |= 1 << LATENCY_PATH_ROUND_TRIP;
 	}
-	I2S_Config->RATEUP.X = x_divide;
-	I2S_Config->RATEUP.Y = y_divide_up;
-	
-	x_divide = ((uint64_t)y_divide_down * (audio_format->SampleRate) * 2 * (audio_format->WordWidth) * N * 2) / pClk;
-	if (x_divide >= 256) {
-		x_divide = 0xFF;
+#endif
+	/* Count from the SOF the packet came after, where the timebase runs */
+	if ((corenum == AUDIO_TIMEBASE_PORT) && Timebase_ToFrame(Arrival, &frame, &offset)) {
+		Arrival -= offset;
 	}
-	if (x_divide == 0) {
-		x_divide = 1;
+	if (Latency_Arm(corenum, Arrival, paths)) {
+		*(uint32_t *) &Audio->Buffer[Audio->WrIndex] = LATENCY_MARKER;
+		Audio->MarkerIndex = Audio->WrIndex;
 	}
-	I2S_Config->RATEDOWN.X = x_divide;
-	I2S_Config->RATEDOWN.Y = y_divide_down;
-
-	//printf("audio_format->SampleRate: %d\r\n", audio_format->SampleRate);
-	//printf("I2S_Config->BITRATE: 0x%02x\r\n", I2S_Config->BITRATE);
-	//printf("I2S_Config->RATEUP.X: 0x%02x\r\n", I2S_Config->RATEUP.X);
-	//printf("I2S_Config->RATEUP.Y: 0x%02x\r\n", I2S_Config->RATEUP.Y);
-	//printf("I2S_Config->RATEDOWN.X: 0x%02x\r\n", I2S_Config->RATEDOWN.X);
-	//printf("I2S_Config->RATEDOWN.Y: 0x%02x\r\n", I2S_Config->RATEDOWN.Y);
-
-	return SUCCESS;
 }
 
-void Audio_Reset_Data_Buffer(void)
+/** Latency probe: the marker is being pushed with Ahead frames still in front of it */
+static void Audio_MarkerPlayed(AUDIO_INSTANCE_T *Audio, uint32_t Ahead)
 {
-	//printf("0x%02x 0x%02x 0x%02x 0x%02x\r\n", audio_buffer[0], audio_buffer[1], audio_buffer[2], audio_buffer[3]);
-	audio_buffer_count = 0;
-	audio_buffer_wr_index = 0;
-	audio_buffer_rd_index = 0;
+	/* It reaches the pin once those and the frame in the shift register are out */
+	uint32_t pin = DWT->CYCCNT + (Ahead + 1) * (SystemCoreClock / Audio->SampleFrequency);
+
+	Audio->MarkerIndex = AUDIO_NO_MARKER;
+	Latency_Complete(Audio->Interface.Config.PortNumber, LATENCY_PATH_ISO_TO_I2S, pin);
 }
+#endif
 
-uint32_t Audio_Get_ISO_Buffer_Address(uint32_t last_packet_size)
+LAYOUT_RAMFUNC static uint32_t Audio_GetISOBufferAddress(AUDIO_INSTANCE_T *Audio, uint32_t last_packet_size)
 {
-	audio_buffer_wr_index += last_packet_size;
-	audio_buffer_count += last_packet_size;
-	if (audio_buffer_count > audio_buffer_size) {
-		Audio_Reset_Data_Buffer();
+	Audio->WrIndex += last_packet_size;
+	Audio->Count += last_packet_size;
+	Audio->IsoPackets++;
+	if (Audio->Count > Audio->BufferSize) {
+		Audio->Overruns++;
+		Audio_ResetRing(Audio);
+	}
+	if (Audio->Count > Audio->FillMax) {
+		Audio->FillMax = Audio->Count;
 	}
-	if (audio_buffer_wr_index >= audio_buffer_size) {
-		memcpy(audio_buffer, &audio_buffer[audio_buffer_size], audio_buffer_wr_index - audio_buffer_size);
-		audio_buffer_wr_index -= audio_buffer_size;
+	if (Audio->WrIndex >= Audio->BufferSize) {
+		memcpy(Audio->Buffer, &Audio->Buffer[Audio->BufferSize], Audio->WrIndex - Audio->BufferSize);
+		Audio->WrIndex -= Audio->BufferSize;
 	}
-	return (uint32_t) &audio_buffer[audio_buffer_wr_index];
+	return (uint32_t) &Audio->Buffer[Audio->WrIndex];
 }
 
-void Audio_Init(uint32_t samplefreq)
+/** Starts the I2S port of one function at its SampleFrequency. A rate missing from the
+ *  registry leaves the function stopped rather than playing at a wrong speed.
+ */
+static void Audio_Start(AUDIO_INSTANCE_T *Audio)
 {
 	I2S_AUDIO_FORMAT_T audio_Confg;
+	uint32_t samplefreq = Audio->SampleFrequency;
+	const AUDIO_RATE_T *rate = AudioRates_Find(samplefreq);
 
 	//printf("%s()\r\n", __FUNCTION__);
 
+	if (rate == NULL) {
+		Audio->Rate = NULL;
+		return;
+	}
+
 	audio_Confg.SampleRate = samplefreq;
 	audio_Confg.ChannelNumber = 2;	// 1 is mono, 2 is stereo
 	audio_Confg.WordWidth = 16;	// 8, 16 or 32 bits
-	Board_Audio_Init(LPC_I2S0);
-
-	Chip_I2S_Init(LPC_I2S0);
-	Chip_I2S_TxConfig(LPC_I2S0, &audio_Confg);
-	Chip_I2S_TxStop(LPC_I2S0);
-	Chip_I2S_DisableMute(LPC_I2S0);
-	Chip_I2S_TxStart(LPC_I2S0);
-	Chip_I2S_Int_TxCmd(LPC_I2S0, ENABLE, 4);
-	NVIC_EnableIRQ(I2S0_IRQn);
-
-	Audio_Reset_Data_Buffer();
-	switch (samplefreq) {
-	case 11025:
-		I2S_SpeedConfig_index = 1;
-		audio_buffer_size = 1764;
-		break;
-	case 22050:
-		I2S_SpeedConfig_index = 3;
-		audio_buffer_size = 1764;
-		break;
-	case 44100:
-		I2S_SpeedConfig_index = 5;
-		audio_buffer_size = 1764;
-		break;
+	Board_Audio_Init(Audio->I2S);
 
-	case 8000:
-		I2S_SpeedConfig_index = 0;
-	audio_buffer_size = samplefreq * 4 * AUDIO_MAX_PC / 1000;
-		break;
-	case 16000:
-		I2S_SpeedConfig_index = 2;
-		audio_buffer_size = samplefreq * 4 * AUDIO_MAX_PC / 1000;
-		break;
-	case 32000:
-		I2S_SpeedConfig_index = 4;
-		audio_buffer_size = samplefreq * 4 * AUDIO_MAX_PC / 1000;
-		break;
-	case 48000:
-		I2S_SpeedConfig_index = 6;
-	default:
-		audio_buffer_size = samplefreq * 4 * AUDIO_MAX_PC / 1000;
-		break;
+	Chip_I2S_Init(Audio->I2S);
+	Chip_I2S_TxConfig(Audio->I2S, &audio_Confg);
+	Chip_I2S_TxStop(Audio->I2S);
+	Chip_I2S_DisableMute(Audio->I2S);
+
+	if (Audio->Sink != NULL) {
+		Audio->Sink->SetRate(samplefreq);
 	}
-	Chip_I2S_SetTxBitRate(LPC_I2S0, I2S_SpeedConfig[I2S_SpeedConfig_index].BITRATE);
-	Chip_I2S_SetTxXYDivider(LPC_I2S0,
-							I2S_SpeedConfig[I2S_SpeedConfig_index].RATEDOWN.X,
-							I2S_SpeedConfig[I2S_SpeedConfig_index].RATEDOWN.Y);
-	audio_buffer_size*=2;
+	Audio->Rate = rate;
+#if defined(USB_DEVICE_ROM_DRIVER)
+	/* The ROM driver glue derives the nominal feedback from it */
+	CurrentAudioSampleFrequency = samplefreq;
+#endif
+	Audio->BufferSize = rate->BufferSize;
+	Audio_ResetRing(Audio);
+	Audio->DoubleSpeed = false;
+	Audio->FillMin = UINT32_MAX;
+	Audio->FillMax = 0;
+	Chip_I2S_SetTxBitRate(Audio->I2S, rate->Divider.BITRATE);
+	Chip_I2S_SetTxXYDivider(Audio->I2S, rate->Divider.RATEDOWN.X, rate->Divider.RATEDOWN.Y);
+
+	Chip_I2S_TxStart(Audio->I2S);
+	Chip_I2S_Int_TxCmd(Audio->I2S, ENABLE, 4);
+	NVIC_EnableIRQ(Audio->I2SIRQ);
+#if (AUDIO_CAPTURE_FUNCTION)
+	/* The receiver borrows the clocks just set up, start it last */
+	Capture_Start(Audio->Interface.Config.PortNumber, Audio->I2S, samplefreq);
+#endif
 
 	//printf("Sample Frequency: %d\r\n", samplefreq);
-	//printf("I2S_SpeedConfig[%d].BITRATE: 0x%02x\r\n", I2S_SpeedConfig_index, I2S_SpeedConfig[I2S_SpeedConfig_index].BITRATE);
-	//printf("I2S_SpeedConfig[%d].RATEUP.X: 0x%02x\r\n", I2S_SpeedConfig_index, I2S_SpeedConfig[I2S_SpeedConfig_index].RATEUP.X);
-	//printf("I2S_SpeedConfig[%d].RATEUP.Y: 0x%02x\r\n", I2S_SpeedConfig_index, I2S_SpeedConfig[I2S_SpeedConfig_index].RATEUP.Y);
-	//printf("I2S_SpeedConfig[%d].RATEDOWN.X: 0x%02x\r\n", I2S_SpeedConfig_index, I2S_SpeedConfig[I2S_SpeedConfig_index].RATEDOWN.X);
-	//printf("I2S_SpeedConfig[%d].RATEDOWN.Y: 0x%02x\r\n", I2S_SpeedConfig_index, I2S_SpeedConfig[I2S_SpeedConfig_index].RATEDOWN.Y);
 }
 
-void Audio_DeInit(void)
+static void Audio_Stop(AUDIO_INSTANCE_T *Audio)
 {
-	Chip_I2S_DeInit(LPC_I2S0);
-	Chip_I2S_Int_TxCmd(LPC_I2S0, DISABLE, 4);
-	NVIC_DisableIRQ(I2S0_IRQn);
+#if (AUDIO_CAPTURE_FUNCTION)
+	Capture_Stop(Audio->Interface.Config.PortNumber);
+#endif
+	Chip_I2S_DeInit(Audio->I2S);
+	Chip_I2S_Int_TxCmd(Audio->I2S, DISABLE, 4);
+	NVIC_DisableIRQ(Audio->I2SIRQ);
 }
 
-void I2S0_IRQHandler(void)
+/** Hands the feature unit volume and mute to the sink as far as its hardware goes, the
+ *  software gain of the I2S refill does the rest. A sink that fails the request leaves
+ *  it all to the software gain.
+ */
+static void Audio_ApplyGain(AUDIO_INSTANCE_T *Audio)
 {
-	uint32_t txlevel, i;
-	static bool double_speed = false;
-	static uint32_t sample = 0;
-	txlevel = Chip_I2S_GetTxLevel(LPC_I2S0);
+	const AUDIO_SINK_T *sink = Audio->Sink;
+
+	if ((sink != NULL) && (sink->SetGain != NULL) && !sink->SetGain(Audio->Volume, Audio->Mute)) {
+		sink = NULL;
+	}
+	Audio->Gain = AudioSink_SoftGain(sink, Audio->Volume, Audio->Mute);
+}
+
+/** Puts a sink behind the I2S port of a function and brings it to the state of the
+ *  function: rate, volume, and powered if the host is streaming already.
+ */
+static void Audio_AttachSink(AUDIO_INSTANCE_T *Audio, const AUDIO_SINK_T *Sink)
+{
+	if ((Sink == NULL) || !Sink->Init() || !Sink->SetFormat(AUDIO_CHANNELS, 16)) {
+		return;
+	}
+	Audio->Sink = Sink;
+	if (Audio->Rate != NULL) {
+		Sink->SetRate(Audio->SampleFrequency);
+	}
+	Audio_ApplyGain(Audio);
+	Sink->SetPower(Audio->Interface.State.InterfaceEnabled);
+	printf("Audio sink: %s on USB%d, %s volume, %u us after the I2S pins\r\n", Sink->Name,
+		   Audio->Interface.Config.PortNumber, (Sink->Caps & AUDIO_SINK_CAP_VOLUME) ? "hardware" : "software",
+		   (unsigned) AudioSink_LatencyUs(Sink, Audio->SampleFrequency));
+}
+
+/** Advances the codec bring-up started by the first Audio_Start(), from the main loop
+ *  so USB keeps enumerating meanwhile, reports the codec found once and attaches its sink.
+ *  Afterwards it only keeps the queued codec control transfers timed.
+ *  Returns true while the bring-up still has steps left.
+ */
+static bool Audio_CodecTask(void)
+{
+	static const char *const names[] = {"none", "pending", "WM8904", "MAX98357A", "WM8904 failed"};
+	BOARD_AUDIO_CODEC_T codec;
+	uint32_t i;
+
+	codec = Board_Audio_CodecPoll();
+	if (codec == BOARD_AUDIO_CODEC_PENDING) {
+		return true;
+	}
+	if (Audio_CodecReported) {
+		return false;
+	}
+	Audio_CodecReported = true;
+	BootProfile_Mark(BOOT_CHECKPOINT_CODEC);
+	printf("Audio codec: %s\r\n", names[codec]);
+	for (i = 0; i < AUDIO_INSTANCE_COUNT; i++) {
+		if (Audio_Instance[i].CodecPort) {
+			Audio_AttachSink(&Audio_Instance[i], AudioSink_ForCodec(codec));
+		}
+	}
+	return false;
+}
+
+/** Refills the TX FIFO of one function from its ring and nudges its I2S divider
+ *  to follow the host rate.
+ */
+LAYOUT_RAMFUNC static void Audio_I2SService(AUDIO_INSTANCE_T *Audio)
+{
+	uint32_t txlevel, i, cycles;
+	uint32_t start = DWT->CYCCNT;
+	bool starved = false, scale;
+	const I2S_RATE_CONFIG *speed = &Audio->Rate->Divider;
+	uint16_t gain = Audio->Gain;
+
+	txlevel = Chip_I2S_GetTxLevel(Audio->I2S);
 	if (txlevel <= 4)
 	{
+		if (Audio->Interface.Config.PortNumber == AUDIO_TIMEBASE_PORT) {
+			Timebase_Mark(TIMEBASE_EVENT_I2S_TX);
+		}
 		for (i = 0; i < 8 - txlevel; i++)
 		{
-			if (audio_buffer_count >= 4)
+			if (Audio->Count >= 4)
 			{	/*has enough data */
-				audio_buffer_count -= 4;
-				sample = *(uint32_t *) (audio_buffer + audio_buffer_rd_index);
-				audio_buffer_rd_index += 4;
-				if (audio_buffer_rd_index >= audio_buffer_size)
+				scale = (gain != AUDIO_SINK_UNITY_GAIN);
+#if (AUDIO_LATENCY_PROBE)
+				if (Audio->RdIndex == Audio->MarkerIndex) {
+					Audio_MarkerPlayed(Audio, txlevel + i);
+					/* The loopback path finds the marker by its value */
+					scale = false;
+				}
+#endif
+				BootProfile_Mark(BOOT_CHECKPOINT_FIRST_SAMPLE);
+				Audio->Count -= 4;
+				Audio->Sample = *(uint32_t *) (Audio->Buffer + Audio->RdIndex);
+				if (scale) {
+					Audio->Sample = AudioSink_Scale(Audio->Sample, gain);
+				}
+				Audio->RdIndex += 4;
+				if (Audio->RdIndex >= Audio->BufferSize)
 				{
-					audio_buffer_rd_index -= audio_buffer_size;
+					Audio->RdIndex -= Audio->BufferSize;
 				}
 			}
-			Chip_I2S_Send(LPC_I2S0, sample);
+			else {
+				starved = true;
+			}
+			Chip_I2S_Send(Audio->I2S, Audio->Sample);
+		}
+		if (starved) {
+			Audio->Underruns++;
+		}
+		if (Audio->Count < Audio->FillMin) {
+			Audio->FillMin = Audio->Count;
 		}
 		/*Skip some samples if buffer run writing too fast. */
-		if(audio_buffer_size != 0)
+		if(Audio->BufferSize != 0)
  		{
- 			if(audio_buffer_count >= AUDIO_SPEEP_UP_TRIGGER)
+ 			if(Audio->Count >= AUDIO_SPEEP_UP_TRIGGER(Audio))
  			{
- 				if(!double_speed)
+ 				if(!Audio->DoubleSpeed)
  				{
-					Chip_I2S_SetTxXYDivider(LPC_I2S0,
-										  I2S_SpeedConfig[I2S_SpeedConfig_index].RATEUP.X,
-										  I2S_SpeedConfig[I2S_SpeedConfig_index].RATEUP.Y);
-					double_speed = true;
+					Chip_I2S_SetTxXYDivider(Audio->I2S, speed->RATEUP.X, speed->RATEUP.Y);
+					Audio->DoubleSpeed = true;
+					Audio->RateSwitches++;
 				}
  			}
- 			else if(audio_buffer_count < AUDIO_NORMAL_SPEED_TRIGGER)
+ 			else if(Audio->Count < AUDIO_NORMAL_SPEED_TRIGGER(Audio))
  			{
- 				if(double_speed)
+ 				if(Audio->DoubleSpeed)
  				{
-					Chip_I2S_SetTxXYDivider(LPC_I2S0,
-											I2S_SpeedConfig[I2S_SpeedConfig_index].RATEDOWN.X,
-											I2S_SpeedConfig[I2S_SpeedConfig_index].RATEDOWN.Y);
-					double_speed = false;
+					Chip_I2S_SetTxXYDivider(Audio->I2S, speed->RATEDOWN.X, speed->RATEDOWN.Y);
+					Audio->DoubleSpeed = false;
+					Audio->RateSwitches++;
 				}
  			}
  		}
 	}
+	cycles = DWT->CYCCNT - start;
+	if (cycles > Audio->I2SMaxCycles) {
+		Audio->I2SMaxCycles = cycles;
+	}
+}
+
+/** Resets the USB0 ring, used by the ROM driver glue */
+void Audio_Reset_Data_Buffer(void)
+{
+	Audio_ResetRing(&Audio_Instance[0]);
 }
 
-/** This callback function provides iso buffer address for HAL iso transfer processing.
+/** (Re)starts the USB0 function at a new rate, used by the ROM driver glue.
+ *  Returns false, leaving the function untouched, for a rate missing from the registry.
  */
-uint32_t CALLBACK_HAL_GetISOBufferAddress(const uint32_t EPNum, uint32_t *last_packet_size)
+bool Audio_Init(uint32_t samplefreq)
+{
+	if (AudioRates_Find(samplefreq) == NULL) {
+		return false;
+	}
+	Audio_Instance[0].SampleFrequency = samplefreq;
+	Audio_Start(&Audio_Instance[0]);
+	return true;
+}
+
+LAYOUT_RAMFUNC void I2S0_IRQHandler(void)
+{
+	TRACE_PROBE_ENTER(APP_TRACE_I2S, 0);
+	Audio_I2SService(&Audio_Instance[0]);
+	TRACE_PROBE_EXIT(APP_TRACE_I2S, 0);
+}
+
+#if (AUDIO_INSTANCE_COUNT > 1)
+LAYOUT_RAMFUNC void I2S1_IRQHandler(void)
+{
+	TRACE_PROBE_ENTER(APP_TRACE_I2S, 1);
+	Audio_I2SService(&Audio_Instance[1]);
+	TRACE_PROBE_EXIT(APP_TRACE_I2S, 1);
+}
+#endif
+
+/** This callback function provides iso buffer address for HAL iso transfer processing,
+ *  routing each controller to the ring of its own audio function.
+ */
+LAYOUT_RAMFUNC uint32_t CALLBACK_HAL_GetPortISOBufferAddress(uint8_t corenum, const uint32_t EPNum, uint32_t *last_packet_size)
 {
     static uint16_t counter = 0;
+	AUDIO_INSTANCE_T *Audio = Audio_FromPort(corenum);
+	uint32_t start = DWT->CYCCNT;
+	uint32_t address, cycles;
+
 	/* Check if this is audio stream endpoint */
-	if (EPNum == AUDIO_STREAM_EPNUM) {
-	    Board_LED_Set(counter % 4, false);
-	    counter++;
-	    Board_LED_Set(counter % 4, true);
-		return Audio_Get_ISO_Buffer_Address(*last_packet_size);
+	if ((Audio != NULL) && (EPNum == Audio->Interface.Config.DataOUTEndpointNumber)) {
+		TRACE_PROBE_POINT(APP_TRACE_ISO_PACKET, *last_packet_size);
+		if (*last_packet_size != 0) {
+			BootProfile_Mark(BOOT_CHECKPOINT_FIRST_PACKET);
+		}
+		if (corenum == AUDIO_TIMEBASE_PORT) {
+			Timebase_Mark(TIMEBASE_EVENT_ISO_OUT);
+		    Board_LED_Set(counter % 4, false);
+		    counter++;
+		    Board_LED_Set(counter % 4, true);
+		}
+#if (AUDIO_CAPTURE_FUNCTION)
+		Capture_PlaybackPacket(corenum, *last_packet_size);
+#endif
+#if (AUDIO_LATENCY_PROBE)
+		if (*last_packet_size >= 4) {
+			Audio_InjectMarker(Audio, start);
+		}
+#endif
+		address = Audio_GetISOBufferAddress(Audio, *last_packet_size);
+		cycles = DWT->CYCCNT - start;
+		if (cycles > Audio->IsoMaxCycles) {
+			Audio->IsoMaxCycles = cycles;
+		}
+		return address;
+	}
+#if (AUDIO_CAPTURE_FUNCTION)
+	else if (EPNum == (ENDPOINT_DIR_IN | CAPTURE_STREAM_EPNUM)) {
+		return Capture_GetISOBufferAddress(corenum, last_packet_size);
 	}
+#endif
 	else {return 0; }
 }
 
+#if (AUDIO_TELEMETRY_CDC)
+/** Snapshot of one audio function for the telemetry channel. Min/max values restart here. */
+bool CALLBACK_Telemetry_Fill(uint8_t corenum, TELEMETRY_RECORD_T *Record)
+{
+	AUDIO_INSTANCE_T *Audio = Audio_FromPort(corenum);
+
+	if (Audio == NULL) {
+		return false;
+	}
+	if (Audio->Interface.State.InterfaceEnabled) {
+		Record->Flags |= TELEMETRY_FLAG_STREAMING;
+	}
+	if (Audio->DoubleSpeed) {
+		Record->Flags |= TELEMETRY_FLAG_RATE_UP;
+	}
+	Record->Flags |= (Board_Audio_GetCodec() << TELEMETRY_FLAG_CODEC_SHIFT) & TELEMETRY_FLAG_CODEC_MASK;
+	Record->SampleRate = Audio->SampleFrequency;
+	Record->RingSize = (uint16_t) Audio->BufferSize;
+	Record->RingFill = (uint16_t) Audio->Count;
+	Record->RingFillMin = (uint16_t) MIN(Audio->FillMin, Audio->BufferSize);
+	Record->RingFillMax = (uint16_t) Audio->FillMax;
+	Record->Underruns = Audio->Underruns;
+	Record->Overruns = Audio->Overruns;
+	Record->IsoPackets = Audio->IsoPackets;
+	Record->RateSwitches = Audio->RateSwitches;
+	Record->I2SIsrMaxCycles = Audio->I2SMaxCycles;
+	Record->IsoIsrMaxCycles = Audio->IsoMaxCycles;
+
+	Audio->FillMin = UINT32_MAX;
+	Audio->FillMax = 0;
+	Audio->I2SMaxCycles = 0;
+	Audio->IsoMaxCycles = 0;
+	return true;
+}
+#endif
+
+/** Port less variant of the ISO buffer callback, the ROM driver glue only serves USB0. */
+uint32_t CALLBACK_HAL_GetISOBufferAddress(const uint32_t EPNum, uint32_t *last_packet_size)
+{
+	return CALLBACK_HAL_GetPortISOBufferAddress(0, EPNum, last_packet_size);
+}
+
+#if defined(USB_DEVICE_ROM_DRIVER)
+/** Fill level deviation, in stereo frames, that moves the feedback by Nominal/4096 */
+#define AUDIO_FEEDBACK_GAIN_SHIFT   12
+/** Largest feedback correction, Nominal/128 or about 0.8% */
+#define AUDIO_FEEDBACK_LIMIT_SHIFT  7
+
+/** Explicit feedback for the ROM driver ISO IN endpoint. Asks the host for more
+ *  samples while the ring is below half full and fewer while above, so the I2S
+ *  rate switching in Audio_I2SService() only has to catch large excursions.
+ */
+uint32_t CALLBACK_UsbdAdc_GetFeedbackValue(uint32_t Nominal)
+{
+	const AUDIO_INSTANCE_T *Audio = &Audio_Instance[0];
+	int32_t error, correction, limit;
+
+	if (Audio->BufferSize == 0) {
+		return Nominal;
+	}
+	error = ((int32_t) (Audio->BufferSize / 2) - (int32_t) Audio->Count) / 4;
+	correction = error * (int32_t) (Nominal >> AUDIO_FEEDBACK_GAIN_SHIFT);
+	limit = (int32_t) (Nominal >> AUDIO_FEEDBACK_LIMIT_SHIFT);
+	if (correction > limit) {
+		correction = limit;
+	}
+	else if (correction < -limit) {
+		correction = -limit;
+	}
+	return (uint32_t) ((int32_t) Nominal + correction);
+}
+#endif
+
+/** Handles one event posted from interrupt context. Runs in the main loop, so the
+ *  blocking control request code and the I2S reconfiguration never execute
+ *  inside an interrupt handler.
+ */
+static void Audio_DispatchEvent(const APP_EVENT_T *Event)
+{
+	AUDIO_INSTANCE_T *Audio = Audio_FromPort(Event->Port);
+#if !defined(USB_DEVICE_ROM_DRIVER)
+	uint32_t i;
+#endif
+
+	switch (Event->Id) {
+	case APP_EVENT_AUDIO_RATE_CHANGE:
+		if (Audio != NULL) {
+			Audio_Stop(Audio);
+			Audio_Start(Audio);
+		}
+		break;
+
+#if !defined(USB_DEVICE_ROM_DRIVER)
+	case APP_EVENT_USB_SETUP:
+	case APP_EVENT_USB_XFER_COMPLETE:
+		if (Audio != NULL) {
+			Audio_ServicePort = Event->Port;
+			Audio_Device_USBTask(&Audio->Interface);
+			USB_USBTask(Event->Port, USB_MODE_Device);
+#if (AUDIO_TELEMETRY_CDC)
+			Telemetry_Task(Event->Port);
+#endif
+#if (AUDIO_MIDI_FUNCTION)
+			Midi_Task(Event->Port);
+#endif
+#if (AUDIO_MSC_FUNCTION)
+			MassStorage_Task(Event->Port);
+#endif
+#if (AUDIO_RNDIS_FUNCTION)
+			Network_Task(Event->Port);
+#endif
+		}
+		break;
+
+	case APP_EVENT_OVERFLOW:
+		/* Events were lost, the port is unknown: service every controller */
+		for (i = 0; i < AUDIO_INSTANCE_COUNT; i++) {
+			Audio_ServicePort = Audio_Instance[i].Interface.Config.PortNumber;
+			Audio_Device_USBTask(&Audio_Instance[i].Interface);
+			USB_USBTask(Audio_ServicePort, USB_MODE_Device);
+#if (AUDIO_TELEMETRY_CDC)
+			Telemetry_Task(Audio_ServicePort);
+#endif
+#if (AUDIO_MIDI_FUNCTION)
+			Midi_Task(Audio_ServicePort);
+#endif
+#if (AUDIO_MSC_FUNCTION)
+			MassStorage_Task(Audio_ServicePort);
+#endif
+#if (AUDIO_RNDIS_FUNCTION)
+			Network_Task(Audio_ServicePort);
+#endif
+		}
+		break;
+
+#if (AUDIO_TELEMETRY_CDC)
+	case APP_EVENT_TELEMETRY:
+		Telemetry_Send(Event->Port);
+		break;
+#endif
+#if (AUDIO_RNDIS_FUNCTION)
+	case APP_EVENT_NETWORK:
+		Network_Task(Event->Port);
+		break;
+#endif
+#endif
+
+	default:
+		break;
+	}
+}
+
 /** Main program entry point. This routine contains the overall program flow, including initial
  *  setup of all components and the main program loop.
  */
 int main(void)
 {
-	I2S_AUDIO_FORMAT_T audio_Confg;
+	uint32_t i;
 
 	SetupHardware();
+	Timebase_Init(AUDIO_TIMEBASE_PORT);
+#if (AUDIO_CAPTURE_FUNCTION)
+	Capture_Init();
+#endif
+#if (AUDIO_RNDIS_FUNCTION)
+	Network_Init();
+#endif
+	/* Large moves, the mass storage sectors, run on a DMA channel */
+	DMA_Copy_Init();
 	printf("\r\nAudio Output Device\r\n");
+	BootProfile_Print(true);
+#if (AUDIO_COPY_BENCH)
+	CopyBench_Run();
+#endif
+#if (AUDIO_LAYOUT_BENCH)
+	LayoutBench_Run();
+#endif
 	//Board_UARTPutChar('*');
 
 /*
@@ -400,14 +753,14 @@ int main(void)
 #endif
 
 	int32_t i, j;
-	char * dev_des = (char*)&DeviceDescriptor;
+	const char * dev_des = (const char*)&DeviceDescriptor;
 	for (i = 0; i < sizeof(USB_Descriptor_Device_t); i++)
 	{
 		printf("0x%02x ", dev_des[i]);
 	}
 	printf("\r\n");
 
-	char * conf_des = (char*)&ConfigurationDescriptor;
+	const char * conf_des = (const char*)&ConfigurationDescriptor;
 	for (i = 0, j = conf_des[0]; i < sizeof(USB_Descriptor_Configuration_t); i++)
 	{
 		printf("0x%02x ", conf_des[i]);
@@ -420,55 +773,49 @@ int main(void)
 	printf("\r\n");
 */
 
-	audio_Confg.ChannelNumber = 2;	//stereo
-	audio_Confg.WordWidth = 16;	//16 bits
-	/* Build I2S config table */
-	audio_Confg.SampleRate = 8000;
-	I2S_RateFind(LPC_I2S0, &audio_Confg, &I2S_SpeedConfig[0]);
-	audio_Confg.SampleRate = 11025;
-	I2S_RateFind(LPC_I2S0, &audio_Confg, &I2S_SpeedConfig[1]);
-	audio_Confg.SampleRate = 16000;
-	I2S_RateFind(LPC_I2S0, &audio_Confg, &I2S_SpeedConfig[2]);
-	audio_Confg.SampleRate = 22050;
-	I2S_RateFind(LPC_I2S0, &audio_Confg, &I2S_SpeedConfig[3]);
-	audio_Confg.SampleRate = 32000;
-	I2S_RateFind(LPC_I2S0, &audio_Confg, &I2S_SpeedConfig[4]);
-	/* Although the founded rate is very accuracy,
-	the XTAL doesn't always match its frequency.
-	Increase the sample rate a little bit will really meet the USB speed. */
-#if defined(__LPC43XX__ )
-	audio_Confg.SampleRate = 44101; /* a bit higher for 204Mhz device */
-#else
-	audio_Confg.SampleRate = 44100;
-#endif
-	I2S_RateFind(LPC_I2S0, &audio_Confg, &I2S_SpeedConfig[5]);
-#if defined(__LPC43XX__ )
-	audio_Confg.SampleRate = 48001; /* a bit higher for 204Mhz device */
-#else
-	audio_Confg.SampleRate = 48000;
-#endif
-	I2S_RateFind(LPC_I2S0, &audio_Confg, &I2S_SpeedConfig[6]);
+	/* Tune the I2S dividers of every advertised rate on the clock actually present */
+	BootProfile_Mark(BOOT_CHECKPOINT_CONSOLE);
+	AudioRates_Init();
+	BootProfile_Mark(BOOT_CHECKPOINT_RATES);
 
 #if defined(USB_DEVICE_ROM_DRIVER)
-	UsbdAdc_Init(&Speaker_Audio_Interface);
+	UsbdAdc_Init(&Audio_Instance[0].Interface);
 #endif
 
-	Audio_Init(CurrentAudioSampleFrequency);
+	for (i = 0; i < AUDIO_INSTANCE_COUNT; i++) {
+		Audio_Start(&Audio_Instance[i]);
+	}
+	BootProfile_Mark(BOOT_CHECKPOINT_AUDIO_START);
 
 	for (;;)
 	{
-#if !defined(USB_DEVICE_ROM_DRIVER)
-		Audio_Device_USBTask(&Speaker_Audio_Interface);
-		USB_USBTask(Speaker_Audio_Interface.Config.PortNumber,USB_MODE_Device);
-#endif
+		APP_EVENT_T Event;
+
+		while (AppEvent_Get(&Event)) {
+			TRACE_PROBE_ENTER(APP_TRACE_EVENT, (Event.Port << 8) | Event.Id);
+			Audio_DispatchEvent(&Event);
+			TRACE_PROBE_EXIT(APP_TRACE_EVENT, (Event.Port << 8) | Event.Id);
+		}
+		/* No sleeping while the codec bring-up has steps left, each one is short */
+		if (!Audio_CodecTask()) {
+			TRACE_PROBE_ENTER(APP_TRACE_SLEEP, 0);
+			AppEvent_WaitForEvent();
+			TRACE_PROBE_EXIT(APP_TRACE_SLEEP, 0);
+		}
 	}
 }
 
 /** Configures the board hardware and chip peripherals for the demo's functionality. */
 void SetupHardware(void)
 {
+	uint32_t i;
+
 	Board_Init();
-	USB_Init(Speaker_Audio_Interface.Config.PortNumber, USB_MODE_Device);
+	BootProfile_Mark(BOOT_CHECKPOINT_BOARD_INIT);
+	for (i = 0; i < AUDIO_INSTANCE_COUNT; i++) {
+		USB_Init(Audio_Instance[i].Interface.Config.PortNumber, USB_MODE_Device);
+	}
+	BootProfile_Mark(BOOT_CHECKPOINT_USB_INIT);
 }
 
 #if !defined(USB_DEVICE_ROM_DRIVER)
@@ -490,31 +837,142 @@ void EVENT_USB_Device_ConfigurationChanged(void)
 	//printf("%s()\r\n", __FUNCTION__);
 
 	bool ConfigSuccess = true;
+	AUDIO_INSTANCE_T *Audio = Audio_FromPort(Audio_ServicePort);
 
-	ConfigSuccess &= Audio_Device_ConfigureEndpoints(&Speaker_Audio_Interface);
+	BootProfile_Mark(BOOT_CHECKPOINT_CONFIGURED);
+	if (Audio != NULL) {
+		ConfigSuccess &= Audio_Device_ConfigureEndpoints(&Audio->Interface);
+#if (AUDIO_CAPTURE_FUNCTION)
+		ConfigSuccess &= Capture_ConfigureEndpoints(Audio_ServicePort);
+#endif
+#if (AUDIO_TELEMETRY_CDC)
+		ConfigSuccess &= Telemetry_ConfigureEndpoints(Audio_ServicePort);
+#endif
+#if (AUDIO_MIDI_FUNCTION)
+		ConfigSuccess &= Midi_ConfigureEndpoints(Audio_ServicePort);
+#endif
+#if (AUDIO_MSC_FUNCTION)
+		ConfigSuccess &= MassStorage_ConfigureEndpoints(Audio_ServicePort);
+#endif
+#if (AUDIO_RNDIS_FUNCTION)
+		ConfigSuccess &= Network_ConfigureEndpoints(Audio_ServicePort);
+#endif
+	}
 
 	//	LEDs_SetAllLEDs(ConfigSuccess ? LEDMASK_USB_READY : LEDMASK_USB_ERROR);
 }
 
-/** Event handler for the library USB Control Request reception event. */
+/** Event handler for the USB start of frame, latches the bus timebase. */
+void EVENT_USB_Device_PortStartOfFrame(uint8_t corenum)
+{
+	if (corenum == AUDIO_TIMEBASE_PORT) {
+		Timebase_SOF();
+	}
+#if (AUDIO_TELEMETRY_CDC)
+	Telemetry_SOF(corenum);
+#endif
+#if (AUDIO_MIDI_FUNCTION)
+	Midi_SOF(corenum);
+#endif
+#if (AUDIO_RNDIS_FUNCTION)
+	Network_SOF(corenum);
+#endif
+}
+
+/** Event handler for the SETUP packet reception, called from the USB interrupt. */
+void EVENT_USB_Device_SetupReceived(uint8_t corenum)
+{
+	AppEvent_Post(APP_EVENT_USB_SETUP, corenum, 0);
+}
+
+/** Event handler for the transfer complete event, called from the USB interrupt.
+ *  The isochronous streams are serviced entirely by CALLBACK_HAL_GetPortISOBufferAddress()
+ *  and telemetry and MIDI transmits by their class driver engines, so only control and other endpoints
+ *  wake the main loop.
+ */
+void EVENT_USB_Device_PortTransferComplete(uint8_t corenum, int logicalEP, int xfer_in)
+{
+#if (AUDIO_TELEMETRY_CDC)
+	if (Telemetry_TransferComplete(corenum, logicalEP, xfer_in)) {
+		return;
+	}
+#endif
+#if (AUDIO_MIDI_FUNCTION)
+	if (Midi_TransferComplete(corenum, logicalEP, xfer_in)) {
+		return;
+	}
+#endif
+#if (AUDIO_MSC_FUNCTION)
+	/* The engine already queued the next buffer, the event lets the main loop refill it */
+	MassStorage_TransferComplete(corenum, logicalEP, xfer_in);
+#endif
+#if (AUDIO_RNDIS_FUNCTION)
+	/* Same for the frame engine, the main loop hands received frames to the sink */
+	Network_TransferComplete(corenum, logicalEP, xfer_in);
+#endif
+	if (logicalEP != AUDIO_STREAM_EPNUM) {
+		AppEvent_Post(APP_EVENT_USB_XFER_COMPLETE,
+					  corenum,
+					  (uint16_t) (logicalEP | (xfer_in ? ENDPOINT_DIR_IN : ENDPOINT_DIR_OUT)));
+	}
+}
+
+/** Event handler for the library USB Control Request reception event. The request
+ *  belongs to the port whose device task is running.
+ */
 void EVENT_USB_Device_ControlRequest(void)
 {
+	AUDIO_INSTANCE_T *Audio = Audio_FromPort(Audio_ServicePort);
+
 	//printf("%s()\r\n", __FUNCTION__);
-	Audio_Device_ProcessControlRequest(&Speaker_Audio_Interface);
+	if (Audio != NULL) {
+#if (AUDIO_TELEMETRY_CDC)
+		/* CDC first: it only takes requests for its own interface number */
+		Telemetry_ProcessControlRequest(Audio_ServicePort);
+#endif
+#if (AUDIO_MIDI_FUNCTION)
+		Midi_ProcessControlRequest(Audio_ServicePort);
+#endif
+#if (AUDIO_MSC_FUNCTION)
+		MassStorage_ProcessControlRequest(Audio_ServicePort);
+#endif
+#if (AUDIO_RNDIS_FUNCTION)
+		Network_ProcessControlRequest(Audio_ServicePort);
+#endif
+		Audio_Device_ProcessControlRequest(&Audio->Interface);
+#if (AUDIO_CAPTURE_FUNCTION)
+		/* Only SET_INTERFACE and endpoint requests of the capture stream are left by then */
+		Capture_ProcessControlRequest(Audio_ServicePort);
+#endif
+	}
 }
 
 void EVENT_Audio_Device_StreamStartStop(USB_ClassInfo_Audio_Device_t *const AudioInterfaceInfo)
 {
 	//printf("%s(%s)\r\n", __FUNCTION__, AudioInterfaceInfo->State.InterfaceEnabled == true ? "Start":"Stop");
+	AUDIO_INSTANCE_T *Audio = Audio_FromPort(AudioInterfaceInfo->Config.PortNumber);
+
+#if (AUDIO_CAPTURE_FUNCTION)
+	if (Capture_StreamStartStop(AudioInterfaceInfo)) {
+		return;
+	}
+#endif
+	if (Audio == NULL) {
+		return;
+	}
 	/* reset audio buffer */
-	Audio_Reset_Data_Buffer();
-	if (AudioInterfaceInfo->State.InterfaceEnabled == true)
-		MAX98357A_Enable();
-	else
-		MAX98357A_Disable();
+	Audio_ResetRing(Audio);
+	if (AudioInterfaceInfo->State.InterfaceEnabled == true) {
+		BootProfile_Mark(BOOT_CHECKPOINT_STREAMING);
+	}
+	if (Audio->Sink != NULL) {
+		Audio->Sink->SetPower(AudioInterfaceInfo->State.InterfaceEnabled);
+	}
 }
+#endif
 
 #ifndef USB_AUDIO_2DOT0
+#if !defined(USB_DEVICE_ROM_DRIVER)
 /** Audio class driver callback for the setting and retrieval of streaming endpoint properties. This callback must be implemented
  *  in the user application to handle property manipulations on streaming audio endpoints.
  */
@@ -525,10 +983,16 @@ bool CALLBACK_Audio_Device_GetSetEndpointProperty(USB_ClassInfo_Audio_Device_t *
 												  uint16_t *const DataLength,
 												  uint8_t *Data)
 {
+	AUDIO_INSTANCE_T *Audio = Audio_FromPort(AudioInterfaceInfo->Config.PortNumber);
+
 	//printf("%s()\r\n", __FUNCTION__);
 
+	if (Audio == NULL) {
+		return false;
+	}
+
 	/* Check the requested endpoint to see if a supported endpoint is being manipulated */
-	if (EndpointAddress == (ENDPOINT_DIR_OUT | Speaker_Audio_Interface.Config.DataOUTEndpointNumber)) {
+	if (EndpointAddress == (ENDPOINT_DIR_OUT | AudioInterfaceInfo->Config.DataOUTEndpointNumber)) {
 		/* Check the requested control to see if a supported control is being manipulated */
 		if (EndpointControl == AUDIO_EPCONTROL_SamplingFreq) {
 			switch (EndpointProperty) {
@@ -536,13 +1000,13 @@ bool CALLBACK_Audio_Device_GetSetEndpointProperty(USB_ClassInfo_Audio_Device_t *
 				/* Check if we are just testing for a valid property, or actually adjusting it */
 				if (DataLength != NULL) {
 					/* Set the new sampling frequency to the value given by the host */
-					CurrentAudioSampleFrequency =
+					uint32_t rate =
 						(((uint32_t) Data[2] << 16) | ((uint32_t) Data[1] << 8) | (uint32_t) Data[0]);
-					if (CurrentAudioSampleFrequency > AUDIO_MAX_SAMPLE_FREQ) {
+					if (AudioRates_Find(rate) == NULL) {
 						return false;
 					}
-					Audio_DeInit();
-					Audio_Init(CurrentAudioSampleFrequency);
+					Audio->SampleFrequency = rate;
+					AppEvent_Post(APP_EVENT_AUDIO_RATE_CHANGE, AudioInterfaceInfo->Config.PortNumber, 0);
 				}
 
 				return true;
@@ -552,9 +1016,9 @@ bool CALLBACK_Audio_Device_GetSetEndpointProperty(USB_ClassInfo_Audio_Device_t *
 				if (DataLength != NULL) {
 					*DataLength = 3;
 
-					Data[2] = (CurrentAudioSampleFrequency >> 16);
-					Data[1] = (CurrentAudioSampleFrequency >> 8);
-					Data[0] = (CurrentAudioSampleFrequency &  0xFF);
+					Data[2] = (Audio->SampleFrequency >> 16);
+					Data[1] = (Audio->SampleFrequency >> 8);
+					Data[0] = (Audio->SampleFrequency &  0xFF);
 				}
 
 				return true;
@@ -564,89 +1028,242 @@ bool CALLBACK_Audio_Device_GetSetEndpointProperty(USB_ClassInfo_Audio_Device_t *
 
 	return false;
 }
+#endif
 #else
-/** Audio class driver callback for the setting and retrieval of streaming properties. This callback must be implemented
- *  in the user application to handle property manipulations on streaming audio properties.
+/* The USB ROM driver glue answers the Audio 2.0 class requests through
+ * CALLBACK_Audio_Device_GetSetProperty() as well, so this part serves both stacks.
  */
-bool CALLBACK_Audio_Device_GetSetProperty(USB_ClassInfo_Audio_Device_t *const AudioInterfaceInfo,
-										  const uint8_t RequestType,
-										  const uint8_t Request,
-										  const uint8_t Control,
-										  uint16_t *const DataLength,
-										  uint8_t *Data)
+
+/** Makes the function follow the clock source picked by the clock selector. A new rate
+ *  restarts the I2S port on the divider set of that rate, the host sees no re-enumeration.
+ */
+static void Audio_FollowClock(AUDIO_INSTANCE_T *Audio)
 {
-	//printf("%s(0x%02x, 0x%02x, 0x%02x)\r\n", __FUNCTION__, RequestType, Request, Control);
+	uint32_t rate = Audio->ClockFrequency[Audio->ClockSource];
 
-	if ((RequestType & CONTROL_REQTYPE_TYPE) == REQTYPE_CLASS)
+	if (rate != Audio->SampleFrequency) {
+		Audio->SampleFrequency = rate;
+		AppEvent_Post(APP_EVENT_AUDIO_RATE_CHANGE, Audio->Interface.Config.PortNumber, 0);
+		//printf("Audio Sample Frequency: %dHz\r\n", Audio->SampleFrequency);
+	}
+}
+
+/** Clock selector requests: the current pin is 1 for the 48 kHz family, 2 for the 44.1 kHz family */
+static bool Audio_ClockSelectorProperty(AUDIO_INSTANCE_T *Audio,
+										const uint8_t RequestType,
+										const uint8_t Request,
+										const uint8_t Control,
+										uint16_t *const DataLength,
+										uint8_t *Data)
+{
+	if ((Control != AUDIO_CX_CLOCK_SELECTOR_CONTROL) || (Request != AUDIO_REQ_Cur)) {
+		return false;
+	}
+	if (RequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE))
 	{
-		switch (Control)
+		if ( (DataLength != NULL) && (Data != NULL) )
 		{
-		case AUDIO_CS_SAM_FREQ_CONTROL:
-			switch (Request)
+			if ((Data[0] == 0) || (Data[0] > AUDIO_CLOCK_SOURCES)) {
+				return false;
+			}
+			Audio->ClockSource = Data[0] - 1;
+			Audio_FollowClock(Audio);
+		}
+		return true;
+	}
+	if ( (DataLength != NULL) && (Data != NULL) )
+	{
+		*DataLength = 1;
+		Data[0] = Audio->ClockSource + 1;
+		return true;
+	}
+	return false;
+}
+
+/** Clock source requests of one family: its sampling frequency, the rates it offers and its validity */
+static bool Audio_ClockSourceProperty(AUDIO_INSTANCE_T *Audio,
+									  const uint8_t Source,
+									  const uint8_t RequestType,
+									  const uint8_t Request,
+									  const uint8_t Control,
+									  uint16_t *const DataLength,
+									  uint8_t *Data)
+{
+	switch (Control)
+	{
+	case AUDIO_CS_SAM_FREQ_CONTROL:
+		switch (Request)
+		{
+		case AUDIO_REQ_Cur:
+			if (RequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE))
 			{
-			case AUDIO_REQ_Cur:
-				if (RequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE))
+				if ( (DataLength != NULL) && (Data != NULL) )
 				{
-					if ( (DataLength != NULL) && (Data != NULL) )
-					{
-						CurrentAudioSampleFrequency =
-							( ((uint32_t) Data[3] << 24) | ((uint32_t) Data[2] << 16) | ((uint32_t) Data[1] << 8) | (uint32_t) Data[0] );
-						if (CurrentAudioSampleFrequency > AUDIO_MAX_SAMPLE_FREQ) {
-							return false;
-						}
-						Audio_DeInit();
-						Audio_Init(CurrentAudioSampleFrequency);
-						//printf("Audio Sample Frequency: %dHz\r\n", CurrentAudioSampleFrequency);
+					uint32_t rate =
+						( ((uint32_t) Data[3] << 24) | ((uint32_t) Data[2] << 16) | ((uint32_t) Data[1] << 8) | (uint32_t) Data[0] );
+					const AUDIO_RATE_T *entry = AudioRates_Find(rate);
+
+					if ((entry == NULL) || (entry->Source != Source)) {
+						return false;
 					}
-					return true;
-				}
-				else if (RequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE))
-				{
-					if ( (DataLength != NULL) && (Data != NULL) )
-					{
-						*DataLength = sizeof(CurrentAudioSampleFrequency);
-						Data[0] = (uint8_t) ((CurrentAudioSampleFrequency & 0x000000ff) >>  0);
-						Data[1] = (uint8_t) ((CurrentAudioSampleFrequency & 0x0000ff00) >>  8);
-						Data[2] = (uint8_t) ((CurrentAudioSampleFrequency & 0x00ff0000) >> 16);
-						Data[3] = (uint8_t) ((CurrentAudioSampleFrequency & 0xff000000) >> 24);
-						return true;
+					Audio->ClockFrequency[Source] = rate;
+					if (Source == Audio->ClockSource) {
+						Audio_FollowClock(Audio);
 					}
 				}
-				break;
-			case AUDIO_REQ_Range:
-				if (RequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE))
+				return true;
+			}
+			else if (RequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE))
+			{
+				if ( (DataLength != NULL) && (Data != NULL) )
 				{
-					Get_USB_Control_Ranges(DataLength, Data);
+					*DataLength = sizeof(Audio->ClockFrequency[Source]);
+					Data[0] = (uint8_t) ((Audio->ClockFrequency[Source] & 0x000000ff) >>  0);
+					Data[1] = (uint8_t) ((Audio->ClockFrequency[Source] & 0x0000ff00) >>  8);
+					Data[2] = (uint8_t) ((Audio->ClockFrequency[Source] & 0x00ff0000) >> 16);
+					Data[3] = (uint8_t) ((Audio->ClockFrequency[Source] & 0xff000000) >> 24);
 					return true;
 				}
-				break;
-			case AUDIO_REQ_Mem:
-				break;
 			}
 			break;
-		case AUDIO_CS_CLOCK_VALID:
-			switch (Request)
+		case AUDIO_REQ_Range:
+			if (RequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE))
 			{
-			case AUDIO_REQ_Cur:
-				if (RequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE))
-				{
-					*DataLength = 1;
-					Data[0] = 0x01;
-					return true;
-				}
-				break;
-			case AUDIO_REQ_Range:
-			case AUDIO_REQ_Mem:
+				AudioRates_GetRanges(Source, DataLength, Data);
+				return true;
+			}
+			break;
+		case AUDIO_REQ_Mem:
+			break;
+		}
+		break;
+	case AUDIO_CS_CLOCK_VALID:
+		switch (Request)
+		{
+		case AUDIO_REQ_Cur:
+			if (RequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE))
+			{
+				*DataLength = 1;
+				Data[0] = 0x01;
+				return true;
+			}
+			break;
+		case AUDIO_REQ_Range:
+		case AUDIO_REQ_Mem:
+			break;
+		}
+		break;
+	}
+
+	return false;
+}
+
+/** Feature unit requests: mute and volume of the master channel, over the range in AudioSink.h */
+static bool Audio_FeatureUnitProperty(AUDIO_INSTANCE_T *Audio,
+									  const uint8_t RequestType,
+									  const uint8_t Request,
+									  const uint8_t Control,
+									  uint16_t *const DataLength,
+									  uint8_t *Data)
+{
+	bool set = (RequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE));
+	USB_Cntrl_Ranges_2 reply;
+	int16_t volume;
+
+	switch (Control)
+	{
+	case AUDIO_FU_MUTE_CONTROL:
+		if (Request != AUDIO_REQ_Cur) {
+			break;
+		}
+		if (set)
+		{
+			if ( (DataLength != NULL) && (Data != NULL) )
+			{
+				Audio->Mute = (Data[0] != 0);
+				Audio_ApplyGain(Audio);
+			}
+			return true;
+		}
+		if ( (DataLength != NULL) && (Data != NULL) )
+		{
+			*DataLength = 1;
+			Data[0] = Audio->Mute;
+			return true;
+		}
+		break;
+	case AUDIO_FU_VOLUME_CONTROL:
+		if (Request == AUDIO_REQ_Range)
+		{
+			if (set || (DataLength == NULL) || (Data == NULL)) {
 				break;
 			}
+			reply.numranges = 1;
+			reply.ranges[0].min = AUDIO_SINK_VOLUME_MIN;
+			reply.ranges[0].max = AUDIO_SINK_VOLUME_MAX;
+			reply.ranges[0].res = AUDIO_SINK_VOLUME_RES;
+			*DataLength = MIN(*DataLength, sizeof(reply));
+			memcpy(Data, &reply, *DataLength);
+			return true;
+		}
+		if (Request != AUDIO_REQ_Cur) {
 			break;
 		}
+		if (set)
+		{
+			if ( (DataLength != NULL) && (Data != NULL) )
+			{
+				/* Out of range values, 0x8000 (silence) included, are clamped */
+				volume = (int16_t) (Data[0] | (Data[1] << 8));
+				Audio->Volume = MAX(MIN(volume, AUDIO_SINK_VOLUME_MAX), AUDIO_SINK_VOLUME_MIN);
+				Audio_ApplyGain(Audio);
+			}
+			return true;
+		}
+		if ( (DataLength != NULL) && (Data != NULL) )
+		{
+			*DataLength = 2;
+			Data[0] = (uint8_t) ((uint16_t) Audio->Volume & 0xFF);
+			Data[1] = (uint8_t) ((uint16_t) Audio->Volume >> 8);
+			return true;
+		}
+		break;
 	}
 
 	return false;
 }
-#endif
 
-#else
+/** Audio class driver callback for the setting and retrieval of streaming properties. This callback must be implemented
+ *  in the user application to handle property manipulations on streaming audio properties.
+ */
+bool CALLBACK_Audio_Device_GetSetProperty(USB_ClassInfo_Audio_Device_t *const AudioInterfaceInfo,
+										  const uint8_t RequestType,
+										  const uint8_t Request,
+										  const uint8_t EntityID,
+										  const uint8_t Control,
+										  uint16_t *const DataLength,
+										  uint8_t *Data)
+{
+	AUDIO_INSTANCE_T *Audio = Audio_FromPort(AudioInterfaceInfo->Config.PortNumber);
+
+	//printf("%s(0x%02x, 0x%02x, 0x%02x, 0x%02x)\r\n", __FUNCTION__, RequestType, Request, EntityID, Control);
+
+	if ((Audio == NULL) || ((RequestType & CONTROL_REQTYPE_TYPE) != REQTYPE_CLASS)) {
+		return false;
+	}
 
+	switch (EntityID)
+	{
+	case AUDIO_CLOCK_SELECTOR_ID:
+		return Audio_ClockSelectorProperty(Audio, RequestType, Request, Control, DataLength, Data);
+	case AUDIO_CLOCK_SOURCE_48K_ID:
+		return Audio_ClockSourceProperty(Audio, AUDIO_CLOCK_SOURCE_48K, RequestType, Request, Control, DataLength, Data);
+	case AUDIO_CLOCK_SOURCE_44K1_ID:
+		return Audio_ClockSourceProperty(Audio, AUDIO_CLOCK_SOURCE_44K1, RequestType, Request, Control, DataLength, Data);
+	case AUDIO_CONTROL_FEATURE_UNIT_ID:
+		return Audio_FeatureUnitProperty(Audio, RequestType, Request, Control, DataLength, Data);
+	}
+
+	return false;
+}
 #endif
@@ -34,6 +34,7 @@
 #define _AUDIO_OUTPUT_H_
 		#include "board.h"
 		#include "USB.h"
+		#include "trace_probe.h"
 		#include <stdlib.h>
 		#include "Descriptors.h"
 #ifdef __cplusplus
@@ -47,6 +48,72 @@ extern "C" {
  * enumerates as audio device (USB speakers) and sends the samples sent
  * to it from the host to the audio circuitry on the board.
  *
+ * Both USB controllers run an independent copy of the function: USB0 at high
+ * speed plays out on I2S0, USB1 at full speed plays out on I2S1. Each copy has
+ * its own ring buffer and its own rate control. The USB ROM driver build only
+ * serves USB0.
+ *
+ * With AUDIO_TELEMETRY_CDC=1, set in the Debug build configuration, a
+ * CDC-ACM function next to each audio function streams binary
+ * telemetry (ring fill, rate control state, interrupt timings, underruns).
+ * Decode it on Linux with example/tools/telemetry_decode.py /dev/ttyACMx.
+ * The same channel drives a latency probe that times marker frames from the
+ * bus to the I2S pins and, over a wired loopback, back to the capture stream;
+ * see example/tools/latency_probe.py, which also simulates the pipeline.
+ *
+ * With AUDIO_MIDI_FUNCTION=1, set in the Debug build configuration, USB0
+ * also carries a USB-MIDI function that echoes every event it receives,
+ * packing the replies into one bulk packet per (micro)frame.
+ *
+ * With AUDIO_MSC_FUNCTION=1, set in the Debug build configuration, USB0
+ * also carries a mass storage function backed by a RAM disk, whose data
+ * phase is pipelined over several sector buffers. Measure it on Linux with
+ * example/tools/msc_bench.py.
+ *
+ * Each audio function also has a capture stream (microphone, isochronous IN):
+ * the I2S receiver runs on the clocks of the transmitter, so capture stays
+ * sample locked to playback for echo cancellation on the host. Build with
+ * AUDIO_CAPTURE_FUNCTION=0 to leave it out.
+ *
+ * The UAC2 topology has one clock source per rate family (48 kHz and 44.1 kHz)
+ * behind a clock selector. Each family runs on I2S dividers tuned at boot
+ * around its exact nominal rates, and the host switches family through the
+ * selector without re-enumerating the device. Only the rates the I2S clock
+ * reaches within tolerance are offered and accepted, see AudioRates.h.
+ *
+ * The audio output is brought up in the background of the main loop while USB
+ * enumerates: a WM8904 codec is probed for on I2C with bounded retries, and
+ * without one the board plays through its MAX98357A amps. The console and the
+ * telemetry records report which one was found.
+ *
+ * The UAC2 feature unit offers the host a master mute and volume. They go to
+ * the audio sink of the output found (AudioSink.h): the WM8904 applies them in
+ * its DAC, for the MAX98357A the I2S refill scales the samples instead.
+ *
+ * Sector moves of the mass storage function run on a GPDMA channel of the DMA
+ * copy service. Build with AUDIO_COPY_BENCH=1 to time CPU and DMA moves across
+ * the SRAM banks at startup, see CopyBench.h.
+ *
+ * The I2S and USB interrupt paths run from local SRAM, and each DMA writer
+ * (USB0, USB1, the capture GPDMA) fills a ring in an AHB SRAM bank of its
+ * own, see MemoryLayout.h. Build with AUDIO_LAYOUT_BENCH=1 to time a model of
+ * the I2S interrupt for each placement at startup, see LayoutBench.h.
+ *
+ * Building with TRACE_PROBES=1 records the USB interrupt, the control
+ * requests, the I2S refill and the main loop events into a cycle stamped RAM
+ * trace (trace_probe.h). Dump it over the telemetry function and turn it into
+ * latency histograms and a timeline with example/tools/trace_decode.py.
+ *
+ * A boot profiler stamps checkpoints from the reset handler to the first
+ * sample played and keeps them in RAM across a warm reset. The console shows
+ * the previous boot at startup, and telemetry_decode.py -b reads either boot
+ * over the telemetry function, see BootProfile.h.
+ *
+ * Building with AUDIO_RNDIS_FUNCTION=1 replaces the MIDI and mass storage
+ * functions with an RNDIS network adapter whose frames are passed by
+ * descriptor between the USB controller and a loopback or Ethernet sink.
+ * Measure frames/s on Linux with example/tools/rndis_bench.py.
+ *
  * On the PC select Control Panel->Hardware and Sound->Sound
  * When the example is first run a new entry in the Sound dialog box
  * will appear titled Speakers and have a description that reads
@@ -99,6 +166,21 @@ extern "C" {
 /** LED mask for the library LED driver, to indicate that an error has occurred in the USB interface. */
 		#define LEDMASK_USB_ERROR        (LEDS_LED1 | LEDS_LED3)
 
+/**
+ * @brief Trace probe IDs of the application, see trace_probe.h
+ */
+/** Span: I2S refill interrupt, Arg = audio instance */
+		#define APP_TRACE_I2S            (TRACE_PROBE_ID_APP_BASE + 0)
+
+/** Point: ISO OUT packet handed to the ring, Arg = packet size in bytes */
+		#define APP_TRACE_ISO_PACKET     (TRACE_PROBE_ID_APP_BASE + 1)
+
+/** Span: main loop event dispatch, Arg = port << 8 | APP_EVENT_ID_T */
+		#define APP_TRACE_EVENT          (TRACE_PROBE_ID_APP_BASE + 2)
+
+/** Span: main loop asleep waiting for an event */
+		#define APP_TRACE_SLEEP          (TRACE_PROBE_ID_APP_BASE + 3)
+
 /**
  * @}
  */
@@ -122,6 +204,12 @@ void EVENT_USB_Device_ConfigurationChanged(void);
 
 void EVENT_USB_Device_ControlRequest(void);
 
+void EVENT_USB_Device_PortStartOfFrame(uint8_t corenum);
+
+void EVENT_USB_Device_SetupReceived(uint8_t corenum);
+
+void EVENT_USB_Device_PortTransferComplete(uint8_t corenum, int logicalEP, int xfer_in);
+
 /**
  * @}
  */
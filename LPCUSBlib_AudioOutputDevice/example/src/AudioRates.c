@@ -0,0 +1,263 @@
+/*
+ * @brief Sampling rate registry of the Audio Output Device
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+#include "AudioRates.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/** Rate control margin: I2S_RateFind places the RATEDOWN divider at least this far below the
+ *  nominal rate and the RATEUP divider at least this far above it, to cover the crystal
+ *  tolerance of both the host and the board. */
+#define AUDIO_CLOCK_TRIM_PPM    40
+
+/** Precomputed dividers of one rate */
+typedef struct {
+	uint32_t Rate;				/* Nominal sampling frequency in Hz */
+	int16_t DownPpm;			/* Deviation of RATEDOWN from the nominal rate */
+	int16_t UpPpm;				/* Deviation of RATEUP from the nominal rate */
+	I2S_RATE_CONFIG Divider;
+} I2S_DIVIDER_ENTRY_T;
+
+/** Precomputed dividers for one I2S clock */
+typedef struct {
+	uint32_t Clock;				/* CLK_APB1_I2S in Hz */
+	uint32_t Count;
+	const I2S_DIVIDER_ENTRY_T *Entries;
+} I2S_DIVIDER_TABLE_T;
+
+/* Generated by example/tools/i2s_dividers.py for the 180 MHz (18xx) and 204 MHz (43xx) clocks */
+#include "I2SDividers.h"
+
+#if (I2S_DIVIDERS_TRIM_PPM != AUDIO_CLOCK_TRIM_PPM) || (I2S_DIVIDERS_WORD_WIDTH != AUDIO_BIT_RESOLUTION)
+#error "I2SDividers.h is stale, regenerate it with example/tools/i2s_dividers.py"
+#endif
+
+#ifdef USB_AUDIO_2DOT0
+#define AUDIO_RATE_48K(Hz)      {.Rate = Hz, .Source = AUDIO_CLOCK_SOURCE_48K},
+#define AUDIO_RATE_44K1(Hz)     {.Rate = Hz, .Source = AUDIO_CLOCK_SOURCE_44K1},
+
+static AUDIO_RATE_T AudioRates[AUDIO_SAMPLE_RATE_COUNT] = {
+	AUDIO_SAMPLE_RATES_48K(AUDIO_RATE_48K)
+	AUDIO_SAMPLE_RATES_44K1(AUDIO_RATE_44K1)
+};
+#else
+#define AUDIO_RATE(Hz)          {.Rate = Hz},
+
+static AUDIO_RATE_T AudioRates[AUDIO_SAMPLE_RATE_COUNT] = {
+	AUDIO_SAMPLE_RATES(AUDIO_RATE)
+};
+#endif
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Precomputed dividers of a rate at the given I2S clock, NULL if the clock or the rate has none */
+static const I2S_DIVIDER_ENTRY_T *AudioRates_Lookup(uint32_t Clock, uint32_t Rate)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < sizeof(I2S_DividerTables) / sizeof(I2S_DividerTables[0]); i++) {
+		if (I2S_DividerTables[i].Clock != Clock) {
+			continue;
+		}
+		for (j = 0; j < I2S_DividerTables[i].Count; j++) {
+			if (I2S_DividerTables[i].Entries[j].Rate == Rate) {
+				return &I2S_DividerTables[i].Entries[j];
+			}
+		}
+	}
+	return NULL;
+}
+
+/* Deviation of the rate an X/Y divider produces from the nominal rate, in ppm */
+static int32_t AudioRates_Deviation(uint64_t pClk, uint32_t Rate, uint32_t N, uint8_t X, uint8_t Y)
+{
+	uint64_t target = (uint64_t) Rate * 2 * AUDIO_BIT_RESOLUTION * 2 * N;
+
+	return (int32_t) ((pClk * X * 1000000) / ((uint64_t) Y * target)) - 1000000;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* All bit rate dividers N are tried. For each one RATEDOWN is the fastest X/Y at least
+   AUDIO_CLOCK_TRIM_PPM below the nominal rate and RATEUP the slowest X/Y at least that far
+   above it. The N with the tightest pair wins, so the I2S clock brackets the exact nominal
+   rate and the rate control jitters as little as possible around it. */
+Status I2S_RateFind(LPC_I2S_T *I2Sx, I2S_AUDIO_FORMAT_T *audio_format, I2S_RATE_CONFIG *I2S_Config)
+{
+	uint64_t pClk, target;
+	uint64_t down, up, span, best = UINT64_MAX;
+	uint32_t N, x, y;
+	uint32_t xd = 0, yd = 0, xu = 0, yu = 0;
+
+	pClk = Chip_Clock_GetRate(CLK_APB1_I2S);
+
+	for (N = 1; N <= 64; N++) {
+		/* X/Y = target / pClk gives exactly the nominal rate with this N */
+		target = (uint64_t) audio_format->SampleRate * 2 * (audio_format->WordWidth) * 2 * N;
+		down = 0;
+		up = UINT64_MAX;
+		for (y = 1; y <= 255; y++) {
+			/* dividers are compared as 0.32 fixed point fractions */
+			x = (y * target * (1000000 - AUDIO_CLOCK_TRIM_PPM)) / (pClk * 1000000);
+			if ((x > 0) && (x <= y) && ((((uint64_t) x << 32) / y) > down)) {
+				down = ((uint64_t) x << 32) / y;
+				xd = x;
+				yd = y;
+			}
+			x = (y * target * (1000000 + AUDIO_CLOCK_TRIM_PPM) + pClk * 1000000 - 1) / (pClk * 1000000);
+			if ((x <= y) && ((((uint64_t) x << 32) / y) < up)) {
+				up = ((uint64_t) x << 32) / y;
+				xu = x;
+				yu = y;
+			}
+		}
+		if ((down == 0) || (up == UINT64_MAX)) {
+			continue;
+		}
+		/* spread of the pair relative to the nominal rate */
+		span = (up - down) * pClk / target;
+		if (span < best) {
+			best = span;
+			I2S_Config->BITRATE = N - 1;
+			I2S_Config->RATEUP.X = xu;
+			I2S_Config->RATEUP.Y = yu;
+			I2S_Config->RATEDOWN.X = xd;
+			I2S_Config->RATEDOWN.Y = yd;
+		}
+	}
+	if (best == UINT64_MAX) {
+		return ERROR;
+	}
+
+	//printf("audio_format->SampleRate: %d\r\n", audio_format->SampleRate);
+	//printf("I2S_Config->BITRATE: 0x%02x\r\n", I2S_Config->BITRATE);
+	//printf("I2S_Config->RATEUP.X: 0x%02x\r\n", I2S_Config->RATEUP.X);
+	//printf("I2S_Config->RATEUP.Y: 0x%02x\r\n", I2S_Config->RATEUP.Y);
+	//printf("I2S_Config->RATEDOWN.X: 0x%02x\r\n", I2S_Config->RATEDOWN.X);
+	//printf("I2S_Config->RATEDOWN.Y: 0x%02x\r\n", I2S_Config->RATEDOWN.Y);
+
+	return SUCCESS;
+}
+
+/* Fill the registry */
+uint32_t AudioRates_Init(void)
+{
+	I2S_AUDIO_FORMAT_T audio_Confg;
+	AUDIO_RATE_T *entry;
+	const I2S_DIVIDER_ENTRY_T *table;
+	uint64_t pClk = Chip_Clock_GetRate(CLK_APB1_I2S);
+	int32_t down, up;
+	uint32_t i, supported = 0;
+
+	audio_Confg.ChannelNumber = AUDIO_CHANNELS;
+	audio_Confg.WordWidth = AUDIO_BIT_RESOLUTION;
+	for (i = 0; i < AUDIO_SAMPLE_RATE_COUNT; i++) {
+		entry = &AudioRates[i];
+		audio_Confg.SampleRate = entry->Rate;
+		entry->Supported = false;
+		table = AudioRates_Lookup(pClk, entry->Rate);
+		if (table != NULL) {
+			entry->Divider = table->Divider;
+			down = table->DownPpm;
+			up = table->UpPpm;
+		}
+		else {
+			/* Clock without a generated table, search at run time */
+			if (I2S_RateFind(LPC_I2S0, &audio_Confg, &entry->Divider) != SUCCESS) {
+				continue;
+			}
+			down = AudioRates_Deviation(pClk, entry->Rate, entry->Divider.BITRATE + 1,
+										entry->Divider.RATEDOWN.X, entry->Divider.RATEDOWN.Y);
+			up = AudioRates_Deviation(pClk, entry->Rate, entry->Divider.BITRATE + 1,
+									  entry->Divider.RATEUP.X, entry->Divider.RATEUP.Y);
+		}
+		entry->DownPpm = down;
+		entry->UpPpm = up;
+		if ((-down > AUDIO_RATE_TOLERANCE_PPM) || (up > AUDIO_RATE_TOLERANCE_PPM)) {
+			continue;
+		}
+		/* Whole frames for AUDIO_MAX_PC ms, doubled so the rate control has room on both sides */
+		entry->BufferSize = ((entry->Rate * AUDIO_MAX_PC + 999) / 1000) * AUDIO_CHANNELS * AUDIO_SUBSLOT_SIZE * 2;
+		entry->Supported = true;
+		supported++;
+	}
+	return supported;
+}
+
+/* Look up a sampling rate */
+const AUDIO_RATE_T *AudioRates_Find(uint32_t Rate)
+{
+	uint32_t i;
+
+	for (i = 0; i < AUDIO_SAMPLE_RATE_COUNT; i++) {
+		if ((AudioRates[i].Rate == Rate) && AudioRates[i].Supported) {
+			return &AudioRates[i];
+		}
+	}
+	return NULL;
+}
+
+#ifdef USB_AUDIO_2DOT0
+/* Fill a RANGE reply */
+void AudioRates_GetRanges(uint8_t Source, uint16_t *DataLength, uint8_t *Data)
+{
+	USB_Cntrl_Ranges reply;
+	uint16_t Size;
+	uint32_t i;
+
+	if ( (DataLength == NULL) || (Data == NULL) ) {
+		return;
+	}
+	reply.numranges = 0;
+	for (i = 0; i < AUDIO_SAMPLE_RATE_COUNT; i++) {
+		if ((AudioRates[i].Source == Source) && AudioRates[i].Supported) {
+			reply.ranges[reply.numranges].min = AudioRates[i].Rate;
+			reply.ranges[reply.numranges].max = AudioRates[i].Rate;
+			reply.ranges[reply.numranges].res = 0;
+			reply.numranges++;
+		}
+	}
+	Size = sizeof(reply.numranges) + reply.numranges * sizeof(USB_Ctrl_Range);
+	if (*DataLength >= Size)
+		*DataLength = Size;
+	memcpy(Data, &reply, *DataLength);
+}
+#endif
@@ -0,0 +1,129 @@
+/*
+ * @brief Sampling rate registry of the Audio Output Device
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#ifndef _AUDIO_RATES_H_
+#define _AUDIO_RATES_H_
+
+#include "board.h"
+#include "Descriptors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_Rates Sampling rate registry
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * At boot every rate the descriptors advertise gets its dividers for the I2S
+ * clock actually present: from the tables example/tools/i2s_dividers.py
+ * generates for 180 and 204 MHz (I2SDividers.h, refreshed by a pre-build
+ * step), or from I2S_RateFind() on any other clock. A rate is kept only when
+ * both dividers the rate control switches between land within
+ * AUDIO_RATE_TOLERANCE_PPM of it. The kept rates answer the RANGE requests, gate SET CUR (anything else
+ * is stalled) and carry the divider set and ring size used to play them.
+ * @{
+ */
+
+/** Largest deviation of the RATEUP or RATEDOWN divider from the nominal rate */
+#define AUDIO_RATE_TOLERANCE_PPM    1000
+
+/** Audio max packet count: milliseconds of audio each half of the ring holds */
+#define AUDIO_MAX_PC                10
+
+/**
+ * @brief I2S dividers for one sampling rate
+ */
+typedef struct {
+	uint8_t BITRATE;		/*!< Bit rate divider N - 1 */
+	struct {
+		uint8_t X,Y;
+	} RATEUP;				/*!< Fractional divider a little above the nominal rate */
+	struct {
+		uint8_t X,Y;
+	} RATEDOWN;				/*!< Fractional divider a little below the nominal rate */
+} I2S_RATE_CONFIG;
+
+/**
+ * @brief One registry entry
+ */
+typedef struct {
+	uint32_t Rate;				/*!< Nominal sampling frequency in Hz */
+	uint8_t Source;				/*!< Clock source (rate family) serving the rate */
+	bool Supported;				/*!< Dividers found within AUDIO_RATE_TOLERANCE_PPM */
+	int16_t DownPpm;			/*!< Deviation of RATEDOWN from the nominal rate */
+	int16_t UpPpm;				/*!< Deviation of RATEUP from the nominal rate */
+	uint32_t BufferSize;		/*!< Working size of the playback ring in bytes */
+	I2S_RATE_CONFIG Divider;	/*!< Dividers programmed into the I2S port */
+} AUDIO_RATE_T;
+
+/**
+ * @brief	Finds the I2S divider pair the rate control switches between for one sampling rate
+ * @param	I2Sx			: I2S peripheral (unused, all ports share CLK_APB1_I2S)
+ * @param	audio_format	: Sampling rate and word width
+ * @param	I2S_Config		: Filled with BITRATE, RATEUP and RATEDOWN
+ * @return	SUCCESS, or ERROR when no pair brackets the rate
+ */
+Status I2S_RateFind(LPC_I2S_T *I2Sx, I2S_AUDIO_FORMAT_T *audio_format, I2S_RATE_CONFIG *I2S_Config);
+
+/**
+ * @brief	Fill the registry from the I2S clock, call once the clocks are set up
+ * @return	Number of supported rates
+ */
+uint32_t AudioRates_Init(void);
+
+/**
+ * @brief	Look up a sampling rate
+ * @param	Rate	: Sampling frequency in Hz
+ * @return	The registry entry, NULL if the rate is not advertised or not achievable
+ */
+const AUDIO_RATE_T *AudioRates_Find(uint32_t Rate);
+
+#ifdef USB_AUDIO_2DOT0
+/**
+ * @brief	Fills the reply to a sampling frequency RANGE request
+ * @param	Source		: AUDIO_CLOCK_SOURCE_48K or AUDIO_CLOCK_SOURCE_44K1
+ * @param	DataLength	: Room in Data on entry, length of the reply on return
+ * @param	Data		: Reply buffer
+ * @return	Nothing
+ * @note	Lists one discrete range per supported rate of the family.
+ */
+void AudioRates_GetRanges(uint8_t Source, uint16_t *DataLength, uint8_t *Data);
+#endif
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _AUDIO_RATES_H_ */
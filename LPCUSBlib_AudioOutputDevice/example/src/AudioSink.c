@@ -0,0 +1,213 @@
+/*
+ * @brief Audio sink backends and the software gain fallback
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#include "AudioSink.h"
+#include "max98357a.h"
+#include "wm8904.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/* Software gain in Q15 for 0 dB down to -60 dB, one entry per dB */
+#define AUDIO_SINK_GAIN_STEPS       ((AUDIO_SINK_VOLUME_MAX - AUDIO_SINK_VOLUME_MIN) / AUDIO_SINK_VOLUME_RES + 1)
+
+static const uint16_t AudioSink_GainTable[AUDIO_SINK_GAIN_STEPS] = {
+	32768, 29205, 26029, 23198, 20675, 18427, 16423, 14637,
+	13045, 11627, 10362, 9235, 8231, 7336, 6538, 5827,
+	5193, 4629, 4125, 3677, 3277, 2920, 2603, 2320,
+	2068, 1843, 1642, 1464, 1305, 1163, 1036, 924,
+	823, 734, 654, 583, 519, 463, 413, 368,
+	328, 292, 260, 232, 207, 184, 164, 146,
+	130, 116, 104, 92, 82, 73, 65, 58,
+	52, 46, 41, 37, 33,
+};
+
+/* One WM8904 DAC volume step is 0.375 dB, 96/256 dB */
+#define WM8904_SINK_STEP            96
+
+/* WM8904 mute requested by the host, and output powered for a stream: the DAC
+   soft mute covers both, the codec stays clocked so the ADC keeps running */
+static bool WM8904_SinkMuted;
+static bool WM8904_SinkPowered;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static bool MAX98357A_SinkInit(void)
+{
+	return MAX98357A_Init() == SUCCESS;
+}
+
+static bool MAX98357A_SinkSetRate(uint32_t Rate)
+{
+	/* The amp detects the rate from the I2S clocks */
+	return (Rate >= 8000) && (Rate <= 96000);
+}
+
+static bool MAX98357A_SinkSetFormat(uint8_t Channels, uint8_t Bits)
+{
+	/* 16 and 32 bit slots are detected from BCLK, 24 bit data rides in 32 bit slots */
+	return (Channels == 2) && ((Bits == 16) || (Bits == 24) || (Bits == 32));
+}
+
+static bool MAX98357A_SinkSetPower(bool On)
+{
+	return (On ? MAX98357A_Enable() : MAX98357A_Disable()) == 0;
+}
+
+static bool WM8904_SinkUpdateMute(void)
+{
+	return WM8904_SetMute(WM8904_SinkMuted || !WM8904_SinkPowered);
+}
+
+static bool WM8904_SinkInit(void)
+{
+	if (Board_Audio_GetCodec() != BOARD_AUDIO_CODEC_WM8904) {
+		return false;
+	}
+	WM8904_SinkMuted = false;
+	WM8904_SinkPowered = false;
+	return WM8904_SinkUpdateMute();
+}
+
+static bool WM8904_SinkSetRate(uint32_t Rate)
+{
+	return WM8904_SetRate(Rate);
+}
+
+static bool WM8904_SinkSetFormat(uint8_t Channels, uint8_t Bits)
+{
+	/* The register table sets up 16 bit stereo at 64 fs bit clock */
+	return (Channels == 2) && (Bits == 16);
+}
+
+static bool WM8904_SinkSetGain(int16_t Volume, bool Mute)
+{
+	/* Round to the nearest step below 0 dB, the lowest step above mute at worst */
+	int32_t steps = (-(int32_t) Volume + WM8904_SINK_STEP / 2) / WM8904_SINK_STEP;
+	int32_t vol = WM8904_DAC_VOL_0DB - steps;
+
+	if (vol < WM8904_DAC_VOL_MUTE + 1) {
+		vol = WM8904_DAC_VOL_MUTE + 1;
+	}
+	if (vol > WM8904_DAC_VOL_0DB) {
+		vol = WM8904_DAC_VOL_0DB;
+	}
+	WM8904_SinkMuted = Mute;
+	return WM8904_SetVolume((uint8_t) vol) && WM8904_SinkUpdateMute();
+}
+
+static bool WM8904_SinkSetPower(bool On)
+{
+	WM8904_SinkPowered = On;
+	return WM8904_SinkUpdateMute();
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* MAX98357A amps, group delay of the interpolation filter */
+const AUDIO_SINK_T AudioSink_MAX98357A = {
+	.Name = "MAX98357A",
+	.Caps = 0,
+	.LatencyFrames = 9,
+	.Init = MAX98357A_SinkInit,
+	.SetRate = MAX98357A_SinkSetRate,
+	.SetFormat = MAX98357A_SinkSetFormat,
+	.SetGain = NULL,
+	.SetPower = MAX98357A_SinkSetPower,
+};
+
+/* WM8904 codec, group delay of the DAC digital filters */
+const AUDIO_SINK_T AudioSink_WM8904 = {
+	.Name = "WM8904",
+	.Caps = AUDIO_SINK_CAP_VOLUME | AUDIO_SINK_CAP_MUTE,
+	.LatencyFrames = 16,
+	.Init = WM8904_SinkInit,
+	.SetRate = WM8904_SinkSetRate,
+	.SetFormat = WM8904_SinkSetFormat,
+	.SetGain = WM8904_SinkSetGain,
+	.SetPower = WM8904_SinkSetPower,
+};
+
+/* Sink of the codec found by the bring-up */
+const AUDIO_SINK_T *AudioSink_ForCodec(BOARD_AUDIO_CODEC_T Codec)
+{
+	switch (Codec) {
+	case BOARD_AUDIO_CODEC_WM8904:
+		return &AudioSink_WM8904;
+
+	case BOARD_AUDIO_CODEC_MAX98357A:
+		return &AudioSink_MAX98357A;
+
+	default:
+		return NULL;
+	}
+}
+
+/* Software gain left to apply once the sink did what it can */
+uint16_t AudioSink_SoftGain(const AUDIO_SINK_T *Sink, int16_t Volume, bool Mute)
+{
+	uint32_t caps = (Sink != NULL) ? Sink->Caps : 0;
+	int32_t index;
+
+	if (Mute && ((caps & AUDIO_SINK_CAP_MUTE) == 0)) {
+		return 0;
+	}
+	if (caps & AUDIO_SINK_CAP_VOLUME) {
+		return AUDIO_SINK_UNITY_GAIN;
+	}
+	index = (AUDIO_SINK_VOLUME_MAX - (int32_t) Volume + AUDIO_SINK_VOLUME_RES / 2) / AUDIO_SINK_VOLUME_RES;
+	if (index < 0) {
+		index = 0;
+	}
+	if (index >= AUDIO_SINK_GAIN_STEPS) {
+		index = AUDIO_SINK_GAIN_STEPS - 1;
+	}
+	return AudioSink_GainTable[index];
+}
+
+/* Delay a sink adds after the I2S pins */
+uint32_t AudioSink_LatencyUs(const AUDIO_SINK_T *Sink, uint32_t Rate)
+{
+	if ((Sink == NULL) || (Rate == 0)) {
+		return 0;
+	}
+	return (uint32_t) (((uint64_t) Sink->LatencyFrames * 1000000 + Rate / 2) / Rate);
+}
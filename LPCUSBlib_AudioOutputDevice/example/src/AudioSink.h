@@ -0,0 +1,142 @@
+/*
+ * @brief Audio sinks: the output stage behind an I2S port and its gain control
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#ifndef _AUDIO_SINK_H_
+#define _AUDIO_SINK_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_Sink Audio sinks
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * An audio sink is whatever turns the I2S stream of a function into sound:
+ * the MAX98357A amps or the WM8904 codec. Each backend fills an AUDIO_SINK_T
+ * with its operations, so the audio functions never touch a codec directly.
+ *
+ * Volume and mute come from the host through the feature unit, over one
+ * fixed range, AUDIO_SINK_VOLUME_MIN to AUDIO_SINK_VOLUME_MAX in 1/256 dB.
+ * A sink with AUDIO_SINK_CAP_VOLUME (or AUDIO_SINK_CAP_MUTE) applies it in
+ * hardware, the WM8904 DAC digital volume, and the samples pass untouched.
+ * Otherwise the I2S refill scales every sample by AudioSink_SoftGain(), and a
+ * unity gain skips the multiply.
+ *
+ * The WM8904 backend only queues its register writes on the I2C batch engine
+ * (i2c_batch.h), so a request from the USB control path returns without
+ * waiting on the bus and the audio interrupts are never held up by it.
+ *
+ * The sink is picked once the codec bring-up finished, until then, and on a
+ * function without an output stage, only the software gain applies.
+ * @{
+ */
+
+/** Sink capabilities */
+#define AUDIO_SINK_CAP_VOLUME       (1 << 0)	/**< Hardware volume, no software gain needed */
+#define AUDIO_SINK_CAP_MUTE         (1 << 1)	/**< Hardware mute */
+
+/** Volume range offered to the host, in 1/256 dB */
+#define AUDIO_SINK_VOLUME_MIN       (-60 * 256)
+#define AUDIO_SINK_VOLUME_MAX       0
+#define AUDIO_SINK_VOLUME_RES       256
+
+/** Software gain of 0 dB, Q15 */
+#define AUDIO_SINK_UNITY_GAIN       0x8000
+
+/**
+ * @brief Operations of one sink backend
+ */
+typedef struct {
+	const char *Name;
+	uint32_t Caps;					/*!< AUDIO_SINK_CAP_* */
+	uint16_t LatencyFrames;			/*!< Delay from the I2S pins to the output, in frames */
+	bool (*Init)(void);				/*!< Attach to the output stage, left muted and powered down */
+	bool (*SetRate)(uint32_t Rate);	/*!< Follow a new sample rate */
+	bool (*SetFormat)(uint8_t Channels, uint8_t Bits);	/*!< Check or set the I2S frame format */
+	bool (*SetGain)(int16_t Volume, bool Mute);	/*!< Hardware volume in 1/256 dB and mute, per Caps */
+	bool (*SetPower)(bool On);		/*!< Power the output stage up for a stream, down after it */
+} AUDIO_SINK_T;
+
+/** MAX98357A amps: SD_MODE power control, software gain */
+extern const AUDIO_SINK_T AudioSink_MAX98357A;
+
+/** WM8904 codec: DAC digital volume and soft mute */
+extern const AUDIO_SINK_T AudioSink_WM8904;
+
+/**
+ * @brief	Get the sink of the codec found by the bring-up
+ * @param	Codec	: Board_Audio_GetCodec() value
+ * @return	The sink, NULL while pending or when no output stage works
+ */
+const AUDIO_SINK_T *AudioSink_ForCodec(BOARD_AUDIO_CODEC_T Codec);
+
+/**
+ * @brief	Get the software gain to apply for a host volume
+ * @param	Sink	: Sink of the function, NULL if none
+ * @param	Volume	: Volume in 1/256 dB, clamped to the host range
+ * @param	Mute	: Muted by the host
+ * @return	Q15 gain, AUDIO_SINK_UNITY_GAIN when the sink does the work itself
+ */
+uint16_t AudioSink_SoftGain(const AUDIO_SINK_T *Sink, int16_t Volume, bool Mute);
+
+/**
+ * @brief	Get the delay a sink adds after the I2S pins
+ * @param	Sink	: Sink of the function, NULL if none
+ * @param	Rate	: Current sample rate
+ * @return	Delay in microseconds, 0 without a sink
+ */
+uint32_t AudioSink_LatencyUs(const AUDIO_SINK_T *Sink, uint32_t Rate);
+
+/**
+ * @brief	Scale one stereo frame of 16 bit samples
+ * @param	Frame	: Left sample in the low half, right sample in the high half
+ * @param	Gain	: Q15 gain, at most AUDIO_SINK_UNITY_GAIN
+ * @return	The scaled frame
+ */
+static INLINE uint32_t AudioSink_Scale(uint32_t Frame, uint16_t Gain)
+{
+	int32_t left = ((int32_t) (int16_t) Frame * Gain) >> 15;
+	int32_t right = ((int32_t) (int16_t) (Frame >> 16) * Gain) >> 15;
+
+	return ((uint32_t) right << 16) | ((uint32_t) left & 0xFFFF);
+}
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _AUDIO_SINK_H_ */
@@ -0,0 +1,220 @@
+/*
+ * @brief Boot timeline profiler, checkpoints from the reset handler to the first audio sample
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+
+#include "BootProfile.h"
+
+#if (AUDIO_BOOT_PROFILE)
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#if (AUDIO_TELEMETRY_CDC)
+typedef char BootProfile_FitsRecord[(BOOT_CHECKPOINT_COUNT <= TELEMETRY_BOOT_CHECKPOINTS) ? 1 : -1];
+#endif
+
+/* Kept across warm resets, not touched by the startup code */
+static BOOT_PROFILE_T BootProfile_Previous ATTR_NO_INIT;
+
+static const char *const BootProfile_Names[BOOT_CHECKPOINT_COUNT] = {
+	"reset",
+	"system init",
+	"data init",
+	"board init",
+	"usb init",
+	"console",
+	"rates",
+	"audio start",
+	"codec",
+	"configured",
+	"streaming",
+	"first packet",
+	"first sample",
+};
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+BOOT_PROFILE_T BootProfile_Current ATTR_NO_INIT;
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static uint32_t BootProfile_Sum(const BOOT_PROFILE_T *Profile)
+{
+	const uint32_t *word = (const uint32_t *) Profile;
+	uint32_t count = offsetof(BOOT_PROFILE_T, Check) / sizeof(uint32_t);
+	uint32_t sum = 0;
+
+	while (count--) {
+		sum += *word++;
+	}
+	return ~sum;
+}
+
+static bool BootProfile_IsValid(const BOOT_PROFILE_T *Profile)
+{
+	return (Profile->Magic == BOOT_PROFILE_MAGIC) && (Profile->Check == BootProfile_Sum(Profile));
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Start the cycle counter and a new profile. Only constants and registers may
+   be used here: the clock driver finds the core clock from the CGU registers
+   and OscRateIn, which sits in flash. */
+void BootProfile_Start(void)
+{
+	BOOT_PROFILE_T *profile = &BootProfile_Current;
+	uint32_t bootcount = 1;
+	uint32_t i;
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	if (BootProfile_IsValid(profile)) {
+		BootProfile_Previous = *profile;
+		bootcount = profile->BootCount + 1;
+	}
+	else {
+		BootProfile_Previous.Magic = 0;
+	}
+
+	profile->Magic = BOOT_PROFILE_MAGIC;
+	profile->BootCount = bootcount;
+	profile->Passed = 0;
+	for (i = 0; i < BOOT_CHECKPOINT_COUNT; i++) {
+		profile->Stamp[i].Cycle = 0;
+		profile->Stamp[i].ClockHz = 0;
+	}
+	BootProfile_Stamp(BOOT_CHECKPOINT_RESET);
+}
+
+/* Stamp a checkpoint, the first stamp wins when two contexts race for it */
+void BootProfile_Stamp(BOOT_CHECKPOINT_T Checkpoint)
+{
+	BOOT_PROFILE_T *profile = &BootProfile_Current;
+	uint32_t cycle = DWT->CYCCNT;
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if ((profile->Passed & (1UL << Checkpoint)) == 0) {
+		profile->Stamp[Checkpoint].Cycle = cycle;
+		profile->Stamp[Checkpoint].ClockHz = Chip_Clock_GetRate(CLK_MX_MXCORE);
+		profile->Passed |= 1UL << Checkpoint;
+		profile->Check = BootProfile_Sum(profile);
+	}
+	__set_PRIMASK(primask);
+}
+
+/* Get a boot profile */
+const BOOT_PROFILE_T *BootProfile_Get(bool Previous)
+{
+	if (Previous) {
+		return BootProfile_IsValid(&BootProfile_Previous) ? &BootProfile_Previous : NULL;
+	}
+	return &BootProfile_Current;
+}
+
+/* Print a boot profile in stamp order, background checkpoints land where they
+   finished. A segment that changed the core clock is converted at the slower
+   of its two clocks, which gives an upper bound. */
+void BootProfile_Print(bool Previous)
+{
+	const BOOT_PROFILE_T *profile = BootProfile_Get(Previous);
+	uint8_t order[BOOT_CHECKPOINT_COUNT];
+	uint32_t count = 0, last = 0, clock = 0, hz, i, j;
+
+	if (profile == NULL) {
+		printf("Boot profile: no previous boot\r\n");
+		return;
+	}
+	for (i = 0; i < BOOT_CHECKPOINT_COUNT; i++) {
+		if ((profile->Passed & (1UL << i)) == 0) {
+			continue;
+		}
+		for (j = count++; (j > 0) && (profile->Stamp[order[j - 1]].Cycle > profile->Stamp[i].Cycle); j--) {
+			order[j] = order[j - 1];
+		}
+		order[j] = (uint8_t) i;
+	}
+
+	printf("Boot profile, boot %u%s\r\n", (unsigned) profile->BootCount, Previous ? " (previous)" : "");
+	for (j = 0; j < count; j++) {
+		i = order[j];
+		hz = (profile->Stamp[i].ClockHz < clock) ? profile->Stamp[i].ClockHz : clock;
+		if (hz != 0) {
+			printf("  %-13s %10u cycles  +%u us%s\r\n", BootProfile_Names[i],
+				   (unsigned) profile->Stamp[i].Cycle,
+				   (unsigned) ((uint64_t) (profile->Stamp[i].Cycle - last) * 1000000 / hz),
+				   (clock != profile->Stamp[i].ClockHz) ? " at most, clock changed" : "");
+		}
+		else {
+			printf("  %-13s %10u cycles\r\n", BootProfile_Names[i], (unsigned) profile->Stamp[i].Cycle);
+		}
+		last = profile->Stamp[i].Cycle;
+		clock = profile->Stamp[i].ClockHz;
+	}
+	for (i = 0; i < BOOT_CHECKPOINT_COUNT; i++) {
+		if ((profile->Passed & (1UL << i)) == 0) {
+			printf("  %-13s -\r\n", BootProfile_Names[i]);
+		}
+	}
+}
+
+#if (AUDIO_TELEMETRY_CDC)
+/* Fill the profile part of a boot record */
+bool BootProfile_Fill(bool Previous, TELEMETRY_BOOT_T *Record)
+{
+	const BOOT_PROFILE_T *profile = BootProfile_Get(Previous);
+	uint32_t i;
+
+	if (profile == NULL) {
+		return false;
+	}
+	Record->BootCount = profile->BootCount;
+	Record->Passed = (uint16_t) profile->Passed;
+	Record->Checkpoints = BOOT_CHECKPOINT_COUNT;
+	for (i = 0; i < BOOT_CHECKPOINT_COUNT; i++) {
+		Record->StampCycle[i] = profile->Stamp[i].Cycle;
+		Record->StampClockHz[i] = profile->Stamp[i].ClockHz;
+	}
+	return true;
+}
+#endif
+
+#endif /* AUDIO_BOOT_PROFILE */
@@ -0,0 +1,191 @@
+/*
+ * @brief Boot timeline profiler, checkpoints from the reset handler to the first audio sample
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+
+#ifndef _BOOT_PROFILE_H_
+#define _BOOT_PROFILE_H_
+
+#include "board.h"
+#include "USB.h"
+#include "Telemetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_BootProfile Boot profiler
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * Timestamps the way from the reset handler to the first audio sample at a
+ * fixed set of checkpoints. The DWT cycle counter is started and zeroed first
+ * thing in ResetISR(), so every stamp counts core cycles from reset, and each
+ * stamp also records the core clock it was taken at: the segment that runs
+ * SystemInit() switches from the IRC to the PLL, the host turns its cycles
+ * into time using both ends.
+ *
+ * The profile lives in .noinit RAM, which the startup code neither copies nor
+ * zeroes, so it can be written before the data and bss sections exist and it
+ * survives a warm reset. A valid profile found at reset is kept as the
+ * previous boot, which is the one to look at for the late checkpoints.
+ *
+ * main() prints the previous boot on the console, and the host reads either
+ * boot on the telemetry function with TELEMETRY_CMD_BOOT, see
+ * example/tools/telemetry_decode.py. A checkpoint not reached yet has its
+ * bit clear in Passed, the USB ROM driver build never passes the ones taken
+ * from LPCUSBlib events.
+ *
+ * A segment longer than the cycle counter period, 21 s at 204 MHz, wraps.
+ * Only the segments ending at the host driven checkpoints can get that long.
+ * @{
+ */
+
+/** @brief	Set to 0 to leave the checkpoints out */
+#ifndef AUDIO_BOOT_PROFILE
+#define AUDIO_BOOT_PROFILE          1
+#endif
+
+/** Profile start marker, also tells a kept profile from power on RAM contents */
+#define BOOT_PROFILE_MAGIC          0x544F4F42
+
+/**
+ * @brief Checkpoints, in boot order except for the background ones, each one ends
+ * the segment since the checkpoint stamped before it
+ */
+typedef enum {
+	BOOT_CHECKPOINT_RESET = 0,		/*!< ResetISR() entry, cycle 0 */
+	BOOT_CHECKPOINT_SYSTEM_INIT,	/*!< Peripheral reset and SystemInit() clock setup done */
+	BOOT_CHECKPOINT_DATA_INIT,		/*!< Data sections copied and bss zeroed, main() next */
+	BOOT_CHECKPOINT_BOARD_INIT,		/*!< Board_Init() done */
+	BOOT_CHECKPOINT_USB_INIT,		/*!< USB_Init() done on every port */
+	BOOT_CHECKPOINT_CONSOLE,		/*!< Application modules set up and banner printed */
+	BOOT_CHECKPOINT_RATES,			/*!< AudioRates_Init() built the rate registry */
+	BOOT_CHECKPOINT_AUDIO_START,	/*!< I2S started on every function, codec bring-up launched */
+	BOOT_CHECKPOINT_CODEC,			/*!< Codec bring-up finished, it runs alongside enumeration */
+	BOOT_CHECKPOINT_CONFIGURED,		/*!< First SET_CONFIGURATION */
+	BOOT_CHECKPOINT_STREAMING,		/*!< First playback stream alternate setting selected */
+	BOOT_CHECKPOINT_FIRST_PACKET,	/*!< First isochronous OUT packet with data */
+	BOOT_CHECKPOINT_FIRST_SAMPLE,	/*!< First sample from the ring sent to I2S */
+	BOOT_CHECKPOINT_COUNT
+} BOOT_CHECKPOINT_T;
+
+/**
+ * @brief One checkpoint stamp
+ */
+typedef struct {
+	uint32_t Cycle;					/*!< DWT cycle count since reset */
+	uint32_t ClockHz;				/*!< Core clock when the stamp was taken */
+} BOOT_STAMP_T;
+
+/**
+ * @brief Profile of one boot
+ */
+typedef struct {
+	uint32_t Magic;					/*!< BOOT_PROFILE_MAGIC */
+	uint32_t BootCount;				/*!< Boots since the RAM lost its contents, this one included */
+	uint32_t Passed;				/*!< Bit per BOOT_CHECKPOINT_T reached */
+	BOOT_STAMP_T Stamp[BOOT_CHECKPOINT_COUNT];
+	uint32_t Check;					/*!< Complement of the sum of all preceding words */
+} BOOT_PROFILE_T;
+
+#if (AUDIO_BOOT_PROFILE)
+
+/** Profile of the running boot, only BootProfile_Mark() writes it */
+extern BOOT_PROFILE_T BootProfile_Current;
+
+/**
+ * @brief	Start the cycle counter and a new profile, keeping a valid one as the previous boot
+ * @return	Nothing
+ * @note	Called first thing in ResetISR(), runs before the data and bss sections exist.
+ */
+void BootProfile_Start(void);
+
+/**
+ * @brief	Stamp a checkpoint that was not passed yet
+ * @param	Checkpoint	: Checkpoint reached
+ * @return	Nothing
+ * @note	Callable before data init and from interrupts.
+ */
+void BootProfile_Stamp(BOOT_CHECKPOINT_T Checkpoint);
+
+/**
+ * @brief	Stamp a checkpoint the first time it is reached
+ * @param	Checkpoint	: Checkpoint reached
+ * @return	Nothing
+ * @note	Costs a bit test once passed, so it may sit on the sample path.
+ */
+static INLINE void BootProfile_Mark(BOOT_CHECKPOINT_T Checkpoint)
+{
+	if ((BootProfile_Current.Passed & (1UL << Checkpoint)) == 0) {
+		BootProfile_Stamp(Checkpoint);
+	}
+}
+
+/**
+ * @brief	Get a boot profile
+ * @param	Previous	: true for the boot before this one
+ * @return	The profile, NULL if there is no valid previous boot
+ */
+const BOOT_PROFILE_T *BootProfile_Get(bool Previous);
+
+/**
+ * @brief	Print a boot profile on the console, one line per checkpoint
+ * @param	Previous	: true for the boot before this one
+ * @return	Nothing
+ */
+void BootProfile_Print(bool Previous);
+
+#if (AUDIO_TELEMETRY_CDC)
+/**
+ * @brief	Fill the profile part of a boot record
+ * @param	Previous	: true for the boot before this one
+ * @param	Record		: Record to fill, header and checksum are done by the caller
+ * @return	false if there is no such profile
+ */
+bool BootProfile_Fill(bool Previous, TELEMETRY_BOOT_T *Record);
+#endif
+
+#else
+
+#define BootProfile_Start()
+#define BootProfile_Mark(Checkpoint)
+#define BootProfile_Print(Previous)
+
+#endif /* AUDIO_BOOT_PROFILE */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BOOT_PROFILE_H_ */
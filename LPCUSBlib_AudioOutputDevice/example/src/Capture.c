@@ -0,0 +1,420 @@
+/*
+ * @brief Audio capture from I2S RX to an isochronous IN endpoint
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#include "Capture.h"
+#include "Latency.h"
+#include "dma_manager.h"
+#include "MemoryLayout.h"
+
+#if (AUDIO_CAPTURE_FUNCTION)
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define CAPTURE_RING_BYTES      (CAPTURE_RING_FRAMES * CAPTURE_FRAME_BYTES)
+#define CAPTURE_SEGMENT_FRAMES  (CAPTURE_RING_FRAMES / CAPTURE_DMA_SEGMENTS)
+
+#if (CAPTURE_RING_FRAMES % CAPTURE_DMA_SEGMENTS) || (CAPTURE_SEGMENT_FRAMES > 4095)
+#error CAPTURE_RING_FRAMES must split into CAPTURE_DMA_SEGMENTS items of at most 4095 frames
+#endif
+
+/* Capture side of one audio function, one per USB controller */
+typedef struct {
+	USB_ClassInfo_Audio_Device_t Interface;	/* Class driver instance of the capture streaming interface */
+	uint32_t DmaConnection;					/* GPDMA request of the I2S receiver */
+	LPC_I2S_T *I2S;							/* I2S port receiving, set while running */
+	uint8_t DmaChannel;						/* From the DMA manager while running */
+	volatile bool Running;					/* Receiver and DMA running */
+	bool Streaming;							/* Host selected the streaming alternate setting */
+	uint32_t SampleFrequency;
+	uint32_t PacketRate;					/* IN packets per second at the negotiated speed */
+	uint32_t MaxFrames;						/* Largest packet the endpoint takes, in frames */
+	uint32_t TargetFrames;					/* Ring fill the packet length servo holds */
+	uint32_t ResyncCycles;					/* Packet gap after which the DMA may have lapped the reader */
+	uint32_t Accumulator;					/* Nominal rate remainder while playback is idle */
+	uint32_t OutFrames;						/* Frames of the last playback OUT packet */
+	uint32_t OutPackets;					/* Playback OUT packets seen */
+	uint32_t OutPacketsUsed;				/* OutPackets when the last IN packet was sized */
+	uint32_t RdIndex;						/* Ring offset of the next frame to send, in bytes */
+	uint32_t LastPacketCycle;				/* DWT cycle count at the last IN packet */
+	CAPTURE_STATS_T Stats;
+	DMA_TransferDescriptor_t *Lli;			/* CAPTURE_DMA_SEGMENTS items from the DMA descriptor pool */
+	uint8_t *Ring;							/* CAPTURE_RING_ALLOC bytes, see MemoryLayout.h */
+} CAPTURE_INSTANCE_T;
+
+/* Ring plus room for one packet, where the head is mirrored when a packet wraps */
+#define CAPTURE_RING_ALLOC      (CAPTURE_RING_BYTES + CAPTURE_STREAM_EPSIZE_FS)
+
+/* Written by the GPDMA, in a bank of their own */
+static uint8_t Capture_Ring[2][CAPTURE_RING_ALLOC] ATTR_ALIGNED(4) LAYOUT_CAPTURE_RING;
+
+/* The endpoint is sized for full speed, the larger of the two packets, so one
+   class driver instance serves both speeds */
+static CAPTURE_INSTANCE_T Capture_Instance[2] = {
+	{
+		.Interface = {
+			.Config = {
+				.StreamingInterfaceNumber = CAPTURE_STREAM_INTERFACE,
+
+				.DataINEndpointNumber     = CAPTURE_STREAM_EPNUM,
+				.DataINEndpointSize       = CAPTURE_STREAM_EPSIZE_FS,
+				.PortNumber = 0,
+			},
+		},
+		.DmaConnection = GPDMA_CONN_I2S_Rx_Channel_1,
+		.Ring = Capture_Ring[0],
+		.SampleFrequency = CAPTURE_MAX_SAMPLE_FREQ,
+		.PacketRate = CAPTURE_PACKET_RATE_HS,
+		.MaxFrames = CAPTURE_STREAM_EPSIZE_HS / CAPTURE_FRAME_BYTES,
+	},
+	{
+		.Interface = {
+			.Config = {
+				.StreamingInterfaceNumber = CAPTURE_STREAM_INTERFACE,
+
+				.DataINEndpointNumber     = CAPTURE_STREAM_EPNUM,
+				.DataINEndpointSize       = CAPTURE_STREAM_EPSIZE_FS,
+				.PortNumber = 1,
+			},
+		},
+		.DmaConnection = GPDMA_CONN_I2S1_Rx_Channel_1,
+		.Ring = Capture_Ring[1],
+		.SampleFrequency = CAPTURE_MAX_SAMPLE_FREQ,
+		.PacketRate = CAPTURE_PACKET_RATE_FS,
+		.MaxFrames = CAPTURE_STREAM_EPSIZE_FS / CAPTURE_FRAME_BYTES,
+	},
+};
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static bool Capture_IsHighSpeed(uint8_t corenum)
+{
+	return ((USB_REG(corenum)->PORTSC1_D >> 26) & 0x03) == 0x02;
+}
+
+static CAPTURE_INSTANCE_T *Capture_FromPort(uint8_t corenum)
+{
+	return (corenum < 2) ? &Capture_Instance[corenum] : NULL;
+}
+
+/* Ring offset the DMA writes next. The end of the last item is the start of the first */
+static uint32_t Capture_WriteIndex(const CAPTURE_INSTANCE_T *Capture)
+{
+	uint32_t offset = LPC_GPDMA->CH[Capture->DmaChannel].DESTADDR - (uint32_t) Capture->Ring;
+
+	return (offset >= CAPTURE_RING_BYTES) ? 0 : offset;
+}
+
+/* Frames written by the DMA and not sent yet */
+static uint32_t Capture_Fill(const CAPTURE_INSTANCE_T *Capture)
+{
+	return ((Capture_WriteIndex(Capture) + CAPTURE_RING_BYTES - Capture->RdIndex) % CAPTURE_RING_BYTES) /
+		   CAPTURE_FRAME_BYTES;
+}
+
+/* Fill target and resync gap for the current rate and speed */
+static void Capture_UpdateTiming(CAPTURE_INSTANCE_T *Capture)
+{
+	uint32_t nominal = (Capture->SampleFrequency + Capture->PacketRate - 1) / Capture->PacketRate;
+
+	/* Two packets in hand absorb a late playback packet, the slack covers the FIFO */
+	Capture->TargetFrames = 2 * nominal + CAPTURE_DMA_SLACK_FRAMES;
+	Capture->ResyncCycles = (uint32_t) (((uint64_t) SystemCoreClock * (CAPTURE_RING_FRAMES / 2)) /
+										Capture->SampleFrequency);
+}
+
+/* Put the reader back at the fill target behind the DMA */
+static void Capture_Resync(CAPTURE_INSTANCE_T *Capture)
+{
+	Capture->RdIndex = (Capture_WriteIndex(Capture) + CAPTURE_RING_BYTES -
+						Capture->TargetFrames * CAPTURE_FRAME_BYTES) % CAPTURE_RING_BYTES;
+	Capture->Accumulator = 0;
+	Capture->OutPacketsUsed = Capture->OutPackets;
+	Capture->LastPacketCycle = DWT->CYCCNT;
+}
+
+#if (AUDIO_LATENCY_PROBE)
+/* Look for the latency marker, looped back from the transmit pin, in a packet leaving now */
+static void Capture_FindMarker(uint8_t corenum, const uint32_t *Packet, uint32_t Frames, uint32_t Now)
+{
+	while (Frames--) {
+		if (*Packet++ == LATENCY_MARKER) {
+			Latency_Complete(corenum, LATENCY_PATH_ROUND_TRIP, Now);
+			return;
+		}
+	}
+}
+#endif
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Initialise the DMA manager */
+void Capture_Init(void)
+{
+	DMA_Manager_Init();
+}
+
+/* Start the receiver on the transmit clocks and the DMA into the ring */
+void Capture_Start(uint8_t corenum, LPC_I2S_T *I2S, uint32_t SampleFrequency)
+{
+	CAPTURE_INSTANCE_T *Capture = Capture_FromPort(corenum);
+	I2S_AUDIO_FORMAT_T Format;
+	DMA_TransferDescriptor_t First;
+	uint32_t i;
+
+	if ((Capture == NULL) || Capture->Running) {
+		return;
+	}
+	/* The ring never moves, so its list is taken once and kept */
+	if (Capture->Lli == NULL) {
+		Capture->Lli = DMA_Manager_AllocDescriptors(CAPTURE_DMA_SEGMENTS);
+	}
+	/* The receive FIFO only holds 8 words, so the channel goes ahead of bulk moves */
+	Capture->DmaChannel = (Capture->Lli != NULL) ?
+						  DMA_Manager_Alloc(DMA_PRIORITY_HIGH, NULL, NULL) : DMA_MANAGER_NO_CHANNEL;
+	if (Capture->DmaChannel == DMA_MANAGER_NO_CHANNEL) {
+		return;
+	}
+	Format.SampleRate = SampleFrequency;
+	Format.ChannelNumber = 2;
+	Format.WordWidth = 16;
+	Chip_I2S_RxConfig(I2S, &Format);
+	/* 4 pin mode: the receiver shifts on SCK and WS of the transmitter, sample locked to playback */
+	Chip_I2S_RxSlave(I2S);
+	Chip_I2S_RxModeConfig(I2S, 0, I2S_RXMODE_4PIN_ENABLE, 0);
+
+	memset(Capture->Ring, 0, CAPTURE_RING_ALLOC);
+	for (i = 0; i < CAPTURE_DMA_SEGMENTS; i++) {
+		Chip_GPDMA_PrepareDescriptor(LPC_GPDMA, &Capture->Lli[i], Capture->DmaConnection,
+									 (uint32_t) &Capture->Ring[i * CAPTURE_SEGMENT_FRAMES * CAPTURE_FRAME_BYTES],
+									 CAPTURE_SEGMENT_FRAMES, GPDMA_TRANSFERTYPE_P2M_CONTROLLER_DMA,
+									 &Capture->Lli[(i + 1) % CAPTURE_DMA_SEGMENTS]);
+	}
+	/* Chip_GPDMA_SGTransfer looks the first source up as a connection, not a FIFO address */
+	First = Capture->Lli[0];
+	First.src = Capture->DmaConnection;
+	DMA_Manager_SGTransfer(Capture->DmaChannel, &First, GPDMA_TRANSFERTYPE_P2M_CONTROLLER_DMA);
+	Chip_I2S_DMA_RxCmd(I2S, I2S_DMA_REQUEST_CHANNEL_2, ENABLE, 4);
+	Chip_I2S_RxStart(I2S);
+
+	HAL_DisableUSBInterrupt(corenum);
+	Capture->I2S = I2S;
+	Capture->SampleFrequency = SampleFrequency;
+	Capture_UpdateTiming(Capture);
+	Capture_Resync(Capture);
+	Capture->Stats.FillMin = 0xFFFFFFFF;
+	Capture->Stats.FillMax = 0;
+	Capture->Running = true;
+	HAL_EnableUSBInterrupt(corenum);
+}
+
+/* Stop the receiver and its DMA, IN packets go out empty until the next start */
+void Capture_Stop(uint8_t corenum)
+{
+	CAPTURE_INSTANCE_T *Capture = Capture_FromPort(corenum);
+
+	if ((Capture == NULL) || !Capture->Running) {
+		return;
+	}
+	HAL_DisableUSBInterrupt(corenum);
+	Capture->Running = false;
+	HAL_EnableUSBInterrupt(corenum);
+
+	Chip_I2S_DMA_RxCmd(Capture->I2S, I2S_DMA_REQUEST_CHANNEL_2, DISABLE, 4);
+	Chip_I2S_RxStop(Capture->I2S);
+	DMA_Manager_Free(Capture->DmaChannel);
+}
+
+/* Configure the capture endpoint for the negotiated speed */
+bool Capture_ConfigureEndpoints(uint8_t corenum)
+{
+	CAPTURE_INSTANCE_T *Capture = Capture_FromPort(corenum);
+	bool HighSpeed;
+
+	if (Capture == NULL) {
+		return true;
+	}
+	HighSpeed = Capture_IsHighSpeed(corenum);
+	HAL_DisableUSBInterrupt(corenum);
+	Capture->Streaming = false;
+	Capture->PacketRate = HighSpeed ? CAPTURE_PACKET_RATE_HS : CAPTURE_PACKET_RATE_FS;
+	Capture->MaxFrames = (HighSpeed ? CAPTURE_STREAM_EPSIZE_HS : CAPTURE_STREAM_EPSIZE_FS) / CAPTURE_FRAME_BYTES;
+	Capture_UpdateTiming(Capture);
+	HAL_EnableUSBInterrupt(corenum);
+	return Audio_Device_ConfigureEndpoints(&Capture->Interface);
+}
+
+/* Let the class driver handle SET_INTERFACE and class requests of the capture interface */
+void Capture_ProcessControlRequest(uint8_t corenum)
+{
+	CAPTURE_INSTANCE_T *Capture = Capture_FromPort(corenum);
+
+	if (Capture != NULL) {
+		Audio_Device_ProcessControlRequest(&Capture->Interface);
+	}
+}
+
+/* Track the streaming alternate setting, a new stream starts at the fill target */
+bool Capture_StreamStartStop(USB_ClassInfo_Audio_Device_t *const AudioInterfaceInfo)
+{
+	uint8_t corenum = AudioInterfaceInfo->Config.PortNumber;
+	CAPTURE_INSTANCE_T *Capture = Capture_FromPort(corenum);
+
+	if ((Capture == NULL) || (AudioInterfaceInfo != &Capture->Interface)) {
+		return false;
+	}
+	HAL_DisableUSBInterrupt(corenum);
+	Capture->Streaming = AudioInterfaceInfo->State.InterfaceEnabled;
+	if (Capture->Streaming && Capture->Running) {
+		Capture_Resync(Capture);
+	}
+	HAL_EnableUSBInterrupt(corenum);
+	return true;
+}
+
+/* Host streams the capture interface */
+bool Capture_IsStreaming(uint8_t corenum)
+{
+	CAPTURE_INSTANCE_T *Capture = Capture_FromPort(corenum);
+
+	return (Capture != NULL) && Capture->Running && Capture->Streaming;
+}
+
+/* Remember the host rate as playback sees it */
+LAYOUT_RAMFUNC void Capture_PlaybackPacket(uint8_t corenum, uint32_t Bytes)
+{
+	CAPTURE_INSTANCE_T *Capture = Capture_FromPort(corenum);
+
+	/* The callback also runs with no data when the endpoint is primed */
+	if ((Capture == NULL) || (Bytes == 0)) {
+		return;
+	}
+	Capture->OutFrames = Bytes / CAPTURE_FRAME_BYTES;
+	Capture->OutPackets++;
+}
+
+/* Size the next IN packet and return it from the ring */
+LAYOUT_RAMFUNC uint32_t Capture_GetISOBufferAddress(uint8_t corenum, uint32_t *PacketSize)
+{
+	CAPTURE_INSTANCE_T *Capture = Capture_FromPort(corenum);
+	uint32_t now = DWT->CYCCNT;
+	uint32_t address, frames, fill, end;
+
+	if ((Capture == NULL) || !Capture->Running || !Capture->Streaming) {
+		*PacketSize = 0;
+		return (Capture != NULL) ? (uint32_t) Capture->Ring : 0;
+	}
+	fill = Capture_Fill(Capture);
+	if (((now - Capture->LastPacketCycle) > Capture->ResyncCycles) || (fill > CAPTURE_RING_FRAMES / 2)) {
+		/* The host skipped packets for long enough that the fill can no longer be trusted */
+		Capture_Resync(Capture);
+		Capture->Stats.Resyncs++;
+		fill = Capture_Fill(Capture);
+	}
+	Capture->LastPacketCycle = now;
+
+	/* Nominal length: the last playback packet, else the accumulated nominal rate */
+	if (Capture->OutPackets != Capture->OutPacketsUsed) {
+		Capture->OutPacketsUsed = Capture->OutPackets;
+		frames = Capture->OutFrames;
+		Capture->Stats.Followed++;
+	}
+	else {
+		Capture->Accumulator += Capture->SampleFrequency;
+		frames = Capture->Accumulator / Capture->PacketRate;
+		Capture->Accumulator -= frames * Capture->PacketRate;
+	}
+
+	/* One frame more or less when the fill drifts off its target */
+	if (fill > Capture->TargetFrames + CAPTURE_SERVO_BAND_FRAMES) {
+		frames++;
+		Capture->Stats.SlewUp++;
+	}
+	else if ((fill + CAPTURE_SERVO_BAND_FRAMES < Capture->TargetFrames) && (frames > 0)) {
+		frames--;
+		Capture->Stats.SlewDown++;
+	}
+	if (frames > Capture->MaxFrames) {
+		frames = Capture->MaxFrames;
+	}
+	if (frames > fill) {
+		frames = fill;
+		Capture->Stats.Underruns++;
+	}
+
+	/* A packet crossing the end of the ring continues in the mirror behind it */
+	address = (uint32_t) &Capture->Ring[Capture->RdIndex];
+	end = Capture->RdIndex + frames * CAPTURE_FRAME_BYTES;
+	if (end >= CAPTURE_RING_BYTES) {
+		end -= CAPTURE_RING_BYTES;
+		memcpy(&Capture->Ring[CAPTURE_RING_BYTES], Capture->Ring, end);
+	}
+	Capture->RdIndex = end;
+#if (AUDIO_LATENCY_PROBE)
+	if (Latency_IsPending(corenum, LATENCY_PATH_ROUND_TRIP)) {
+		Capture_FindMarker(corenum, (const uint32_t *) address, frames, now);
+	}
+#endif
+
+	Capture->Stats.Packets++;
+	Capture->Stats.Frames += frames;
+	if (fill < Capture->Stats.FillMin) {
+		Capture->Stats.FillMin = fill;
+	}
+	if (fill > Capture->Stats.FillMax) {
+		Capture->Stats.FillMax = fill;
+	}
+	*PacketSize = frames * CAPTURE_FRAME_BYTES;
+	return address;
+}
+
+/* Copy the counters and restart the fill min/max */
+void Capture_GetStats(uint8_t corenum, CAPTURE_STATS_T *Stats)
+{
+	CAPTURE_INSTANCE_T *Capture = Capture_FromPort(corenum);
+
+	if (Capture == NULL) {
+		return;
+	}
+	HAL_DisableUSBInterrupt(corenum);
+	*Stats = Capture->Stats;
+	Capture->Stats.FillMin = 0xFFFFFFFF;
+	Capture->Stats.FillMax = 0;
+	HAL_EnableUSBInterrupt(corenum);
+}
+
+#endif /* AUDIO_CAPTURE_FUNCTION */
@@ -0,0 +1,187 @@
+/*
+ * @brief Audio capture from I2S RX to an isochronous IN endpoint
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include "board.h"
+#include "USB.h"
+#include "Descriptors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_Capture Audio capture
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * Every port adds a capture streaming interface to its audio function. The I2S
+ * receiver of the port runs in 4 pin mode on the bit clock and word select of
+ * the transmitter, so each word select period moves one frame out to the
+ * speaker and one frame in from the microphone. Playback and capture stay
+ * sample locked whatever the playback rate control does with the divider,
+ * which is what an echo canceller on the host needs.
+ *
+ * A GPDMA channel drains the receive FIFO into a capture ring through a
+ * circular linked list, so capture costs no interrupt of its own. The channel
+ * is allocated at high priority from the DMA manager (dma_manager.h) while the
+ * receiver runs, the list items come from its descriptor pool. Each
+ * isochronous IN completion hands the USB controller the next whole packet
+ * straight from the ring. The packet length follows the last playback OUT
+ * packet, which is the host clock as the playback path measures it, and moves
+ * by one frame when the ring fill leaves its target. While playback is idle
+ * the nominal rate is accumulated instead.
+ * @{
+ */
+
+#if (AUDIO_CAPTURE_FUNCTION)
+
+/** Capture ring per port, in frames, a multiple of CAPTURE_DMA_SEGMENTS */
+#ifndef CAPTURE_RING_FRAMES
+#define CAPTURE_RING_FRAMES         512
+#endif
+/** Linked list items the ring is split into, each moves at most 4095 frames */
+#ifndef CAPTURE_DMA_SEGMENTS
+#define CAPTURE_DMA_SEGMENTS        2
+#endif
+/** Frames the DMA may hold back in the FIFO, added to the ring fill target */
+#ifndef CAPTURE_DMA_SLACK_FRAMES
+#define CAPTURE_DMA_SLACK_FRAMES    8
+#endif
+/** Ring fill deviation, in frames, that makes a packet one frame longer or shorter */
+#ifndef CAPTURE_SERVO_BAND_FRAMES
+#define CAPTURE_SERVO_BAND_FRAMES   2
+#endif
+
+/**
+ * @brief Capture counters of one port
+ */
+typedef struct {
+	uint32_t Packets;		/*!< Isochronous IN packets sent */
+	uint32_t Frames;		/*!< Stereo frames sent */
+	uint32_t Followed;		/*!< Packets sized from a playback OUT packet */
+	uint32_t SlewUp;		/*!< Packets one frame longer to drain the ring */
+	uint32_t SlewDown;		/*!< Packets one frame shorter to refill the ring */
+	uint32_t Underruns;		/*!< Packets cut short because the ring held fewer frames */
+	uint32_t Resyncs;		/*!< Reader moved back to the target, the DMA had lapped it */
+	uint32_t FillMin;		/*!< Lowest ring fill seen at a packet, in frames */
+	uint32_t FillMax;		/*!< Highest ring fill seen at a packet, in frames */
+} CAPTURE_STATS_T;
+
+/**
+ * @brief	Initialise the DMA manager the capture rings take their channels from
+ * @return	Nothing
+ */
+void Capture_Init(void);
+
+/**
+ * @brief	Start the I2S receiver and its DMA for one port
+ * @param	corenum			: USB port number
+ * @param	I2S				: I2S port whose transmitter is already running
+ * @param	SampleFrequency	: Sampling frequency shared with playback
+ * @return	Nothing
+ * @note	Main loop only, called each time playback (re)starts the I2S port.
+ */
+void Capture_Start(uint8_t corenum, LPC_I2S_T *I2S, uint32_t SampleFrequency);
+
+/**
+ * @brief	Stop the I2S receiver and its DMA for one port
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ * @note	Main loop only, called before playback shuts the I2S port down.
+ */
+void Capture_Stop(uint8_t corenum);
+
+/**
+ * @brief	Configure the capture endpoint, from the configuration changed event
+ * @param	corenum	: USB port number
+ * @return	true if the endpoint was configured
+ */
+bool Capture_ConfigureEndpoints(uint8_t corenum);
+
+/**
+ * @brief	Handle standard requests addressed to the capture streaming interface
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ */
+void Capture_ProcessControlRequest(uint8_t corenum);
+
+/**
+ * @brief	Realign the ring when the host selects or leaves the streaming alternate setting
+ * @param	AudioInterfaceInfo	: Class driver instance from the stream start/stop event
+ * @return	false if the instance is not a capture interface
+ */
+bool Capture_StreamStartStop(USB_ClassInfo_Audio_Device_t *const AudioInterfaceInfo);
+
+/**
+ * @brief	Tell whether the host streams the capture interface of a port
+ * @param	corenum	: USB port number
+ * @return	true while the streaming alternate setting is selected and the receiver runs
+ */
+bool Capture_IsStreaming(uint8_t corenum);
+
+/**
+ * @brief	Record the length of a playback OUT packet
+ * @param	corenum	: USB port number
+ * @param	Bytes	: Bytes received in the packet
+ * @return	Nothing
+ * @note	Called from the USB interrupt, from the playback ISO buffer callback.
+ */
+void Capture_PlaybackPacket(uint8_t corenum, uint32_t Bytes);
+
+/**
+ * @brief	Take the next capture packet from the ring
+ * @param	corenum		: USB port number
+ * @param	PacketSize	: Filled with the packet length in bytes, 0 while capture is stopped
+ * @return	Address of the packet, inside the ring
+ * @note	Called from the USB interrupt, from the ISO buffer callback of the IN endpoint.
+ */
+uint32_t Capture_GetISOBufferAddress(uint8_t corenum, uint32_t *PacketSize);
+
+/**
+ * @brief	Copy the capture counters of a port, min/max restart
+ * @param	corenum	: USB port number
+ * @param	Stats	: Where the counters are copied
+ * @return	Nothing
+ */
+void Capture_GetStats(uint8_t corenum, CAPTURE_STATS_T *Stats);
+
+#endif /* AUDIO_CAPTURE_FUNCTION */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CAPTURE_H_ */
@@ -0,0 +1,867 @@
+/*
+ * @brief Body of the configuration descriptor initializer, expanded once per port and speed variant
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+/*
+ * This file has no include guard: Descriptors.c includes it inside the braces of each
+ * USB_Descriptor_Configuration_t it keeps in flash, after defining
+ *
+ *   CONFIG_EPSIZE(Name)       the size of an endpoint that depends on the bus speed,
+ *                             Name##_HS or Name##_FS
+ *   CONFIG_TOTAL_SIZE         wTotalLength of the variant
+ *   CONFIG_TOTAL_INTERFACES   bNumInterfaces of the variant
+ *
+ * Lengths that used to be summed by hand are taken from the structure layout, so they
+ * follow the build options. Descriptors.c checks the class-specific descriptor sizes.
+ */
+
+	.Config = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Configuration_Header_t), .Type = DTYPE_Configuration},
+
+		.TotalConfigurationSize   = CONFIG_TOTAL_SIZE,
+		.TotalInterfaces          = CONFIG_TOTAL_INTERFACES,
+
+		.ConfigurationNumber      = 1,
+		.ConfigurationStrIndex    = NO_DESCRIPTOR,
+
+		.ConfigAttributes         = (USB_CONFIG_ATTR_BUSPOWERED | USB_CONFIG_ATTR_SELFPOWERED),
+
+		.MaxPowerConsumption      = USB_CONFIG_POWER_MA(100)
+	},
+
+#ifdef AUDIO_FUNCTION_IAD
+	.InterfaceAssociation = {
+		.bLength                  = sizeof(USB_StdDescriptor_Interface_Association_t), /*  Size of the descriptor, in bytes. */
+		.bDescriptorType          = DTYPE_InterfaceAssociation,                        /*  Type of the descriptor, either a value in
+		                                                                                *  @ref USB_DescriptorTypes_t or a value
+			                                                                            *  given by the specific class.
+			                                                                            */
+		.bFirstInterface          = 0,                                                 /*  Index of the first associated interface. */
+		.bInterfaceCount          = AUDIO_FUNCTION_INTERFACES,                         /*  Total number of associated interfaces. */
+		.bFunctionClass           = 1,                                                 /*  Interface class ID. */
+		.bFunctionSubClass        = 0,                                                 /*  Interface subclass ID. */
+		.bFunctionProtocol        = AUDIO_CSCP_StreamingProtocol,                      /*  Interface protocol ID. */
+		.iFunction                = 0,                                                 /*  Index of the string descriptor describing the
+			                                                                            *  interface association.
+			                                                                            */
+	},
+#endif
+
+	.Audio_ControlInterface = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+		.InterfaceNumber          = 0,
+		.AlternateSetting         = 0,
+
+		.TotalEndpoints           = 0,
+
+		.Class                    = AUDIO_CSCP_AudioClass,
+		.SubClass                 = AUDIO_CSCP_ControlSubclass,
+		.Protocol                 = AUDIO_CSCP_ControlProtocol,
+
+		.InterfaceStrIndex        = NO_DESCRIPTOR
+	},
+
+	.Audio_ControlInterface_SPC = {
+		.Header                   = {.Size = sizeof(USB_Audio_Descriptor_Interface_AC_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_Header,
+
+#ifndef USB_AUDIO_2DOT0
+		.ACSpecification          = VERSION_BCD(01.00),
+		.TotalLength              = offsetof(USB_Descriptor_Configuration_t, Audio_StreamInterface_Alt0)
+									- offsetof(USB_Descriptor_Configuration_t, Audio_ControlInterface_SPC),
+
+		.InCollection             = 1,
+		.InterfaceNumber          = 1,
+#else
+		.ACSpecification          = VERSION_BCD(02.00),
+		.bCategory                = 1,  /* DESKTOP_SPEAKER, the primary use of this audio function (UAC2 A.7) */
+		.wTotalLength             = offsetof(USB_Descriptor_Configuration_t, Audio_StreamInterface_Alt0)
+									- offsetof(USB_Descriptor_Configuration_t, Audio_ControlInterface_SPC),
+									/* This header and every clock source, unit and terminal after it, up to the
+									 * streaming interfaces, so it follows the entities built in.
+									 */
+		.bmControls               = 0,  /* No latency control */
+#endif
+	},
+
+#ifdef USB_AUDIO_2DOT0
+	/* One clock source per rate family, each with its own I2S divider set */
+	.Audio_SourceClock48k = {
+			.bLength                  = sizeof(USB_Audio_StdDescriptor_Source_Clock_t), /*  Size of the descriptor, in bytes. */
+			.bDescriptorType          = DTYPE_CSInterface,                              /*  Type of the descriptor, either a value in
+			                                                                             *  @ref USB_DescriptorTypes_t or a value
+				                                                                         *  given by the specific class.
+				                                                                         */
+			.bDescriptorSubtype      = AUDIO_DSUBTYPE_CSInterface_ClockSource,  /*  Sub type value used to distinguish between audio class-specific descriptors,
+			                                                                     *  a value from the @ref Audio_CSInterface_AS_SubTypes_t enum.
+			                                                                     */
+			.bClockID                = AUDIO_CLOCK_SOURCE_48K_ID,  /* Constant uniquely identifying the Clock Source Entity within the audio function.
+			                                                                 * This value is used in all requests to address this Entity.
+			                                                                 */
+
+			.bmAttributes            = 3,  /* Bitmap: D1..0: Clock Type: 00: External Clock
+			                                *                            01: Internal fixed Clock
+			                                *                            10: Internal variable Clock
+			                                *                            11: Internal programmable Clock
+			                                *            D2: Clock synchronized to SOF
+			                                *         D7..3: Reserved. Must be set to 0.
+			                                */
+
+			.bmControls              = 7,   /* Bitmap: D1..0: Clock Frequency Control
+			                                 *         D3..2: Clock Validity Control
+			                                 *         D7..4: Reserved. Must be set to 0.
+			                                 */
+
+			.bAssocTerminal          = 0,   /* Terminal ID of the Terminal that is associated with this Clock Source. */
+
+			.iClockSource            = 0,   /* Index of a string descriptor, describing the Clock Source Entity. */
+	},
+
+	.Audio_SourceClock44k1 = {
+			.bLength                  = sizeof(USB_Audio_StdDescriptor_Source_Clock_t),
+			.bDescriptorType          = DTYPE_CSInterface,
+			.bDescriptorSubtype      = AUDIO_DSUBTYPE_CSInterface_ClockSource,
+			.bClockID                = AUDIO_CLOCK_SOURCE_44K1_ID,
+			.bmAttributes            = 3,
+			.bmControls              = 7,
+			.bAssocTerminal          = 0,
+			.iClockSource            = 0,
+	},
+
+	/* The terminals run from whichever family the host selects, switching needs no re-enumeration */
+	.Audio_ClockSelector = {
+			.bLength                  = sizeof(USB_Audio_StdDescriptor_Clock_Selector_t),
+			.bDescriptorType          = DTYPE_CSInterface,
+			.bDescriptorSubtype      = AUDIO_DSUBTYPE_CSInterface_ClockSelector,
+			.bClockID                = AUDIO_CLOCK_SELECTOR_ID,
+			.bNrInPins               = AUDIO_CLOCK_SOURCES,
+			.baCSourceID             = {AUDIO_CLOCK_SOURCE_48K_ID, AUDIO_CLOCK_SOURCE_44K1_ID},
+			.bmControls              = 3,   /* Clock Selector Control read/write */
+			.iClockSelector          = 0,
+	},
+#endif
+
+	.Audio_InputTerminal = {
+		.Header                   = {.Size = sizeof(USB_Audio_Descriptor_InputTerminal_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_InputTerminal,
+
+		.TerminalID               = AUDIO_CONTROL_INPUT_TERMINAL_ID,
+		.TerminalType             = AUDIO_TERMINAL_STREAMING,
+		.AssociatedOutputTerminal = 0x00,
+#ifdef USB_AUDIO_2DOT0
+        .bCSourceID               = AUDIO_CLOCK_SELECTOR_ID, /* ID of Clock Enity to which this Input Terminal is connected. */
+#endif
+		.TotalChannels            = AUDIO_CHANNELS,
+		.ChannelConfig            = AUDIO_CHANNEL_CONFIG,
+
+		.ChannelStrIndex          = NO_DESCRIPTOR,
+#ifdef USB_AUDIO_2DOT0
+        .bmControls               = 0,  /* Bitmap controls */
+#endif
+		.TerminalStrIndex         = NO_DESCRIPTOR
+	},
+
+#ifdef USB_AUDIO_2DOT0
+	.Audio_FeatureUnit = {
+		.bLength				  = sizeof(USB_Audio_StdDescriptor_FeatureUnit_t),
+		.bDescriptorType          = DTYPE_CSInterface,
+		.bDescriptorSubtype       = AUDIO_DSUBTYPE_CSInterface_Feature,
+		.bUnitID                  = AUDIO_CONTROL_FEATURE_UNIT_ID,
+		.bSourceID                = AUDIO_CONTROL_INPUT_TERMINAL_ID,
+#ifndef USB_AUDIO_2DOT0
+		.bControlSize             = 1,
+		.bmaControls[0]           = 1,
+		.bmaControls[1]           = 2,
+		.bmaControls[2]           = 2,
+#else
+		/* Four bytes for the master channel and each of the AUDIO_CHANNELS logical channels: host
+		   programmable mute (D1..0) and volume (D3..2) on the master channel only, see AudioSink.h */
+		.bmaControls              = {0x0F},
+#endif
+		.iFeature                 = 0
+	},
+#endif
+
+	.Audio_OutputTerminal = {
+		.Header                   = {.Size = sizeof(USB_Audio_Descriptor_OutputTerminal_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_OutputTerminal,
+
+		.TerminalID               = AUDIO_CONTROL_OUTPUT_TERMINAL_ID,
+		.TerminalType             = AUDIO_TERMINAL_OUT_SPEAKER,
+		.AssociatedInputTerminal  = 0x00,
+
+#ifndef USB_AUDIO_2DOT0
+		.SourceID                 = AUDIO_CONTROL_INPUT_TERMINAL_ID,
+#else
+		.SourceID                 = AUDIO_CONTROL_FEATURE_UNIT_ID,
+
+        .bCSourceID               = AUDIO_CLOCK_SELECTOR_ID, /* ID of the Clock Enity to which this output Terminal is connected. */
+        .bmControls               = 0,    /* Bitmap Controls */
+#endif
+
+		.TerminalStrIndex         = NO_DESCRIPTOR
+	},
+
+#if (AUDIO_CAPTURE_FUNCTION)
+	.Capture_InputTerminal = {
+		.Header                   = {.Size = sizeof(USB_Audio_Descriptor_InputTerminal_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_InputTerminal,
+
+		.TerminalID               = CAPTURE_INPUT_TERMINAL_ID,
+		.TerminalType             = AUDIO_TERMINAL_IN_MIC,
+		.AssociatedOutputTerminal = 0x00,
+        .bCSourceID               = AUDIO_CLOCK_SELECTOR_ID, /* Same clock as playback: the I2S RX shares the TX bit clock */
+		.TotalChannels            = AUDIO_CHANNELS,
+		.ChannelConfig            = AUDIO_CHANNEL_CONFIG,
+
+		.ChannelStrIndex          = NO_DESCRIPTOR,
+        .bmControls               = 0,
+		.TerminalStrIndex         = NO_DESCRIPTOR
+	},
+
+	.Capture_OutputTerminal = {
+		.Header                   = {.Size = sizeof(USB_Audio_Descriptor_OutputTerminal_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_OutputTerminal,
+
+		.TerminalID               = CAPTURE_OUTPUT_TERMINAL_ID,
+		.TerminalType             = AUDIO_TERMINAL_STREAMING,
+		.AssociatedInputTerminal  = 0x00,
+		.SourceID                 = CAPTURE_INPUT_TERMINAL_ID,
+        .bCSourceID               = AUDIO_CLOCK_SELECTOR_ID,
+        .bmControls               = 0,
+
+		.TerminalStrIndex         = NO_DESCRIPTOR
+	},
+#endif
+
+	.Audio_StreamInterface_Alt0 = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+		.InterfaceNumber          = 1,
+		.AlternateSetting         = 0,
+
+		.TotalEndpoints           = 0,
+
+		.Class                    = AUDIO_CSCP_AudioClass,
+		.SubClass                 = AUDIO_CSCP_AudioStreamingSubclass,
+		.Protocol                 = AUDIO_CSCP_StreamingProtocol,
+
+		.InterfaceStrIndex        = NO_DESCRIPTOR
+	},
+
+	.Audio_StreamInterface_Alt1 = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+		.InterfaceNumber          = 1,
+		.AlternateSetting         = 1,
+
+#if !defined(USB_AUDIO_2DOT0) || (AUDIO_CAPTURE_FUNCTION)
+		.TotalEndpoints           = 1,
+#else
+		.TotalEndpoints           = 2,
+#endif
+
+		.Class                    = AUDIO_CSCP_AudioClass,
+		.SubClass                 = AUDIO_CSCP_AudioStreamingSubclass,
+		.Protocol                 = AUDIO_CSCP_StreamingProtocol,
+
+		.InterfaceStrIndex        = NO_DESCRIPTOR
+	},
+
+	.Audio_StreamInterface_SPC = {
+		.Header                   = {.Size = sizeof(USB_Audio_Descriptor_Interface_AS_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_General,
+
+		.TerminalLink             = AUDIO_CONTROL_INPUT_TERMINAL_ID,
+
+#ifndef USB_AUDIO_2DOT0
+		.FrameDelay               = 1,
+		.AudioFormat              = 0x0001
+#else
+		.bmControls               = 0,  /* Bitmap  D1..0: Active Alternate Setting Control
+		                                 *         D3..2: Valid Alternate Settings Control
+		                                 *         D7..4: Reserved. Must be set to 0.
+		                                 * Neither is implemented, the host tracks the alternate setting itself.
+		                                 */
+		.bFormatType              = 1,  /* FORMAT_TYPE_I, the Format Type the AudioStreaming interface is using. */
+		.bmFormats                = 1,  /* PCM, the Audio Data Format(s) that can be used to communicate with this interface.
+		                                 * See the USB Audio Data Formats document for further details.
+		                                 */
+		.bNrChannels              = AUDIO_CHANNELS,        /* Number of physical channels in the AS Interface audio channel cluster. */
+		.bmChannelConfig          = AUDIO_CHANNEL_CONFIG,  /* Describes the spatial location of the physical channels. */
+		.iChannelNames            = 0,  /* Index of a string descriptor, describing the name of the first physical channel. */
+#endif
+	},
+	.Audio_AudioFormat = {
+#ifndef USB_AUDIO_2DOT0
+		.Header                   = {.Size = sizeof(USB_Audio_Descriptor_Format_t) +
+											 AUDIO_SAMPLE_RATE_COUNT * sizeof(USB_Audio_SampleFreq_t),
+									 .Type = DTYPE_CSInterface},
+#else
+		/* The Audio 2.0 Type I format has no rate list, the clock source answers the RANGE request */
+		.Header                   = {.Size = sizeof(USB_Audio_Descriptor_Format_t),
+				                     .Type = DTYPE_CSInterface},
+#endif
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_FormatType,
+
+		.FormatType               = 0x01,
+#ifndef USB_AUDIO_2DOT0
+		.Channels                 = AUDIO_CHANNELS,
+
+		.SubFrameSize             = AUDIO_SUBSLOT_SIZE,
+		.BitResolution            = AUDIO_BIT_RESOLUTION,
+
+		.TotalDiscreteSampleRates = AUDIO_SAMPLE_RATE_COUNT,
+#else
+        .bSubslotSize             = AUDIO_SUBSLOT_SIZE,    /* The number of bytes occupied by one audio subslot. Can be 1, 2, 3 or 4. */
+        .bBitResolution           = AUDIO_BIT_RESOLUTION,  /* The number of effectively used bits from the available bits in an audio subslot. */
+#endif
+	},
+
+#ifndef USB_AUDIO_2DOT0
+	.Audio_AudioFormatSampleRates = {
+		AUDIO_SAMPLE_RATES(CONFIG_SAMPLE_FREQ)
+	},
+#endif
+
+	.Audio_StreamEndpointOut = {
+		.Endpoint = {
+			.Header              = {.Size = sizeof(USB_Audio_Descriptor_StreamEndpoint_Std_t), .Type = DTYPE_Endpoint},
+
+			.EndpointAddress     = (ENDPOINT_DIR_OUT | AUDIO_STREAM_EPNUM),
+#if defined(USB_DEVICE_ROM_DRIVER) && defined(USB_AUDIO_2DOT0)
+			/* ROM driver path services the explicit feedback endpoint below */
+			.Attributes          = (EP_TYPE_ISOCHRONOUS | ENDPOINT_ATTR_ASYNC | ENDPOINT_USAGE_DATA),
+#else
+			.Attributes          = (EP_TYPE_ISOCHRONOUS | ENDPOINT_ATTR_SYNC | ENDPOINT_USAGE_DATA),
+#endif
+			.EndpointSize        = AUDIO_STREAM_EPSIZE,
+			.PollingIntervalMS   = POLLING_INTERVAL
+		},
+
+#ifndef USB_AUDIO_2DOT0
+		.Refresh                  = 0,
+		.SyncEndpointNumber       = 0
+#endif
+	},
+
+	.Audio_StreamEndpoint_SPC = {
+		.Header                   =
+		{.Size = sizeof(USB_Audio_Descriptor_StreamEndpoint_Spc_t), .Type = DTYPE_CSEndpoint},
+		.Subtype                  = AUDIO_DSUBTYPE_CSEndpoint_General,
+
+		//.Attributes               = (AUDIO_EP_ACCEPTS_SMALL_PACKETS | AUDIO_EP_SAMPLE_FREQ_CONTROL),
+		.Attributes               = AUDIO_EP_ACCEPTS_SMALL_PACKETS,
+
+#ifdef USB_AUDIO_2DOT0
+		.bmControls               = 0x00,
+#endif
+
+		.LockDelayUnits           = 0x00,
+		.LockDelay                = 0x0000
+	},
+
+#if defined(USB_AUDIO_2DOT0) && !(AUDIO_CAPTURE_FUNCTION)
+	.Audio_StreamEndpointIn = {
+		.Endpoint = {
+			.Header              = {.Size = sizeof(USB_Audio_Descriptor_StreamEndpoint_Std_t), .Type = DTYPE_Endpoint},
+
+			.EndpointAddress     = (ENDPOINT_DIR_IN | 0x01),
+			.Attributes          = (0x10 | EP_TYPE_ISOCHRONOUS),
+			.EndpointSize        = 0x0004,
+			.PollingIntervalMS   = POLLING_INTERVAL
+		},
+	},
+#endif
+
+#if (AUDIO_CAPTURE_FUNCTION)
+	.Capture_StreamInterface_Alt0 = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+		.InterfaceNumber          = CAPTURE_STREAM_INTERFACE,
+		.AlternateSetting         = 0,
+
+		.TotalEndpoints           = 0,
+
+		.Class                    = AUDIO_CSCP_AudioClass,
+		.SubClass                 = AUDIO_CSCP_AudioStreamingSubclass,
+		.Protocol                 = AUDIO_CSCP_StreamingProtocol,
+
+		.InterfaceStrIndex        = NO_DESCRIPTOR
+	},
+
+	.Capture_StreamInterface_Alt1 = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+		.InterfaceNumber          = CAPTURE_STREAM_INTERFACE,
+		.AlternateSetting         = 1,
+
+		.TotalEndpoints           = 1,
+
+		.Class                    = AUDIO_CSCP_AudioClass,
+		.SubClass                 = AUDIO_CSCP_AudioStreamingSubclass,
+		.Protocol                 = AUDIO_CSCP_StreamingProtocol,
+
+		.InterfaceStrIndex        = NO_DESCRIPTOR
+	},
+
+	.Capture_StreamInterface_SPC = {
+		.Header                   = {.Size = sizeof(USB_Audio_Descriptor_Interface_AS_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_General,
+
+		.TerminalLink             = CAPTURE_OUTPUT_TERMINAL_ID,
+
+		.bmControls               = 0,
+		.bFormatType              = 1,
+		.bmFormats                = 1,  /* PCM */
+		.bNrChannels              = AUDIO_CHANNELS,
+		.bmChannelConfig          = AUDIO_CHANNEL_CONFIG,
+		.iChannelNames            = 0,
+	},
+
+	.Capture_AudioFormat = {
+		.Header                   = {.Size = sizeof(USB_Audio_Descriptor_Format_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_FormatType,
+
+		.FormatType               = 0x01,
+        .bSubslotSize             = AUDIO_SUBSLOT_SIZE,
+        .bBitResolution           = AUDIO_BIT_RESOLUTION,
+	},
+
+	.Capture_StreamEndpoint = {
+		.Endpoint = {
+			.Header              = {.Size = sizeof(USB_Audio_Descriptor_StreamEndpoint_Std_t), .Type = DTYPE_Endpoint},
+
+			.EndpointAddress     = (ENDPOINT_DIR_IN | CAPTURE_STREAM_EPNUM),
+			/* The packet sizes carry the device rate, the host needs no feedback */
+			.Attributes          = (EP_TYPE_ISOCHRONOUS | ENDPOINT_ATTR_ASYNC | ENDPOINT_USAGE_DATA),
+			.EndpointSize        = CONFIG_EPSIZE(CAPTURE_STREAM_EPSIZE),
+			.PollingIntervalMS   = CAPTURE_STREAM_INTERVAL
+		},
+	},
+
+	.Capture_StreamEndpoint_SPC = {
+		.Header                   = {.Size = sizeof(USB_Audio_Descriptor_StreamEndpoint_Spc_t), .Type = DTYPE_CSEndpoint},
+		.Subtype                  = AUDIO_DSUBTYPE_CSEndpoint_General,
+
+		.Attributes               = 0x00,
+		.bmControls               = 0x00,
+		.LockDelayUnits           = 0x00,
+		.LockDelay                = 0x0000
+	},
+#endif
+
+#if (AUDIO_TELEMETRY_CDC)
+	.CDC_InterfaceAssociation = {
+		.bLength                  = sizeof(USB_StdDescriptor_Interface_Association_t),
+		.bDescriptorType          = DTYPE_InterfaceAssociation,
+		.bFirstInterface          = TELEMETRY_CONTROL_INTERFACE,
+		.bInterfaceCount          = 2,
+		.bFunctionClass           = CDC_CSCP_CDCClass,
+		.bFunctionSubClass        = CDC_CSCP_ACMSubclass,
+		.bFunctionProtocol        = CDC_CSCP_ATCommandProtocol,
+		.iFunction                = NO_DESCRIPTOR,
+	},
+
+	.CDC_CCI_Interface = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+		.InterfaceNumber          = TELEMETRY_CONTROL_INTERFACE,
+		.AlternateSetting         = 0,
+
+		.TotalEndpoints           = 1,
+
+		.Class                    = CDC_CSCP_CDCClass,
+		.SubClass                 = CDC_CSCP_ACMSubclass,
+		.Protocol                 = CDC_CSCP_ATCommandProtocol,
+
+		.InterfaceStrIndex        = NO_DESCRIPTOR
+	},
+
+	.CDC_Functional_Header = {
+		.Header                   = {.Size = sizeof(USB_CDC_Descriptor_FunctionalHeader_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = CDC_DSUBTYPE_CSInterface_Header,
+
+		.CDCSpecification         = VERSION_BCD(01.10),
+	},
+
+	.CDC_Functional_ACM = {
+		.Header                   = {.Size = sizeof(USB_CDC_Descriptor_FunctionalACM_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = CDC_DSUBTYPE_CSInterface_ACM,
+
+		.Capabilities             = 0x06,
+	},
+
+	.CDC_Functional_Union = {
+		.Header                   = {.Size = sizeof(USB_CDC_Descriptor_FunctionalUnion_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = CDC_DSUBTYPE_CSInterface_Union,
+
+		.MasterInterfaceNumber    = TELEMETRY_CONTROL_INTERFACE,
+		.SlaveInterfaceNumber     = TELEMETRY_DATA_INTERFACE,
+	},
+
+	.CDC_NotificationEndpoint = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+		.EndpointAddress          = (ENDPOINT_DIR_IN | TELEMETRY_NOTIFICATION_EPNUM),
+		.Attributes               = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+		.EndpointSize             = TELEMETRY_NOTIFICATION_EPSIZE,
+		.PollingIntervalMS        = 0xFF
+	},
+
+	.CDC_DCI_Interface = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+		.InterfaceNumber          = TELEMETRY_DATA_INTERFACE,
+		.AlternateSetting         = 0,
+
+		.TotalEndpoints           = 2,
+
+		.Class                    = CDC_CSCP_CDCDataClass,
+		.SubClass                 = CDC_CSCP_NoDataSubclass,
+		.Protocol                 = CDC_CSCP_NoDataProtocol,
+
+		.InterfaceStrIndex        = NO_DESCRIPTOR
+	},
+
+	.CDC_DataOutEndpoint = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+		.EndpointAddress          = (ENDPOINT_DIR_OUT | TELEMETRY_RX_EPNUM),
+		.Attributes               = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+		.EndpointSize             = CONFIG_EPSIZE(TELEMETRY_TXRX_EPSIZE),
+		.PollingIntervalMS        = 0x00
+	},
+
+	.CDC_DataInEndpoint = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+		.EndpointAddress          = (ENDPOINT_DIR_IN | TELEMETRY_TX_EPNUM),
+		.Attributes               = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+		.EndpointSize             = CONFIG_EPSIZE(TELEMETRY_TXRX_EPSIZE),
+		.PollingIntervalMS        = 0x00
+	},
+#endif
+
+#if (AUDIO_MIDI_FUNCTION)
+	.MIDI_InterfaceAssociation = {
+		.bLength                  = sizeof(USB_StdDescriptor_Interface_Association_t),
+		.bDescriptorType          = DTYPE_InterfaceAssociation,
+		.bFirstInterface          = MIDI_CONTROL_INTERFACE,
+		.bInterfaceCount          = 2,
+		.bFunctionClass           = AUDIO_CSCP_AudioClass,
+		.bFunctionSubClass        = AUDIO_CSCP_MIDIStreamingSubclass,
+		.bFunctionProtocol        = 0x00,
+		.iFunction                = NO_DESCRIPTOR,
+	},
+
+	.MIDI_ControlInterface = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+		.InterfaceNumber          = MIDI_CONTROL_INTERFACE,
+		.AlternateSetting         = 0,
+
+		.TotalEndpoints           = 0,
+
+		.Class                    = AUDIO_CSCP_AudioClass,
+		.SubClass                 = AUDIO_CSCP_ControlSubclass,
+		.Protocol                 = 0x00,
+
+		.InterfaceStrIndex        = NO_DESCRIPTOR
+	},
+
+	.MIDI_ControlInterface_SPC = {
+		.Header                   = {.Size = sizeof(MIDI_Descriptor_AudioControl_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_Header,
+
+		.ACSpecification          = VERSION_BCD(01.00),
+		.TotalLength              = sizeof(MIDI_Descriptor_AudioControl_t),
+
+		.InCollection             = 1,
+		.InterfaceNumber          = MIDI_STREAM_INTERFACE,
+	},
+
+	.MIDI_StreamInterface = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+		.InterfaceNumber          = MIDI_STREAM_INTERFACE,
+		.AlternateSetting         = 0,
+
+		.TotalEndpoints           = 2,
+
+		.Class                    = AUDIO_CSCP_AudioClass,
+		.SubClass                 = AUDIO_CSCP_MIDIStreamingSubclass,
+		.Protocol                 = 0x00,
+
+		.InterfaceStrIndex        = NO_DESCRIPTOR
+	},
+
+	.MIDI_StreamInterface_SPC = {
+		.Header                   = {.Size = sizeof(USB_MIDI_Descriptor_AudioInterface_AS_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_General,
+
+		.AudioSpecification       = VERSION_BCD(01.00),
+
+		.TotalLength              = offsetof(USB_Descriptor_Configuration_t, MIDI_Out_Jack_Endpoint_SPC)
+									+ sizeof(USB_MIDI_Descriptor_Jack_Endpoint_t)
+									- offsetof(USB_Descriptor_Configuration_t, MIDI_StreamInterface_SPC)
+	},
+
+	/* Host data enters through the OUT endpoint into jack 1 and leaves on the external jack 4,
+	   external jack 2 feeds jack 3 and the IN endpoint */
+	.MIDI_In_Jack_Emb = {
+		.Header                   = {.Size = sizeof(USB_MIDI_Descriptor_InputJack_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_InputTerminal,
+
+		.JackType                 = MIDI_JACKTYPE_Embedded,
+		.JackID                   = 0x01,
+
+		.JackStrIndex             = NO_DESCRIPTOR
+	},
+
+	.MIDI_In_Jack_Ext = {
+		.Header                   = {.Size = sizeof(USB_MIDI_Descriptor_InputJack_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_InputTerminal,
+
+		.JackType                 = MIDI_JACKTYPE_External,
+		.JackID                   = 0x02,
+
+		.JackStrIndex             = NO_DESCRIPTOR
+	},
+
+	.MIDI_Out_Jack_Emb = {
+		.Header                   = {.Size = sizeof(USB_MIDI_Descriptor_OutputJack_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_OutputTerminal,
+
+		.JackType                 = MIDI_JACKTYPE_Embedded,
+		.JackID                   = 0x03,
+
+		.NumberOfPins             = 1,
+		.SourceJackID             = {0x02},
+		.SourcePinID              = {0x01},
+
+		.JackStrIndex             = NO_DESCRIPTOR
+	},
+
+	.MIDI_Out_Jack_Ext = {
+		.Header                   = {.Size = sizeof(USB_MIDI_Descriptor_OutputJack_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_OutputTerminal,
+
+		.JackType                 = MIDI_JACKTYPE_External,
+		.JackID                   = 0x04,
+
+		.NumberOfPins             = 1,
+		.SourceJackID             = {0x01},
+		.SourcePinID              = {0x01},
+
+		.JackStrIndex             = NO_DESCRIPTOR
+	},
+
+	.MIDI_In_Jack_Endpoint = {
+		.Endpoint = {
+			.Header               = {.Size = sizeof(MIDI_Descriptor_StreamEndpoint_t), .Type = DTYPE_Endpoint},
+
+			.EndpointAddress      = (ENDPOINT_DIR_OUT | MIDI_STREAM_EPNUM),
+			.Attributes           = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+			.EndpointSize         = CONFIG_EPSIZE(MIDI_STREAM_EPSIZE),
+			.PollingIntervalMS    = 0x00
+		},
+
+		.Refresh                  = 0,
+		.SyncEndpointNumber       = 0
+	},
+
+	.MIDI_In_Jack_Endpoint_SPC = {
+		.Header                   = {.Size = sizeof(USB_MIDI_Descriptor_Jack_Endpoint_t), .Type = DTYPE_CSEndpoint},
+		.Subtype                  = AUDIO_DSUBTYPE_CSEndpoint_General,
+
+		.TotalEmbeddedJacks       = 0x01,
+		.AssociatedJackID         = {0x01}
+	},
+
+	.MIDI_Out_Jack_Endpoint = {
+		.Endpoint = {
+			.Header               = {.Size = sizeof(MIDI_Descriptor_StreamEndpoint_t), .Type = DTYPE_Endpoint},
+
+			.EndpointAddress      = (ENDPOINT_DIR_IN | MIDI_STREAM_EPNUM),
+			.Attributes           = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+			.EndpointSize         = CONFIG_EPSIZE(MIDI_STREAM_EPSIZE),
+			.PollingIntervalMS    = 0x00
+		},
+
+		.Refresh                  = 0,
+		.SyncEndpointNumber       = 0
+	},
+
+	.MIDI_Out_Jack_Endpoint_SPC = {
+		.Header                   = {.Size = sizeof(USB_MIDI_Descriptor_Jack_Endpoint_t), .Type = DTYPE_CSEndpoint},
+		.Subtype                  = AUDIO_DSUBTYPE_CSEndpoint_General,
+
+		.TotalEmbeddedJacks       = 0x01,
+		.AssociatedJackID         = {0x03}
+	},
+#endif
+
+#if (AUDIO_MSC_FUNCTION)
+	.MSC_Interface = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+		.InterfaceNumber          = MSC_INTERFACE,
+		.AlternateSetting         = 0,
+
+		.TotalEndpoints           = 2,
+
+		.Class                    = MS_CSCP_MassStorageClass,
+		.SubClass                 = MS_CSCP_SCSITransparentSubclass,
+		.Protocol                 = MS_CSCP_BulkOnlyTransportProtocol,
+
+		.InterfaceStrIndex        = NO_DESCRIPTOR
+	},
+
+	.MSC_DataInEndpoint = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+		.EndpointAddress          = (ENDPOINT_DIR_IN | MSC_DATA_EPNUM),
+		.Attributes               = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+		.EndpointSize             = CONFIG_EPSIZE(MSC_DATA_EPSIZE),
+		.PollingIntervalMS        = 0x00
+	},
+
+	.MSC_DataOutEndpoint = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+		.EndpointAddress          = (ENDPOINT_DIR_OUT | MSC_DATA_EPNUM),
+		.Attributes               = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+		.EndpointSize             = CONFIG_EPSIZE(MSC_DATA_EPSIZE),
+		.PollingIntervalMS        = 0x00
+	},
+#endif
+
+#if (AUDIO_RNDIS_FUNCTION)
+	/* Windows binds its RNDIS driver to this IAD class triple, Linux to the CDC vendor protocol below */
+	.RNDIS_InterfaceAssociation = {
+		.bLength                  = sizeof(USB_StdDescriptor_Interface_Association_t),
+		.bDescriptorType          = DTYPE_InterfaceAssociation,
+		.bFirstInterface          = RNDIS_CONTROL_INTERFACE,
+		.bInterfaceCount          = 2,
+		.bFunctionClass           = 0xE0,
+		.bFunctionSubClass        = 0x01,
+		.bFunctionProtocol        = 0x03,
+		.iFunction                = NO_DESCRIPTOR,
+	},
+
+	.RNDIS_CCI_Interface = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+		.InterfaceNumber          = RNDIS_CONTROL_INTERFACE,
+		.AlternateSetting         = 0,
+
+		.TotalEndpoints           = 1,
+
+		.Class                    = CDC_CSCP_CDCClass,
+		.SubClass                 = CDC_CSCP_ACMSubclass,
+		.Protocol                 = CDC_CSCP_VendorSpecificProtocol,
+
+		.InterfaceStrIndex        = NO_DESCRIPTOR
+	},
+
+	.RNDIS_Functional_Header = {
+		.Header                   = {.Size = sizeof(USB_CDC_Descriptor_FunctionalHeader_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = CDC_DSUBTYPE_CSInterface_Header,
+
+		.CDCSpecification         = VERSION_BCD(01.10),
+	},
+
+	.RNDIS_Functional_ACM = {
+		.Header                   = {.Size = sizeof(USB_CDC_Descriptor_FunctionalACM_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = CDC_DSUBTYPE_CSInterface_ACM,
+
+		.Capabilities             = 0x00,
+	},
+
+	.RNDIS_Functional_Union = {
+		.Header                   = {.Size = sizeof(USB_CDC_Descriptor_FunctionalUnion_t), .Type = DTYPE_CSInterface},
+		.Subtype                  = CDC_DSUBTYPE_CSInterface_Union,
+
+		.MasterInterfaceNumber    = RNDIS_CONTROL_INTERFACE,
+		.SlaveInterfaceNumber     = RNDIS_DATA_INTERFACE,
+	},
+
+	.RNDIS_NotificationEndpoint = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+		.EndpointAddress          = (ENDPOINT_DIR_IN | RNDIS_NOTIFICATION_EPNUM),
+		.Attributes               = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+		.EndpointSize             = RNDIS_NOTIFICATION_EPSIZE,
+		.PollingIntervalMS        = 0x08
+	},
+
+	.RNDIS_DCI_Interface = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+		.InterfaceNumber          = RNDIS_DATA_INTERFACE,
+		.AlternateSetting         = 0,
+
+		.TotalEndpoints           = 2,
+
+		.Class                    = CDC_CSCP_CDCDataClass,
+		.SubClass                 = CDC_CSCP_NoDataSubclass,
+		.Protocol                 = CDC_CSCP_NoDataProtocol,
+
+		.InterfaceStrIndex        = NO_DESCRIPTOR
+	},
+
+	.RNDIS_DataOutEndpoint = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+		.EndpointAddress          = (ENDPOINT_DIR_OUT | RNDIS_DATA_EPNUM),
+		.Attributes               = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+		.EndpointSize             = CONFIG_EPSIZE(RNDIS_DATA_EPSIZE),
+		.PollingIntervalMS        = 0x00
+	},
+
+	.RNDIS_DataInEndpoint = {
+		.Header                   = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+		.EndpointAddress          = (ENDPOINT_DIR_IN | RNDIS_DATA_EPNUM),
+		.Attributes               = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+		.EndpointSize             = CONFIG_EPSIZE(RNDIS_DATA_EPSIZE),
+		.PollingIntervalMS        = 0x00
+	},
+#endif
+
+/*
+	.my_bytes = {0x09, 0x04, 0x02, 0x00, 0x01, 0x03, 0x00, 0x00, 0x00,
+	             0x09, 0x21, 0x10, 0x01, 0x00, 0x01, 0x02, 0x1f, 0x00,
+	             0x07, 0x05, 0x82, 0x03, 0x01, 0x00, 0x0a},
+*/
+	.Audio_Termination = 0x00
@@ -0,0 +1,195 @@
+/*
+ * @brief Benchmark of CPU and DMA memory moves across the SRAM banks
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+
+#include <string.h>
+#include "CopyBench.h"
+#include "dma_manager.h"
+#include "dma_copy.h"
+
+#if (AUDIO_COPY_BENCH)
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#if (COPY_BENCH_BYTES % 4) || (COPY_BENCH_BYTES > 16380)
+#error COPY_BENCH_BYTES must be a multiple of 4 up to 16380
+#endif
+
+#define COPY_BENCH_WORDS    (COPY_BENCH_BYTES / 4)
+#define COPY_BENCH_BANKS    5
+
+/* One scratch buffer per bank, RAM to RAM5 are the banks of the managed linker script */
+static uint32_t CopyBench_Loc32[COPY_BENCH_WORDS];
+static uint32_t CopyBench_Loc40[COPY_BENCH_WORDS] __BSS(RAM2);
+static uint32_t CopyBench_AHB32[COPY_BENCH_WORDS] __BSS(RAM3);
+static uint32_t CopyBench_AHB16[COPY_BENCH_WORDS] __BSS(RAM4);
+static uint32_t CopyBench_ETB16[COPY_BENCH_WORDS] __BSS(RAM5);
+
+static uint32_t *const CopyBench_Buffers[COPY_BENCH_BANKS] = {
+	CopyBench_Loc32, CopyBench_Loc40, CopyBench_AHB32, CopyBench_AHB16, CopyBench_ETB16,
+};
+
+static const char *const CopyBench_Names[COPY_BENCH_BANKS] = {
+	"Loc32", "Loc40", "AHB32", "AHB16", "ETB16",
+};
+
+/* Fastest run of each figure */
+typedef struct {
+	uint32_t Cpu;
+	uint32_t Dma;
+	uint32_t Submit;
+} COPY_BENCH_RESULT_T;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static void CopyBench_Keep(uint32_t *Best, uint32_t Cycles)
+{
+	if (Cycles < *Best) {
+		*Best = Cycles;
+	}
+}
+
+/* Copy, or fill when src is NULL, through the CPU and the DMA copy service */
+static void CopyBench_Service(uint32_t *dst, const uint32_t *src, COPY_BENCH_RESULT_T *Result)
+{
+	DMA_COPY_T copy;
+	uint32_t run, start, submitted;
+
+	Result->Cpu = Result->Dma = Result->Submit = 0xFFFFFFFF;
+	for (run = 0; run < COPY_BENCH_RUNS; run++) {
+		start = DWT->CYCCNT;
+		if (src != NULL) {
+			memcpy(dst, src, COPY_BENCH_BYTES);
+		}
+		else {
+			memset(dst, 0x5A, COPY_BENCH_BYTES);
+		}
+		CopyBench_Keep(&Result->Cpu, DWT->CYCCNT - start);
+
+		start = DWT->CYCCNT;
+		if (src != NULL) {
+			DMA_Memcpy(&copy, dst, src, COPY_BENCH_BYTES, NULL);
+		}
+		else {
+			DMA_Memset(&copy, dst, 0x5A, COPY_BENCH_BYTES, NULL);
+		}
+		submitted = DWT->CYCCNT;
+		DMA_Copy_Wait(&copy);
+		CopyBench_Keep(&Result->Dma, DWT->CYCCNT - start);
+		CopyBench_Keep(&Result->Submit, submitted - start);
+	}
+}
+
+/* CPU against a bare DMA transfer of the same size, polled to completion */
+static void CopyBench_Bare(uint8_t Channel, uint32_t Bytes, COPY_BENCH_RESULT_T *Result)
+{
+	uint32_t run, start;
+
+	Result->Cpu = Result->Dma = 0xFFFFFFFF;
+	Result->Submit = 0;
+	for (run = 0; run < COPY_BENCH_RUNS; run++) {
+		start = DWT->CYCCNT;
+		memcpy(CopyBench_AHB32, CopyBench_Loc32, Bytes);
+		CopyBench_Keep(&Result->Cpu, DWT->CYCCNT - start);
+
+		start = DWT->CYCCNT;
+		DMA_Manager_Transfer(Channel, (uint32_t) CopyBench_Loc32, (uint32_t) CopyBench_AHB32,
+							 GPDMA_TRANSFERTYPE_M2M_CONTROLLER_DMA, Bytes);
+		while (DMA_Manager_IsBusy(Channel)) {}
+		CopyBench_Keep(&Result->Dma, DWT->CYCCNT - start);
+	}
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Run the benchmark and print the results */
+void CopyBench_Run(void)
+{
+	COPY_BENCH_RESULT_T result;
+	uint32_t s, d, bytes;
+	uint8_t channel;
+
+	for (s = 0; s < COPY_BENCH_BANKS; s++) {
+		for (d = 0; d < COPY_BENCH_WORDS; d++) {
+			CopyBench_Buffers[s][d] = (s << 24) | d;
+		}
+	}
+
+	printf("\r\nCopy of %u bytes, core cycles: CPU / DMA done / DMA submit\r\n", COPY_BENCH_BYTES);
+	printf("from \\ to");
+	for (d = 0; d < COPY_BENCH_BANKS; d++) {
+		printf("  %-20s", CopyBench_Names[d]);
+	}
+	printf("\r\n");
+	for (s = 0; s < COPY_BENCH_BANKS; s++) {
+		printf("%-9s", CopyBench_Names[s]);
+		for (d = 0; d < COPY_BENCH_BANKS; d++) {
+			if (s == d) {
+				printf("  %-20s", "-");
+				continue;
+			}
+			CopyBench_Service(CopyBench_Buffers[d], CopyBench_Buffers[s], &result);
+			printf("  %6u/%6u/%6u", result.Cpu, result.Dma, result.Submit);
+		}
+		printf("\r\n");
+	}
+
+	printf("\r\nFill of %u bytes, core cycles: CPU / DMA done / DMA submit\r\n", COPY_BENCH_BYTES);
+	for (d = 0; d < COPY_BENCH_BANKS; d++) {
+		CopyBench_Service(CopyBench_Buffers[d], NULL, &result);
+		printf("%-9s  %6u/%6u/%6u\r\n", CopyBench_Names[d], result.Cpu, result.Dma, result.Submit);
+	}
+
+	/* The service keeps small moves on the CPU, so the sweep drives a channel of its own */
+	channel = DMA_Manager_Alloc(DMA_PRIORITY_LOW, NULL, NULL);
+	if (channel == DMA_MANAGER_NO_CHANNEL) {
+		return;
+	}
+	printf("\r\nLoc32 to AHB32 by size, core cycles: CPU / bare DMA (threshold %u)\r\n", DMA_COPY_THRESHOLD);
+	for (bytes = 16; bytes <= COPY_BENCH_BYTES; bytes *= 2) {
+		CopyBench_Bare(channel, bytes, &result);
+		printf("%6u  %6u/%6u%s\r\n", bytes, result.Cpu, result.Dma, (result.Dma < result.Cpu) ? "  DMA faster" : "");
+	}
+	DMA_Manager_Free(channel);
+}
+
+#endif /* AUDIO_COPY_BENCH */
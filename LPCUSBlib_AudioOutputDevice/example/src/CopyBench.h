@@ -0,0 +1,96 @@
+/*
+ * @brief Benchmark of CPU and DMA memory moves across the SRAM banks
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#ifndef _COPY_BENCH_H_
+#define _COPY_BENCH_H_
+
+#include "board.h"
+#include "USB.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_CopyBench Memory move benchmark
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * Built with AUDIO_COPY_BENCH=1, main() times memcpy() and memset() against
+ * the DMA copy service (dma_copy.h) once at startup and prints the results on
+ * the console:
+ *  - a COPY_BENCH_BYTES copy between every pair of SRAM banks: local SRAM at
+ *    0x10000000 and 0x10080000, AHB SRAM at 0x20000000, 0x20008000 and
+ *    0x2000C000. For the DMA both the time to completion and the cycles the
+ *    caller spends submitting are shown, the difference is what the core gets
+ *    back for other work;
+ *  - a fill of each bank;
+ *  - a copy from local to AHB SRAM for sizes from 16 bytes up, CPU against a
+ *    bare DMA transfer, which is where DMA_COPY_THRESHOLD should sit.
+ *
+ * Every figure is the lowest of COPY_BENCH_RUNS runs, in core cycles, so
+ * interrupts taken during a run do not count. The scratch buffers take
+ * COPY_BENCH_BYTES in each bank and exist only in the benchmark build.
+ * @{
+ */
+
+/** @brief	Set to 1 to run the benchmark at startup */
+#ifndef AUDIO_COPY_BENCH
+#define AUDIO_COPY_BENCH            0
+#endif
+
+#if (AUDIO_COPY_BENCH)
+
+/** Bytes moved per bank pair, a multiple of 4 up to 16380 */
+#ifndef COPY_BENCH_BYTES
+#define COPY_BENCH_BYTES            4096
+#endif
+/** Runs per figure, the fastest one is kept */
+#ifndef COPY_BENCH_RUNS
+#define COPY_BENCH_RUNS             4
+#endif
+
+/**
+ * @brief	Run the benchmark and print the results
+ * @return	Nothing
+ * @note	Call after DMA_Copy_Init(), from the main loop context.
+ */
+void CopyBench_Run(void);
+
+#endif /* AUDIO_COPY_BENCH */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _COPY_BENCH_H_ */
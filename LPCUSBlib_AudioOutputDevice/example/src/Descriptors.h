@@ -59,6 +59,229 @@ extern "C" {
  */
 		#define AUDIO_STREAM_EPSIZE          ENDPOINT_MAX_SIZE(AUDIO_STREAM_EPNUM)
 
+/** @brief	Stream format of the audio function: channel cluster, bytes per subslot and valid bits.
+ *          The playback and capture descriptors both take their format from here.
+ */
+		#define AUDIO_CHANNELS               2
+		#define AUDIO_CHANNEL_CONFIG         (AUDIO_CHANNEL_LEFT_FRONT | AUDIO_CHANNEL_RIGHT_FRONT)
+		#define AUDIO_SUBSLOT_SIZE           2
+		#define AUDIO_BIT_RESOLUTION         16
+
+/** @brief	Sampling frequencies offered to the host, as a list of RATE(Hz) entries. The Audio 1.0
+ *          descriptors list them in the format descriptor. The Audio 2.0 function has one clock
+ *          source per rate family, each reporting its own list as discrete ranges, behind a clock
+ *          selector the terminals are clocked from. Adding a rate here adds it to both.
+ */
+		#ifndef USB_AUDIO_2DOT0
+			#define AUDIO_SAMPLE_RATES(RATE) RATE(8000) RATE(11025) RATE(16000) RATE(22050) RATE(32000) RATE(44100) RATE(48000)
+		#else
+			#define AUDIO_SAMPLE_RATES_48K(RATE)  RATE(16000) RATE(32000) RATE(48000)
+			#define AUDIO_SAMPLE_RATES_44K1(RATE) RATE(11025) RATE(22050) RATE(44100)
+			#define AUDIO_SAMPLE_RATES(RATE) AUDIO_SAMPLE_RATES_48K(RATE) AUDIO_SAMPLE_RATES_44K1(RATE)
+
+/** @brief	Clock entities: the 48 kHz and 44.1 kHz family clock sources, in selector pin order,
+ *          and the clock selector between them.
+ */
+			#define AUDIO_CLOCK_SOURCE_48K       0
+			#define AUDIO_CLOCK_SOURCE_44K1      1
+			#define AUDIO_CLOCK_SOURCES          2
+			#define AUDIO_CLOCK_SOURCE_48K_ID    0x10
+			#define AUDIO_CLOCK_SOURCE_44K1_ID   0x11
+			#define AUDIO_CLOCK_SELECTOR_ID      0x12
+
+/** @brief	Feature unit in front of the output terminal, carries the master mute and volume controls. */
+			#define AUDIO_CONTROL_FEATURE_UNIT_ID 0x30
+		#endif
+		#define AUDIO_SAMPLE_RATE_ONE(Rate)  + 1
+/** @brief	Number of entries in AUDIO_SAMPLE_RATES. */
+		#define AUDIO_SAMPLE_RATE_COUNT      (0 AUDIO_SAMPLE_RATES(AUDIO_SAMPLE_RATE_ONE))
+
+/** @brief	Set to 1 to add a capture path to the audio function: I2S RX samples are sent to the host on
+ *          an isochronous IN endpoint of a second streaming interface, clocked by the same clock source
+ *          as playback. It takes endpoint 1 IN, which the USB ROM driver build uses for explicit
+ *          feedback, and needs the Audio 2.0 descriptors.
+ */
+		#ifndef AUDIO_CAPTURE_FUNCTION
+			#if defined(USB_DEVICE_ROM_DRIVER) || !defined(USB_AUDIO_2DOT0)
+				#define AUDIO_CAPTURE_FUNCTION   0
+			#else
+				#define AUDIO_CAPTURE_FUNCTION   1
+			#endif
+		#endif
+
+		#if (AUDIO_CAPTURE_FUNCTION) && (defined(USB_DEVICE_ROM_DRIVER) || !defined(USB_AUDIO_2DOT0))
+			#error AUDIO_CAPTURE_FUNCTION needs endpoint 1 IN and the Audio 2.0 descriptors of the LPCUSBlib stack
+		#endif
+
+#if (AUDIO_CAPTURE_FUNCTION)
+/**
+ * @brief Interface and endpoint numbers of the capture streaming interface. It shares endpoint
+ *        number 1 with the playback stream, in the other direction, on both ports.
+ */
+		#define CAPTURE_STREAM_INTERFACE     2
+		#define CAPTURE_STREAM_EPNUM         1
+/** @brief	bInterval of the capture endpoint, the same as the playback endpoint. */
+		#define CAPTURE_STREAM_INTERVAL      0x02
+/** @brief	Capture packets per second at high speed and at full speed. */
+		#define CAPTURE_PACKET_RATE_HS       (8000 >> (CAPTURE_STREAM_INTERVAL - 1))
+		#define CAPTURE_PACKET_RATE_FS       (1000 >> (CAPTURE_STREAM_INTERVAL - 1))
+/** @brief	Highest capture sampling frequency and bytes per stereo 16 bit frame. */
+		#define CAPTURE_MAX_SAMPLE_FREQ      48000
+		#define CAPTURE_FRAME_BYTES          (AUDIO_CHANNELS * AUDIO_SUBSLOT_SIZE)
+/** @brief	Size in bytes of the capture endpoint: the nominal frames of one packet plus one for the rate servo. */
+		#define CAPTURE_STREAM_EPSIZE_HS     ((CAPTURE_MAX_SAMPLE_FREQ / CAPTURE_PACKET_RATE_HS + 1) * CAPTURE_FRAME_BYTES)
+		#define CAPTURE_STREAM_EPSIZE_FS     ((CAPTURE_MAX_SAMPLE_FREQ / CAPTURE_PACKET_RATE_FS + 1) * CAPTURE_FRAME_BYTES)
+#endif
+
+/** @brief	Number of interfaces of the audio function: control, playback streaming and capture streaming. */
+		#define AUDIO_FUNCTION_INTERFACES    (2 + ((AUDIO_CAPTURE_FUNCTION) ? 1 : 0))
+
+/** @brief	Set to 1 to add a CDC-ACM telemetry function next to the audio function, off unless
+ *          the build configuration defines it (the Debug configuration does). The USB ROM driver
+ *          glue has no CDC handler, so that build keeps the audio only configuration.
+ */
+		#ifndef AUDIO_TELEMETRY_CDC
+			#define AUDIO_TELEMETRY_CDC          0
+		#elif defined(USB_DEVICE_ROM_DRIVER)
+			#undef AUDIO_TELEMETRY_CDC
+			#define AUDIO_TELEMETRY_CDC          0
+		#endif
+
+/** @brief	Set to 1 to add an RNDIS network adapter function on the port given by RNDIS_PORT.
+ *          It needs the two endpoints the MIDI and mass storage functions use, so those default
+ *          to off when it is selected.
+ */
+		#ifndef AUDIO_RNDIS_FUNCTION
+			#define AUDIO_RNDIS_FUNCTION         0
+		#endif
+
+/** @brief	Set to 1 to add a USB-MIDI function on the port given by MIDI_PORT, off unless the
+ *          build configuration defines it (the Debug configuration does). The USB ROM driver
+ *          glue has no MIDI handler, so that build keeps the audio only configuration, and an
+ *          RNDIS build gives its endpoints to the network adapter.
+ */
+		#ifndef AUDIO_MIDI_FUNCTION
+			#define AUDIO_MIDI_FUNCTION          0
+		#elif defined(USB_DEVICE_ROM_DRIVER) || (AUDIO_RNDIS_FUNCTION)
+			#undef AUDIO_MIDI_FUNCTION
+			#define AUDIO_MIDI_FUNCTION          0
+		#endif
+
+/** @brief	Set to 1 to add a mass storage function backed by a RAM disk on the port given by
+ *          MSC_PORT, off unless the build configuration defines it (the Debug configuration
+ *          does). The USB ROM driver glue has no MSC handler, so that build keeps the audio only
+ *          configuration, and an RNDIS build gives its endpoint to the network adapter.
+ */
+		#ifndef AUDIO_MSC_FUNCTION
+			#define AUDIO_MSC_FUNCTION           0
+		#elif defined(USB_DEVICE_ROM_DRIVER) || (AUDIO_RNDIS_FUNCTION)
+			#undef AUDIO_MSC_FUNCTION
+			#define AUDIO_MSC_FUNCTION           0
+		#endif
+
+		#if (AUDIO_RNDIS_FUNCTION) && ((AUDIO_MIDI_FUNCTION) || (AUDIO_MSC_FUNCTION) || defined(USB_DEVICE_ROM_DRIVER))
+			#error AUDIO_RNDIS_FUNCTION needs USB0 endpoints 4 and 5 and the LPCUSBlib stack
+		#endif
+
+/** @brief	The audio function is wrapped in an interface association descriptor for UAC2 and
+ *          whenever it shares the device with another function.
+ */
+		#if defined(USB_AUDIO_2DOT0) || (AUDIO_TELEMETRY_CDC) || (AUDIO_MIDI_FUNCTION) || (AUDIO_MSC_FUNCTION) || \
+			(AUDIO_RNDIS_FUNCTION)
+			#define AUDIO_FUNCTION_IAD
+		#endif
+
+#if (AUDIO_TELEMETRY_CDC)
+/**
+ * @brief Interface and endpoint numbers of the telemetry CDC-ACM function
+ */
+		#define TELEMETRY_CONTROL_INTERFACE  AUDIO_FUNCTION_INTERFACES
+		#define TELEMETRY_DATA_INTERFACE     (TELEMETRY_CONTROL_INTERFACE + 1)
+		#define TELEMETRY_NOTIFICATION_EPNUM 2
+		#define TELEMETRY_TX_EPNUM           3
+		#define TELEMETRY_RX_EPNUM           3
+/** @brief	Size in bytes of the telemetry notification endpoint. */
+		#define TELEMETRY_NOTIFICATION_EPSIZE 8
+/** @brief	Size in bytes of the telemetry bulk endpoints at high speed. */
+		#define TELEMETRY_TXRX_EPSIZE_HS     512
+/** @brief	Size in bytes of the telemetry bulk endpoints at full speed. */
+		#define TELEMETRY_TXRX_EPSIZE_FS     64
+#endif
+
+#if (AUDIO_MIDI_FUNCTION)
+/**
+ * @brief Port, interface and endpoint numbers of the USB-MIDI function. USB1 only has
+ *        endpoints 1 to 3, so the function lives on USB0 and is cut from the USB1
+ *        configuration descriptor.
+ */
+		#define MIDI_PORT                    0
+		#define MIDI_CONTROL_INTERFACE       (AUDIO_FUNCTION_INTERFACES + ((AUDIO_TELEMETRY_CDC) ? 2 : 0))
+		#define MIDI_STREAM_INTERFACE        (MIDI_CONTROL_INTERFACE + 1)
+		#define MIDI_STREAM_EPNUM            4
+/** @brief	Size in bytes of the MIDI bulk endpoints at high speed. */
+		#define MIDI_STREAM_EPSIZE_HS        512
+/** @brief	Size in bytes of the MIDI bulk endpoints at full speed. */
+		#define MIDI_STREAM_EPSIZE_FS        64
+
+/** @brief	Audio 1.0 class-specific AC interface header. MIDI 1.0 streaming interfaces hang
+ *          off an Audio 1.0 control interface, while USB_Audio_Descriptor_Interface_AC_t
+ *          has the Audio 2.0 layout in this build.
+ */
+typedef ATTR_IAR_PACKED struct {
+	USB_Descriptor_Header_t Header;
+	uint8_t                 Subtype;
+	uint16_t                ACSpecification;
+	uint16_t                TotalLength;
+	uint8_t                 InCollection;
+	uint8_t                 InterfaceNumber;
+} ATTR_PACKED MIDI_Descriptor_AudioControl_t;
+
+/** @brief	Audio 1.0 standard endpoint descriptor used by the MIDI streaming endpoints. */
+typedef ATTR_IAR_PACKED struct {
+	USB_Descriptor_Endpoint_t Endpoint;
+	uint8_t                   Refresh;
+	uint8_t                   SyncEndpointNumber;
+} ATTR_PACKED MIDI_Descriptor_StreamEndpoint_t;
+#endif
+
+#if (AUDIO_MSC_FUNCTION)
+/**
+ * @brief Port, interface and endpoint numbers of the mass storage function. It uses
+ *        endpoint 5, which only USB0 has, so it follows the MIDI function at the end of
+ *        the configuration descriptor and is cut from the USB1 copy as well.
+ */
+		#define MSC_PORT                     0
+		#define MSC_INTERFACE                (AUDIO_FUNCTION_INTERFACES + ((AUDIO_TELEMETRY_CDC) ? 2 : 0) + ((AUDIO_MIDI_FUNCTION) ? 2 : 0))
+		#define MSC_DATA_EPNUM               5
+/** @brief	Size in bytes of the mass storage bulk endpoints at high speed. */
+		#define MSC_DATA_EPSIZE_HS           512
+/** @brief	Size in bytes of the mass storage bulk endpoints at full speed. */
+		#define MSC_DATA_EPSIZE_FS           64
+#endif
+
+#if (AUDIO_RNDIS_FUNCTION)
+/**
+ * @brief Port, interface and endpoint numbers of the RNDIS function. It takes endpoints 4
+ *        and 5 of USB0, so it sits at the end of the configuration descriptor in place of
+ *        the MIDI and mass storage functions and is cut from the USB1 copy the same way.
+ */
+		#define RNDIS_PORT                   0
+		#define RNDIS_CONTROL_INTERFACE      (AUDIO_FUNCTION_INTERFACES + ((AUDIO_TELEMETRY_CDC) ? 2 : 0))
+		#define RNDIS_DATA_INTERFACE         (RNDIS_CONTROL_INTERFACE + 1)
+		#define RNDIS_NOTIFICATION_EPNUM     4
+		#define RNDIS_DATA_EPNUM             5
+/** @brief	Size in bytes of the RNDIS notification endpoint. */
+		#define RNDIS_NOTIFICATION_EPSIZE    8
+/** @brief	Size in bytes of the RNDIS bulk endpoints at high speed. */
+		#define RNDIS_DATA_EPSIZE_HS         512
+/** @brief	Size in bytes of the RNDIS bulk endpoints at full speed. */
+		#define RNDIS_DATA_EPSIZE_FS         64
+#endif
+
+/** @brief	Number of interfaces in the full configuration. */
+		#define AUDIO_TOTAL_INTERFACES       (AUDIO_FUNCTION_INTERFACES + ((AUDIO_TELEMETRY_CDC) ? 2 : 0) + ((AUDIO_MIDI_FUNCTION) ? 2 : 0) + \
+											  ((AUDIO_MSC_FUNCTION) ? 1 : 0) + ((AUDIO_RNDIS_FUNCTION) ? 2 : 0))
+
 /** @brief	Type define for the device configuration descriptor structure. This must be defined in the
  *          application code, as the configuration descriptor contains several sub-descriptors which
  *          vary between devices, and which describe the device's usage to the host.
@@ -66,7 +289,7 @@ extern "C" {
 typedef struct {
 	USB_Descriptor_Configuration_Header_t     Config;
 
-#ifdef USB_AUDIO_2DOT0
+#ifdef AUDIO_FUNCTION_IAD
 	//
 	USB_StdDescriptor_Interface_Association_t InterfaceAssociation;
 #endif
@@ -75,13 +298,19 @@ typedef struct {
 	USB_Descriptor_Interface_t                Audio_ControlInterface;
 	USB_Audio_Descriptor_Interface_AC_t       Audio_ControlInterface_SPC;
 #ifdef USB_AUDIO_2DOT0
-	USB_Audio_StdDescriptor_Source_Clock_t    Audio_SourceClock;
+	USB_Audio_StdDescriptor_Source_Clock_t    Audio_SourceClock48k;
+	USB_Audio_StdDescriptor_Source_Clock_t    Audio_SourceClock44k1;
+	USB_Audio_StdDescriptor_Clock_Selector_t  Audio_ClockSelector;
 #endif
 	USB_Audio_Descriptor_InputTerminal_t      Audio_InputTerminal;
 #ifdef USB_AUDIO_2DOT0
 	USB_Audio_StdDescriptor_FeatureUnit_t     Audio_FeatureUnit;
 #endif
 	USB_Audio_Descriptor_OutputTerminal_t     Audio_OutputTerminal;
+#if (AUDIO_CAPTURE_FUNCTION)
+	USB_Audio_Descriptor_InputTerminal_t      Capture_InputTerminal;
+	USB_Audio_Descriptor_OutputTerminal_t     Capture_OutputTerminal;
+#endif
 
 	// Audio Streaming Interface
 	USB_Descriptor_Interface_t                Audio_StreamInterface_Alt0;
@@ -89,13 +318,75 @@ typedef struct {
 	USB_Audio_Descriptor_Interface_AS_t       Audio_StreamInterface_SPC;
 	USB_Audio_Descriptor_Format_t             Audio_AudioFormat;
 #ifndef USB_AUDIO_2DOT0
-	USB_Audio_SampleFreq_t                    Audio_AudioFormatSampleRates[7];
+	USB_Audio_SampleFreq_t                    Audio_AudioFormatSampleRates[AUDIO_SAMPLE_RATE_COUNT];
 #endif
 	USB_Audio_Descriptor_StreamEndpoint_Std_t Audio_StreamEndpointOut;
 	USB_Audio_Descriptor_StreamEndpoint_Spc_t Audio_StreamEndpoint_SPC;
-#ifdef USB_AUDIO_2DOT0
+#if defined(USB_AUDIO_2DOT0) && !(AUDIO_CAPTURE_FUNCTION)
 	USB_Audio_Descriptor_StreamEndpoint_Std_t Audio_StreamEndpointIn;
 #endif
+
+#if (AUDIO_CAPTURE_FUNCTION)
+	// Capture Streaming Interface
+	USB_Descriptor_Interface_t                Capture_StreamInterface_Alt0;
+	USB_Descriptor_Interface_t                Capture_StreamInterface_Alt1;
+	USB_Audio_Descriptor_Interface_AS_t       Capture_StreamInterface_SPC;
+	USB_Audio_Descriptor_Format_t             Capture_AudioFormat;
+	USB_Audio_Descriptor_StreamEndpoint_Std_t Capture_StreamEndpoint;
+	USB_Audio_Descriptor_StreamEndpoint_Spc_t Capture_StreamEndpoint_SPC;
+#endif
+
+#if (AUDIO_TELEMETRY_CDC)
+	// Telemetry CDC Control Interface
+	USB_StdDescriptor_Interface_Association_t CDC_InterfaceAssociation;
+	USB_Descriptor_Interface_t                CDC_CCI_Interface;
+	USB_CDC_Descriptor_FunctionalHeader_t     CDC_Functional_Header;
+	USB_CDC_Descriptor_FunctionalACM_t        CDC_Functional_ACM;
+	USB_CDC_Descriptor_FunctionalUnion_t      CDC_Functional_Union;
+	USB_Descriptor_Endpoint_t                 CDC_NotificationEndpoint;
+
+	// Telemetry CDC Data Interface
+	USB_Descriptor_Interface_t                CDC_DCI_Interface;
+	USB_Descriptor_Endpoint_t                 CDC_DataOutEndpoint;
+	USB_Descriptor_Endpoint_t                 CDC_DataInEndpoint;
+#endif
+
+#if (AUDIO_MIDI_FUNCTION)
+	// MIDI function, kept at the end with the other USB0 only functions so USB1 can cut them off
+	USB_StdDescriptor_Interface_Association_t MIDI_InterfaceAssociation;
+	USB_Descriptor_Interface_t                MIDI_ControlInterface;
+	MIDI_Descriptor_AudioControl_t            MIDI_ControlInterface_SPC;
+	USB_Descriptor_Interface_t                MIDI_StreamInterface;
+	USB_MIDI_Descriptor_AudioInterface_AS_t   MIDI_StreamInterface_SPC;
+	USB_MIDI_Descriptor_InputJack_t           MIDI_In_Jack_Emb;
+	USB_MIDI_Descriptor_InputJack_t           MIDI_In_Jack_Ext;
+	USB_MIDI_Descriptor_OutputJack_t          MIDI_Out_Jack_Emb;
+	USB_MIDI_Descriptor_OutputJack_t          MIDI_Out_Jack_Ext;
+	MIDI_Descriptor_StreamEndpoint_t          MIDI_In_Jack_Endpoint;
+	USB_MIDI_Descriptor_Jack_Endpoint_t       MIDI_In_Jack_Endpoint_SPC;
+	MIDI_Descriptor_StreamEndpoint_t          MIDI_Out_Jack_Endpoint;
+	USB_MIDI_Descriptor_Jack_Endpoint_t       MIDI_Out_Jack_Endpoint_SPC;
+#endif
+
+#if (AUDIO_MSC_FUNCTION)
+	// Mass storage function, USB0 only like MIDI
+	USB_Descriptor_Interface_t                MSC_Interface;
+	USB_Descriptor_Endpoint_t                 MSC_DataInEndpoint;
+	USB_Descriptor_Endpoint_t                 MSC_DataOutEndpoint;
+#endif
+
+#if (AUDIO_RNDIS_FUNCTION)
+	// RNDIS function, USB0 only, replaces MIDI and mass storage
+	USB_StdDescriptor_Interface_Association_t RNDIS_InterfaceAssociation;
+	USB_Descriptor_Interface_t                RNDIS_CCI_Interface;
+	USB_CDC_Descriptor_FunctionalHeader_t     RNDIS_Functional_Header;
+	USB_CDC_Descriptor_FunctionalACM_t        RNDIS_Functional_ACM;
+	USB_CDC_Descriptor_FunctionalUnion_t      RNDIS_Functional_Union;
+	USB_Descriptor_Endpoint_t                 RNDIS_NotificationEndpoint;
+	USB_Descriptor_Interface_t                RNDIS_DCI_Interface;
+	USB_Descriptor_Endpoint_t                 RNDIS_DataOutEndpoint;
+	USB_Descriptor_Endpoint_t                 RNDIS_DataInEndpoint;
+#endif
 	//unsigned char                             my_bytes[25];
 	unsigned char                             Audio_Termination;
 } USB_Descriptor_Configuration_t;
@@ -112,11 +403,26 @@ _Pragma("pack()")
 _Pragma("pack(1)")
 typedef struct _USB_Cntrl_Ranges {
  uint16_t        numranges;
- USB_Ctrl_Range  ranges[3];
+ USB_Ctrl_Range  ranges[AUDIO_SAMPLE_RATE_COUNT];
 } USB_Cntrl_Ranges;
 _Pragma("pack()")
 
-void Get_USB_Control_Ranges(uint16_t *DataLength, uint8_t *Data);
+/* Layout 2 (16 bit) range block, one subrange, for the feature unit volume */
+_Pragma("pack(1)")
+typedef struct _USB_Ctrl_Range_2 {
+ int16_t     min;
+ int16_t     max;
+ int16_t     res;
+} USB_Ctrl_Range_2;
+_Pragma("pack()")
+
+_Pragma("pack(1)")
+typedef struct _USB_Cntrl_Ranges_2 {
+ uint16_t          numranges;
+ USB_Ctrl_Range_2  ranges[1];
+} USB_Cntrl_Ranges_2;
+_Pragma("pack()")
+
 #endif
 
 uint16_t CALLBACK_USB_GetDescriptor(uint8_t corenum,
@@ -125,8 +431,11 @@ uint16_t CALLBACK_USB_GetDescriptor(uint8_t corenum,
 									const void * *const DescriptorAddress)
 ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(4);
 
-USB_Descriptor_Device_t DeviceDescriptor;
-USB_Descriptor_Configuration_t ConfigurationDescriptor;
+/** @brief	Device descriptor and the high speed configuration descriptor of USB0, both in flash. The
+ *          USB ROM driver glue registers them directly.
+ */
+extern const USB_Descriptor_Device_t DeviceDescriptor;
+extern const USB_Descriptor_Configuration_t ConfigurationDescriptor;
 
 /**
  * @}
@@ -0,0 +1,39 @@
+/*
+ * @brief I2S divider tables, generated by example/tools/i2s_dividers.py
+ *
+ * Do not edit, regenerate with
+ *   i2s_dividers.py generate -o example/src/I2SDividers.h
+ * Included once, by AudioRates.c.
+ */
+
+#define I2S_DIVIDERS_WORD_WIDTH     16
+#define I2S_DIVIDERS_TRIM_PPM       40
+
+/* CLK_APB1_I2S = 180000000 Hz */
+static const I2S_DIVIDER_ENTRY_T I2S_Dividers180MHz[] = {
+	/* Rate	ppm down, up	BITRATE	RATE_Up(x,y)	RATE_Down(x,y) */
+	{8000,	-81, 115,	{0x22,	{0x17,	0xE7},	{0x16,	0xDD}}},
+	{11025,	-50, 64,	{0x3D,	{0x23,	0x90},	{0x3D,	0xFB}}},
+	{16000,	-74, 53,	{0x2A,	{0x39,	0xE9},	{0x22,	0x8B}}},
+	{22050,	-50, 64,	{0x3D,	{0x23,	0x48},	{0x7A,	0xFB}}},
+	{32000,	-63, 50,	{0x2E,	{0x7B,	0xE6},	{0x4D,	0x90}}},
+	{44100,	-45, 50,	{0x38,	{0x65,	0x71},	{0xB9,	0xCF}}},
+	{48000,	-58, 53,	{0x2C,	{0x95,	0xC2},	{0x8B,	0xB5}}},
+};
+
+/* CLK_APB1_I2S = 204000000 Hz */
+static const I2S_DIVIDER_ENTRY_T I2S_Dividers204MHz[] = {
+	/* Rate	ppm down, up	BITRATE	RATE_Up(x,y)	RATE_Down(x,y) */
+	{8000,	-61, 94,	{0x37,	{0x23,	0xF9},	{0x1A,	0xB9}}},
+	{11025,	-95, 42,	{0x3F,	{0x1D,	0x83},	{0x38,	0xFD}}},
+	{16000,	-74, 73,	{0x2A,	{0x31,	0xE3},	{0x1E,	0x8B}}},
+	{22050,	-48, 42,	{0x3F,	{0x3A,	0x83},	{0x55,	0xC0}}},
+	{32000,	-52, 59,	{0x34,	{0x3A,	0x6D},	{0x53,	0x9C}}},
+	{44100,	-48, 42,	{0x1F,	{0x3A,	0x83},	{0x55,	0xC0}}},
+	{48000,	-51, 57,	{0x36,	{0x52,	0x63},	{0xBC,	0xE3}}},
+};
+
+static const I2S_DIVIDER_TABLE_T I2S_DividerTables[] = {
+	{180000000, sizeof(I2S_Dividers180MHz) / sizeof(I2S_Dividers180MHz[0]), I2S_Dividers180MHz},
+	{204000000, sizeof(I2S_Dividers204MHz) / sizeof(I2S_Dividers204MHz[0]), I2S_Dividers204MHz},
+};
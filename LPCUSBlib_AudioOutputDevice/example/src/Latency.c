@@ -0,0 +1,213 @@
+/*
+ * @brief Marker based latency and jitter measurement of the audio paths
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#include "Latency.h"
+
+#if (AUDIO_LATENCY_PROBE)
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/* Longest interval, the cycle counter wraps after 21 s at 204 MHz */
+#define LATENCY_MAX_INTERVAL_MS     10000
+
+/* Results of one path */
+typedef struct {
+	uint32_t Count;
+	uint32_t Lost;
+	uint32_t MinUs;
+	uint32_t MaxUs;
+	uint64_t SumUs;
+	uint64_t SumSquaresUs;
+	uint16_t Bins[TELEMETRY_LATENCY_BINS];
+} LATENCY_DIST_T;
+
+/* Per port probe state */
+typedef struct {
+	volatile uint16_t IntervalMs;		/* 0 while stopped */
+	uint32_t IntervalCycles;
+	uint32_t TimeoutCycles;
+	uint32_t CyclesPerUs;
+	uint32_t LastMarker;				/* Cycle count when the last marker was armed */
+	bool MarkerValid;					/* LastMarker holds a marker */
+	volatile uint32_t Start;			/* Arrival of the marker in flight */
+	volatile bool Pending[LATENCY_PATH_COUNT];	/* Marker in flight on the path */
+	LATENCY_DIST_T Path[LATENCY_PATH_COUNT];
+} LATENCY_PORT_T;
+
+static LATENCY_PORT_T Latency_Port[MAX_USB_CORE];
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static void Latency_Add(LATENCY_DIST_T *Dist, uint32_t Us)
+{
+	uint32_t bin = Us / LATENCY_BIN_US;
+
+	if (bin >= TELEMETRY_LATENCY_BINS) {
+		bin = TELEMETRY_LATENCY_BINS - 1;
+	}
+	if (Dist->Bins[bin] != 0xFFFF) {
+		Dist->Bins[bin]++;
+	}
+	if (Us < Dist->MinUs) {
+		Dist->MinUs = Us;
+	}
+	if (Us > Dist->MaxUs) {
+		Dist->MaxUs = Us;
+	}
+	Dist->SumUs += Us;
+	Dist->SumSquaresUs += (uint64_t) Us * Us;
+	Dist->Count++;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Start, restart or stop the probe */
+void Latency_SetInterval(uint8_t corenum, uint16_t IntervalMs)
+{
+	LATENCY_PORT_T *Port = &Latency_Port[corenum];
+	uint32_t cyclesPerMs = SystemCoreClock / 1000;
+	uint32_t primask;
+	uint32_t i;
+
+	if (IntervalMs > LATENCY_MAX_INTERVAL_MS) {
+		IntervalMs = LATENCY_MAX_INTERVAL_MS;
+	}
+	/* Both the USB and the I2S interrupts update the results */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (IntervalMs != 0) {
+		memset(Port->Path, 0, sizeof(Port->Path));
+		for (i = 0; i < LATENCY_PATH_COUNT; i++) {
+			Port->Path[i].MinUs = 0xFFFFFFFF;
+		}
+	}
+	for (i = 0; i < LATENCY_PATH_COUNT; i++) {
+		Port->Pending[i] = false;
+	}
+	Port->MarkerValid = false;
+	Port->CyclesPerUs = SystemCoreClock / 1000000;
+	Port->IntervalCycles = IntervalMs * cyclesPerMs;
+	Port->TimeoutCycles = LATENCY_TIMEOUT_MS * cyclesPerMs;
+	Port->IntervalMs = IntervalMs;
+	__set_PRIMASK(primask);
+}
+
+/* Arm a marker once per interval, with a single marker in flight */
+bool Latency_Arm(uint8_t corenum, uint32_t Arrival, uint8_t Paths)
+{
+	LATENCY_PORT_T *Port = &Latency_Port[corenum];
+	uint32_t now = DWT->CYCCNT;
+	bool waiting = false;
+	uint32_t i;
+
+	if ((Port->IntervalMs == 0) || (Paths == 0)) {
+		return false;
+	}
+	if (Port->MarkerValid) {
+		if ((now - Port->LastMarker) < Port->IntervalCycles) {
+			return false;
+		}
+		for (i = 0; i < LATENCY_PATH_COUNT; i++) {
+			waiting |= Port->Pending[i];
+		}
+		if (waiting) {
+			/* Two markers in flight would be told apart by nothing but their order */
+			if ((now - Port->Start) < Port->TimeoutCycles) {
+				return false;
+			}
+			for (i = 0; i < LATENCY_PATH_COUNT; i++) {
+				if (Port->Pending[i]) {
+					Port->Pending[i] = false;
+					Port->Path[i].Lost++;
+				}
+			}
+		}
+	}
+	Port->LastMarker = now;
+	Port->MarkerValid = true;
+	Port->Start = Arrival;
+	for (i = 0; i < LATENCY_PATH_COUNT; i++) {
+		Port->Pending[i] = (Paths & (1 << i)) != 0;
+	}
+	return true;
+}
+
+/* Marker in flight on a path */
+bool Latency_IsPending(uint8_t corenum, LATENCY_PATH_T Path)
+{
+	return Latency_Port[corenum].Pending[Path];
+}
+
+/* Record the marker at the end of a path */
+void Latency_Complete(uint8_t corenum, LATENCY_PATH_T Path, uint32_t Cycle)
+{
+	LATENCY_PORT_T *Port = &Latency_Port[corenum];
+
+	if (!Port->Pending[Path]) {
+		return;
+	}
+	Latency_Add(&Port->Path[Path], (Cycle - Port->Start) / Port->CyclesPerUs);
+	Port->Pending[Path] = false;
+}
+
+/* Copy the results of a path */
+bool Latency_Fill(uint8_t corenum, LATENCY_PATH_T Path, TELEMETRY_LATENCY_T *Record)
+{
+	LATENCY_PORT_T *Port = &Latency_Port[corenum];
+	const LATENCY_DIST_T *Dist = &Port->Path[Path];
+	uint32_t primask;
+
+	if (Port->IntervalMs == 0) {
+		return false;
+	}
+	Record->IntervalMs = Port->IntervalMs;
+	Record->BinUs = LATENCY_BIN_US;
+	primask = __get_PRIMASK();
+	__disable_irq();
+	Record->Count = Dist->Count;
+	Record->Lost = Dist->Lost;
+	Record->MinUs = (Dist->Count != 0) ? Dist->MinUs : 0;
+	Record->MaxUs = Dist->MaxUs;
+	Record->SumUs = Dist->SumUs;
+	Record->SumSquaresUs = Dist->SumSquaresUs;
+	memcpy(Record->Bins, Dist->Bins, sizeof(Record->Bins));
+	__set_PRIMASK(primask);
+	return true;
+}
+
+#endif /* AUDIO_LATENCY_PROBE */
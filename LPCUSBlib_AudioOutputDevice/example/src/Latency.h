@@ -0,0 +1,157 @@
+/*
+ * @brief Marker based latency and jitter measurement of the audio paths
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include "board.h"
+#include "Descriptors.h"
+#include "Telemetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_Latency Latency probe
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * A test mode that measures what the device adds between the USB bus and the
+ * I2S pins. Every probe interval the first frame of an incoming isochronous
+ * OUT packet is overwritten with LATENCY_MARKER. The marker is timed from the
+ * SOF the packet arrived after (the ISO interrupt on ports without a
+ * timebase) to:
+ *  - the I2S transmit pin: the I2S interrupt stamps the refill that pushes the
+ *    marker and adds the frames still ahead of it in the FIFO;
+ *  - the capture IN packet that carries it back, when the TX data pin of the
+ *    port is wired to its RX data pin and the host streams the capture
+ *    interface. This is the device round trip.
+ *
+ * Each path keeps a histogram plus exact min, max and sums, so the host gets
+ * the mean and the jitter (standard deviation) as well as percentiles. The
+ * host starts the probe by writing TELEMETRY_CMD_LATENCY followed by the
+ * interval in ms as a little endian uint16_t, 0 stops it, and the results
+ * follow the regular records on the telemetry stream. Play silence while
+ * measuring: the marker value is found by comparison on the loopback path.
+ *
+ * example/tools/latency_probe.py drives the probe, and runs the same analysis
+ * on a simulation of the device pipeline without hardware.
+ * @{
+ */
+
+/** @brief	Set to 1 to build the latency probe, it reports through the telemetry function */
+#ifndef AUDIO_LATENCY_PROBE
+#define AUDIO_LATENCY_PROBE         (AUDIO_TELEMETRY_CDC)
+#endif
+
+#if (AUDIO_LATENCY_PROBE) && !(AUDIO_TELEMETRY_CDC)
+#error AUDIO_LATENCY_PROBE needs AUDIO_TELEMETRY_CDC
+#endif
+
+#if (AUDIO_LATENCY_PROBE)
+
+/** Marker frame: left 0x8001, right 0x7FFF, two near full scale samples of opposite sign */
+#define LATENCY_MARKER              0x7FFF8001
+/** Histogram bin width, in us */
+#ifndef LATENCY_BIN_US
+#define LATENCY_BIN_US              250
+#endif
+/** A marker not seen on a path after this long is counted lost there, in ms */
+#ifndef LATENCY_TIMEOUT_MS
+#define LATENCY_TIMEOUT_MS          200
+#endif
+
+/**
+ * @brief Measured paths, the Path field of TELEMETRY_LATENCY_T
+ */
+typedef enum {
+	LATENCY_PATH_ISO_TO_I2S = 0,	/*!< ISO OUT arrival to the I2S transmit pin */
+	LATENCY_PATH_ROUND_TRIP,		/*!< ISO OUT arrival to the capture IN packet, over a wired loopback */
+	LATENCY_PATH_COUNT
+} LATENCY_PATH_T;
+
+/**
+ * @brief	Start, restart or stop the probe of a port
+ * @param	corenum		: USB port number
+ * @param	IntervalMs	: Time between markers in ms, 0 stops; a start clears the results
+ * @return	Nothing
+ * @note	Main loop only.
+ */
+void Latency_SetInterval(uint8_t corenum, uint16_t IntervalMs);
+
+/**
+ * @brief	Decide whether the packet just received carries a marker
+ * @param	corenum	: USB port number
+ * @param	Arrival	: Cycle count the latency is counted from
+ * @param	Paths	: Bit mask of the LATENCY_PATH_T paths able to see the marker
+ * @return	true if the caller must write LATENCY_MARKER into the packet
+ * @note	Called from the USB interrupt, from the playback ISO buffer callback.
+ */
+bool Latency_Arm(uint8_t corenum, uint32_t Arrival, uint8_t Paths);
+
+/**
+ * @brief	Tell whether a path still waits for the marker
+ * @param	corenum	: USB port number
+ * @param	Path	: Path to check
+ * @return	true if the marker is in flight on that path
+ */
+bool Latency_IsPending(uint8_t corenum, LATENCY_PATH_T Path);
+
+/**
+ * @brief	Record the marker reaching the end of a path
+ * @param	corenum	: USB port number
+ * @param	Path	: Path the marker went through
+ * @param	Cycle	: Cycle count at the end of the path
+ * @return	Nothing
+ * @note	Callable from the I2S and USB interrupts, each path from a single one.
+ */
+void Latency_Complete(uint8_t corenum, LATENCY_PATH_T Path, uint32_t Cycle);
+
+/**
+ * @brief	Fill the results part of a latency record
+ * @param	corenum	: USB port number
+ * @param	Path	: Path to report
+ * @param	Record	: Record to fill, header and checksum are done by the caller
+ * @return	false while the probe is stopped
+ * @note	Main loop only. The results accumulate from the last start.
+ */
+bool Latency_Fill(uint8_t corenum, LATENCY_PATH_T Path, TELEMETRY_LATENCY_T *Record);
+
+#endif /* AUDIO_LATENCY_PROBE */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LATENCY_H_ */
@@ -0,0 +1,245 @@
+/*
+ * @brief Interrupt cost of the code and buffer placement per memory bank
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+
+#include <string.h>
+#include "LayoutBench.h"
+#include "dma_manager.h"
+
+#if (AUDIO_LAYOUT_BENCH)
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#if (LAYOUT_BENCH_DMA_BYTES % 4) || (LAYOUT_BENCH_DMA_BYTES > 16380)
+#error LAYOUT_BENCH_DMA_BYTES must be a multiple of 4 up to 16380
+#endif
+
+#define LAYOUT_BENCH_DMA_WORDS      (LAYOUT_BENCH_DMA_BYTES / 4)
+/* Model ring, a power of 2 */
+#define LAYOUT_BENCH_RING_WORDS     64
+/* Flash read between calls, one word per 16 byte line */
+#define LAYOUT_BENCH_EVICT_WORDS    1024
+#define LAYOUT_BENCH_BANKS          3
+#define LAYOUT_BENCH_LOADS          3
+
+/* Model rings, one per bank the playback ring may sit in */
+static uint32_t LayoutBench_RingLoc32[LAYOUT_BENCH_RING_WORDS];
+static uint32_t LayoutBench_RingAHB32[LAYOUT_BENCH_RING_WORDS] __BSS(RAM3);
+static uint32_t LayoutBench_RingAHB16[LAYOUT_BENCH_RING_WORDS] __BSS(RAM4);
+
+/* DMA load: read from local SRAM at 0x10080000, written next to each ring or to a bank of its own */
+static uint32_t LayoutBench_DmaSource[LAYOUT_BENCH_DMA_WORDS] __BSS(RAM2);
+static uint32_t LayoutBench_DmaLoc32[LAYOUT_BENCH_DMA_WORDS];
+static uint32_t LayoutBench_DmaAHB32[LAYOUT_BENCH_DMA_WORDS] __BSS(RAM3);
+static uint32_t LayoutBench_DmaAHB16[LAYOUT_BENCH_DMA_WORDS] __BSS(RAM4);
+static uint32_t LayoutBench_DmaETB16[LAYOUT_BENCH_DMA_WORDS] __BSS(RAM5);
+
+/* Constant data the eviction pass reads, in flash */
+static const uint32_t LayoutBench_Flash[LAYOUT_BENCH_EVICT_WORDS * 4] = {1};
+
+/* Stands in for the I2S TX FIFO */
+static volatile uint32_t LayoutBench_Fifo;
+
+typedef struct {
+	const char *Name;
+	uint32_t *Ring;
+	uint32_t *DmaTarget;			/* Written by the same bank load */
+} LAYOUT_BENCH_BANK_T;
+
+static const LAYOUT_BENCH_BANK_T LayoutBench_Banks[LAYOUT_BENCH_BANKS] = {
+	{"Loc32", LayoutBench_RingLoc32, LayoutBench_DmaLoc32},
+	{"AHB32", LayoutBench_RingAHB32, LayoutBench_DmaAHB32},
+	{"AHB16", LayoutBench_RingAHB16, LayoutBench_DmaAHB16},
+};
+
+static const char *const LayoutBench_Loads[LAYOUT_BENCH_LOADS] = {
+	"idle", "same bank", "other bank",
+};
+
+/* Model interrupt state */
+typedef struct {
+	uint32_t *Ring;
+	uint32_t RdIndex;
+	int32_t Gain;					/* Q15 */
+} LAYOUT_BENCH_MODEL_T;
+
+typedef void (*LAYOUT_BENCH_REFILL_T)(LAYOUT_BENCH_MODEL_T *Model);
+
+/* Totals and longest call of one figure */
+typedef struct {
+	uint32_t Cycles;
+	uint32_t MaxCycles;
+	uint32_t Cpi;
+	uint32_t Lsu;
+} LAYOUT_BENCH_RESULT_T;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* The refill of Audio_I2SService() reduced to its memory traffic */
+static inline ATTR_ALWAYS_INLINE void LayoutBench_Refill(LAYOUT_BENCH_MODEL_T *Model)
+{
+	uint32_t i, sample;
+	int32_t left, right;
+
+	for (i = 0; i < LAYOUT_BENCH_REFILL; i++) {
+		sample = Model->Ring[Model->RdIndex];
+		Model->RdIndex = (Model->RdIndex + 1) & (LAYOUT_BENCH_RING_WORDS - 1);
+		left = ((int32_t) (int16_t) sample * Model->Gain) >> 15;
+		right = (((int32_t) sample >> 16) * Model->Gain) >> 15;
+		LayoutBench_Fifo = ((uint32_t) right << 16) | ((uint32_t) left & 0xFFFF);
+	}
+}
+
+/* The same code once in flash and once in local SRAM */
+static ATTR_NO_INLINE void LayoutBench_RefillFlash(LAYOUT_BENCH_MODEL_T *Model)
+{
+	LayoutBench_Refill(Model);
+}
+
+static ATTR_NO_INLINE __RAMFUNC(RAM) void LayoutBench_RefillRam(LAYOUT_BENCH_MODEL_T *Model)
+{
+	LayoutBench_Refill(Model);
+}
+
+/* Read one word per line of a flash area larger than the accelerator buffers */
+static uint32_t LayoutBench_Evict(void)
+{
+	uint32_t i, sum = 0;
+
+	for (i = 0; i < LAYOUT_BENCH_EVICT_WORDS; i++) {
+		sum += LayoutBench_Flash[i * 4];
+	}
+	return sum;
+}
+
+/* Time LAYOUT_BENCH_CALLS calls, keeping a DMA copy to DmaTarget running when not NULL */
+static void LayoutBench_Measure(LAYOUT_BENCH_REFILL_T Refill, uint32_t *Ring, uint8_t Channel,
+								uint32_t *DmaTarget, LAYOUT_BENCH_RESULT_T *Result)
+{
+	LAYOUT_BENCH_MODEL_T model = {Ring, 0, 0x6000};
+	uint32_t call, start, cycles, cpi, lsu;
+
+	memset(Result, 0, sizeof(*Result));
+	for (call = 0; call < LAYOUT_BENCH_CALLS; call++) {
+		if ((DmaTarget != NULL) && !DMA_Manager_IsBusy(Channel)) {
+			DMA_Manager_Transfer(Channel, (uint32_t) LayoutBench_DmaSource, (uint32_t) DmaTarget,
+								 GPDMA_TRANSFERTYPE_M2M_CONTROLLER_DMA, LAYOUT_BENCH_DMA_BYTES);
+		}
+		LayoutBench_Fifo += LayoutBench_Evict();
+
+		__disable_irq();
+		cpi = DWT->CPICNT;
+		lsu = DWT->LSUCNT;
+		start = DWT->CYCCNT;
+		Refill(&model);
+		cycles = DWT->CYCCNT - start;
+		/* 8 bit counters, a call stalls far less than 256 cycles */
+		cpi = (DWT->CPICNT - cpi) & 0xFF;
+		lsu = (DWT->LSUCNT - lsu) & 0xFF;
+		__enable_irq();
+
+		Result->Cycles += cycles;
+		Result->Cpi += cpi;
+		Result->Lsu += lsu;
+		if (cycles > Result->MaxCycles) {
+			Result->MaxCycles = cycles;
+		}
+	}
+	while ((DmaTarget != NULL) && DMA_Manager_IsBusy(Channel)) {}
+}
+
+/* Mean of a total over the calls, in tenths */
+static uint32_t LayoutBench_Tenths(uint32_t Total)
+{
+	return (Total * 10 + LAYOUT_BENCH_CALLS / 2) / LAYOUT_BENCH_CALLS;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Run the benchmark and print the results */
+void LayoutBench_Run(void)
+{
+	static const LAYOUT_BENCH_REFILL_T refill[2] = {LayoutBench_RefillFlash, LayoutBench_RefillRam};
+	static const char *const code[2] = {"flash", "SRAM"};
+	LAYOUT_BENCH_RESULT_T result;
+	uint32_t ctrl = DWT->CTRL;
+	uint32_t c, b, l, i, mean, cpi, lsu;
+	uint32_t *target;
+	uint8_t channel;
+
+	channel = DMA_Manager_Alloc(DMA_PRIORITY_LOW, NULL, NULL);
+	if (channel == DMA_MANAGER_NO_CHANNEL) {
+		return;
+	}
+	for (i = 0; i < LAYOUT_BENCH_DMA_WORDS; i++) {
+		LayoutBench_DmaSource[i] = i * 0x00010001;
+	}
+	for (b = 0; b < LAYOUT_BENCH_BANKS; b++) {
+		for (i = 0; i < LAYOUT_BENCH_RING_WORDS; i++) {
+			LayoutBench_Banks[b].Ring[i] = i * 0x01000100;
+		}
+	}
+	DWT->CTRL = ctrl | DWT_CTRL_CYCCNTENA_Msk | DWT_CTRL_CPIEVTENA_Msk | DWT_CTRL_LSUEVTENA_Msk;
+
+	printf("\r\nModel I2S refill of %u words, %u calls: core cycles mean/max, stall cycles mean\r\n",
+		   LAYOUT_BENCH_REFILL, LAYOUT_BENCH_CALLS);
+	printf("code   ring   DMA load     cycles mean/max     CPI     LSU\r\n");
+	for (c = 0; c < 2; c++) {
+		for (b = 0; b < LAYOUT_BENCH_BANKS; b++) {
+			for (l = 0; l < LAYOUT_BENCH_LOADS; l++) {
+				target = (l == 0) ? NULL : (l == 1) ? LayoutBench_Banks[b].DmaTarget : LayoutBench_DmaETB16;
+				LayoutBench_Measure(refill[c], LayoutBench_Banks[b].Ring, channel, target, &result);
+				mean = LayoutBench_Tenths(result.Cycles);
+				cpi = LayoutBench_Tenths(result.Cpi);
+				lsu = LayoutBench_Tenths(result.Lsu);
+				printf("%-6s %-6s %-10s  %5u.%u/%5u  %4u.%u  %4u.%u\r\n", code[c], LayoutBench_Banks[b].Name,
+					   LayoutBench_Loads[l], mean / 10, mean % 10, result.MaxCycles,
+					   cpi / 10, cpi % 10, lsu / 10, lsu % 10);
+			}
+		}
+	}
+
+	DWT->CTRL = ctrl;
+	DMA_Manager_Free(channel);
+}
+
+#endif /* AUDIO_LAYOUT_BENCH */
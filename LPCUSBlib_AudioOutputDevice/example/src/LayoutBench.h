@@ -0,0 +1,103 @@
+/*
+ * @brief Interrupt cost of the code and buffer placement per memory bank
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+
+#ifndef _LAYOUT_BENCH_H_
+#define _LAYOUT_BENCH_H_
+
+#include "board.h"
+#include "USB.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_LayoutBench Memory layout benchmark
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * Built with AUDIO_LAYOUT_BENCH=1, main() times a model of the I2S refill
+ * interrupt once at startup, for every placement MemoryLayout.h chooses
+ * between, and prints the results on the console:
+ *  - the code in flash or in local SRAM (__RAMFUNC);
+ *  - the ring it reads in local SRAM at 0x10000000 or in AHB SRAM at
+ *    0x20000000 or 0x20008000;
+ *  - with the bus idle, with a GPDMA copy writing the bank of the ring, or
+ *    writing a bank of its own.
+ *
+ * Each call refills LAYOUT_BENCH_REFILL words from the ring with the software
+ * gain applied, like Audio_I2SService(). Between calls the benchmark reads
+ * constant data spread over flash, as other code would, so the flash
+ * accelerator does not keep the refill in its buffers. Figures are the mean
+ * and the longest of LAYOUT_BENCH_CALLS calls in core cycles, with the mean
+ * stall cycles the DWT counts: CPI for instruction fetch and multi cycle
+ * instructions, LSU for loads and stores. Interrupts are masked for each call.
+ * The scratch buffers exist only in the benchmark build.
+ * @{
+ */
+
+/** @brief	Set to 1 to run the benchmark at startup */
+#ifndef AUDIO_LAYOUT_BENCH
+#define AUDIO_LAYOUT_BENCH          0
+#endif
+
+#if (AUDIO_LAYOUT_BENCH)
+
+/** Calls of the model interrupt per figure */
+#ifndef LAYOUT_BENCH_CALLS
+#define LAYOUT_BENCH_CALLS          256
+#endif
+/** Words moved by one call, a FIFO refill */
+#ifndef LAYOUT_BENCH_REFILL
+#define LAYOUT_BENCH_REFILL         4
+#endif
+/** Bytes of one background DMA copy, a multiple of 4 up to 16380 */
+#ifndef LAYOUT_BENCH_DMA_BYTES
+#define LAYOUT_BENCH_DMA_BYTES      4096
+#endif
+
+/**
+ * @brief	Run the benchmark and print the results
+ * @return	Nothing
+ * @note	Call after DMA_Copy_Init(), from the main loop context.
+ */
+void LayoutBench_Run(void);
+
+#endif /* AUDIO_LAYOUT_BENCH */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LAYOUT_BENCH_H_ */
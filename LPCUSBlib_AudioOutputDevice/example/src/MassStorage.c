@@ -0,0 +1,298 @@
+/*
+ * @brief RAM disk mass storage function
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#include "MassStorage.h"
+#include "dma_copy.h"
+
+#if (AUDIO_MSC_FUNCTION)
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/* Sector buffers cycled by the class driver data phase engine */
+static uint8_t MassStorage_Buffers[MASS_STORAGE_BUFFER_COUNT * MASS_STORAGE_BUFFER_SIZE] __attribute__ ((aligned(4)));
+
+/* Backing store */
+static uint8_t MassStorage_Disk[MASS_STORAGE_BLOCKS * MASS_STORAGE_BLOCK_SIZE] __attribute__ ((aligned(4)));
+
+/* Sense data returned by the next REQUEST SENSE */
+static SCSI_Request_Sense_Response_t MassStorage_Sense = {
+	.ResponseCode     = 0x70,
+	.AdditionalLength = 0x0A,
+};
+
+static const SCSI_Inquiry_Response_t MassStorage_Inquiry = {
+	.DeviceType         = 0x00,
+	.Removable          = true,
+	.Version            = 0x00,
+	.ResponseDataFormat = 1,
+	.AdditionalLength   = 0x1F,
+	.VendorID           = "NXP",
+	.ProductID          = "Audio RAM Disk",
+	.RevisionID         = {'1', '.', '0', '0'},
+};
+
+/* LPCUSBlib mass storage class driver instance. The endpoint sizes are set at
+   configuration time from the negotiated speed */
+static USB_ClassInfo_MS_Device_t MassStorage_Interface[2] = {
+	{
+		.Config = {
+			.InterfaceNumber           = MSC_INTERFACE,
+
+			.DataINEndpointNumber      = MSC_DATA_EPNUM,
+			.DataINEndpointSize        = MSC_DATA_EPSIZE_HS,
+			.DataINEndpointDoubleBank  = false,
+
+			.DataOUTEndpointNumber     = MSC_DATA_EPNUM,
+			.DataOUTEndpointSize       = MSC_DATA_EPSIZE_HS,
+			.DataOUTEndpointDoubleBank = false,
+
+			.TotalLUNs                 = 1,
+			.PortNumber                = MSC_PORT,
+
+			.DataBuffers               = MassStorage_Buffers,
+			.BufferSize                = MASS_STORAGE_BUFFER_SIZE,
+			.BufferCount               = MASS_STORAGE_BUFFER_COUNT,
+		},
+	},
+	{
+		.Config = {
+			.InterfaceNumber           = MSC_INTERFACE,
+
+			.DataINEndpointNumber      = MSC_DATA_EPNUM,
+			.DataINEndpointSize        = MSC_DATA_EPSIZE_FS,
+			.DataINEndpointDoubleBank  = false,
+
+			.DataOUTEndpointNumber     = MSC_DATA_EPNUM,
+			.DataOUTEndpointSize       = MSC_DATA_EPSIZE_FS,
+			.DataOUTEndpointDoubleBank = false,
+
+			.TotalLUNs                 = 1,
+			.PortNumber                = MSC_PORT,
+
+			.DataBuffers               = MassStorage_Buffers,
+			.BufferSize                = MASS_STORAGE_BUFFER_SIZE,
+			.BufferCount               = MASS_STORAGE_BUFFER_COUNT,
+		},
+	},
+};
+
+/* Instance matching the speed of the current configuration */
+static USB_ClassInfo_MS_Device_t *MassStorage_Active = &MassStorage_Interface[0];
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static bool MassStorage_IsHighSpeed(uint8_t corenum)
+{
+	return ((USB_REG(corenum)->PORTSC1_D >> 26) & 0x03) == 0x02;
+}
+
+static void MassStorage_SetSense(uint8_t Key, uint8_t Code, uint8_t Qualifier)
+{
+	MassStorage_Sense.SenseKey                 = Key;
+	MassStorage_Sense.AdditionalSenseCode      = Code;
+	MassStorage_Sense.AdditionalSenseQualifier = Qualifier;
+}
+
+static void MassStorage_PutBE32(uint8_t *Buffer, uint32_t Value)
+{
+	Buffer[0] = (uint8_t) (Value >> 24);
+	Buffer[1] = (uint8_t) (Value >> 16);
+	Buffer[2] = (uint8_t) (Value >> 8);
+	Buffer[3] = (uint8_t) Value;
+}
+
+/* Busy wait modelling the access time of a slower backing store */
+static void MassStorage_ModelDelay(uint32_t Blocks)
+{
+#if (MASS_STORAGE_BLOCK_DELAY_US)
+	uint32_t Start  = DWT->CYCCNT;
+	uint32_t Cycles = Blocks * MASS_STORAGE_BLOCK_DELAY_US * (SystemCoreClock / 1000000);
+
+	while ((DWT->CYCCNT - Start) < Cycles) {}
+#else
+	(void) Blocks;
+#endif
+}
+
+/* READ(10) and WRITE(10): check the range and hand the data phase to the engine */
+static bool MassStorage_ReadWrite(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	const uint8_t *Cdb = MSInterfaceInfo->State.CommandBlock.SCSICommandData;
+	uint32_t BlockAddress = ((uint32_t) Cdb[2] << 24) | ((uint32_t) Cdb[3] << 16) | ((uint32_t) Cdb[4] << 8) | Cdb[5];
+	uint16_t TotalBlocks  = ((uint16_t) Cdb[7] << 8) | Cdb[8];
+
+	if ((BlockAddress >= MASS_STORAGE_BLOCKS) || (TotalBlocks > (MASS_STORAGE_BLOCKS - BlockAddress))) {
+		MassStorage_SetSense(SCSI_SENSE_KEY_ILLEGAL_REQUEST, SCSI_ASENSE_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE,
+							 SCSI_ASENSEQ_NO_QUALIFIER);
+		return false;
+	}
+	return MS_Device_QueueBlocks(MSInterfaceInfo, BlockAddress, TotalBlocks, MASS_STORAGE_BLOCK_SIZE);
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Configure the mass storage endpoints */
+bool MassStorage_ConfigureEndpoints(uint8_t corenum)
+{
+	if (corenum != MSC_PORT) {
+		return true;
+	}
+	/* The class driver config is const, so the speed picks one of two instances */
+	MassStorage_Active = &MassStorage_Interface[MassStorage_IsHighSpeed(corenum) ? 0 : 1];
+	return MS_Device_ConfigureEndpoints(MassStorage_Active);
+}
+
+/* Handle Mass Storage Reset and Get Max LUN */
+void MassStorage_ProcessControlRequest(uint8_t corenum)
+{
+	if (corenum == MSC_PORT) {
+		MS_Device_ProcessControlRequest(MassStorage_Active);
+	}
+}
+
+/* Feed a transfer completion to the data phase engine */
+bool MassStorage_TransferComplete(uint8_t corenum, int logicalEP, int xfer_in)
+{
+	if (corenum != MSC_PORT) {
+		return false;
+	}
+	return MS_Device_TransferComplete(MassStorage_Active, logicalEP, xfer_in);
+}
+
+/* Run the command engine */
+void MassStorage_Task(uint8_t corenum)
+{
+	if (corenum == MSC_PORT) {
+		MS_Device_USBTask(MassStorage_Active);
+	}
+}
+
+/* Copy the data phase engine counters */
+void MassStorage_GetStats(MS_Device_Stats_t *Stats)
+{
+	MS_Device_GetStats(MassStorage_Active, Stats);
+}
+
+/* SCSI command set of the RAM disk. Responses and block transfers are queued
+   on the class driver engine, nothing here waits on the bus */
+bool CALLBACK_MS_Device_SCSICommandReceived(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	const uint8_t *Cdb = MSInterfaceInfo->State.CommandBlock.SCSICommandData;
+	uint8_t Response[8];
+	bool Success = true;
+
+	switch (Cdb[0]) {
+	case SCSI_CMD_INQUIRY:
+		Success = MS_Device_QueueResponse(MSInterfaceInfo, &MassStorage_Inquiry,
+										  MIN(sizeof(MassStorage_Inquiry), ((uint16_t) Cdb[3] << 8) | Cdb[4]));
+		break;
+
+	case SCSI_CMD_REQUEST_SENSE:
+		/* The sense data goes out before being cleared by the good status below */
+		Success = MS_Device_QueueResponse(MSInterfaceInfo, &MassStorage_Sense, MIN(sizeof(MassStorage_Sense), Cdb[4]));
+		break;
+
+	case SCSI_CMD_READ_CAPACITY_10:
+		MassStorage_PutBE32(&Response[0], MASS_STORAGE_BLOCKS - 1);
+		MassStorage_PutBE32(&Response[4], MASS_STORAGE_BLOCK_SIZE);
+		Success = MS_Device_QueueResponse(MSInterfaceInfo, Response, 8);
+		break;
+
+	case SCSI_CMD_MODE_SENSE_6:
+		/* Header only: no pages, not write protected */
+		Response[0] = 3;
+		Response[1] = 0;
+		Response[2] = 0;
+		Response[3] = 0;
+		Success = MS_Device_QueueResponse(MSInterfaceInfo, Response, MIN(4, Cdb[4]));
+		break;
+
+	case SCSI_CMD_READ_10:
+	case SCSI_CMD_WRITE_10:
+		Success = MassStorage_ReadWrite(MSInterfaceInfo);
+		break;
+
+	case SCSI_CMD_TEST_UNIT_READY:
+	case SCSI_CMD_SEND_DIAGNOSTIC:
+	case SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL:
+	case SCSI_CMD_VERIFY_10:
+		break;
+
+	default:
+		MassStorage_SetSense(SCSI_SENSE_KEY_ILLEGAL_REQUEST, SCSI_ASENSE_INVALID_COMMAND, SCSI_ASENSEQ_NO_QUALIFIER);
+		return false;
+	}
+
+	if (Success) {
+		MassStorage_SetSense(SCSI_SENSE_KEY_GOOD, SCSI_ASENSE_NO_ADDITIONAL_INFORMATION, SCSI_ASENSEQ_NO_QUALIFIER);
+	}
+	return Success;
+}
+
+/* RAM disk read, runs while the previous sector buffer is on the wire */
+bool CALLBACK_MS_Device_ReadBlocks(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+								   const uint32_t BlockAddress,
+								   const uint32_t TotalBlocks,
+								   uint8_t *const Buffer)
+{
+	DMA_COPY_T Copy;
+
+	/* The DMA moves the sectors while the modelled access time runs */
+	DMA_Memcpy(&Copy, Buffer, &MassStorage_Disk[BlockAddress * MASS_STORAGE_BLOCK_SIZE],
+			   TotalBlocks * MASS_STORAGE_BLOCK_SIZE, NULL);
+	MassStorage_ModelDelay(TotalBlocks);
+	DMA_Copy_Wait(&Copy);
+	return true;
+}
+
+/* RAM disk write, runs while the next sector buffer is being received */
+bool CALLBACK_MS_Device_WriteBlocks(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+									const uint32_t BlockAddress,
+									const uint32_t TotalBlocks,
+									const uint8_t *const Buffer)
+{
+	DMA_COPY_T Copy;
+
+	DMA_Memcpy(&Copy, &MassStorage_Disk[BlockAddress * MASS_STORAGE_BLOCK_SIZE], Buffer,
+			   TotalBlocks * MASS_STORAGE_BLOCK_SIZE, NULL);
+	MassStorage_ModelDelay(TotalBlocks);
+	DMA_Copy_Wait(&Copy);
+	return true;
+}
+
+#endif /* AUDIO_MSC_FUNCTION */
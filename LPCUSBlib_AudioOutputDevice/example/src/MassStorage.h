@@ -0,0 +1,132 @@
+/*
+ * @brief RAM disk mass storage function
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#ifndef _MASS_STORAGE_H_
+#define _MASS_STORAGE_H_
+
+#include "board.h"
+#include "USB.h"
+#include "Descriptors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_MassStorage Mass storage function
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * MSC_PORT exposes a bulk-only mass storage function backed by a RAM disk.
+ * READ(10) and WRITE(10) are handed to the class driver data phase engine,
+ * which cycles MASS_STORAGE_BUFFER_COUNT sector buffers: while one buffer is
+ * on the wire the RAM disk fills or empties the next one, and the USB
+ * interrupt queues the following buffer as soon as the previous transfer
+ * completes. The sectors are moved between the RAM disk and the buffers by the
+ * DMA copy service (dma_copy.h).
+ *
+ * MASS_STORAGE_BLOCK_DELAY_US makes every block access busy wait, modelling a
+ * slower backing store such as SPIFI flash or an SD card, so the effect of the
+ * pipeline shows on the RAM disk as well. The DMA moves run during that wait. Measure the throughput from the host
+ * with example/tools/msc_bench.py.
+ * @{
+ */
+
+#if (AUDIO_MSC_FUNCTION)
+
+/** Block size of the RAM disk in bytes */
+#ifndef MASS_STORAGE_BLOCK_SIZE
+#define MASS_STORAGE_BLOCK_SIZE     512
+#endif
+/** Number of blocks of the RAM disk */
+#ifndef MASS_STORAGE_BLOCKS
+#define MASS_STORAGE_BLOCKS         32
+#endif
+/** Sector buffer size in bytes, a multiple of the block size and of 512, at most 16 KB */
+#ifndef MASS_STORAGE_BUFFER_SIZE
+#define MASS_STORAGE_BUFFER_SIZE    4096
+#endif
+/** Number of sector buffers, 2 or 4 */
+#ifndef MASS_STORAGE_BUFFER_COUNT
+#define MASS_STORAGE_BUFFER_COUNT   2
+#endif
+/** Modelled access time per block in us, 0 for plain RAM speed */
+#ifndef MASS_STORAGE_BLOCK_DELAY_US
+#define MASS_STORAGE_BLOCK_DELAY_US 0
+#endif
+
+/**
+ * @brief	Configure the mass storage endpoints, from the configuration changed event
+ * @param	corenum	: USB port number
+ * @return	true if all endpoints were configured or the port has no mass storage function
+ */
+bool MassStorage_ConfigureEndpoints(uint8_t corenum);
+
+/**
+ * @brief	Handle the mass storage class requests
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ */
+void MassStorage_ProcessControlRequest(uint8_t corenum);
+
+/**
+ * @brief	Pass a transfer completion to the data phase engine
+ * @param	corenum		: USB port number
+ * @param	logicalEP	: Logical endpoint number
+ * @param	xfer_in		: Non zero for an IN completion
+ * @return	true if the completion belonged to the mass storage function
+ * @note	Called from the USB interrupt. The main loop still has to run MassStorage_Task().
+ */
+bool MassStorage_TransferComplete(uint8_t corenum, int logicalEP, int xfer_in);
+
+/**
+ * @brief	Run the SCSI commands and the RAM disk side of the data phase, main loop only
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ */
+void MassStorage_Task(uint8_t corenum);
+
+/**
+ * @brief	Copy the data phase engine counters
+ * @param	Stats	: Where the counters are copied
+ * @return	Nothing
+ */
+void MassStorage_GetStats(MS_Device_Stats_t *Stats);
+
+#endif /* AUDIO_MSC_FUNCTION */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MASS_STORAGE_H_ */
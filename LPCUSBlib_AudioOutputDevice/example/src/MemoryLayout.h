@@ -0,0 +1,102 @@
+/*
+ * @brief Memory bank placement of the hot code and the DMA buffers
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+
+#ifndef _MEMORY_LAYOUT_H_
+#define _MEMORY_LAYOUT_H_
+
+#include "board.h"
+#include "USB.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_MemoryLayout Memory layout
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * Where the audio path lives among the SRAM banks of the LPC4337. RAM to
+ * RAM5 are the banks of the managed linker script:
+ *  - RAM, local SRAM at 0x10000000: stack, default .data/.bss, and the
+ *    interrupt hot path (LAYOUT_RAMFUNC), fetched on the I-code bus;
+ *  - RAM2, local SRAM at 0x10080000: USB queue heads, transfer descriptors
+ *    and stack buffers (USBRAM_SECTION in HAL_LPC18xx.h);
+ *  - RAM3, AHB SRAM at 0x20000000: USB0 playback ring, written by the USB0 DMA;
+ *  - RAM4, AHB SRAM at 0x20008000: USB1 playback ring, written by the USB1 DMA;
+ *  - RAM5, AHB SRAM at 0x2000C000: capture rings, written by the GPDMA.
+ *
+ * Each bus master then writes a bank of its own, and the I2S and USB
+ * interrupts neither wait on the flash accelerator nor queue behind a DMA
+ * burst on the bank they fetch code from.
+ *
+ * Build with AUDIO_MEMORY_LAYOUT=0 (and USB_RAMFUNC defined empty for the
+ * USB stack) for the flat layout: code in flash, everything else in the
+ * default sections. Compare the two with the interrupt timings of the
+ * telemetry records or of a probe trace (trace_probe.h), or with the model
+ * interrupt of LayoutBench.h.
+ * @{
+ */
+
+/** Flat layout: code in flash, data in the default sections */
+#define MEMORY_LAYOUT_FLAT          0
+/** Banked layout: hot code in local SRAM, one AHB bank per DMA writer */
+#define MEMORY_LAYOUT_BANKED        1
+
+/** @brief	Layout the application is built for */
+#ifndef AUDIO_MEMORY_LAYOUT
+#define AUDIO_MEMORY_LAYOUT         MEMORY_LAYOUT_BANKED
+#endif
+
+#if (AUDIO_MEMORY_LAYOUT == MEMORY_LAYOUT_BANKED)
+/** Interrupt hot path, run from local SRAM */
+#define LAYOUT_RAMFUNC              __RAMFUNC(RAM)
+/** Playback ring of USB0 */
+#define LAYOUT_PLAYBACK_RING0       __BSS(RAM3)
+/** Playback ring of USB1 */
+#define LAYOUT_PLAYBACK_RING1       __BSS(RAM4)
+/** Capture rings */
+#define LAYOUT_CAPTURE_RING         __BSS(RAM5)
+#else
+#define LAYOUT_RAMFUNC
+#define LAYOUT_PLAYBACK_RING0
+#define LAYOUT_PLAYBACK_RING1
+#define LAYOUT_CAPTURE_RING
+#endif
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MEMORY_LAYOUT_H_ */
@@ -0,0 +1,182 @@
+/*
+ * @brief USB-MIDI function with a low latency event engine
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#include "Midi.h"
+
+#if (AUDIO_MIDI_FUNCTION)
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+static MIDI_Device_TimedEvent_t Midi_TxQueue[MIDI_TX_QUEUE_SIZE];
+static MIDI_Device_TimedEvent_t Midi_RxQueue[MIDI_RX_QUEUE_SIZE];
+
+/* Packet buffers, filled and drained by the USB DMA. Sized for high speed,
+   the full speed endpoints use the first 64 bytes */
+static uint8_t Midi_TxPacket[MIDI_STREAM_EPSIZE_HS] __attribute__ ((aligned(4)));
+static uint8_t Midi_RxPacket[MIDI_STREAM_EPSIZE_HS] __attribute__ ((aligned(4)));
+
+/* LPCUSBlib MIDI class driver instance. The endpoint sizes are set at
+   configuration time from the negotiated speed */
+static USB_ClassInfo_MIDI_Device_t Midi_Interface[2] = {
+	{
+		.Config = {
+			.StreamingInterfaceNumber  = MIDI_STREAM_INTERFACE,
+
+			.DataINEndpointNumber      = MIDI_STREAM_EPNUM,
+			.DataINEndpointSize        = MIDI_STREAM_EPSIZE_HS,
+			.DataINEndpointDoubleBank  = false,
+
+			.DataOUTEndpointNumber     = MIDI_STREAM_EPNUM,
+			.DataOUTEndpointSize       = MIDI_STREAM_EPSIZE_HS,
+			.DataOUTEndpointDoubleBank = false,
+			.PortNumber                = MIDI_PORT,
+
+			.TxQueue                   = Midi_TxQueue,
+			.TxQueueSize               = MIDI_TX_QUEUE_SIZE,
+			.RxQueue                   = Midi_RxQueue,
+			.RxQueueSize               = MIDI_RX_QUEUE_SIZE,
+			.TxPacketBuffer            = Midi_TxPacket,
+			.RxPacketBuffer            = Midi_RxPacket,
+		},
+	},
+	{
+		.Config = {
+			.StreamingInterfaceNumber  = MIDI_STREAM_INTERFACE,
+
+			.DataINEndpointNumber      = MIDI_STREAM_EPNUM,
+			.DataINEndpointSize        = MIDI_STREAM_EPSIZE_FS,
+			.DataINEndpointDoubleBank  = false,
+
+			.DataOUTEndpointNumber     = MIDI_STREAM_EPNUM,
+			.DataOUTEndpointSize       = MIDI_STREAM_EPSIZE_FS,
+			.DataOUTEndpointDoubleBank = false,
+			.PortNumber                = MIDI_PORT,
+
+			.TxQueue                   = Midi_TxQueue,
+			.TxQueueSize               = MIDI_TX_QUEUE_SIZE,
+			.RxQueue                   = Midi_RxQueue,
+			.RxQueueSize               = MIDI_RX_QUEUE_SIZE,
+			.TxPacketBuffer            = Midi_TxPacket,
+			.RxPacketBuffer            = Midi_RxPacket,
+		},
+	},
+};
+
+/* Instance matching the speed of the current configuration */
+static USB_ClassInfo_MIDI_Device_t *Midi_Active = &Midi_Interface[0];
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static bool Midi_IsHighSpeed(uint8_t corenum)
+{
+	return ((USB_REG(corenum)->PORTSC1_D >> 26) & 0x03) == 0x02;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Configure the MIDI endpoints */
+bool Midi_ConfigureEndpoints(uint8_t corenum)
+{
+	if (corenum != MIDI_PORT) {
+		return true;
+	}
+	/* The class driver config is const, so the speed picks one of two instances */
+	Midi_Active = &Midi_Interface[Midi_IsHighSpeed(corenum) ? 0 : 1];
+	return MIDI_Device_ConfigureEndpoints(Midi_Active);
+}
+
+/* Accept SET_INTERFACE to the only alternate setting of the MIDI interfaces */
+void Midi_ProcessControlRequest(uint8_t corenum)
+{
+	if ((corenum != MIDI_PORT) || !Endpoint_IsSETUPReceived(corenum)) {
+		return;
+	}
+	if ((USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_STANDARD | REQREC_INTERFACE)) &&
+		(USB_ControlRequest.bRequest == REQ_SetInterface) &&
+		((USB_ControlRequest.wIndex == MIDI_CONTROL_INTERFACE) || (USB_ControlRequest.wIndex == MIDI_STREAM_INTERFACE)) &&
+		(USB_ControlRequest.wValue == 0)) {
+		Endpoint_ClearSETUP(corenum);
+		Endpoint_ClearStatusStage(corenum);
+	}
+}
+
+/* Flush the transmit queue */
+void Midi_SOF(uint8_t corenum)
+{
+	if (corenum == MIDI_PORT) {
+		MIDI_Device_SOF(Midi_Active);
+	}
+}
+
+/* Feed a transfer completion to the event engine */
+bool Midi_TransferComplete(uint8_t corenum, int logicalEP, int xfer_in)
+{
+	if (corenum != MIDI_PORT) {
+		return false;
+	}
+	/* A receive completion still wakes the main loop to handle the events */
+	return MIDI_Device_TransferComplete(Midi_Active, logicalEP, xfer_in) && xfer_in;
+}
+
+/* Echo received events */
+void Midi_Task(uint8_t corenum)
+{
+	MIDI_Device_TimedEvent_t Entry;
+
+	if (corenum != MIDI_PORT) {
+		return;
+	}
+	while (MIDI_Device_DequeueEvent(Midi_Active, &Entry)) {
+		/* Keep the receive timestamp: the engine latency is then the turnaround time */
+		MIDI_Device_QueueEvent(Midi_Active, &Entry.Event, Entry.Timestamp);
+	}
+}
+
+/* Queue an event for the host */
+bool Midi_Send(const MIDI_EventPacket_t *Event)
+{
+	return MIDI_Device_QueueEvent(Midi_Active, Event, DWT->CYCCNT);
+}
+
+/* Copy the event engine counters */
+void Midi_GetStats(MIDI_Device_Stats_t *Stats)
+{
+	MIDI_Device_GetStats(Midi_Active, Stats);
+}
+
+#endif /* AUDIO_MIDI_FUNCTION */
@@ -0,0 +1,134 @@
+/*
+ * @brief USB-MIDI function with a low latency event engine
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#ifndef _MIDI_H_
+#define _MIDI_H_
+
+#include "board.h"
+#include "USB.h"
+#include "Descriptors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_Midi USB-MIDI function
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * MIDI_PORT exposes a USB-MIDI 1.0 function next to the audio function. The
+ * class driver event engine moves events through lock free queues: received
+ * packets are unpacked and timestamped in the USB interrupt, and events
+ * queued for the host are packed into one bulk packet at each start of
+ * frame, every 125 us at high speed and every ms at full speed. The time an
+ * event waits in the queue is bounded by one frame plus the host polling,
+ * whatever the controller traffic density.
+ *
+ * Received events are echoed back to the host with their receive timestamp,
+ * so the engine latency statistics measure the device turnaround. A host
+ * sending at a steady rate sees the jitter of the echo directly.
+ * @{
+ */
+
+#if (AUDIO_MIDI_FUNCTION)
+
+/** Events queued for the host, must be a power of 2 */
+#ifndef MIDI_TX_QUEUE_SIZE
+#define MIDI_TX_QUEUE_SIZE          256
+#endif
+/** Events received from the host, must be a power of 2 of at least two packets */
+#ifndef MIDI_RX_QUEUE_SIZE
+#define MIDI_RX_QUEUE_SIZE          256
+#endif
+
+/**
+ * @brief	Configure the MIDI endpoints, from the configuration changed event
+ * @param	corenum	: USB port number
+ * @return	true if all endpoints were configured or the port has no MIDI function
+ */
+bool Midi_ConfigureEndpoints(uint8_t corenum);
+
+/**
+ * @brief	Handle standard interface requests addressed to the MIDI interfaces
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ */
+void Midi_ProcessControlRequest(uint8_t corenum);
+
+/**
+ * @brief	Send the events queued during the previous frame
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ * @note	Called from the USB start of frame interrupt.
+ */
+void Midi_SOF(uint8_t corenum);
+
+/**
+ * @brief	Pass a transfer completion to the MIDI event engine
+ * @param	corenum		: USB port number
+ * @param	logicalEP	: Logical endpoint number
+ * @param	xfer_in		: Non zero for an IN completion
+ * @return	true if the completion was a MIDI transmit, which needs no main loop work
+ * @note	Called from the USB interrupt.
+ */
+bool Midi_TransferComplete(uint8_t corenum, int logicalEP, int xfer_in);
+
+/**
+ * @brief	Handle the events received from the host, main loop only
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ */
+void Midi_Task(uint8_t corenum);
+
+/**
+ * @brief	Queue an event for the host, sent at the next start of frame
+ * @param	Event	: USB-MIDI event packet
+ * @return	false if the queue is full or the host is not connected
+ */
+bool Midi_Send(const MIDI_EventPacket_t *Event);
+
+/**
+ * @brief	Copy the MIDI event engine counters
+ * @param	Stats	: Where the counters are copied
+ * @return	Nothing
+ */
+void Midi_GetStats(MIDI_Device_Stats_t *Stats);
+
+#endif /* AUDIO_MIDI_FUNCTION */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MIDI_H_ */
@@ -0,0 +1,454 @@
+/*
+ * @brief RNDIS network adapter function
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+
+#include "Network.h"
+#include "AppEvent.h"
+#include "Timebase.h"
+
+#if (AUDIO_RNDIS_FUNCTION)
+
+#if (NETWORK_SINK == NETWORK_SINK_ENET)
+#include "lpc_phy.h"
+#endif
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/* FRINDEX runs in microframes at high speed and in frames << 3 at full speed */
+#define NETWORK_FRINDEX_MASK        (TIMEBASE_FRINDEX_MODULO - 1)
+#define NETWORK_UNITS_PER_MS        8
+
+/* Ethernet header size and the offset of its ethertype */
+#define NETWORK_ETH_HEADER_SIZE     14
+#define NETWORK_ETH_TYPE_OFFSET     12
+
+/* Locally administered adapter address. The host takes it as the address of
+   its end of the link, the Ethernet sink filters on it */
+#define NETWORK_MAC_ADDRESS         0x02, 0x60, 0x37, 0x12, 0x34, 0x56
+
+/* Frame pool handed to the class driver frame engine */
+static uint8_t Network_FramePool[NETWORK_FRAME_COUNT * RNDIS_DEVICE_FRAME_SIZE] __attribute__ ((aligned(4)));
+
+/* LPCUSBlib RNDIS class driver instance. The bulk endpoint sizes are set at
+   configuration time from the negotiated speed */
+static USB_ClassInfo_RNDIS_Device_t Network_Interface[2] = {
+	{
+		.Config = {
+			.ControlInterfaceNumber         = RNDIS_CONTROL_INTERFACE,
+
+			.DataINEndpointNumber           = RNDIS_DATA_EPNUM,
+			.DataINEndpointSize             = RNDIS_DATA_EPSIZE_HS,
+			.DataINEndpointDoubleBank       = false,
+
+			.DataOUTEndpointNumber          = RNDIS_DATA_EPNUM,
+			.DataOUTEndpointSize            = RNDIS_DATA_EPSIZE_HS,
+			.DataOUTEndpointDoubleBank      = false,
+
+			.NotificationEndpointNumber     = RNDIS_NOTIFICATION_EPNUM,
+			.NotificationEndpointSize       = RNDIS_NOTIFICATION_EPSIZE,
+			.NotificationEndpointDoubleBank = false,
+
+			.AdapterVendorDescription       = "LPCUSBlib Audio RNDIS Adapter",
+			.AdapterMACAddress              = {{NETWORK_MAC_ADDRESS}},
+			.PortNumber                     = RNDIS_PORT,
+
+			.FramePool                      = Network_FramePool,
+			.FrameCount                     = NETWORK_FRAME_COUNT,
+		},
+	},
+	{
+		.Config = {
+			.ControlInterfaceNumber         = RNDIS_CONTROL_INTERFACE,
+
+			.DataINEndpointNumber           = RNDIS_DATA_EPNUM,
+			.DataINEndpointSize             = RNDIS_DATA_EPSIZE_FS,
+			.DataINEndpointDoubleBank       = false,
+
+			.DataOUTEndpointNumber          = RNDIS_DATA_EPNUM,
+			.DataOUTEndpointSize            = RNDIS_DATA_EPSIZE_FS,
+			.DataOUTEndpointDoubleBank      = false,
+
+			.NotificationEndpointNumber     = RNDIS_NOTIFICATION_EPNUM,
+			.NotificationEndpointSize       = RNDIS_NOTIFICATION_EPSIZE,
+			.NotificationEndpointDoubleBank = false,
+
+			.AdapterVendorDescription       = "LPCUSBlib Audio RNDIS Adapter",
+			.AdapterMACAddress              = {{NETWORK_MAC_ADDRESS}},
+			.PortNumber                     = RNDIS_PORT,
+
+			.FramePool                      = Network_FramePool,
+			.FrameCount                     = NETWORK_FRAME_COUNT,
+		},
+	},
+};
+
+/* Instance matching the speed of the current configuration */
+static USB_ClassInfo_RNDIS_Device_t *Network_Active = &Network_Interface[0];
+
+/* Sink counters, main loop owned. Usb is filled by Network_GetStats() */
+static NETWORK_STATS_T Network_Counters;
+
+#if (NETWORK_SINK == NETWORK_SINK_ENET)
+/* Largest frame the MAC may write behind the headroom of a slot, CRC included */
+#define NETWORK_ENET_RX_BUFSIZE     ((RNDIS_DEVICE_FRAME_SIZE - RNDIS_DEVICE_FRAME_HEADROOM - 1) & ~3)
+/* The MAC stores the frame check sequence after the frame */
+#define NETWORK_ENET_CRC_SIZE       4
+
+/* MAC DMA descriptor rings. Every armed descriptor points into a pool slot */
+static ENET_ENHRXDESC_T Network_RxDesc[NETWORK_ENET_RX_DESCS] __attribute__ ((aligned(4)));
+static ENET_ENHTXDESC_T Network_TxDesc[NETWORK_ENET_TX_DESCS] __attribute__ ((aligned(4)));
+static RNDIS_Device_Frame_t *Network_RxFrame[NETWORK_ENET_RX_DESCS];
+static RNDIS_Device_Frame_t *Network_TxFrame[NETWORK_ENET_TX_DESCS];
+static uint8_t Network_RxNext;
+static uint8_t Network_TxHead;
+static uint8_t Network_TxTail;
+static uint8_t Network_TxCount;
+static bool Network_LinkUp;
+
+/* PHY poll period tracking, start of frame interrupt */
+static uint16_t Network_LastFrame;
+static uint32_t Network_Elapsed;
+static bool Network_FrameValid;
+static volatile bool Network_PollPending;
+#endif
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static bool Network_IsHighSpeed(uint8_t corenum)
+{
+	return ((USB_REG(corenum)->PORTSC1_D >> 26) & 0x03) == 0x02;
+}
+
+static void Network_Drop(RNDIS_Device_Frame_t *Frame)
+{
+	RNDIS_Device_FreeFrame(Network_Active, Frame);
+	Network_Counters.Dropped++;
+}
+
+/* Queues a frame for the host, the frame is gone either way */
+static void Network_ToHost(RNDIS_Device_Frame_t *Frame)
+{
+	if (RNDIS_Device_SendFrame(Network_Active, Frame)) {
+		Network_Counters.FromSink++;
+	}
+	else {
+		Network_Drop(Frame);
+	}
+}
+
+#if (NETWORK_SINK == NETWORK_SINK_LOOPBACK)
+/* Loopback sink: benchmark frames go back to the host with the addresses
+   swapped in place, from the slot they arrived in */
+static void Network_SinkFrame(RNDIS_Device_Frame_t *Frame)
+{
+	uint8_t *Data = RNDIS_Device_FrameData(Frame);
+	uint8_t Address[6];
+
+	if ((Frame->Length < NETWORK_ETH_HEADER_SIZE) ||
+		((((uint16_t) Data[NETWORK_ETH_TYPE_OFFSET] << 8) | Data[NETWORK_ETH_TYPE_OFFSET + 1]) !=
+		 NETWORK_LOOPBACK_ETHERTYPE)) {
+		/* Echoing the host's own ARP or neighbour discovery would look like an address conflict */
+		Network_Drop(Frame);
+		return;
+	}
+	Network_Counters.ToSink++;
+	memcpy(Address, &Data[0], 6);
+	memcpy(&Data[0], &Data[6], 6);
+	memcpy(&Data[6], Address, 6);
+	Network_ToHost(Frame);
+}
+
+static void Network_SinkPoll(void)
+{}
+
+static void Network_SinkReset(void)
+{}
+
+#else /* NETWORK_SINK_ENET */
+
+static void Network_DelayMs(uint32_t ms)
+{
+	uint32_t Start  = DWT->CYCCNT;
+	uint32_t Cycles = ms * (SystemCoreClock / 1000);
+
+	while ((DWT->CYCCNT - Start) < Cycles) {}
+}
+
+/* Lends a pool frame to the MAC. The frame lands behind the headroom, so it
+   can go to the host from the same slot */
+static void Network_ArmRx(uint8_t Index, RNDIS_Device_Frame_t *Frame)
+{
+	ENET_ENHRXDESC_T *Desc = &Network_RxDesc[Index];
+
+	Network_RxFrame[Index] = Frame;
+	Desc->B1ADD  = (uint32_t) RNDIS_Device_FrameData(Frame);
+	Desc->CTRL   = RDES_ENH_BS1(NETWORK_ENET_RX_BUFSIZE) |
+				   ((Index == (NETWORK_ENET_RX_DESCS - 1)) ? RDES_ENH_RER : 0);
+	Desc->STATUS = RDES_OWN;
+}
+
+/* Passes received frames to the host and rearms their descriptors with
+   fresh pool frames. A descriptor left without a frame stops the MAC there
+   until the pool refills */
+static void Network_EnetReceive(void)
+{
+	RNDIS_Device_Frame_t *Frame;
+	uint32_t Status;
+
+	for (;;) {
+		Frame = Network_RxFrame[Network_RxNext];
+		if (Frame != NULL) {
+			Status = Network_RxDesc[Network_RxNext].STATUS;
+			if (Status & RDES_OWN) {
+				break;
+			}
+			Network_RxFrame[Network_RxNext] = NULL;
+			if (((Status & (RDES_FS | RDES_LS | RDES_ES)) != (RDES_FS | RDES_LS)) ||
+				(RDES_FLMSK(Status) <= (NETWORK_ETH_HEADER_SIZE + NETWORK_ENET_CRC_SIZE))) {
+				RNDIS_Device_FreeFrame(Network_Active, Frame);
+				Network_Counters.SinkErrors++;
+			}
+			else {
+				Frame->Length = RDES_FLMSK(Status) - NETWORK_ENET_CRC_SIZE;
+				Network_ToHost(Frame);
+			}
+		}
+		if ((Frame = RNDIS_Device_AllocFrame(Network_Active)) == NULL) {
+			break;
+		}
+		Network_ArmRx(Network_RxNext, Frame);
+		Network_RxNext = (Network_RxNext + 1) % NETWORK_ENET_RX_DESCS;
+	}
+	Chip_ENET_RXStart(LPC_ETHERNET);
+}
+
+/* Returns the frames the MAC has sent to the pool */
+static void Network_EnetReclaim(void)
+{
+	ENET_ENHTXDESC_T *Desc;
+
+	while (Network_TxCount) {
+		Desc = &Network_TxDesc[Network_TxTail];
+		if (Desc->CTRLSTAT & TDES_OWN) {
+			break;
+		}
+		if (Desc->CTRLSTAT & TDES_ES) {
+			Network_Counters.SinkErrors++;
+		}
+		RNDIS_Device_FreeFrame(Network_Active, Network_TxFrame[Network_TxTail]);
+		Network_TxFrame[Network_TxTail] = NULL;
+		Network_TxTail = (Network_TxTail + 1) % NETWORK_ENET_TX_DESCS;
+		Network_TxCount--;
+	}
+}
+
+/* Ethernet sink: the transmit descriptor points at the frame in its pool slot */
+static void Network_SinkFrame(RNDIS_Device_Frame_t *Frame)
+{
+	ENET_ENHTXDESC_T *Desc = &Network_TxDesc[Network_TxHead];
+
+	Network_EnetReclaim();
+	if (!Network_LinkUp || (Network_TxCount == NETWORK_ENET_TX_DESCS)) {
+		Network_Drop(Frame);
+		return;
+	}
+	Network_TxFrame[Network_TxHead] = Frame;
+	Desc->B1ADD    = (uint32_t) RNDIS_Device_FrameData(Frame);
+	Desc->BSIZE    = TDES_ENH_BS1(Frame->Length);
+	Desc->CTRLSTAT = TDES_ENH_FS | TDES_ENH_LS | TDES_ENH_IC |
+					 ((Network_TxHead == (NETWORK_ENET_TX_DESCS - 1)) ? TDES_ENH_TER : 0) | TDES_OWN;
+	Network_TxHead = (Network_TxHead + 1) % NETWORK_ENET_TX_DESCS;
+	Network_TxCount++;
+	Network_Counters.ToSink++;
+	Chip_ENET_TXStart(LPC_ETHERNET);
+}
+
+/* Follows the PHY link and moves frames in both directions */
+static void Network_SinkPoll(void)
+{
+	uint32_t Status;
+
+	if (Network_PollPending) {
+		Network_PollPending = false;
+		Status = lpcPHYStsPoll();
+		if (Status & PHY_LINK_CHANGED) {
+			Network_LinkUp = (Status & PHY_LINK_CONNECTED) != 0;
+			Chip_ENET_SetSpeed(LPC_ETHERNET, (Status & PHY_LINK_SPEED100) != 0);
+			Chip_ENET_SetDuplex(LPC_ETHERNET, (Status & PHY_LINK_FULLDUPLX) != 0);
+		}
+	}
+	Network_EnetReclaim();
+	Network_EnetReceive();
+}
+
+/* The pool starts over on every configuration, so the MAC gives back its
+   frames before the class driver reclaims them */
+static void Network_SinkReset(void)
+{
+	Chip_ENET_TXDisable(LPC_ETHERNET);
+	Chip_ENET_RXDisable(LPC_ETHERNET);
+
+	memset(Network_RxDesc, 0, sizeof(Network_RxDesc));
+	memset(Network_TxDesc, 0, sizeof(Network_TxDesc));
+	memset(Network_RxFrame, 0, sizeof(Network_RxFrame));
+	memset(Network_TxFrame, 0, sizeof(Network_TxFrame));
+	Network_RxNext  = 0;
+	Network_TxHead  = 0;
+	Network_TxTail  = 0;
+	Network_TxCount = 0;
+	Chip_ENET_InitDescriptors(LPC_ETHERNET, Network_TxDesc, Network_RxDesc);
+}
+#endif /* NETWORK_SINK */
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+#if (NETWORK_SINK == NETWORK_SINK_ENET)
+/* Wake the main loop when the MAC received or sent a frame */
+void ETH_IRQHandler(void)
+{
+	LPC_ETHERNET->DMA_STAT = DMA_ST_ALL;
+	AppEvent_Post(APP_EVENT_NETWORK, RNDIS_PORT, 0);
+}
+#endif
+
+/* Bring up the Ethernet MAC and PHY for the Ethernet sink */
+void Network_Init(void)
+{
+#if (NETWORK_SINK == NETWORK_SINK_ENET)
+	static const uint8_t Address[6] = {NETWORK_MAC_ADDRESS};
+
+	Chip_ENET_Init(LPC_ETHERNET, BOARD_ENET_PHY_ADDR);
+	Chip_ENET_SetADDR(LPC_ETHERNET, Address);
+	/* Frames for the host's address, broadcasts and multicasts */
+	LPC_ETHERNET->MAC_FRAME_FILTER = MAC_FF_PM;
+	if (lpc_phy_init(true, Network_DelayMs) != SUCCESS) {
+		printf("Network: PHY init failed\r\n");
+	}
+	Network_SinkReset();
+	LPC_ETHERNET->DMA_INT_EN = DMA_IE_NIE | DMA_IE_RIE | DMA_IE_TIE;
+	NVIC_EnableIRQ(ETHERNET_IRQn);
+#endif
+}
+
+/* Configure the RNDIS endpoints */
+bool Network_ConfigureEndpoints(uint8_t corenum)
+{
+	bool Success;
+
+	if (corenum != RNDIS_PORT) {
+		return true;
+	}
+	Network_SinkReset();
+	/* The class driver config is const, so the speed picks one of two instances */
+	Network_Active = &Network_Interface[Network_IsHighSpeed(corenum) ? 0 : 1];
+	Success = RNDIS_Device_ConfigureEndpoints(Network_Active);
+#if (NETWORK_SINK == NETWORK_SINK_ENET)
+	Network_EnetReceive();
+	Chip_ENET_TXEnable(LPC_ETHERNET);
+	Chip_ENET_RXEnable(LPC_ETHERNET);
+#endif
+	return Success;
+}
+
+/* Handle the encapsulated RNDIS commands */
+void Network_ProcessControlRequest(uint8_t corenum)
+{
+	if (corenum == RNDIS_PORT) {
+		RNDIS_Device_ProcessControlRequest(Network_Active);
+	}
+}
+
+/* Post a PHY poll every NETWORK_PHY_POLL_MS */
+void Network_SOF(uint8_t corenum)
+{
+#if (NETWORK_SINK == NETWORK_SINK_ENET)
+	uint16_t frame;
+
+	if (corenum != RNDIS_PORT) {
+		return;
+	}
+	frame = (uint16_t) (USB_REG(corenum)->FRINDEX_D & NETWORK_FRINDEX_MASK);
+	if (!Network_FrameValid) {
+		Network_LastFrame  = frame;
+		Network_FrameValid = true;
+		return;
+	}
+	Network_Elapsed  += (uint16_t) ((frame - Network_LastFrame) & NETWORK_FRINDEX_MASK);
+	Network_LastFrame = frame;
+	if ((Network_Elapsed < (uint32_t) NETWORK_PHY_POLL_MS * NETWORK_UNITS_PER_MS) || Network_PollPending) {
+		return;
+	}
+	Network_Elapsed     = 0;
+	Network_PollPending = AppEvent_Post(APP_EVENT_NETWORK, corenum, 0);
+#else
+	(void) corenum;
+#endif
+}
+
+/* Feed a transfer completion to the frame engine */
+bool Network_TransferComplete(uint8_t corenum, int logicalEP, int xfer_in)
+{
+	if (corenum != RNDIS_PORT) {
+		return false;
+	}
+	return RNDIS_Device_TransferComplete(Network_Active, logicalEP, xfer_in);
+}
+
+/* Send the response available notification and hand received frames to the sink */
+void Network_Task(uint8_t corenum)
+{
+	RNDIS_Device_Frame_t *Frame;
+
+	if (corenum != RNDIS_PORT) {
+		return;
+	}
+	RNDIS_Device_USBTask(Network_Active);
+	while ((Frame = RNDIS_Device_ReceiveFrame(Network_Active)) != NULL) {
+		Network_SinkFrame(Frame);
+	}
+	Network_SinkPoll();
+}
+
+/* Copy the network function counters */
+void Network_GetStats(NETWORK_STATS_T *Stats)
+{
+	*Stats = Network_Counters;
+	RNDIS_Device_GetStats(Network_Active, &Stats->Usb);
+}
+
+#endif /* AUDIO_RNDIS_FUNCTION */
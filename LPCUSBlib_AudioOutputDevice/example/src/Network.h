@@ -0,0 +1,174 @@
+/*
+ * @brief RNDIS network adapter function
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#ifndef _NETWORK_H_
+#define _NETWORK_H_
+
+#include "board.h"
+#include "USB.h"
+#include "Descriptors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_Network RNDIS network function
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * With AUDIO_RNDIS_FUNCTION set, RNDIS_PORT exposes an RNDIS network adapter
+ * so the board can carry control traffic next to the audio stream.
+ *
+ * Frames live in a pool of NETWORK_FRAME_COUNT slots handed to the class
+ * driver frame engine. The USB controller receives each packet message
+ * straight into a free slot, the header is stripped by moving the frame
+ * offset, and the frame descriptor goes to the sink. Frames for the host are
+ * built behind a header sized headroom and the header is written in front of
+ * them, so they leave from the slot they were received into. No frame byte
+ * is copied on either path. The pool bounds the frames in flight: when it is
+ * empty the OUT endpoint NAKs until a frame is freed, the audio endpoints
+ * are never involved.
+ *
+ * NETWORK_SINK_LOOPBACK sends frames of ethertype NETWORK_LOOPBACK_ETHERTYPE
+ * back to the host with the MAC addresses swapped and drops everything else,
+ * which is what example/tools/rndis_bench.py measures frames/s with.
+ * NETWORK_SINK_ENET bridges the adapter to the Ethernet port: the MAC DMA
+ * descriptors point into pool slots, so frames cross between USB and the
+ * wire by descriptor as well.
+ * @{
+ */
+
+#if (AUDIO_RNDIS_FUNCTION)
+
+/** Sink that echoes benchmark frames to the host */
+#define NETWORK_SINK_LOOPBACK       0
+/** Sink that bridges frames to the Ethernet MAC */
+#define NETWORK_SINK_ENET           1
+
+/** Where frames from the host go, NETWORK_SINK_LOOPBACK or NETWORK_SINK_ENET */
+#ifndef NETWORK_SINK
+#define NETWORK_SINK                NETWORK_SINK_LOOPBACK
+#endif
+/** Number of frame pool slots, at most RNDIS_DEVICE_MAX_FRAMES */
+#ifndef NETWORK_FRAME_COUNT
+#define NETWORK_FRAME_COUNT         8
+#endif
+/** Ethertype echoed by the loopback sink, IEEE local experimental */
+#ifndef NETWORK_LOOPBACK_ETHERTYPE
+#define NETWORK_LOOPBACK_ETHERTYPE  0x88B5
+#endif
+/** Receive descriptors of the Ethernet MAC, each holds a pool frame */
+#ifndef NETWORK_ENET_RX_DESCS
+#define NETWORK_ENET_RX_DESCS       3
+#endif
+/** Transmit descriptors of the Ethernet MAC */
+#ifndef NETWORK_ENET_TX_DESCS
+#define NETWORK_ENET_TX_DESCS       4
+#endif
+/** PHY link poll period of the Ethernet sink, in ms */
+#ifndef NETWORK_PHY_POLL_MS
+#define NETWORK_PHY_POLL_MS         100
+#endif
+
+/**
+ * @brief Counters of the network function
+ */
+typedef struct {
+	RNDIS_Device_Stats_t Usb;	/*!< Class driver frame engine counters */
+	uint32_t ToSink;			/*!< Frames from the host taken by the sink */
+	uint32_t FromSink;			/*!< Frames from the sink queued for the host */
+	uint32_t Dropped;			/*!< Frames the sink or the host side could not take */
+	uint32_t SinkErrors;		/*!< Frames the Ethernet MAC flagged as bad, either direction */
+} NETWORK_STATS_T;
+
+/**
+ * @brief	Bring up the sink hardware, after Timebase_Init()
+ * @return	Nothing
+ */
+void Network_Init(void);
+
+/**
+ * @brief	Configure the RNDIS endpoints, from the configuration changed event
+ * @param	corenum	: USB port number
+ * @return	true if all endpoints were configured or the port has no network function
+ * @note	Frames held by the sink are taken back, the pool starts over.
+ */
+bool Network_ConfigureEndpoints(uint8_t corenum);
+
+/**
+ * @brief	Handle the RNDIS encapsulated command requests
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ */
+void Network_ProcessControlRequest(uint8_t corenum);
+
+/**
+ * @brief	Post APP_EVENT_NETWORK when the sink needs polling
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ * @note	Called from the USB start of frame interrupt.
+ */
+void Network_SOF(uint8_t corenum);
+
+/**
+ * @brief	Pass a transfer completion to the frame engine
+ * @param	corenum		: USB port number
+ * @param	logicalEP	: Logical endpoint number
+ * @param	xfer_in		: Non zero for an IN completion
+ * @return	true if the completion belonged to the network function
+ * @note	Called from the USB interrupt. The main loop still has to run Network_Task().
+ */
+bool Network_TransferComplete(uint8_t corenum, int logicalEP, int xfer_in);
+
+/**
+ * @brief	Send RNDIS notifications and move frames between the host and the sink, main loop only
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ */
+void Network_Task(uint8_t corenum);
+
+/**
+ * @brief	Copy the network function counters
+ * @param	Stats	: Where the counters are copied
+ * @return	Nothing
+ */
+void Network_GetStats(NETWORK_STATS_T *Stats);
+
+#endif /* AUDIO_RNDIS_FUNCTION */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NETWORK_H_ */
@@ -0,0 +1,441 @@
+/*
+ * @brief Audio telemetry over a CDC-ACM side channel
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#include "Telemetry.h"
+#include "AppEvent.h"
+#include "Timebase.h"
+#include "Latency.h"
+#include "BootProfile.h"
+
+#if (AUDIO_TELEMETRY_CDC)
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define TELEMETRY_FRINDEX_MASK      (TIMEBASE_FRINDEX_MODULO - 1)
+/* FRINDEX advances by 8 per ms at both speeds */
+#define TELEMETRY_UNITS_PER_MS      8
+
+/* Per port telemetry state */
+typedef struct {
+	volatile uint16_t PeriodMs;		/* 0 when stopped */
+	uint16_t LastFrame;				/* FRINDEX at the previous SOF */
+	bool FrameValid;				/* LastFrame holds a sample */
+	uint32_t Elapsed;				/* Microframe units since the last record was due */
+	volatile bool Pending;			/* APP_EVENT_TELEMETRY posted and not handled yet */
+	volatile uint16_t Skipped;		/* Records not sent */
+	uint16_t Sequence;
+	uint8_t Command[3];				/* Host command being assembled */
+	uint8_t CommandLength;
+#if (TRACE_PROBES)
+	volatile bool TraceDumping;		/* Trace chunks left to send, polled by the SOF interrupt */
+	uint32_t TraceNext;				/* Recording index of the next event to send */
+	uint32_t TraceEnd;				/* Recording index after the last event of the dump */
+#endif
+} TELEMETRY_PORT_T;
+
+static TELEMETRY_PORT_T Telemetry_Port[MAX_USB_CORE];
+
+/* CDC rings, drained and filled by the USB DMA */
+static uint8_t Telemetry_TxRing[MAX_USB_CORE][TELEMETRY_TX_RING_SIZE] __attribute__ ((aligned(4)));
+static uint8_t Telemetry_RxRing[MAX_USB_CORE][TELEMETRY_RX_RING_SIZE] __attribute__ ((aligned(4)));
+
+/* LPCUSBlib CDC class driver instances, one per port */
+static USB_ClassInfo_CDC_Device_t Telemetry_Interface[MAX_USB_CORE] = {
+	{
+		.Config = {
+			.ControlInterfaceNumber         = TELEMETRY_CONTROL_INTERFACE,
+
+			.DataINEndpointNumber           = TELEMETRY_TX_EPNUM,
+			.DataINEndpointSize             = TELEMETRY_TXRX_EPSIZE_HS,
+			.DataINEndpointDoubleBank       = false,
+
+			.DataOUTEndpointNumber          = TELEMETRY_RX_EPNUM,
+			.DataOUTEndpointSize            = TELEMETRY_TXRX_EPSIZE_HS,
+			.DataOUTEndpointDoubleBank      = false,
+
+			.NotificationEndpointNumber     = TELEMETRY_NOTIFICATION_EPNUM,
+			.NotificationEndpointSize       = TELEMETRY_NOTIFICATION_EPSIZE,
+			.NotificationEndpointDoubleBank = false,
+			.PortNumber                     = 0,
+
+			.TxRingBuffer                   = Telemetry_TxRing[0],
+			.TxRingSize                     = TELEMETRY_TX_RING_SIZE,
+			.RxRingBuffer                   = Telemetry_RxRing[0],
+			.RxRingSize                     = TELEMETRY_RX_RING_SIZE,
+			.TxFlushTimeoutMS               = TELEMETRY_FLUSH_TIMEOUT_MS,
+		},
+	},
+#if (MAX_USB_CORE > 1)
+	{
+		.Config = {
+			.ControlInterfaceNumber         = TELEMETRY_CONTROL_INTERFACE,
+
+			.DataINEndpointNumber           = TELEMETRY_TX_EPNUM,
+			.DataINEndpointSize             = TELEMETRY_TXRX_EPSIZE_FS,
+			.DataINEndpointDoubleBank       = false,
+
+			.DataOUTEndpointNumber          = TELEMETRY_RX_EPNUM,
+			.DataOUTEndpointSize            = TELEMETRY_TXRX_EPSIZE_FS,
+			.DataOUTEndpointDoubleBank      = false,
+
+			.NotificationEndpointNumber     = TELEMETRY_NOTIFICATION_EPNUM,
+			.NotificationEndpointSize       = TELEMETRY_NOTIFICATION_EPSIZE,
+			.NotificationEndpointDoubleBank = false,
+			.PortNumber                     = 1,
+
+			.TxRingBuffer                   = Telemetry_TxRing[1],
+			.TxRingSize                     = TELEMETRY_TX_RING_SIZE,
+			.RxRingBuffer                   = Telemetry_RxRing[1],
+			.RxRingSize                     = TELEMETRY_RX_RING_SIZE,
+			.TxFlushTimeoutMS               = TELEMETRY_FLUSH_TIMEOUT_MS,
+		},
+	},
+#endif
+};
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Fletcher-16, cheap enough to run per record and catches the byte slips a
+   decoder resynchronising mid stream would otherwise accept */
+static uint16_t Telemetry_Checksum(const uint8_t *Data, uint32_t Length)
+{
+	uint32_t sum1 = 0, sum2 = 0;
+
+	while (Length--) {
+		sum1 = (sum1 + *Data++) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	return (uint16_t) ((sum2 << 8) | sum1);
+}
+
+static bool Telemetry_IsHighSpeed(uint8_t corenum)
+{
+	return ((USB_REG(corenum)->PORTSC1_D >> 26) & 0x03) == 0x02;
+}
+
+#if (AUDIO_BOOT_PROFILE)
+/* Queue the record of one boot profile */
+static void Telemetry_SendBoot(uint8_t corenum, bool Previous)
+{
+	USB_ClassInfo_CDC_Device_t *Interface = &Telemetry_Interface[corenum];
+	TELEMETRY_PORT_T *Port = &Telemetry_Port[corenum];
+	TELEMETRY_BOOT_T Record;
+
+	if (CDC_Device_SendSpace(Interface) < sizeof(Record)) {
+		Port->Skipped++;
+		return;
+	}
+	memset(&Record, 0, sizeof(Record));
+	if (!BootProfile_Fill(Previous, &Record)) {
+		return;
+	}
+	Record.Magic = TELEMETRY_BOOT_MAGIC;
+	Record.Version = TELEMETRY_BOOT_VERSION;
+	Record.Length = sizeof(Record);
+	Record.Sequence = Port->Sequence++;
+	Record.Port = corenum;
+	Record.Previous = Previous ? 1 : 0;
+	Record.Cycle = DWT->CYCCNT;
+	Record.Checksum = Telemetry_Checksum((const uint8_t *) &Record, offsetof(TELEMETRY_BOOT_T, Checksum));
+
+	CDC_Device_SendBuffer(Interface, &Record, sizeof(Record));
+}
+#endif
+
+#if (TRACE_PROBES)
+/* Queue trace chunks while the transmit ring has room, resume recording after the last one */
+static void Telemetry_SendTrace(uint8_t corenum)
+{
+	USB_ClassInfo_CDC_Device_t *Interface = &Telemetry_Interface[corenum];
+	TELEMETRY_PORT_T *Port = &Telemetry_Port[corenum];
+	TELEMETRY_TRACE_T Record;
+
+	while (Port->TraceDumping && (CDC_Device_SendSpace(Interface) >= sizeof(Record))) {
+		memset(&Record, 0, sizeof(Record));
+		Record.Magic = TELEMETRY_TRACE_MAGIC;
+		Record.Version = TELEMETRY_TRACE_VERSION;
+		Record.Length = sizeof(Record);
+		Record.Sequence = Port->Sequence++;
+		Record.Port = corenum;
+		Record.Count = (uint8_t) TraceProbe_Read(Port->TraceNext, Record.Events, TELEMETRY_TRACE_EVENTS);
+		Record.Cycle = DWT->CYCCNT;
+		Record.ClockHz = SystemCoreClock;
+		Record.Index = Port->TraceNext;
+		Record.End = Port->TraceEnd;
+		Record.Checksum = Telemetry_Checksum((const uint8_t *) &Record, offsetof(TELEMETRY_TRACE_T, Checksum));
+
+		CDC_Device_SendBuffer(Interface, &Record, sizeof(Record));
+		Port->TraceNext += Record.Count;
+		if ((Record.Count == 0) || (Port->TraceNext == Port->TraceEnd)) {
+			Port->TraceDumping = false;
+			TraceProbe_Pause(false);
+		}
+	}
+}
+
+/* Pause the trace and start dumping it, or drop it */
+static void Telemetry_Trace(uint8_t corenum, uint16_t Value)
+{
+	TELEMETRY_PORT_T *Port = &Telemetry_Port[corenum];
+
+	if (Value != 0) {
+		TraceProbe_Clear();
+		return;
+	}
+	if (Port->TraceDumping) {
+		return;
+	}
+	TraceProbe_Pause(true);
+	Port->TraceNext = TraceProbe_GetOldest();
+	Port->TraceEnd = TraceProbe_GetCount();
+	Port->TraceDumping = true;
+	Telemetry_SendTrace(corenum);
+}
+#endif
+
+static void Telemetry_Command(uint8_t corenum, uint8_t Byte)
+{
+	TELEMETRY_PORT_T *Port = &Telemetry_Port[corenum];
+
+	uint16_t value;
+
+	if ((Port->CommandLength == 0) && (Byte != TELEMETRY_CMD_PERIOD) && (Byte != TELEMETRY_CMD_LATENCY) &&
+		(Byte != TELEMETRY_CMD_BOOT) && (Byte != TELEMETRY_CMD_TRACE)) {
+		return;
+	}
+	Port->Command[Port->CommandLength++] = Byte;
+	if (Port->CommandLength == sizeof(Port->Command)) {
+		value = (uint16_t) (Port->Command[1] | (Port->Command[2] << 8));
+		if (Port->Command[0] == TELEMETRY_CMD_PERIOD) {
+			Telemetry_SetPeriod(corenum, value);
+		}
+#if (AUDIO_BOOT_PROFILE)
+		else if (Port->Command[0] == TELEMETRY_CMD_BOOT) {
+			Telemetry_SendBoot(corenum, value != 0);
+		}
+#endif
+#if (AUDIO_LATENCY_PROBE)
+		else if (Port->Command[0] == TELEMETRY_CMD_LATENCY) {
+			Latency_SetInterval(corenum, value);
+		}
+#endif
+#if (TRACE_PROBES)
+		else if (Port->Command[0] == TELEMETRY_CMD_TRACE) {
+			Telemetry_Trace(corenum, value);
+		}
+#endif
+		Port->CommandLength = 0;
+	}
+}
+
+#if (AUDIO_LATENCY_PROBE)
+/* Queue one latency record per path behind the regular record */
+static void Telemetry_SendLatency(uint8_t corenum)
+{
+	USB_ClassInfo_CDC_Device_t *Interface = &Telemetry_Interface[corenum];
+	TELEMETRY_PORT_T *Port = &Telemetry_Port[corenum];
+	TELEMETRY_LATENCY_T Record;
+	uint32_t path;
+
+	for (path = 0; path < LATENCY_PATH_COUNT; path++) {
+		if (CDC_Device_SendSpace(Interface) < sizeof(Record)) {
+			Port->Skipped++;
+			return;
+		}
+		memset(&Record, 0, sizeof(Record));
+		if (!Latency_Fill(corenum, (LATENCY_PATH_T) path, &Record)) {
+			return;
+		}
+		Record.Magic = TELEMETRY_LATENCY_MAGIC;
+		Record.Version = TELEMETRY_LATENCY_VERSION;
+		Record.Length = sizeof(Record);
+		Record.Sequence = Port->Sequence++;
+		Record.Port = corenum;
+		Record.Path = (uint8_t) path;
+		Record.Cycle = DWT->CYCCNT;
+		Record.Checksum = Telemetry_Checksum((const uint8_t *) &Record, offsetof(TELEMETRY_LATENCY_T, Checksum));
+
+		CDC_Device_SendBuffer(Interface, &Record, sizeof(Record));
+	}
+}
+#endif
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Count frames and post APP_EVENT_TELEMETRY when a period elapsed */
+void Telemetry_SOF(uint8_t corenum)
+{
+	TELEMETRY_PORT_T *Port = &Telemetry_Port[corenum];
+	uint16_t frame = (uint16_t) (USB_REG(corenum)->FRINDEX_D & TELEMETRY_FRINDEX_MASK);
+	uint16_t period = Port->PeriodMs;
+
+	CDC_Device_SOF(&Telemetry_Interface[corenum]);
+	if (!Port->FrameValid) {
+		Port->LastFrame = frame;
+		Port->FrameValid = true;
+		return;
+	}
+	Port->Elapsed += (uint16_t) ((frame - Port->LastFrame) & TELEMETRY_FRINDEX_MASK);
+	Port->LastFrame = frame;
+#if (TRACE_PROBES)
+	/* A trace dump drains every ms, whatever the record period */
+	if (Port->TraceDumping) {
+		period = 1;
+	}
+#endif
+	if ((period == 0) || (Port->Elapsed < (uint32_t) period * TELEMETRY_UNITS_PER_MS)) {
+		return;
+	}
+	Port->Elapsed = 0;
+	if (Port->Pending) {
+		Port->Skipped++;
+		return;
+	}
+	Port->Pending = AppEvent_Post(APP_EVENT_TELEMETRY, corenum, 0);
+}
+
+/* Feed a transfer completion to the ring engine */
+bool Telemetry_TransferComplete(uint8_t corenum, int logicalEP, int xfer_in)
+{
+	/* A receive completion still wakes the main loop to parse the command */
+	return CDC_Device_TransferComplete(&Telemetry_Interface[corenum], logicalEP, xfer_in) && xfer_in;
+}
+
+/* Copy the ring engine counters */
+void Telemetry_GetStats(uint8_t corenum, CDC_Device_Stats_t *Stats)
+{
+	CDC_Device_GetStats(&Telemetry_Interface[corenum], Stats);
+}
+
+/* Configure the telemetry endpoints */
+bool Telemetry_ConfigureEndpoints(uint8_t corenum)
+{
+	TELEMETRY_PORT_T *Port = &Telemetry_Port[corenum];
+
+	Port->FrameValid = false;
+	Port->Elapsed = 0;
+	Port->Pending = false;
+	Port->CommandLength = 0;
+#if (TRACE_PROBES)
+	if (Port->TraceDumping) {
+		/* The host went away mid dump */
+		Port->TraceDumping = false;
+		TraceProbe_Pause(false);
+	}
+#endif
+	if (Port->PeriodMs == 0) {
+		Port->PeriodMs = TELEMETRY_DEFAULT_PERIOD_MS;
+	}
+	return CDC_Device_ConfigureEndpoints(&Telemetry_Interface[corenum]);
+}
+
+/* Handle CDC class requests */
+void Telemetry_ProcessControlRequest(uint8_t corenum)
+{
+	CDC_Device_ProcessControlRequest(&Telemetry_Interface[corenum]);
+}
+
+/* Parse host commands */
+void Telemetry_Task(uint8_t corenum)
+{
+	uint8_t data[32];
+	uint16_t count, i;
+
+	while ((count = CDC_Device_ReceiveBuffer(&Telemetry_Interface[corenum], data, sizeof(data))) != 0) {
+		for (i = 0; i < count; i++) {
+			Telemetry_Command(corenum, data[i]);
+		}
+	}
+}
+
+/* Build and queue one record */
+void Telemetry_Send(uint8_t corenum)
+{
+	USB_ClassInfo_CDC_Device_t *Interface = &Telemetry_Interface[corenum];
+	TELEMETRY_PORT_T *Port = &Telemetry_Port[corenum];
+	TELEMETRY_RECORD_T Record;
+
+	Port->Pending = false;
+	/* Nobody listening until the host opened the port and set a line coding */
+	if ((USB_DeviceState[corenum] != DEVICE_STATE_Configured) || (Interface->State.LineEncoding.BaudRateBPS == 0)) {
+		return;
+	}
+#if (TRACE_PROBES)
+	if (Port->TraceDumping) {
+		Telemetry_SendTrace(corenum);
+		return;
+	}
+#endif
+	if (CDC_Device_SendSpace(Interface) < sizeof(Record)) {
+		/* Host is not reading fast enough: drop this record rather than wait on the bus */
+		Port->Skipped++;
+		return;
+	}
+
+	memset(&Record, 0, sizeof(Record));
+	if (!CALLBACK_Telemetry_Fill(corenum, &Record)) {
+		return;
+	}
+	Record.Magic = TELEMETRY_MAGIC;
+	Record.Version = TELEMETRY_VERSION;
+	Record.Length = sizeof(Record);
+	Record.Sequence = Port->Sequence++;
+	Record.Port = corenum;
+	if (Telemetry_IsHighSpeed(corenum)) {
+		Record.Flags |= TELEMETRY_FLAG_HIGH_SPEED;
+	}
+	Record.Cycle = DWT->CYCCNT;
+	Record.ControlMaxCycles = USB_ControlLatency[corenum].MaxServiceCycles;
+	Record.EventsDropped = (uint16_t) AppEvent_GetDroppedCount();
+	Record.RecordsSkipped = Port->Skipped;
+	Record.Checksum = Telemetry_Checksum((const uint8_t *) &Record, offsetof(TELEMETRY_RECORD_T, Checksum));
+
+	CDC_Device_SendBuffer(Interface, &Record, sizeof(Record));
+#if (AUDIO_LATENCY_PROBE)
+	Telemetry_SendLatency(corenum);
+#endif
+}
+
+/* Change the telemetry period */
+void Telemetry_SetPeriod(uint8_t corenum, uint16_t PeriodMs)
+{
+	Telemetry_Port[corenum].Elapsed = 0;
+	Telemetry_Port[corenum].PeriodMs = PeriodMs;
+}
+
+#endif /* AUDIO_TELEMETRY_CDC */
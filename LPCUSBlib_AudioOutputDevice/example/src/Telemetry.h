@@ -0,0 +1,308 @@
+/*
+ * @brief Audio telemetry over a CDC-ACM side channel
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include "board.h"
+#include "USB.h"
+#include "trace_probe.h"
+#include "Descriptors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_Telemetry CDC telemetry
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * Every port exposes a CDC-ACM function next to the audio function. Once the
+ * host opens the serial port, a fixed size binary record describing the audio
+ * function of that port is sent every telemetry period. See
+ * example/tools/telemetry_decode.py for the host side.
+ *
+ * The CDC traffic never competes with the isochronous path: the SOF interrupt
+ * only compares frame numbers and posts an event, the record is built from the
+ * main loop and copied into the CDC transmit ring, and a record is skipped
+ * rather than waited for when the ring has no room. The class driver ring
+ * engine drains the ring by DMA in whole packets, so records sent close
+ * together share bulk packets instead of costing one transfer each.
+ *
+ * The host changes the period by writing TELEMETRY_CMD_PERIOD followed by the
+ * period in ms as a little endian uint16_t, 0 stops the stream.
+ *
+ * While the latency probe runs (TELEMETRY_CMD_LATENCY, see Latency.h), each
+ * record is followed by one TELEMETRY_LATENCY_T per measured path. Both kinds
+ * share the sequence counter, so gaps still count skipped records.
+ *
+ * TELEMETRY_CMD_BOOT followed by 0 (this boot) or 1 (the boot before) queues
+ * one TELEMETRY_BOOT_T with that boot profile, see BootProfile.h.
+ *
+ * In a TRACE_PROBES build, TELEMETRY_CMD_TRACE followed by 0 pauses the probe
+ * trace (trace_probe.h) and dumps it as TELEMETRY_TRACE_T chunks, oldest
+ * event first. The chunks go out every ms until the dump is complete, regular
+ * records wait meanwhile, and recording resumes after the last chunk. 1 drops
+ * the recorded events instead.
+ * @{
+ */
+
+#if (AUDIO_TELEMETRY_CDC)
+
+/** Telemetry period used until the host picks one, in ms */
+#ifndef TELEMETRY_DEFAULT_PERIOD_MS
+#define TELEMETRY_DEFAULT_PERIOD_MS 100
+#endif
+
+/** CDC transmit ring per port, in bytes, a multiple of the high speed packet size */
+#ifndef TELEMETRY_TX_RING_SIZE
+#define TELEMETRY_TX_RING_SIZE      2048
+#endif
+/** CDC receive ring per port, in bytes, a multiple of the high speed packet size */
+#ifndef TELEMETRY_RX_RING_SIZE
+#define TELEMETRY_RX_RING_SIZE      1024
+#endif
+/** Time a partial packet waits in the transmit ring for the next record, in ms */
+#ifndef TELEMETRY_FLUSH_TIMEOUT_MS
+#define TELEMETRY_FLUSH_TIMEOUT_MS  2
+#endif
+
+/** Record start marker, "TM" on the wire */
+#define TELEMETRY_MAGIC             0x4D54
+/** Record layout version */
+#define TELEMETRY_VERSION           1
+
+/** Latency record start marker, "TL" on the wire */
+#define TELEMETRY_LATENCY_MAGIC     0x4C54
+/** Latency record layout version */
+#define TELEMETRY_LATENCY_VERSION   1
+/** Histogram bins of a latency record, the last one also counts everything above it */
+#define TELEMETRY_LATENCY_BINS      64
+
+/** Boot record start marker, "TB" on the wire */
+#define TELEMETRY_BOOT_MAGIC        0x4254
+/** Boot record layout version */
+#define TELEMETRY_BOOT_VERSION      1
+/** Checkpoint slots of a boot record, unused ones are zero */
+#define TELEMETRY_BOOT_CHECKPOINTS  16
+
+/** Trace record start marker, "TR" on the wire */
+#define TELEMETRY_TRACE_MAGIC       0x5254
+/** Trace record layout version */
+#define TELEMETRY_TRACE_VERSION     1
+/** Events per trace record */
+#define TELEMETRY_TRACE_EVENTS      24
+
+/** Host command: set period, followed by uint16_t ms */
+#define TELEMETRY_CMD_PERIOD        'P'
+/** Host command: set the latency probe interval, followed by uint16_t ms, 0 stops the probe */
+#define TELEMETRY_CMD_LATENCY       'L'
+/** Host command: send a boot record, followed by uint16_t 0 for this boot, 1 for the previous one */
+#define TELEMETRY_CMD_BOOT          'B'
+/** Host command: trace, followed by uint16_t 0 to dump the probe trace, 1 to clear it */
+#define TELEMETRY_CMD_TRACE         'T'
+
+/** TELEMETRY_RECORD_T Flags bits */
+#define TELEMETRY_FLAG_STREAMING    (1 << 0)	/*!< Streaming interface alternate setting 1 selected */
+#define TELEMETRY_FLAG_RATE_UP      (1 << 1)	/*!< I2S running on the RATEUP divider */
+#define TELEMETRY_FLAG_HIGH_SPEED   (1 << 2)	/*!< Port negotiated high speed */
+#define TELEMETRY_FLAG_CODEC_SHIFT  3			/*!< Bits 3..5 hold the BOARD_AUDIO_CODEC_T found by the bring-up */
+#define TELEMETRY_FLAG_CODEC_MASK   (7 << TELEMETRY_FLAG_CODEC_SHIFT)
+
+/**
+ * @brief Telemetry record, little endian, records follow each other on the bulk stream
+ */
+typedef ATTR_IAR_PACKED struct {
+	uint16_t Magic;				/*!< TELEMETRY_MAGIC */
+	uint8_t  Version;			/*!< TELEMETRY_VERSION */
+	uint8_t  Length;			/*!< Record size including Checksum */
+	uint16_t Sequence;			/*!< Incremented per record, gaps are skipped records */
+	uint8_t  Port;				/*!< USB port the audio function runs on */
+	uint8_t  Flags;				/*!< TELEMETRY_FLAG_* */
+	uint32_t Cycle;				/*!< DWT cycle count when the record was built */
+	uint32_t SampleRate;		/*!< Current sampling frequency in Hz */
+	uint16_t RingSize;			/*!< Working ring size in bytes */
+	uint16_t RingFill;			/*!< Ring fill in bytes */
+	uint16_t RingFillMin;		/*!< Lowest fill since the previous record */
+	uint16_t RingFillMax;		/*!< Highest fill since the previous record */
+	uint32_t Underruns;			/*!< I2S refills that found the ring empty */
+	uint32_t Overruns;			/*!< Ring resets because ISO data overran it */
+	uint32_t IsoPackets;		/*!< ISO OUT packets received */
+	uint32_t RateSwitches;		/*!< I2S divider changes made by the rate control */
+	uint32_t I2SIsrMaxCycles;	/*!< Longest I2S interrupt since the previous record */
+	uint32_t IsoIsrMaxCycles;	/*!< Longest ISO buffer callback since the previous record */
+	uint32_t ControlMaxCycles;	/*!< Longest control request service time */
+	uint16_t EventsDropped;		/*!< Main loop events lost, low 16 bits */
+	uint16_t RecordsSkipped;	/*!< Records not sent because the transmit ring was full */
+	uint16_t Checksum;			/*!< Fletcher-16 over all preceding bytes */
+} ATTR_PACKED TELEMETRY_RECORD_T;
+
+/**
+ * @brief Latency record of one path, little endian, results accumulate from the probe start
+ */
+typedef ATTR_IAR_PACKED struct {
+	uint16_t Magic;				/*!< TELEMETRY_LATENCY_MAGIC */
+	uint8_t  Version;			/*!< TELEMETRY_LATENCY_VERSION */
+	uint8_t  Length;			/*!< Record size including Checksum */
+	uint16_t Sequence;			/*!< Shared with TELEMETRY_RECORD_T */
+	uint8_t  Port;				/*!< USB port the audio function runs on */
+	uint8_t  Path;				/*!< LATENCY_PATH_T */
+	uint32_t Cycle;				/*!< DWT cycle count when the record was built */
+	uint16_t IntervalMs;		/*!< Probe interval */
+	uint16_t BinUs;				/*!< Histogram bin width in us */
+	uint32_t Count;				/*!< Markers measured */
+	uint32_t Lost;				/*!< Markers that never reached the end of the path */
+	uint32_t MinUs;				/*!< Shortest latency */
+	uint32_t MaxUs;				/*!< Longest latency */
+	uint64_t SumUs;				/*!< Sum of the latencies, for the mean */
+	uint64_t SumSquaresUs;		/*!< Sum of the squared latencies, for the jitter */
+	uint16_t Bins[TELEMETRY_LATENCY_BINS];	/*!< Markers per bin, saturating */
+	uint16_t Checksum;			/*!< Fletcher-16 over all preceding bytes */
+} ATTR_PACKED TELEMETRY_LATENCY_T;
+
+/**
+ * @brief Boot record, little endian, one boot profile sent on request
+ */
+typedef ATTR_IAR_PACKED struct {
+	uint16_t Magic;				/*!< TELEMETRY_BOOT_MAGIC */
+	uint8_t  Version;			/*!< TELEMETRY_BOOT_VERSION */
+	uint8_t  Length;			/*!< Record size including Checksum */
+	uint16_t Sequence;			/*!< Shared with TELEMETRY_RECORD_T */
+	uint8_t  Port;				/*!< USB port the request came from */
+	uint8_t  Previous;			/*!< 1 for the boot before the running one */
+	uint32_t Cycle;				/*!< DWT cycle count when the record was built */
+	uint32_t BootCount;			/*!< Boots since the RAM lost its contents */
+	uint16_t Passed;			/*!< Bit per checkpoint reached */
+	uint16_t Checkpoints;		/*!< Checkpoints the firmware defines */
+	uint32_t StampCycle[TELEMETRY_BOOT_CHECKPOINTS];	/*!< Cycles since reset at each checkpoint */
+	uint32_t StampClockHz[TELEMETRY_BOOT_CHECKPOINTS];	/*!< Core clock at each checkpoint */
+	uint16_t Checksum;			/*!< Fletcher-16 over all preceding bytes */
+} ATTR_PACKED TELEMETRY_BOOT_T;
+
+/**
+ * @brief Trace record, little endian, one chunk of a probe trace dump
+ */
+typedef ATTR_IAR_PACKED struct {
+	uint16_t Magic;				/*!< TELEMETRY_TRACE_MAGIC */
+	uint8_t  Version;			/*!< TELEMETRY_TRACE_VERSION */
+	uint8_t  Length;			/*!< Record size including Checksum */
+	uint16_t Sequence;			/*!< Shared with TELEMETRY_RECORD_T */
+	uint8_t  Port;				/*!< USB port the dump was requested on */
+	uint8_t  Count;				/*!< Events used in this chunk */
+	uint32_t Cycle;				/*!< DWT cycle count when the record was built */
+	uint32_t ClockHz;			/*!< Core clock the cycles count */
+	uint32_t Index;				/*!< Recording index of the first event */
+	uint32_t End;				/*!< Recording index after the last event of the dump */
+	TRACE_PROBE_EVENT_T Events[TELEMETRY_TRACE_EVENTS];	/*!< Events, unused ones are zero */
+	uint16_t Checksum;			/*!< Fletcher-16 over all preceding bytes */
+} ATTR_PACKED TELEMETRY_TRACE_T;
+
+/**
+ * @brief	Count frames and post APP_EVENT_TELEMETRY when a period elapsed
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ * @note	Called from the USB start of frame interrupt.
+ */
+void Telemetry_SOF(uint8_t corenum);
+
+/**
+ * @brief	Pass a transfer completion to the telemetry ring engine
+ * @param	corenum		: USB port number
+ * @param	logicalEP	: Logical endpoint number
+ * @param	xfer_in		: Non zero for an IN completion
+ * @return	true if the completion was a telemetry transmit, which needs no main loop work
+ * @note	Called from the USB interrupt.
+ */
+bool Telemetry_TransferComplete(uint8_t corenum, int logicalEP, int xfer_in);
+
+/**
+ * @brief	Copy the CDC ring engine counters of a port
+ * @param	corenum	: USB port number
+ * @param	Stats	: Where the counters are copied
+ * @return	Nothing
+ */
+void Telemetry_GetStats(uint8_t corenum, CDC_Device_Stats_t *Stats);
+
+/**
+ * @brief	Configure the telemetry endpoints, from the configuration changed event
+ * @param	corenum	: USB port number
+ * @return	true if all endpoints were configured
+ */
+bool Telemetry_ConfigureEndpoints(uint8_t corenum);
+
+/**
+ * @brief	Handle CDC class requests addressed to the telemetry function
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ */
+void Telemetry_ProcessControlRequest(uint8_t corenum);
+
+/**
+ * @brief	Parse host commands received on the telemetry function, main loop only
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ */
+void Telemetry_Task(uint8_t corenum);
+
+/**
+ * @brief	Build and queue one record if the transmit ring has room, main loop only
+ * @param	corenum	: USB port number
+ * @return	Nothing
+ */
+void Telemetry_Send(uint8_t corenum);
+
+/**
+ * @brief	Change the telemetry period
+ * @param	corenum		: USB port number
+ * @param	PeriodMs	: Period in ms, 0 stops the stream
+ * @return	Nothing
+ */
+void Telemetry_SetPeriod(uint8_t corenum, uint16_t PeriodMs);
+
+/**
+ * @brief	Fill the audio part of a record, implemented by the application
+ * @param	corenum	: USB port number
+ * @param	Record	: Record to fill, header and checksum are done by the caller
+ * @return	false if the port has no audio function
+ * @note	Min/max statistics restart after each call.
+ */
+bool CALLBACK_Telemetry_Fill(uint8_t corenum, TELEMETRY_RECORD_T *Record);
+
+#endif /* AUDIO_TELEMETRY_CDC */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TELEMETRY_H_ */
@@ -0,0 +1,160 @@
+/*
+ * @brief USB SOF locked microframe timebase
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+#include "Timebase.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/* The SOF stamp is guarded by a sequence count that is odd while the interrupt
+   writes it: a reader retries when the count was odd or moved during its copy,
+   so it never sees a half written stamp, however many SOFs went by meanwhile */
+static volatile TIMEBASE_STAMP_T SofStamp;
+static volatile uint32_t SofSeq;
+static volatile bool SofValid;
+
+/* Start of the current period measurement window */
+static uint32_t WindowCycle;
+static uint16_t WindowFrame;
+static bool WindowStarted;
+static volatile uint32_t CyclesPerMicroframe;
+
+static LPC_USBHS_T *TimebaseUSB;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+volatile TIMEBASE_EVENT_STAMP_T Timebase_Events[TIMEBASE_EVENT_COUNT];
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Initialise the timebase */
+void Timebase_Init(uint8_t corenum)
+{
+	TimebaseUSB = corenum ? LPC_USB1 : LPC_USB0;
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	SofValid = false;
+	WindowStarted = false;
+	CyclesPerMicroframe = 0;
+	memset((void *) Timebase_Events, 0, sizeof(Timebase_Events));
+}
+
+/* Latch FRINDEX at SOF */
+void Timebase_SOF(void)
+{
+	uint32_t cycle = DWT->CYCCNT;
+	uint16_t frame = (uint16_t) (TimebaseUSB->FRINDEX_D & (TIMEBASE_FRINDEX_MODULO - 1));
+	uint16_t elapsed;
+
+	SofSeq++;
+	__DMB();
+	SofStamp.Cycle = cycle;
+	SofStamp.FrameIndex = frame;
+	__DMB();
+	SofSeq++;
+	SofValid = true;
+
+	if (!WindowStarted) {
+		WindowCycle = cycle;
+		WindowFrame = frame;
+		WindowStarted = true;
+		return;
+	}
+	/* Missed SOF interrupts do not matter, FRINDEX tells how many went by */
+	elapsed = (frame - WindowFrame) & (TIMEBASE_FRINDEX_MODULO - 1);
+	if (elapsed >= TIMEBASE_PERIOD_WINDOW) {
+		CyclesPerMicroframe = (uint32_t) (((uint64_t) (cycle - WindowCycle) << 8) / elapsed);
+		WindowCycle = cycle;
+		WindowFrame = frame;
+	}
+}
+
+/* Most recent SOF stamp */
+bool Timebase_GetLastSOF(TIMEBASE_STAMP_T *Stamp)
+{
+	uint32_t seq;
+
+	if (!SofValid) {
+		return false;
+	}
+	/* Never called from above the SOF interrupt, so a write in progress always finishes */
+	do {
+		seq = SofSeq;
+		__DMB();
+		Stamp->Cycle = SofStamp.Cycle;
+		Stamp->FrameIndex = SofStamp.FrameIndex;
+		__DMB();
+	} while ((seq & 1) || (seq != SofSeq));
+	return true;
+}
+
+/* Measured cycles per microframe unit, 24.8 fixed point */
+uint32_t Timebase_GetCyclesPerMicroframe(void)
+{
+	return CyclesPerMicroframe;
+}
+
+/* Cycle stamp to frame index and offset */
+bool Timebase_ToFrame(uint32_t Cycle, uint16_t *FrameIndex, uint32_t *Offset)
+{
+	TIMEBASE_STAMP_T sof;
+	int32_t delta;
+	uint32_t period = CyclesPerMicroframe;
+
+	if (!Timebase_GetLastSOF(&sof)) {
+		return false;
+	}
+	delta = (int32_t) (Cycle - sof.Cycle);
+	if ((delta >= 0) || (period == 0)) {
+		*FrameIndex = sof.FrameIndex;
+		*Offset = (delta >= 0) ? (uint32_t) delta : 0;
+		return true;
+	}
+	/* Event before the latched SOF: walk back whole microframes */
+	{
+		uint32_t back = (uint32_t) -delta;
+		uint32_t units = (uint32_t) ((((uint64_t) back << 8) + period - 1) / period);
+		*FrameIndex = (uint16_t) ((sof.FrameIndex - units) & (TIMEBASE_FRINDEX_MODULO - 1));
+		*Offset = (uint32_t) ((((uint64_t) units * period) >> 8) - back);
+	}
+	return true;
+}
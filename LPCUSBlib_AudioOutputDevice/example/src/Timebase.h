@@ -0,0 +1,158 @@
+/*
+ * @brief USB SOF locked microframe timebase
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+#ifndef _TIMEBASE_H_
+#define _TIMEBASE_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Audio_Output_Device_Timebase SOF timebase
+ * @ingroup LPC18xx_43xx_Audio_Output_Device
+ * Every USB start of frame latches the controller frame index (FRINDEX) together
+ * with the Cortex-M DWT cycle counter. Stream events (ISO packet arrival, I2S
+ * FIFO refill) are stamped with the cycle counter only, which costs a load and
+ * two stores, and are related to the bus afterwards through the latched SOF.
+ *
+ * FRINDEX counts microframes in bits 13:0 at high speed; at full speed it
+ * advances by 8 per frame. All frame arithmetic here is in those units, modulo
+ * TIMEBASE_FRINDEX_MODULO.
+ * @{
+ */
+
+/** FRINDEX wraps after this many microframe units */
+#define TIMEBASE_FRINDEX_MODULO     (1 << 14)
+
+/** Microframe units over which the cycles per microframe estimate is averaged, 1 s */
+#define TIMEBASE_PERIOD_WINDOW      8000
+
+/**
+ * @brief Stream events that can be stamped
+ */
+typedef enum {
+	TIMEBASE_EVENT_ISO_OUT = 0,		/*!< Isochronous OUT packet received */
+	TIMEBASE_EVENT_I2S_TX,			/*!< I2S transmit FIFO refilled */
+	TIMEBASE_EVENT_COUNT
+} TIMEBASE_EVENT_T;
+
+/**
+ * @brief Frame index and cycle count latched at one SOF
+ */
+typedef struct {
+	uint32_t Cycle;			/*!< DWT cycle count when the SOF interrupt ran */
+	uint16_t FrameIndex;	/*!< FRINDEX, in microframe units */
+	uint16_t Reserved;
+} TIMEBASE_STAMP_T;
+
+/**
+ * @brief Last occurrence of a stream event
+ */
+typedef struct {
+	uint32_t Cycle;			/*!< DWT cycle count of the latest event */
+	uint32_t Count;			/*!< Number of events since Timebase_Init() */
+} TIMEBASE_EVENT_STAMP_T;
+
+/** Latest event stamps, written by Timebase_Mark() */
+extern volatile TIMEBASE_EVENT_STAMP_T Timebase_Events[TIMEBASE_EVENT_COUNT];
+
+/**
+ * @brief	Initialise the timebase for one USB port
+ * @param	corenum	: USB port whose FRINDEX is latched
+ * @return	Nothing
+ * @note	Enables the DWT cycle counter if it is not running yet.
+ */
+void Timebase_Init(uint8_t corenum);
+
+/**
+ * @brief	Latch FRINDEX and the cycle counter, call from the SOF interrupt
+ * @return	Nothing
+ */
+void Timebase_SOF(void);
+
+/**
+ * @brief	Current high resolution time
+ * @return	DWT cycle count
+ */
+STATIC INLINE uint32_t Timebase_Now(void)
+{
+	return DWT->CYCCNT;
+}
+
+/**
+ * @brief	Stamp a stream event, callable from any interrupt
+ * @param	Event	: Event to stamp
+ * @return	Nothing
+ */
+STATIC INLINE void Timebase_Mark(TIMEBASE_EVENT_T Event)
+{
+	Timebase_Events[Event].Cycle = DWT->CYCCNT;
+	Timebase_Events[Event].Count++;
+}
+
+/**
+ * @brief	Read the most recent SOF stamp
+ * @param	Stamp	: Pointer to stamp to fill
+ * @return	false if no SOF was seen since Timebase_Init()
+ * @note	Retries while the SOF interrupt updates the stamp, so call it from the main
+ *			loop or an interrupt that cannot preempt the SOF interrupt.
+ */
+bool Timebase_GetLastSOF(TIMEBASE_STAMP_T *Stamp);
+
+/**
+ * @brief	Measured length of a microframe unit
+ * @return	CPU cycles per FRINDEX unit in 24.8 fixed point, 0 until the first window completed
+ * @note	The ratio to the nominal value is the drift between the CPU clock and the host clock.
+ */
+uint32_t Timebase_GetCyclesPerMicroframe(void);
+
+/**
+ * @brief	Express a cycle stamp on the bus timeline
+ * @param	Cycle		: DWT cycle count, e.g. from Timebase_Events[]
+ * @param	FrameIndex	: Filled with the FRINDEX of the SOF that preceded Cycle
+ * @param	Offset		: Filled with the cycles from that SOF to Cycle
+ * @return	false if no SOF is known yet
+ * @note	Stamps older than the last SOF are resolved with the measured period, so
+ *			they stay exact for as long as the clocks do not drift noticeably.
+ */
+bool Timebase_ToFrame(uint32_t Cycle, uint16_t *FrameIndex, uint32_t *Offset);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TIMEBASE_H_ */
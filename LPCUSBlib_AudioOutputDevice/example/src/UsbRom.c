@@ -89,8 +89,8 @@ uint8_t StringDescriptor[] = {
 	WBVAL('5'),
 	WBVAL('6')
 };
-extern USB_Descriptor_Device_t DeviceDescriptor;
-extern USB_Descriptor_Configuration_t ConfigurationDescriptor;
+extern const USB_Descriptor_Device_t DeviceDescriptor;
+extern const USB_Descriptor_Configuration_t ConfigurationDescriptor;
 
 uint32_t CALLBACK_UsbdRom_Register_DeviceDescriptor(void)
 {
@@ -29,6 +29,11 @@
 // this code.
 //*****************************************************************************
 
+#if defined (__USE_LPCOPEN)
+// Boot timeline checkpoints, BootProfile_Start() must run before anything else
+#include "BootProfile.h"
+#endif
+
 #if defined (__cplusplus)
 #ifdef __REDLIB__
 #error Redlib does not support C++
@@ -302,6 +307,10 @@ extern unsigned int __bss_section_table_end;
 //*****************************************************************************
 void ResetISR(void) {
 
+#if defined (__USE_LPCOPEN)
+    BootProfile_Start();
+#endif
+
 // *************************************************************
 // The following conditional block of code manually resets as
 // much of the peripheral set of the LPC43 as possible. This is
@@ -354,6 +363,7 @@ void ResetISR(void) {
 
 #if defined (__USE_LPCOPEN)
     SystemInit();
+    BootProfile_Mark(BOOT_CHECKPOINT_SYSTEM_INIT);
 #endif
 
     //
@@ -417,6 +427,10 @@ void ResetISR(void) {
     SystemInit();
 #endif
 
+#if defined (__USE_LPCOPEN)
+    BootProfile_Mark(BOOT_CHECKPOINT_DATA_INIT);
+#endif
+
 #if defined (__cplusplus)
     //
     // Call C++ library initialisation
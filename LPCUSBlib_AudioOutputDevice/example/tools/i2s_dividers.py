@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+#
+# I2S divider table generator for the Audio Output Device example (see
+# example/src/AudioRates.h).
+#
+# Usage:
+#   i2s_dividers.py report                       180 and 204 MHz, all rates
+#   i2s_dividers.py report --clock 204000000 --rates 44100 48000
+#   i2s_dividers.py generate -o example/src/I2SDividers.h
+#   i2s_dividers.py generate --check -o example/src/I2SDividers.h
+#
+# For every I2S clock (CLK_APB1_I2S) and sample rate this runs the search of
+# I2S_RateFind() in AudioRates.c, step for step and with the same integer
+# arithmetic: every bit rate divider N is tried, RATEDOWN is the fastest X/Y
+# at least the trim margin below the nominal rate, RATEUP the slowest X/Y at
+# least that far above it, and the N with the tightest pair wins.
+#
+# "report" prints each entry with the error of both dividers in ppm, as the
+# firmware computes it, and the spread the rate control switches across.
+#
+# "generate" writes the const tables AudioRates_Init() picks from when the
+# I2S clock matches, so the firmware skips the search at boot. The project
+# runs it as a pre-build step. The file is only rewritten when its contents
+# change, and --check exits with status 1 instead when it is out of date.
+#
+# Only the Python 3 standard library is used.
+
+import argparse
+import os
+import sys
+
+CLOCKS = [180000000, 204000000]
+RATES = [8000, 11025, 16000, 22050, 32000, 44100, 48000]
+
+
+def fraction(x, y):
+    """X/Y as the 0.32 fixed point value the firmware compares."""
+    return (x << 32) // y
+
+
+def rate_find(clock, rate, width, trim):
+    """Mirror of I2S_RateFind(), returns (N, (down X, Y), (up X, Y)) or None."""
+    best = None
+    result = None
+    for n in range(1, 65):
+        target = rate * 2 * width * 2 * n
+        down = 0
+        up = None
+        for y in range(1, 256):
+            x = (y * target * (1000000 - trim)) // (clock * 1000000)
+            if 0 < x <= y and fraction(x, y) > down:
+                down = fraction(x, y)
+                pair_down = (x, y)
+            x = (y * target * (1000000 + trim) + clock * 1000000 - 1) // (clock * 1000000)
+            if x <= y and (up is None or fraction(x, y) < up):
+                up = fraction(x, y)
+                pair_up = (x, y)
+        if down == 0 or up is None:
+            continue
+        span = (up - down) * clock // target
+        if best is None or span < best:
+            best = span
+            result = (n, pair_down, pair_up)
+    return result
+
+
+def deviation(clock, rate, width, n, pair):
+    """Error of one divider in ppm, as AudioRates_Deviation() computes it."""
+    x, y = pair
+    return (clock * x * 1000000) // (y * rate * 2 * width * 2 * n) - 1000000
+
+
+def entries(clock, rates, width, trim):
+    table = []
+    for rate in rates:
+        found = rate_find(clock, rate, width, trim)
+        if found is None:
+            table.append((rate, None))
+            continue
+        n, down, up = found
+        table.append((rate, (n, down, up,
+                             deviation(clock, rate, width, n, down),
+                             deviation(clock, rate, width, n, up))))
+    return table
+
+
+def cmd_report(args):
+    print('word width %d, trim %d ppm' % (args.width, args.trim))
+    for clock in args.clock:
+        print()
+        print('CLK_APB1_I2S %d Hz' % clock)
+        print('   rate   N   down X/Y     ppm    up X/Y     ppm   spread')
+        for rate, entry in entries(clock, args.rates, args.width, args.trim):
+            if entry is None:
+                print('%7d   no divider pair brackets this rate' % rate)
+                continue
+            n, down, up, down_ppm, up_ppm = entry
+            print('%7d  %2d   %3d/%-3d  %+6d   %3d/%-3d  %+6d   %6d'
+                  % (rate, n, down[0], down[1], down_ppm, up[0], up[1], up_ppm, up_ppm - down_ppm))
+
+
+def render(args):
+    lines = [
+        '/*',
+        ' * @brief I2S divider tables, generated by example/tools/i2s_dividers.py',
+        ' *',
+        ' * Do not edit, regenerate with',
+        ' *   i2s_dividers.py generate -o example/src/I2SDividers.h',
+        ' * Included once, by AudioRates.c.',
+        ' */',
+        '',
+        '#define I2S_DIVIDERS_WORD_WIDTH     %d' % args.width,
+        '#define I2S_DIVIDERS_TRIM_PPM       %d' % args.trim,
+    ]
+    names = []
+    for clock in args.clock:
+        name = 'I2S_Dividers%dMHz' % (clock // 1000000) if clock % 1000000 == 0 else 'I2S_Dividers%dHz' % clock
+        names.append((clock, name))
+        lines += [
+            '',
+            '/* CLK_APB1_I2S = %d Hz */' % clock,
+            'static const I2S_DIVIDER_ENTRY_T %s[] = {' % name,
+            '\t/* Rate\tppm down, up\tBITRATE\tRATE_Up(x,y)\tRATE_Down(x,y) */',
+        ]
+        for rate, entry in entries(clock, args.rates, args.width, args.trim):
+            if entry is None:
+                lines.append('\t/* %d: no divider pair brackets this rate */' % rate)
+                continue
+            n, down, up, down_ppm, up_ppm = entry
+            lines.append('\t{%d,\t%d, %d,\t{0x%02X,\t{0x%02X,\t0x%02X},\t{0x%02X,\t0x%02X}}},'
+                         % (rate, down_ppm, up_ppm, n - 1, up[0], up[1], down[0], down[1]))
+        lines.append('};')
+    lines += ['', 'static const I2S_DIVIDER_TABLE_T I2S_DividerTables[] = {']
+    for clock, name in names:
+        lines.append('\t{%d, sizeof(%s) / sizeof(%s[0]), %s},' % (clock, name, name, name))
+    lines += ['};', '']
+    return '\n'.join(lines)
+
+
+def cmd_generate(args):
+    text = render(args)
+    if args.output is None:
+        sys.stdout.write(text)
+        return
+    try:
+        with open(args.output) as f:
+            current = f.read()
+    except OSError:
+        current = None
+    if current == text:
+        return
+    if args.check:
+        sys.exit('%s is out of date, run i2s_dividers.py generate -o %s' % (args.output, args.output))
+    with open(args.output + '.tmp', 'w') as f:
+        f.write(text)
+    os.replace(args.output + '.tmp', args.output)
+
+
+def main():
+    common = argparse.ArgumentParser(add_help=False)
+    common.add_argument('--clock', type=int, nargs='+', default=CLOCKS,
+                        help='I2S clocks in Hz (default 180000000 204000000)')
+    common.add_argument('--rates', type=int, nargs='+', default=RATES, help='sample rates (default all advertised)')
+    common.add_argument('--width', type=int, default=16, help='I2S word width (default 16)')
+    common.add_argument('--trim', type=int, default=40, help='rate control margin in ppm (default 40)')
+
+    parser = argparse.ArgumentParser(description='I2S divider table generator')
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    report = sub.add_parser('report', parents=[common], help='print the dividers and their error')
+    report.set_defaults(func=cmd_report)
+
+    generate = sub.add_parser('generate', parents=[common], help='write the const divider tables')
+    generate.add_argument('-o', '--output', help='header to write (default stdout)')
+    generate.add_argument('--check', action='store_true', help='fail instead of rewriting an out of date header')
+    generate.set_defaults(func=cmd_generate)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,367 @@
+#!/usr/bin/env python3
+#
+# Latency and jitter probe for the Audio Output Device example (see
+# example/src/Latency.h).
+#
+# Usage:
+#   latency_probe.py run /dev/ttyACM0                 20 ms interval, 10 s
+#   latency_probe.py run -i 50 -t 60 /dev/ttyACM0
+#   latency_probe.py run --max-p99-us 2000 /dev/ttyACM0
+#   latency_probe.py simulate                         48 kHz, high speed
+#   latency_probe.py simulate --speed full --host-ppm -50 --max-p99-us 4000
+#
+# "run" starts the probe through the telemetry function, collects latency
+# records for the given time, stops the probe and prints for each path the
+# marker count, losses, mean, jitter (standard deviation), percentiles and
+# histogram. Play silence on the audio function while it runs. The round trip
+# path also needs the capture interface streaming (e.g. arecord) and the I2S
+# TX data pin of the port wired to its RX data pin.
+#
+# "simulate" runs a model of the device pipeline: host packets, the playback
+# ring with its two divider rate control, the I2S FIFO refills, the capture
+# ring and its packet length servo. The model is probed the way the firmware
+# probes the device, its results are encoded as telemetry records and go
+# through the same decoder and analysis as "run".
+#
+# With --max-p99-us either mode exits with status 1 when a path has no
+# markers, lost markers or a 99th percentile above the bound, so a simulation
+# run can guard the pipeline against latency regressions without hardware.
+#
+# Only the Python 3 standard library is used.
+
+import argparse
+import math
+import os
+import random
+import select
+import struct
+import sys
+import time
+
+from telemetry_decode import (CMD_LATENCY, LATENCY_BINS, LATENCY_MAGIC, LATENCY_PATHS,
+                              LATENCY_VERSION, LATENCY, Decoder, open_port, pack_latency)
+
+# Must match the firmware
+BIN_US = 250                # LATENCY_BIN_US
+TIMEOUT_S = 0.2             # LATENCY_TIMEOUT_MS
+FIFO_REFILL = 4             # I2S interrupt when the TX FIFO holds this many frames ...
+FIFO_DEPTH = 8              # ... and refill up to this many
+STREAM_INTERVAL = 2         # bInterval of both streaming endpoints
+CAPTURE_RING = 512          # CAPTURE_RING_FRAMES
+CAPTURE_SLACK = 8           # CAPTURE_DMA_SLACK_FRAMES
+CAPTURE_BAND = 2            # CAPTURE_SERVO_BAND_FRAMES
+CAPTURE_MAX_RATE = 48000    # CAPTURE_MAX_SAMPLE_FREQ
+PATH_ISO, PATH_ROUND_TRIP = 0, 1
+
+
+def percentile(record, fraction):
+    """Upper edge of the bin holding the given fraction of the markers."""
+    total = sum(record['bins'])
+    if total == 0:
+        return 0
+    wanted = fraction * total
+    seen = 0
+    for index, count in enumerate(record['bins']):
+        seen += count
+        if seen >= wanted:
+            return max(record['min_us'], min(record['max_us'], (index + 1) * record['bin_us']))
+    return record['max_us']
+
+
+def analyse(record):
+    """Mean, jitter and percentiles of one latency record, all in us."""
+    count = record['count']
+    result = {'count': count, 'lost': record['lost']}
+    if count == 0:
+        return result
+    mean = record['sum_us'] / count
+    result['mean'] = mean
+    result['jitter'] = math.sqrt(max(0.0, record['sum_squares_us'] / count - mean * mean))
+    result['min'] = record['min_us']
+    result['max'] = record['max_us']
+    for name, fraction in (('p50', 0.5), ('p90', 0.9), ('p99', 0.99)):
+        result[name] = percentile(record, fraction)
+    return result
+
+
+def report(records, max_p99):
+    """Prints the latest record of each port and path, returns the exit status."""
+    status = 0
+    if not records:
+        print('no latency record received, is the probe built in?')
+        return 1
+    for key in sorted(records):
+        record = records[key]
+        result = analyse(record)
+        print('port%d %s: %d markers, %d lost' % (
+            record['port'], LATENCY_PATHS[record['path']], result['count'], result['lost']))
+        if result['count'] == 0:
+            if max_p99 is not None:
+                status = 1
+            continue
+        print('  min %d  mean %.1f  max %d  jitter %.1f us (std dev)' % (
+            result['min'], result['mean'], result['max'], result['jitter']))
+        print('  p50 <= %d  p90 <= %d  p99 <= %d us' % (result['p50'], result['p90'], result['p99']))
+        bins = record['bins']
+        used = [i for i, count in enumerate(bins) if count]
+        peak = max(bins)
+        for i in range(used[0], used[-1] + 1):
+            upper = '+' if i == LATENCY_BINS - 1 else '%6d' % ((i + 1) * record['bin_us'])
+            print('  %6d..%s us %6d %s' % (i * record['bin_us'], upper, bins[i],
+                                           '#' * int(round(40.0 * bins[i] / peak))))
+        if max_p99 is not None and (result['lost'] or result['p99'] > max_p99):
+            print('  FAIL: p99 %d us (bound %d), %d lost' % (result['p99'], max_p99, result['lost']))
+            status = 1
+    return status
+
+
+def cmd_run(args):
+    fd = open_port(args.device, args.period)
+    os.write(fd, CMD_LATENCY + struct.pack('<H', args.interval))
+    decoder = Decoder()
+    records = {}
+    end = time.monotonic() + args.time
+    try:
+        while time.monotonic() < end:
+            readable, _, _ = select.select([fd], [], [], 0.5)
+            if not readable:
+                continue
+            data = os.read(fd, 4096)
+            if not data:
+                break
+            for record in decoder.feed(data):
+                if record['magic'] == LATENCY_MAGIC:
+                    records[(record['port'], record['path'])] = record
+    except KeyboardInterrupt:
+        pass
+    finally:
+        os.write(fd, CMD_LATENCY + struct.pack('<H', 0))
+        os.close(fd)
+    return report(records, args.max_p99_us)
+
+
+class Path:
+    """Results of one path, as Latency_Add() keeps them."""
+
+    def __init__(self):
+        self.count = self.lost = self.max_us = self.sum_us = self.sum_squares_us = 0
+        self.min_us = 0xFFFFFFFF
+        self.bins = [0] * LATENCY_BINS
+
+    def add(self, us):
+        bin_index = min(us // BIN_US, LATENCY_BINS - 1)
+        self.bins[bin_index] = min(0xFFFF, self.bins[bin_index] + 1)
+        self.min_us = min(self.min_us, us)
+        self.max_us = max(self.max_us, us)
+        self.sum_us += us
+        self.sum_squares_us += us * us
+        self.count += 1
+
+
+class Probe:
+    """Latency_Arm() and Latency_Complete(): one marker in flight, timed out after TIMEOUT_S."""
+
+    def __init__(self, interval):
+        self.interval = interval
+        self.last = None
+        self.start = 0.0
+        self.pending = [False, False]
+        self.paths = [Path(), Path()]
+
+    def arm(self, now, arrival, paths):
+        if self.last is not None:
+            if now - self.last < self.interval:
+                return False
+            if any(self.pending):
+                if now - self.start < TIMEOUT_S:
+                    return False
+                for path, pending in enumerate(self.pending):
+                    if pending:
+                        self.paths[path].lost += 1
+                        self.pending[path] = False
+        self.last = now
+        self.start = arrival
+        self.pending = [bool(paths & (1 << path)) for path in range(2)]
+        return True
+
+    def complete(self, path, now):
+        if self.pending[path]:
+            self.paths[path].add(int((now - self.start) * 1e6))
+            self.pending[path] = False
+
+    def records(self, sequence, interval_ms):
+        for number, path in enumerate(self.paths):
+            record = {
+                'magic': LATENCY_MAGIC, 'version': LATENCY_VERSION, 'length': LATENCY.size,
+                'sequence': (sequence + number) & 0xFFFF, 'port': 0, 'path': number, 'cycle': 0,
+                'interval_ms': interval_ms, 'bin_us': BIN_US, 'count': path.count,
+                'lost': path.lost, 'min_us': path.min_us if path.count else 0,
+                'max_us': path.max_us, 'sum_us': path.sum_us,
+                'sum_squares_us': path.sum_squares_us, 'bins': path.bins,
+            }
+            yield pack_latency(record)
+
+
+def playback_ring_frames(rate):
+    """BufferSize of Audio_Start(), in frames."""
+    if rate in (11025, 22050, 44100):
+        return 1764 * 2 // 4
+    return rate * 4 * 10 // 1000 * 2 // 4
+
+
+def cmd_simulate(args):
+    rng = random.Random(args.seed)
+    rate = args.rate
+    frame_s = 1.0 / rate
+    frame_up_s = frame_s / (1 + args.rate_up_ppm * 1e-6)
+    high = args.speed == 'high'
+    period = (125e-6 if high else 1e-3) * 2 ** (STREAM_INTERVAL - 1)
+    host_period = period / (1 + args.host_ppm * 1e-6)
+    packet_rate = int(round(1.0 / period))
+    ring = playback_ring_frames(rate)
+    probe = Probe(args.interval / 1000.0)
+
+    # Playback: absolute frame numbers written and read, the marker position
+    written = read = 0
+    marker = None
+    double_speed = False
+    host_accumulator = 0.0
+    # I2S: frames shifted out, wire number of the marker on its way back
+    wire = 0
+    wire_marker = None
+    # Capture: reader position and packet sizing state (Capture_GetISOBufferAddress)
+    max_frames = CAPTURE_MAX_RATE // packet_rate + 1
+    target = 2 * ((rate + packet_rate - 1) // packet_rate) + CAPTURE_SLACK
+    capture_read = -target
+    capture_accumulator = 0
+    out_frames = out_packets = out_used = 0
+    underruns = overruns = 0
+
+    decoder = Decoder()
+    records = {}
+    sequence = 0
+    next_out = host_period
+    next_in = host_period + host_period / 2
+    next_refill = FIFO_REFILL * frame_s
+    next_report = args.settle + 0.1
+    while True:
+        now = min(next_out, next_in, next_refill, next_report)
+        if now >= args.time:
+            break
+        if now == next_out:
+            # OUT packet completes somewhere in its (micro)frame, latency counts from the SOF
+            sof = next_out
+            arrival = sof + rng.uniform(0.0, args.host_jitter_us * 1e-6)
+            host_accumulator += rate * period
+            frames = int(host_accumulator)
+            host_accumulator -= frames
+            paths = 1 << PATH_ISO
+            if not args.no_loopback:
+                paths |= 1 << PATH_ROUND_TRIP
+            if frames and arrival >= args.settle and probe.arm(arrival, sof, paths):
+                marker = written
+            written += frames
+            if written - read > ring:
+                overruns += 1
+                read = written
+                marker = None
+            out_frames = frames
+            out_packets += 1
+            next_out += host_period
+        elif now == next_refill:
+            # FIFO down to FIFO_REFILL frames: push FIFO_DEPTH - FIFO_REFILL more
+            wire += FIFO_REFILL
+            for i in range(FIFO_DEPTH - FIFO_REFILL):
+                if written - read >= 1:
+                    if read == marker:
+                        probe.complete(PATH_ISO, now + (FIFO_REFILL + i + 1) * frame_s)
+                        wire_marker = wire + FIFO_REFILL + i
+                        marker = None
+                    read += 1
+                elif i == 0:
+                    underruns += 1
+            fill = written - read
+            if fill >= ring * 5 // 8:
+                double_speed = True
+            elif fill < ring * 3 // 8:
+                double_speed = False
+            next_refill += FIFO_REFILL * (frame_up_s if double_speed else frame_s)
+        elif now == next_in:
+            # The RX DMA has written every frame fully shifted in
+            capture_written = wire
+            fill = capture_written - capture_read
+            if fill > CAPTURE_RING // 2:
+                capture_read = capture_written - target
+                fill = target
+            if out_packets != out_used:
+                out_used = out_packets
+                frames = out_frames
+            else:
+                capture_accumulator += rate
+                frames = capture_accumulator // packet_rate
+                capture_accumulator -= frames * packet_rate
+            if fill > target + CAPTURE_BAND:
+                frames += 1
+            elif fill + CAPTURE_BAND < target and frames > 0:
+                frames -= 1
+            frames = max(0, min(frames, max_frames, fill))
+            if wire_marker is not None and capture_read <= wire_marker < capture_read + frames:
+                probe.complete(PATH_ROUND_TRIP, now)
+                wire_marker = None
+            capture_read += frames
+            next_in += host_period
+        else:
+            # Telemetry period: encode the results and decode them like a real stream
+            for raw in probe.records(sequence, args.interval):
+                for record in decoder.feed(raw):
+                    records[(record['port'], record['path'])] = record
+            sequence += 2
+            next_report += 0.1
+
+    if args.no_loopback:
+        records.pop((0, PATH_ROUND_TRIP), None)
+    print('simulated %.1f s: %d Hz, %s speed, host %+.0f ppm, RATEUP %+.0f ppm, '
+          '%d I2S underruns, %d ring overruns' % (
+              args.time, rate, args.speed, args.host_ppm, args.rate_up_ppm, underruns, overruns))
+    if decoder.bad:
+        print('%d records failed to decode' % decoder.bad)
+        return 1
+    return report(records, args.max_p99_us)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Audio path latency and jitter probe')
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    run = sub.add_parser('run', help='probe a device')
+    run.add_argument('device', help='telemetry CDC-ACM tty, e.g. /dev/ttyACM0')
+    run.add_argument('-i', '--interval', type=int, default=20, help='ms between markers (default 20)')
+    run.add_argument('-t', '--time', type=float, default=10.0, help='seconds to run (default 10)')
+    run.add_argument('-p', '--period', type=int, help='telemetry period in ms')
+    run.add_argument('--max-p99-us', type=int, help='fail when a path p99 exceeds this')
+    run.set_defaults(func=cmd_run)
+
+    sim = sub.add_parser('simulate', help='probe a model of the device pipeline')
+    sim.add_argument('-r', '--rate', type=int, default=48000, help='sample rate (default 48000)')
+    sim.add_argument('--speed', choices=('high', 'full'), default='high', help='bus speed (default high)')
+    sim.add_argument('-i', '--interval', type=int, default=20, help='ms between markers (default 20)')
+    sim.add_argument('-t', '--time', type=float, default=10.0, help='simulated seconds (default 10)')
+    sim.add_argument('--settle', type=float, default=0.5, help='seconds before the first marker (default 0.5)')
+    sim.add_argument('--host-ppm', type=float, default=20.0,
+                     help='host clock against the I2S nominal rate (default 20)')
+    sim.add_argument('--rate-up-ppm', type=float, default=34.0,
+                     help='speed up of the RATEUP divider (default 34, the LPC43xx 48 kHz entry)')
+    sim.add_argument('--host-jitter-us', type=float, default=20.0,
+                     help='OUT packet completion spread after the SOF (default 20)')
+    sim.add_argument('--no-loopback', action='store_true', help='no TX to RX wire, iso->i2s only')
+    sim.add_argument('--seed', type=int, default=1, help='random seed (default 1)')
+    sim.add_argument('--max-p99-us', type=int, help='fail when a path p99 exceeds this')
+    sim.set_defaults(func=cmd_simulate)
+
+    args = parser.parse_args()
+    sys.exit(args.func(args))
+
+
+if __name__ == '__main__':
+    main()
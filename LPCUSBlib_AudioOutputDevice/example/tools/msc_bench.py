@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+#
+# Throughput benchmark for the mass storage function of the Audio Output
+# Device example (see example/src/MassStorage.h).
+#
+# Usage:
+#   msc_bench.py run /dev/sdX                    sequential reads, 8 MB
+#   msc_bench.py run --write -s 64 /dev/sdX      writes too (destroys the disk
+#                                                contents), 64 KB requests
+#   msc_bench.py model                           pipeline model, RAM disk
+#   msc_bench.py model --block-us 40 --buffers 4 slower backing store
+#
+# "run" talks to the device through the Linux block layer with O_DIRECT, so
+# every request reaches the device as READ(10)/WRITE(10) commands. The RAM
+# disk is small, requests wrap around it until the total is reached.
+#
+# "model" replays the class driver data phase engine with a fixed wire rate,
+# a fixed backing store access time per block and a fixed cost per transfer,
+# and prints the throughput to expect for 1 (no pipelining) up to the given
+# number of sector buffers. Compare it with "run" to see where the time goes.
+#
+# Only the Python 3 standard library is used.
+
+import argparse
+import math
+import mmap
+import os
+import sys
+import time
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, int(round(fraction * (len(ordered) - 1))))
+    return ordered[index]
+
+
+def run_pass(fd, disk_size, request, total, write):
+    buf = mmap.mmap(-1, request)	# page aligned, as O_DIRECT requires
+    if write:
+        buf.write(bytes((i * 7) & 0xFF for i in range(request)))
+    latencies = []
+    done = 0
+    offset = 0
+    start = time.perf_counter()
+    while done < total:
+        if offset + request > disk_size:
+            offset = 0
+        t0 = time.perf_counter()
+        if write:
+            moved = os.pwritev(fd, [buf], offset)
+        else:
+            moved = os.preadv(fd, [buf], offset)
+        latencies.append(time.perf_counter() - t0)
+        if moved != request:
+            raise OSError('short transfer at offset %d: %d bytes' % (offset, moved))
+        done += request
+        offset += request
+    elapsed = time.perf_counter() - start
+    buf.close()
+    return done / elapsed, latencies
+
+
+def cmd_run(args):
+    request = args.size * 1024
+    flags = os.O_DIRECT | (os.O_RDWR | os.O_SYNC if args.write else os.O_RDONLY)
+    fd = os.open(args.device, flags)
+    try:
+        disk_size = os.lseek(fd, 0, os.SEEK_END)
+        if disk_size < request:
+            request = disk_size & ~4095
+        if request <= 0:
+            sys.exit('%s: disk too small' % args.device)
+        total = args.total * 1024 * 1024
+        passes = [('read', False)] + ([('write', True)] if args.write else [])
+        print('%s: %d KB disk, %d KB requests, %d MB per pass'
+              % (args.device, disk_size // 1024, request // 1024, args.total))
+        for name, write in passes:
+            rate, lat = run_pass(fd, disk_size, request, total, write)
+            print('%-5s %8.2f MB/s  latency us: min %.0f  p50 %.0f  p99 %.0f  max %.0f'
+                  % (name, rate / 1e6, min(lat) * 1e6, percentile(lat, 0.5) * 1e6,
+                     percentile(lat, 0.99) * 1e6, max(lat) * 1e6))
+    finally:
+        os.close(fd)
+
+
+def model_transfer(args, buffers, write):
+    """Time in seconds to move one request through the engine."""
+    request = args.size * 1024
+    chunks = math.ceil(request / args.buffer_size)
+    wire_s_per_byte = 1.0 / (args.wire_mbps * 1e6)
+    store_s_per_byte = args.block_us * 1e-6 / args.block_size + 1.0 / (args.memcpy_mbps * 1e6)
+    overhead = args.transfer_us * 1e-6
+    free_at = [0.0] * buffers
+    wire_free = 0.0
+    store_free = 0.0
+    for i in range(chunks):
+        b = i % buffers
+        size = min(args.buffer_size, request - i * args.buffer_size)
+        if write:
+            # The wire fills a free buffer, the store empties it afterwards
+            wire_start = max(wire_free, free_at[b]) + overhead
+            wire_free = wire_start + size * wire_s_per_byte
+            store_start = max(store_free, wire_free)
+            store_free = store_start + size * store_s_per_byte
+            free_at[b] = store_free
+        else:
+            # The store fills a free buffer, the wire drains it afterwards
+            store_start = max(store_free, free_at[b])
+            store_free = store_start + size * store_s_per_byte
+            wire_start = max(wire_free, store_free) + overhead
+            wire_free = wire_start + size * wire_s_per_byte
+            free_at[b] = wire_free
+    return max(wire_free, store_free) + args.command_us * 1e-6
+
+
+def cmd_model(args):
+    request = args.size * 1024
+    if args.buffer_size % args.block_size or request % args.block_size:
+        sys.exit('buffer and request sizes must be multiples of the block size')
+    print('wire %.0f MB/s, store %.1f us/block + %.0f MB/s copy, %d B buffers, %d KB requests'
+          % (args.wire_mbps, args.block_us, args.memcpy_mbps, args.buffer_size, args.size))
+    print('buffers   read MB/s  write MB/s')
+    buffers = 1
+    while buffers <= args.buffers:
+        read = request / model_transfer(args, buffers, False)
+        write = request / model_transfer(args, buffers, True)
+        print('%7d   %9.2f  %10.2f' % (buffers, read / 1e6, write / 1e6))
+        buffers *= 2
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Mass storage function throughput benchmark')
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    run = sub.add_parser('run', help='measure a device')
+    run.add_argument('device', help='block device of the function, e.g. /dev/sdb')
+    run.add_argument('-s', '--size', type=int, default=16, help='request size in KB (default 16)')
+    run.add_argument('-t', '--total', type=int, default=8, help='MB moved per pass (default 8)')
+    run.add_argument('--write', action='store_true', help='also measure writes, overwrites the disk')
+    run.set_defaults(func=cmd_run)
+
+    model = sub.add_parser('model', help='model the data phase pipeline')
+    model.add_argument('-s', '--size', type=int, default=16, help='request size in KB (default 16)')
+    model.add_argument('--buffers', type=int, default=4, help='largest sector buffer count (default 4)')
+    model.add_argument('--buffer-size', type=int, default=4096, help='sector buffer size (default 4096)')
+    model.add_argument('--block-size', type=int, default=512, help='block size (default 512)')
+    model.add_argument('--block-us', type=float, default=0.0,
+                       help='backing store access time per block, MASS_STORAGE_BLOCK_DELAY_US (default 0)')
+    model.add_argument('--memcpy-mbps', type=float, default=200.0, help='RAM copy rate (default 200)')
+    model.add_argument('--wire-mbps', type=float, default=40.0, help='bulk wire rate (default 40, high speed)')
+    model.add_argument('--transfer-us', type=float, default=5.0,
+                       help='interrupt and re-prime cost per buffer (default 5)')
+    model.add_argument('--command-us', type=float, default=250.0,
+                       help='CBW and CSW cost per request (default 250, two microframes)')
+    model.set_defaults(func=cmd_model)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
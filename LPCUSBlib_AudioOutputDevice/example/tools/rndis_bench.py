@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+#
+# Frame rate benchmark for the RNDIS function of the Audio Output Device
+# example (see example/src/Network.h), built with AUDIO_RNDIS_FUNCTION=1.
+#
+# Usage:
+#   rndis_bench.py run usb0                     64 byte frames, 5 s, window 4
+#   rndis_bench.py run -s 1500 -w 8 usb0        full size frames, 8 in flight
+#   rndis_bench.py model                        frame engine model
+#   rndis_bench.py model --frames 16 --sink-us 20
+#
+# "run" needs the loopback sink (NETWORK_SINK_LOOPBACK, the default) and
+# root or CAP_NET_RAW. It sends raw frames of ethertype 0x88B5 to the
+# adapter, which swaps the MAC addresses and sends them back, keeping up to
+# WINDOW frames in flight. It prints echoed frames/s, the payload rate and
+# the round trip latency. Frames are numbered, so losses and reordering are
+# counted as well.
+#
+# "model" replays the class driver frame engine: a pool of N slots, one OUT
+# transfer and one IN transfer in flight, a fixed cost per transfer and a
+# fixed sink time per frame in the main loop. It prints the echo rate to
+# expect for pools of 2 up to the given number of frames, at each frame size.
+# Compare it with "run" to see where the time goes.
+#
+# Only the Python 3 standard library is used.
+
+import argparse
+import select
+import socket
+import struct
+import sys
+import time
+
+ETHERTYPE = 0x88B5
+HEADER = 14
+RNDIS_HEADER = 44
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, int(round(fraction * (len(ordered) - 1))))
+    return ordered[index]
+
+
+def cmd_run(args):
+    if args.size < HEADER + 8 or args.size > 1500:
+        sys.exit('frame size must be between %d and 1500' % (HEADER + 8))
+    sock = socket.socket(socket.AF_PACKET, socket.SOCK_RAW, socket.htons(ETHERTYPE))
+    sock.bind((args.interface, ETHERTYPE))
+    sock.setblocking(False)
+    local = sock.getsockname()[4]
+    # The adapter swaps the addresses, so any unicast destination comes back
+    peer = bytes.fromhex('026037123456')
+    head = peer + local + struct.pack('!H', ETHERTYPE)
+    padding = bytes(args.size - HEADER - 8)
+
+    sent = {}
+    latencies = []
+    sequence = 0
+    expected = 0
+    received = 0
+    reordered = 0
+    start = time.perf_counter()
+    end = start + args.time
+    while True:
+        now = time.perf_counter()
+        if now >= end and not sent:
+            break
+        while now < end and len(sent) < args.window:
+            sock.send(head + struct.pack('!Q', sequence) + padding)
+            sent[sequence] = time.perf_counter()
+            sequence += 1
+        readable, _, _ = select.select([sock], [], [], args.timeout)
+        if not readable:
+            # Whatever is outstanding after a full timeout is lost
+            if now >= end:
+                break
+            sent.clear()
+            continue
+        while True:
+            try:
+                frame = sock.recv(2048)
+            except BlockingIOError:
+                break
+            if len(frame) < HEADER + 8 or frame[6:12] != peer:
+                continue
+            number = struct.unpack_from('!Q', frame, HEADER)[0]
+            stamp = sent.pop(number, None)
+            if stamp is None:
+                continue
+            latencies.append(time.perf_counter() - stamp)
+            received += 1
+            if number < expected:
+                reordered += 1
+            expected = max(expected, number + 1)
+    elapsed = time.perf_counter() - start
+    sock.close()
+
+    if not latencies:
+        sys.exit('%s: no frame came back, is the loopback sink built in?' % args.interface)
+    rate = received / elapsed
+    print('%s: %d B frames, window %d, %.1f s' % (args.interface, args.size, args.window, elapsed))
+    print('sent %d  echoed %d  lost %d  reordered %d'
+          % (sequence, received, sequence - received, reordered))
+    print('%.0f frames/s  %.2f Mbit/s each way' % (rate, rate * args.size * 8 / 1e6))
+    print('round trip us: min %.0f  p50 %.0f  p99 %.0f  max %.0f'
+          % (min(latencies) * 1e6, percentile(latencies, 0.5) * 1e6,
+             percentile(latencies, 0.99) * 1e6, max(latencies) * 1e6))
+
+
+def model_rate(args, frames, size):
+    """Echoed frames per second for a pool of the given size."""
+    wire = (RNDIS_HEADER + size) / (args.wire_mbps * 1e6)
+    transfer = args.transfer_us * 1e-6 + wire
+    sink = args.sink_us * 1e-6
+    count = 2000
+    free = frames
+    out_free = 0.0		# OUT endpoint idle from
+    in_free = 0.0		# IN endpoint idle from
+    loop_free = 0.0		# main loop idle from
+    pending = []		# pool slots returning at the given times
+    finish = 0.0
+    for _ in range(count):
+        # Frames come back to the pool once their IN transfer completed
+        pending.sort()
+        while free == 0:
+            out_free = max(out_free, pending.pop(0))
+            free += 1
+        while pending and pending[0] <= out_free:
+            pending.pop(0)
+            free += 1
+        free -= 1
+        # The host keeps the OUT endpoint busy, the slot receives the frame
+        received = out_free + transfer
+        out_free = received
+        # The main loop swaps the addresses and queues the reply
+        queued = max(received, loop_free) + sink
+        loop_free = queued
+        sent = max(queued, in_free) + transfer
+        in_free = sent
+        pending.append(sent)
+        finish = sent
+    return count / finish
+
+
+def cmd_model(args):
+    print('wire %.0f MB/s, %.0f us per transfer, %.0f us sink per frame'
+          % (args.wire_mbps, args.transfer_us, args.sink_us))
+    sizes = [64, 512, 1500]
+    print('frames  ' + ''.join('%10d B' % size for size in sizes) + '   (frames/s)')
+    frames = 2
+    while frames <= args.frames:
+        print('%6d  ' % frames + ''.join('%12.0f' % model_rate(args, frames, size) for size in sizes))
+        frames *= 2
+
+
+def main():
+    parser = argparse.ArgumentParser(description='RNDIS function frame rate benchmark')
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    run = sub.add_parser('run', help='measure the loopback sink')
+    run.add_argument('interface', help='network interface of the adapter, e.g. usb0')
+    run.add_argument('-s', '--size', type=int, default=64, help='frame size in bytes (default 64)')
+    run.add_argument('-t', '--time', type=float, default=5.0, help='seconds to run (default 5)')
+    run.add_argument('-w', '--window', type=int, default=4, help='frames in flight (default 4)')
+    run.add_argument('--timeout', type=float, default=0.5, help='seconds before a frame counts as lost')
+    run.set_defaults(func=cmd_run)
+
+    model = sub.add_parser('model', help='model the frame engine')
+    model.add_argument('--frames', type=int, default=16, help='largest pool size (default 16)')
+    model.add_argument('--wire-mbps', type=float, default=40.0, help='bulk wire rate (default 40, high speed)')
+    model.add_argument('--transfer-us', type=float, default=10.0,
+                       help='interrupt, re-prime and host scheduling cost per transfer (default 10)')
+    model.add_argument('--sink-us', type=float, default=5.0,
+                       help='main loop time per frame, event dispatch and sink (default 5)')
+    model.set_defaults(func=cmd_model)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
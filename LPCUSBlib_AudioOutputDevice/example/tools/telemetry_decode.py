@@ -0,0 +1,301 @@
+#!/usr/bin/env python3
+#
+# Decoder for the audio telemetry stream sent on the CDC-ACM function of the
+# Audio Output Device example (see example/src/Telemetry.h).
+#
+# Usage:
+#   telemetry_decode.py /dev/ttyACM0                 print records
+#   telemetry_decode.py -p 20 /dev/ttyACM0           set a 20 ms period first
+#   telemetry_decode.py --csv /dev/ttyACM0 > log.csv
+#   telemetry_decode.py -b previous /dev/ttyACM0     boot timeline of the last boot
+#   telemetry_decode.py capture.bin                  decode a raw capture
+#
+# Latency records (see example/src/Latency.h) are printed as a one line
+# summary and left out of the CSV output; example/tools/latency_probe.py
+# analyses them in full.
+#
+# -b asks for a boot record (see example/src/BootProfile.h), printed as one
+# line per checkpoint, in the order they were stamped, with the time of the
+# segment it ends. Each stamp carries
+# the core clock it was taken at; a segment whose two ends differ changed the
+# clock on the way, and is shown as the range its cycles allow.
+#
+# Trace records (a probe trace dump, see lpc_chip_43xx/inc/trace_probe.h) are
+# printed as a one line summary per chunk; example/tools/trace_decode.py
+# requests and analyses them.
+#
+# Only the Python 3 standard library is used.
+
+import argparse
+import os
+import struct
+import sys
+import termios
+import tty
+
+MAGIC = 0x4D54
+VERSION = 1
+LATENCY_MAGIC = 0x4C54
+LATENCY_VERSION = 1
+LATENCY_BINS = 64
+BOOT_MAGIC = 0x4254
+BOOT_VERSION = 1
+BOOT_CHECKPOINTS = 16
+TRACE_MAGIC = 0x5254
+TRACE_VERSION = 1
+TRACE_EVENTS = 24
+CMD_PERIOD = b'P'
+CMD_LATENCY = b'L'
+CMD_BOOT = b'B'
+CMD_TRACE = b'T'
+
+FLAG_STREAMING = 1 << 0
+FLAG_RATE_UP = 1 << 1
+FLAG_HIGH_SPEED = 1 << 2
+FLAG_CODEC_SHIFT = 3
+FLAG_CODEC_MASK = 7 << FLAG_CODEC_SHIFT
+# BOARD_AUDIO_CODEC_T order
+CODECS = ('none', 'pending', 'wm8904', 'max98357a', 'failed')
+
+# Must match TELEMETRY_RECORD_T
+RECORD = struct.Struct('<HBBHBBIIHHHHIIIIIIIHHH')
+FIELDS = ('magic', 'version', 'length', 'sequence', 'port', 'flags', 'cycle',
+          'sample_rate', 'ring_size', 'ring_fill', 'ring_fill_min', 'ring_fill_max',
+          'underruns', 'overruns', 'iso_packets', 'rate_switches',
+          'i2s_isr_max', 'iso_isr_max', 'control_max', 'events_dropped',
+          'records_skipped', 'checksum')
+
+# Must match TELEMETRY_LATENCY_T, the bins follow these fields, then the checksum
+LATENCY = struct.Struct('<HBBHBBIHHIIIIQQ%dHH' % LATENCY_BINS)
+LATENCY_FIELDS = ('magic', 'version', 'length', 'sequence', 'port', 'path', 'cycle',
+                  'interval_ms', 'bin_us', 'count', 'lost', 'min_us', 'max_us',
+                  'sum_us', 'sum_squares_us')
+LATENCY_PATHS = ('iso->i2s', 'round trip')
+
+# Must match TELEMETRY_BOOT_T, the cycle then the clock arrays follow these fields
+BOOT = struct.Struct('<HBBHBBIIHH%dI%dIH' % (BOOT_CHECKPOINTS, BOOT_CHECKPOINTS))
+BOOT_FIELDS = ('magic', 'version', 'length', 'sequence', 'port', 'previous', 'cycle',
+               'boot_count', 'passed', 'checkpoints')
+# BOOT_CHECKPOINT_T order
+BOOT_NAMES = ('reset', 'system init', 'data init', 'board init', 'usb init', 'console',
+              'rates', 'audio start', 'codec', 'configured', 'streaming', 'first packet',
+              'first sample')
+
+# Must match TELEMETRY_TRACE_T, the events (TRACE_PROBE_EVENT_T: cycle, id,
+# kind, arg) follow these fields, then the checksum
+TRACE = struct.Struct('<HBBHBBIIII%sH' % ('IBBH' * TRACE_EVENTS))
+TRACE_FIELDS = ('magic', 'version', 'length', 'sequence', 'port', 'count', 'cycle',
+                'clock_hz', 'index', 'end')
+
+# Record layouts by start marker
+KINDS = {
+    MAGIC: (RECORD, VERSION),
+    LATENCY_MAGIC: (LATENCY, LATENCY_VERSION),
+    BOOT_MAGIC: (BOOT, BOOT_VERSION),
+    TRACE_MAGIC: (TRACE, TRACE_VERSION),
+}
+
+
+def fletcher16(data):
+    sum1 = 0
+    sum2 = 0
+    for byte in data:
+        sum1 = (sum1 + byte) % 255
+        sum2 = (sum2 + sum1) % 255
+    return (sum2 << 8) | sum1
+
+
+def unpack(magic, raw):
+    layout = KINDS[magic][0]
+    values = layout.unpack(raw)
+    if magic == LATENCY_MAGIC:
+        record = dict(zip(LATENCY_FIELDS, values))
+        record['bins'] = list(values[len(LATENCY_FIELDS):-1])
+        record['checksum'] = values[-1]
+        return record
+    if magic == BOOT_MAGIC:
+        record = dict(zip(BOOT_FIELDS, values))
+        n = len(BOOT_FIELDS)
+        record['stamp_cycle'] = list(values[n:n + BOOT_CHECKPOINTS])
+        record['stamp_clock_hz'] = list(values[n + BOOT_CHECKPOINTS:-1])
+        record['checksum'] = values[-1]
+        return record
+    if magic == TRACE_MAGIC:
+        record = dict(zip(TRACE_FIELDS, values))
+        n = len(TRACE_FIELDS)
+        events = values[n:-1]
+        record['events'] = [tuple(events[i:i + 4]) for i in range(0, 4 * record['count'], 4)]
+        record['checksum'] = values[-1]
+        return record
+    return dict(zip(FIELDS, values))
+
+
+def pack_latency(record):
+    """Encodes a latency record the way the firmware does, checksum included."""
+    values = [record[f] for f in LATENCY_FIELDS] + list(record['bins'])
+    raw = LATENCY.pack(*(values + [0]))
+    return raw[:-2] + struct.pack('<H', fletcher16(raw[:-2]))
+
+
+class Decoder:
+    """Splits a byte stream into records, resynchronising on the magic."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.bad = 0
+        self.lost = 0
+        self.last_sequence = {}
+
+    def feed(self, data):
+        self.buffer += data
+        records = []
+        while True:
+            found = [(self.buffer.find(struct.pack('<H', m)), m) for m in KINDS]
+            found = [f for f in found if f[0] >= 0]
+            if not found:
+                # Keep a possible half magic at the end
+                del self.buffer[:max(0, len(self.buffer) - 1)]
+                break
+            start, magic = min(found)
+            if start:
+                del self.buffer[:start]
+            layout, version = KINDS[magic]
+            if len(self.buffer) < layout.size:
+                break
+            raw = bytes(self.buffer[:layout.size])
+            record = unpack(magic, raw)
+            if (record['version'] != version or record['length'] != layout.size or
+                    fletcher16(raw[:-2]) != record['checksum']):
+                self.bad += 1
+                del self.buffer[:1]
+                continue
+            del self.buffer[:layout.size]
+            last = self.last_sequence.get(record['port'])
+            if last is not None:
+                self.lost += (record['sequence'] - last - 1) & 0xFFFF
+            self.last_sequence[record['port']] = record['sequence']
+            records.append(record)
+        return records
+
+
+def open_port(path, period, boot):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        # Any non zero line coding starts the stream, the rate itself is unused
+        attrs[4] = attrs[5] = termios.B115200
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+        if period is not None:
+            os.write(fd, CMD_PERIOD + struct.pack('<H', period))
+        if boot is not None:
+            os.write(fd, CMD_BOOT + struct.pack('<H', boot == 'previous'))
+    return fd
+
+
+def print_record(record, cpu_hz):
+    us = 1e6 / cpu_hz
+    codec = (record['flags'] & FLAG_CODEC_MASK) >> FLAG_CODEC_SHIFT
+    codec = CODECS[codec] if codec < len(CODECS) else 'codec%d' % codec
+    flags = ''.join((
+        'S' if record['flags'] & FLAG_STREAMING else '-',
+        'U' if record['flags'] & FLAG_RATE_UP else '-',
+        'H' if record['flags'] & FLAG_HIGH_SPEED else 'F'))
+    print('port%d #%5d %s %6d Hz  fill %4d/%4d [%4d..%4d]  under %d over %d  '
+          'iso %d  switch %d  i2s %.1fus iso %.1fus ctrl %.1fus  drop %d skip %d  %s' % (
+              record['port'], record['sequence'], flags, record['sample_rate'],
+              record['ring_fill'], record['ring_size'], record['ring_fill_min'],
+              record['ring_fill_max'], record['underruns'], record['overruns'],
+              record['iso_packets'], record['rate_switches'],
+              record['i2s_isr_max'] * us, record['iso_isr_max'] * us,
+              record['control_max'] * us, record['events_dropped'],
+              record['records_skipped'], codec))
+
+
+def print_latency(record):
+    count = record['count']
+    mean = record['sum_us'] / count if count else 0.0
+    path = record['path']
+    name = LATENCY_PATHS[path] if path < len(LATENCY_PATHS) else 'path%d' % path
+    print('port%d #%5d latency %-10s markers %d lost %d  min %d mean %.0f max %d us' % (
+        record['port'], record['sequence'], name, count, record['lost'],
+        record['min_us'], mean, record['max_us']))
+
+
+def print_trace(record):
+    print('port%d #%5d trace events %d..%d of %d' % (
+        record['port'], record['sequence'], record['index'],
+        record['index'] + record['count'], record['end']))
+
+
+def print_boot(record):
+    print('port%d #%5d boot %d%s' % (record['port'], record['sequence'], record['boot_count'],
+                                     ' (previous)' if record['previous'] else ''))
+    checkpoints = range(min(record['checkpoints'], BOOT_CHECKPOINTS))
+    passed = [i for i in checkpoints if record['passed'] & (1 << i)]
+    last = None
+    for i in sorted(passed, key=lambda i: record['stamp_cycle'][i]):
+        name = BOOT_NAMES[i] if i < len(BOOT_NAMES) else 'checkpoint%d' % i
+        cycle = record['stamp_cycle'][i]
+        clock = record['stamp_clock_hz'][i]
+        if last is None or not last[1] or not clock:
+            print('  %-13s %10d cycles' % (name, cycle))
+        else:
+            cycles = (cycle - last[0]) & 0xFFFFFFFF
+            fast = cycles * 1e6 / max(clock, last[1])
+            slow = cycles * 1e6 / min(clock, last[1])
+            if clock == last[1]:
+                print('  %-13s %10d cycles  +%.1f us' % (name, cycle, slow))
+            else:
+                print('  %-13s %10d cycles  +%.1f..%.1f us, %.0f -> %.0f MHz' % (
+                    name, cycle, fast, slow, last[1] / 1e6, clock / 1e6))
+        last = (cycle, clock)
+    for i in checkpoints:
+        if i not in passed:
+            print('  %-13s -' % (BOOT_NAMES[i] if i < len(BOOT_NAMES) else 'checkpoint%d' % i))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode audio telemetry records')
+    parser.add_argument('device', help='CDC-ACM tty or raw capture file')
+    parser.add_argument('-p', '--period', type=int, help='telemetry period in ms, 0 stops')
+    parser.add_argument('-b', '--boot', choices=('current', 'previous'),
+                        help='request the boot timeline of this or the previous boot')
+    parser.add_argument('--csv', action='store_true', help='print CSV instead of text')
+    parser.add_argument('--cpu-hz', type=float, default=204e6,
+                        help='core clock used to convert cycle counts (default 204 MHz)')
+    args = parser.parse_args()
+
+    fd = open_port(args.device, args.period, args.boot)
+    decoder = Decoder()
+    if args.csv:
+        print(','.join(FIELDS[3:-1]))
+    try:
+        while True:
+            data = os.read(fd, 4096)
+            if not data:
+                break
+            for record in decoder.feed(data):
+                if record['magic'] == LATENCY_MAGIC:
+                    if not args.csv:
+                        print_latency(record)
+                elif record['magic'] == BOOT_MAGIC:
+                    if not args.csv:
+                        print_boot(record)
+                elif record['magic'] == TRACE_MAGIC:
+                    if not args.csv:
+                        print_trace(record)
+                elif args.csv:
+                    print(','.join(str(record[f]) for f in FIELDS[3:-1]))
+                else:
+                    print_record(record, args.cpu_hz)
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        os.close(fd)
+    print('bad records %d, lost records %d' % (decoder.bad, decoder.lost), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,353 @@
+#!/usr/bin/env python3
+#
+# Decoder for the probe trace of the Audio Output Device example (see
+# lpc_chip_43xx/inc/trace_probe.h), for firmware built with TRACE_PROBES=1.
+#
+# Usage:
+#   trace_decode.py /dev/ttyACM0                     dump the trace and report it
+#   trace_decode.py -o field.bin /dev/ttyACM0        also keep the raw dump
+#   trace_decode.py --clear /dev/ttyACM0             start a fresh recording after the dump
+#   trace_decode.py field.bin                        report a dump kept earlier
+#   trace_decode.py --timeline field.bin             list every event
+#   trace_decode.py --timeline --last 200 field.bin
+#   trace_decode.py --chrome field.json field.bin    timeline for chrome://tracing or Perfetto
+#
+# On a tty the trace is requested through the telemetry function and read
+# until the dump is complete. The firmware pauses recording for the dump, so
+# the events are the last ones recorded before the request.
+#
+# The report has one line per span (an enter/exit pair of a probe, e.g. one
+# I2S interrupt) with its count and latency percentiles, total and self time,
+# the latter without the spans nested in it, followed by a log2 histogram of
+# the total time. Point probes get their count and the interval between them.
+# The last table counts which span was running when another one started
+# inside it, an interrupt preempting code or a probed call, and the time the
+# nested spans took from it in total.
+#
+# Only the Python 3 standard library is used.
+
+import argparse
+import json
+import os
+import select
+import struct
+import sys
+import time
+
+from telemetry_decode import CMD_TRACE, TRACE_MAGIC, Decoder, open_port
+
+# Must match the probe IDs in Endpoint_LPC18xx.h and AudioOutputDevice.h
+PROBES = {
+    0x10: 'dcd_irq',
+    0x11: 'transfer_complete',
+    0x12: 'setup',
+    0x13: 'control',
+    0x14: 'request',
+    0x40: 'i2s_irq',
+    0x41: 'iso_packet',
+    0x42: 'event',
+    0x43: 'sleep',
+}
+# Chrome trace thread per probe, interrupts of one source share a row
+THREADS = {
+    'dcd_irq': 'usb irq',
+    'transfer_complete': 'usb irq',
+    'setup': 'usb irq',
+    'i2s_irq': 'i2s irq',
+    'iso_packet': 'usb irq',
+}
+# APP_EVENT_ID_T order
+APP_EVENTS = ('none', 'usb_setup', 'xfer_complete', 'rate_change', 'overflow', 'telemetry',
+              'network')
+
+# Event kinds, must match TRACE_PROBE_KIND_T in trace_probe.h
+KIND_POINT, KIND_ENTER, KIND_EXIT = 0, 1, 2
+
+
+def probe_name(probe):
+    return PROBES.get(probe, 'probe%02x' % probe)
+
+
+def span_label(probe, arg):
+    """Name of a span instance, the argument tells apart ports and event kinds."""
+    name = probe_name(probe)
+    if name == 'event':
+        kind = arg & 0xFF
+        return 'event %s@%d' % (APP_EVENTS[kind] if kind < len(APP_EVENTS) else kind, arg >> 8)
+    if name == 'sleep':
+        return name
+    return '%s[%d]' % (name, arg)
+
+
+def point_text(probe, arg):
+    name = probe_name(probe)
+    if name == 'request':
+        return 'request type 0x%02x req 0x%02x' % (arg >> 8, arg & 0xFF)
+    if name == 'iso_packet':
+        return 'iso_packet %d bytes' % arg
+    return '%s %d' % (name, arg)
+
+
+class Dump:
+    """One trace dump, its events in recording order with unwrapped cycles."""
+
+    def __init__(self, port, clock_hz, end):
+        self.port = port
+        self.clock_hz = clock_hz
+        self.end = end
+        self.chunks = {}
+
+    def add(self, record):
+        self.chunks[record['index']] = record['events']
+
+    def complete(self):
+        index = min(self.chunks) if self.chunks else self.end
+        while index in self.chunks and self.chunks[index]:
+            index += len(self.chunks[index])
+        return index >= self.end
+
+    def events(self):
+        """(index, cycle, probe, kind, arg), cycles made monotonic from 0."""
+        result = []
+        last = None
+        for start in sorted(self.chunks):
+            for offset, (cycle, probe, kind, arg) in enumerate(self.chunks[start]):
+                now = result[-1][1] + ((cycle - last) & 0xFFFFFFFF) if result else 0
+                last = cycle
+                result.append((start + offset, now, probe, kind, arg))
+        return result
+
+
+def read_dumps(source, clear, output, timeout):
+    """Collects the trace records of a tty or a raw capture into dumps."""
+    fd = open_port(source, None, None)
+    tty = os.isatty(fd)
+    if tty:
+        os.write(fd, CMD_TRACE + struct.pack('<H', 0))
+    keep = open(output, 'wb') if output else None
+    decoder = Decoder()
+    dumps = []
+    current = {}
+    deadline = time.time() + timeout
+    try:
+        while True:
+            if tty:
+                if time.time() > deadline:
+                    print('dump incomplete after %.0f s' % timeout, file=sys.stderr)
+                    break
+                readable, _, _ = select.select([fd], [], [], 0.2)
+                if not readable:
+                    continue
+            data = os.read(fd, 4096)
+            if not data:
+                break
+            if keep:
+                keep.write(data)
+            for record in decoder.feed(data):
+                if record['magic'] != TRACE_MAGIC:
+                    continue
+                dump = current.get(record['port'])
+                if dump is None or record['end'] != dump.end or record['index'] in dump.chunks:
+                    dump = Dump(record['port'], record['clock_hz'], record['end'])
+                    current[record['port']] = dump
+                    dumps.append(dump)
+                dump.add(record)
+            if tty and dumps and all(d.complete() for d in dumps):
+                break
+        if tty and clear:
+            os.write(fd, CMD_TRACE + struct.pack('<H', 1))
+    finally:
+        os.close(fd)
+        if keep:
+            keep.close()
+    if decoder.bad or decoder.lost:
+        print('bad records %d, lost records %d' % (decoder.bad, decoder.lost), file=sys.stderr)
+    return dumps
+
+
+def pair(events):
+    """Matches enter and exit events.
+
+    Returns the spans as (label, probe, start, end, self cycles, depth), the
+    preemptions as {(running label, new label): [count, cycles]}, the points as
+    (index, cycle, probe, arg) and the number of exits without an enter.
+    Interrupts nest, so the spans open at any instant form one stack.
+    """
+    stack = []
+    spans = []
+    points = []
+    preempted = {}
+    orphans = 0
+    for index, cycle, probe, kind, arg in events:
+        if kind == KIND_POINT:
+            points.append((index, cycle, probe, arg))
+        elif kind == KIND_ENTER:
+            label = span_label(probe, arg)
+            if stack:
+                entry = preempted.setdefault((stack[-1][0], label), [0, 0])
+                entry[0] += 1
+            stack.append([label, probe, arg, cycle, 0])
+        elif kind == KIND_EXIT:
+            found = None
+            for depth in range(len(stack) - 1, -1, -1):
+                if stack[depth][1] == probe and stack[depth][2] == arg:
+                    found = depth
+                    break
+            if found is None:
+                # Its enter was overwritten before the dump
+                orphans += 1
+                continue
+            # Spans above it lost their exit, close them here
+            del stack[found + 1:]
+            label, _, _, start, nested = stack.pop()
+            total = cycle - start
+            spans.append((label, probe, start, cycle, total - nested, len(stack)))
+            if stack:
+                stack[-1][4] += total
+                key = (stack[-1][0], label)
+                if key in preempted:
+                    preempted[key][1] += total
+    return spans, preempted, points, orphans
+
+
+def percentile(values, fraction):
+    return values[min(len(values) - 1, int(fraction * len(values)))]
+
+
+def histogram(values_us, width=40):
+    """Log2 bins of us, from the lowest populated one."""
+    bins = {}
+    for value in values_us:
+        b = 0
+        while (1 << b) <= value:
+            b += 1
+        bins[b] = bins.get(b, 0) + 1
+    most = max(bins.values())
+    lines = []
+    for b in range(min(bins), max(bins) + 1):
+        low = 0 if b == 0 else 1 << (b - 1)
+        count = bins.get(b, 0)
+        lines.append('      %6d..%-6d us %7d %s' % (low, 1 << b, count, '#' * ((count * width + most - 1) // most)))
+    return lines
+
+
+def report(dump, events, spans, preempted, points, orphans):
+    us = 1e6 / dump.clock_hz
+    duration = events[-1][1] * us if events else 0.0
+    print('port%d dump: events %d..%d, %.1f ms at %.0f MHz' % (
+        dump.port, events[0][0] if events else 0, dump.end, duration / 1000, dump.clock_hz / 1e6))
+    if events and events[0][0] > 0:
+        print('  %d older events were overwritten' % events[0][0])
+    if orphans:
+        print('  %d exits without their enter' % orphans)
+
+    print()
+    print('%-28s %7s %9s %9s %9s %9s %9s %9s' % (
+        'span', 'count', 'min us', 'p50 us', 'p99 us', 'max us', 'total us', 'self us'))
+    by_label = {}
+    for label, _, start, end, own, _ in spans:
+        by_label.setdefault(label, []).append(((end - start) * us, own * us))
+    for label in sorted(by_label):
+        times = sorted(t for t, _ in by_label[label])
+        own = sum(o for _, o in by_label[label])
+        print('%-28s %7d %9.2f %9.2f %9.2f %9.2f %9.0f %9.0f' % (
+            label, len(times), times[0], percentile(times, 0.5), percentile(times, 0.99),
+            times[-1], sum(times), own))
+        for line in histogram(times):
+            print(line)
+
+    if points:
+        print()
+        print('%-28s %7s %12s %12s %12s' % ('point', 'count', 'min gap us', 'mean gap us', 'max gap us'))
+        by_probe = {}
+        for _, cycle, probe, _ in points:
+            by_probe.setdefault(probe_name(probe), []).append(cycle)
+        for name in sorted(by_probe):
+            cycles = by_probe[name]
+            gaps = [(b - a) * us for a, b in zip(cycles, cycles[1:])]
+            if gaps:
+                print('%-28s %7d %12.2f %12.2f %12.2f' % (
+                    name, len(cycles), min(gaps), sum(gaps) / len(gaps), max(gaps)))
+            else:
+                print('%-28s %7d' % (name, len(cycles)))
+
+    if preempted:
+        print()
+        print('%-28s %-28s %7s %10s' % ('running', 'nested', 'count', 'total us'))
+        for (running, new), (count, cycles) in sorted(preempted.items(), key=lambda i: -i[1][1]):
+            print('%-28s %-28s %7d %10.1f' % (running, new, count, cycles * us))
+
+
+def timeline(dump, events, last):
+    us = 1e6 / dump.clock_hz
+    depth = 0
+    opened = {}
+    if last:
+        events = events[-last:]
+    for index, cycle, probe, kind, arg in events:
+        if kind == KIND_ENTER:
+            text = '> ' + span_label(probe, arg)
+            opened.setdefault((probe, arg), []).append(cycle)
+            indent = depth
+            depth += 1
+        elif kind == KIND_EXIT:
+            depth = max(0, depth - 1)
+            indent = depth
+            starts = opened.get((probe, arg))
+            if starts:
+                text = '< %s  %.2f us' % (span_label(probe, arg), (cycle - starts.pop()) * us)
+            else:
+                text = '< ' + span_label(probe, arg)
+        else:
+            text = '* ' + point_text(probe, arg)
+            indent = depth
+        print('%8d %12.2f  %s%s' % (index, cycle * us, '  ' * indent, text))
+
+
+def chrome(dumps, path):
+    """Complete events and instants in the Chrome trace event format."""
+    trace = []
+    for dump in dumps:
+        us = 1e6 / dump.clock_hz
+        events = dump.events()
+        spans, _, points, _ = pair(events)
+        for label, probe, start, end, _, _ in spans:
+            trace.append({'name': label, 'ph': 'X', 'ts': start * us, 'dur': (end - start) * us,
+                          'pid': dump.port, 'tid': THREADS.get(probe_name(probe), 'main loop')})
+        for _, cycle, probe, arg in points:
+            trace.append({'name': point_text(probe, arg), 'ph': 'i', 's': 't', 'ts': cycle * us,
+                          'pid': dump.port, 'tid': THREADS.get(probe_name(probe), 'main loop')})
+    with open(path, 'w') as f:
+        json.dump({'traceEvents': trace, 'displayTimeUnit': 'ns'}, f)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode probe trace dumps')
+    parser.add_argument('source', help='CDC-ACM tty or raw capture file')
+    parser.add_argument('-o', '--output', help='keep the raw bytes read from the tty')
+    parser.add_argument('--clear', action='store_true', help='drop the recorded events after the dump')
+    parser.add_argument('--timeout', type=float, default=5.0, help='time allowed for the dump in s (default 5)')
+    parser.add_argument('--timeline', action='store_true', help='list the events instead of the report')
+    parser.add_argument('--last', type=int, help='only the last N events of the timeline')
+    parser.add_argument('--chrome', metavar='JSON', help='write a Chrome trace event file')
+    args = parser.parse_args()
+
+    dumps = read_dumps(args.source, args.clear, args.output, args.timeout)
+    if not dumps:
+        sys.exit('no trace records found, is the firmware built with TRACE_PROBES=1?')
+    for dump in dumps:
+        events = dump.events()
+        if not dump.complete() or not events:
+            print('port%d dump incomplete, skipped' % dump.port, file=sys.stderr)
+            continue
+        if args.timeline:
+            timeline(dump, events, args.last)
+        else:
+            report(dump, events, *pair(events))
+        print()
+    if args.chrome:
+        chrome(dumps, args.chrome)
+
+
+if __name__ == '__main__':
+    main()
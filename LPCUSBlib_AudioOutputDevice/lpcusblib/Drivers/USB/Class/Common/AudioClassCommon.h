@@ -326,6 +326,21 @@
 			AUDIO_CS_SAM_FREQ_CONTROL = 0x01, /**< Audio class-specific request to get or set Sample Frequency. */
 			AUDIO_CS_CLOCK_VALID      = 0x02, /**< Audio class-specific request to indicate clock source is valid. */
 		};
+
+		/** Enum for Audio class specific clock selector control selectors which can be set and retrieved by a USB host. */
+        /*  A.17.2 */
+		enum Audio_ClockSelectorControlSelectors_t
+		{
+			AUDIO_CX_CLOCK_SELECTOR_CONTROL = 0x01, /**< Audio class-specific request to get or set the selected clock input pin. */
+		};
+
+		/** Enum for Audio class specific feature unit control selectors which can be set and retrieved by a USB host. */
+        /*  A.17.7 */
+		enum Audio_FeatureUnitControlSelectors_t
+		{
+			AUDIO_FU_MUTE_CONTROL   = 0x01, /**< Audio class-specific request to get or set the mute state, one byte. */
+			AUDIO_FU_VOLUME_CONTROL = 0x02, /**< Audio class-specific request to get or set the volume, int16_t in 1/256 dB. */
+		};
 #endif
 		
 		/** Enum for Audio class specific Endpoint control modifiers which can be set and retrieved by a USB host, if the corresponding
@@ -611,6 +626,37 @@
 
 			uint8_t  iClockSource; /* Index of a string descriptor, describing the Clock Source Entity. */
 		} ATTR_PACKED USB_Audio_StdDescriptor_Source_Clock_t;
+
+		/** @brief Audio class-specific Clock Selector Descriptor (USB-IF naming conventions).
+		 *
+		 *  Type define for an Audio class-specific clock selector descriptor with two input pins, the clock
+		 *  sources it chooses between. See the USB Audio 2.0 specification for more details.
+		 *
+		 *  @note Regardless of CPU architecture, these values should be stored as little endian.
+		 */
+        /*  Table 4-7 */
+		typedef ATTR_IAR_PACKED struct
+		{
+			uint8_t  bLength; /**< Size of the descriptor, in bytes. */
+			uint8_t  bDescriptorType; /**< Type of the descriptor, either a value in @ref USB_DescriptorTypes_t or a value
+			                           *   given by the specific class.
+			                           */
+
+			uint8_t  bDescriptorSubtype;/**< Sub type value used to distinguish between audio class-specific descriptors,
+			                             *   must be @ref AUDIO_DSUBTYPE_CSInterface_ClockSelector.
+			                             */
+			uint8_t  bClockID; /**< Constant uniquely identifying the Clock Selector Entity within the audio function.
+			                    *   This value is used in all requests to address this Entity.
+			                    */
+			uint8_t  bNrInPins; /**< Number of input pins, the entries used in \c baCSourceID. */
+			uint8_t  baCSourceID[2]; /**< ID of the Clock Entity connected to each input pin, pin 1 first. */
+
+			uint8_t  bmControls; /**< Bitmap: D1..0: Clock Selector Control
+			                      *         D7..2: Reserved. Must be set to 0.
+			                      */
+
+			uint8_t  iClockSelector; /**< Index of a string descriptor, describing the Clock Selector Entity. */
+		} ATTR_PACKED USB_Audio_StdDescriptor_Clock_Selector_t;
 #endif
 
 		/** @brief Audio class-specific Feature Unit Descriptor (nxpUSBlib naming conventions).
@@ -671,7 +717,9 @@
 			uint8_t bControlSize; /**< Size of each element in the \c ChannelControls array. */
 			uint8_t bmaControls[3]; /**< Feature masks for the control channel, and each separate audio channel. */
 #else
-			uint8_t bmaControls[8]; /**< Feature masks for the control channel, and each separate audio channel. */
+			uint8_t bmaControls[12]; /**< Feature masks for the control channel, and each separate audio channel:
+			                          *   four bytes each for the master channel and the two channels of a stereo cluster.
+			                          */
 #endif
 			uint8_t iFeature; /**< Index of a string descriptor describing this descriptor within the device. */
 		} ATTR_PACKED USB_Audio_StdDescriptor_FeatureUnit_t;
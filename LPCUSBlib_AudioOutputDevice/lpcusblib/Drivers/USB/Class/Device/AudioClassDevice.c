@@ -40,6 +40,25 @@
 #define  __INCLUDE_FROM_AUDIO_DEVICE_C
 #include "AudioClassDevice.h"
 
+#if (AUDIO_CONTROL_BUFFER_SIZE > USB_DATA_BUFFER_TEM_LENGTH)
+	#error AUDIO_CONTROL_BUFFER_SIZE must not exceed the control endpoint DMA buffer.
+#endif
+
+/* Data stage buffer for class requests, one per port so the control path never grows the stack */
+PRAGMA_ALIGN_4
+static uint8_t Audio_ControlBuffer[MAX_USB_CORE][AUDIO_CONTROL_BUFFER_SIZE] ATTR_ALIGNED(4);
+
+/* Stall a host to device request whose data stage does not fit the control buffer */
+static bool Audio_Device_RejectOversizedRequest(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo)
+{
+	if (USB_ControlRequest.wLength <= AUDIO_CONTROL_BUFFER_SIZE)
+	  return false;
+
+	Endpoint_ClearSETUP(AudioInterfaceInfo->Config.PortNumber);
+	Endpoint_StallTransaction(AudioInterfaceInfo->Config.PortNumber);
+	return true;
+}
+
 void Audio_Device_ProcessControlRequest(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo)
 {
 	if (!(Endpoint_IsSETUPReceived(AudioInterfaceInfo->Config.PortNumber)))
@@ -106,18 +125,24 @@ void Audio_Device_ProcessControlRequest(USB_ClassInfo_Audio_Device_t* const Audi
 					uint8_t EndpointAddress  = (uint8_t)USB_ControlRequest.wIndex;
 					uint8_t EndpointControl  = (USB_ControlRequest.wValue >> 8);
 
+					if (Audio_Device_RejectOversizedRequest(AudioInterfaceInfo))
+					  break;
+
 					if (CALLBACK_Audio_Device_GetSetEndpointProperty(AudioInterfaceInfo, EndpointProperty, EndpointAddress,
 																	 EndpointControl, NULL, NULL))
 					{
 						uint16_t ValueLength = USB_ControlRequest.wLength;
-						uint8_t  Value[ValueLength];
+						uint8_t* Value       = Audio_ControlBuffer[AudioInterfaceInfo->Config.PortNumber];
 
 						Endpoint_ClearSETUP(AudioInterfaceInfo->Config.PortNumber);
 						Endpoint_Read_Control_Stream_LE(AudioInterfaceInfo->Config.PortNumber, Value, ValueLength);
-						Endpoint_ClearIN(AudioInterfaceInfo->Config.PortNumber);
 
-						CALLBACK_Audio_Device_GetSetEndpointProperty(AudioInterfaceInfo, EndpointProperty, EndpointAddress,
-																	 EndpointControl, &ValueLength, Value);
+						/* A value the application rejects stalls the status stage */
+						if (CALLBACK_Audio_Device_GetSetEndpointProperty(AudioInterfaceInfo, EndpointProperty, EndpointAddress,
+																		 EndpointControl, &ValueLength, Value))
+						  Endpoint_ClearIN(AudioInterfaceInfo->Config.PortNumber);
+						else
+						  Endpoint_StallTransaction(AudioInterfaceInfo->Config.PortNumber);
 					}
 				}
 
@@ -131,8 +156,8 @@ void Audio_Device_ProcessControlRequest(USB_ClassInfo_Audio_Device_t* const Audi
 					uint8_t  EndpointProperty = USB_ControlRequest.bRequest;
 					uint8_t  EndpointAddress  = (uint8_t)USB_ControlRequest.wIndex;
 					uint8_t  EndpointControl  = (USB_ControlRequest.wValue >> 8);
-					uint16_t ValueLength      = USB_ControlRequest.wLength;
-					uint8_t  Value[ValueLength];
+					uint16_t ValueLength      = MIN(USB_ControlRequest.wLength, AUDIO_CONTROL_BUFFER_SIZE);
+					uint8_t* Value            = Audio_ControlBuffer[AudioInterfaceInfo->Config.PortNumber];
 
 					if (CALLBACK_Audio_Device_GetSetEndpointProperty(AudioInterfaceInfo, EndpointProperty, EndpointAddress,
 																	 EndpointControl, &ValueLength, Value))
@@ -150,12 +175,15 @@ void Audio_Device_ProcessControlRequest(USB_ClassInfo_Audio_Device_t* const Audi
 				{
 					uint8_t  RequestType = USB_ControlRequest.bmRequestType;
 					uint8_t  Request     = USB_ControlRequest.bRequest;
+					uint8_t  EntityID    = (USB_ControlRequest.wIndex >> 8);
 					uint8_t  Control     = (USB_ControlRequest.wValue >> 8);
-					uint16_t ValueLength = USB_ControlRequest.wLength;
-					uint8_t  Value[ValueLength];
+					uint16_t ValueLength = MIN(USB_ControlRequest.wLength, AUDIO_CONTROL_BUFFER_SIZE);
+					uint8_t* Value       = Audio_ControlBuffer[AudioInterfaceInfo->Config.PortNumber];
+
+					/* ValueLength holds the buffer capacity on entry to the callback and the reply length on return */
 					if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE))
 					{
-						if (CALLBACK_Audio_Device_GetSetProperty(AudioInterfaceInfo, RequestType, Request, Control, &ValueLength, Value))
+						if (CALLBACK_Audio_Device_GetSetProperty(AudioInterfaceInfo, RequestType, Request, EntityID, Control, &ValueLength, Value))
 						{
 							Endpoint_ClearSETUP(AudioInterfaceInfo->Config.PortNumber);
 							Endpoint_Write_Control_Stream_LE(AudioInterfaceInfo->Config.PortNumber, Value, ValueLength);
@@ -164,13 +192,19 @@ void Audio_Device_ProcessControlRequest(USB_ClassInfo_Audio_Device_t* const Audi
 					}
 					else if (USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE))
 					{
-						if (CALLBACK_Audio_Device_GetSetProperty(AudioInterfaceInfo, RequestType, Request, Control, NULL, NULL))
+						if (Audio_Device_RejectOversizedRequest(AudioInterfaceInfo))
+						  break;
+
+						if (CALLBACK_Audio_Device_GetSetProperty(AudioInterfaceInfo, RequestType, Request, EntityID, Control, NULL, NULL))
 						{
 							Endpoint_ClearSETUP(AudioInterfaceInfo->Config.PortNumber);
 							Endpoint_Read_Control_Stream_LE(AudioInterfaceInfo->Config.PortNumber, Value, ValueLength);
-							Endpoint_ClearIN(AudioInterfaceInfo->Config.PortNumber);
 
-							CALLBACK_Audio_Device_GetSetProperty(AudioInterfaceInfo, RequestType, Request, Control, &ValueLength, Value);
+							/* A value the application rejects stalls the status stage */
+							if (CALLBACK_Audio_Device_GetSetProperty(AudioInterfaceInfo, RequestType, Request, EntityID, Control, &ValueLength, Value))
+							  Endpoint_ClearIN(AudioInterfaceInfo->Config.PortNumber);
+							else
+							  Endpoint_StallTransaction(AudioInterfaceInfo->Config.PortNumber);
 						}
 					}
 				}
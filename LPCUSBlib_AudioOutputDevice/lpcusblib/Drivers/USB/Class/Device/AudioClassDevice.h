@@ -62,6 +62,16 @@
 		#endif
 
 	/* Public Interface - May be used in end-application: */
+		/* Macros: */
+			#if !defined(AUDIO_CONTROL_BUFFER_SIZE) || defined(__DOXYGEN__)
+				/** Size in bytes of the per port buffer holding the data stage of an Audio class request. Host to
+				 *  device requests with a longer data stage are stalled; device to host requests are answered with
+				 *  at most this many bytes. May be overridden in the project defines, up to
+				 *  \c USB_DATA_BUFFER_TEM_LENGTH.
+				 */
+				#define AUDIO_CONTROL_BUFFER_SIZE        256
+			#endif
+
 		/* Type Defines: */
 			/** @brief Audio Class Device Mode Configuration and State Structure.
 			 *
@@ -135,7 +145,8 @@
 			 *
 			 *  When the DataLength parameter is NULL, this callback should only indicate whether the specified operation is valid for
 			 *  the given endpoint index, and should return as fast as possible. When non-NULL, this value may be altered for GET operations
-			 *  to indicate the size of the retreived data.
+			 *  to indicate the size of the retreived data. Returning false for the data of a SET operation stalls its status stage,
+			 *  which is how an unsupported value is refused.
 			 *
 			 *  @note The length of the retrieved data stored into the Data buffer on GET operations should not exceed the initial value
 			 *        of the \c DataLength parameter.
@@ -164,7 +175,8 @@
 			 *
 			 *  When the DataLength parameter is NULL, this callback should only indicate whether the specified operation is valid for
 			 *  the given endpoint index, and should return as fast as possible. When non-NULL, this value may be altered for GET operations
-			 *  to indicate the size of the retreived data.
+			 *  to indicate the size of the retreived data. Returning false for the data of a SET operation stalls its status stage,
+			 *  which is how an unsupported value is refused.
 			 *
 			 *  @note The length of the retrieved data stored into the Data buffer on GET operations should not exceed the initial value
 			 *        of the \c DataLength parameter.
@@ -173,7 +185,8 @@
 			 * @param   RequestType         : Indicate the type of request (Device to Host or Host to Device) and request class
 			 *                                (Device, Class or Vendor Specific).
 			 * @param   Request             : Property to get or set, a value from @ref Audio_ClassRequests_t.
-			 * @param   Control             : Clock Source Control Selector
+			 * @param   EntityID            : ID of the clock source, clock selector or unit the request addresses (high byte of wIndex).
+			 * @param   Control             : Control Selector of that entity
 			 * @param   DataLength          : For SET operations, the length of the parameter data to set. For GET operations, the maximum
 			 *                                length of the retrieved data. When NULL, the function should return whether the given property
 			 *                                and parameter is valid for the requested endpoint without reading or modifying the Data buffer.
@@ -184,6 +197,7 @@
 			bool CALLBACK_Audio_Device_GetSetProperty(USB_ClassInfo_Audio_Device_t *const AudioInterfaceInfo,
 													  const uint8_t RequestType,
 													  const uint8_t Request,
+													  const uint8_t EntityID,
 													  const uint8_t Control,
 													  uint16_t *const DataLength,
 													  uint8_t *Data);
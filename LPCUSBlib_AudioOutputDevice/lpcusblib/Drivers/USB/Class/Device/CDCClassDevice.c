@@ -40,6 +40,297 @@
 #define  __INCLUDE_FROM_CDC_DEVICE_C
 #include "CDCClassDevice.h"
 
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/* Ring engine. The application side copies data outside the critical section and
+   only masks the port interrupt to publish indexes and start DMA; the completion
+   and SOF handlers run in the USB interrupt. */
+
+#define CDC_DEVICE_FRAME_MASK  0x07FF
+
+static uint16_t CDC_Device_Frame(const uint8_t corenum)
+{
+	/* FRINDEX counts microframes, bits 13:3 are the 1 ms frame number */
+	return (USB_Device_GetFrameNumber(corenum) >> 3) & CDC_DEVICE_FRAME_MASK;
+}
+
+static void CDC_Device_TxKick(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
+{
+	uint16_t PacketSize = CDCInterfaceInfo->Config.DataINEndpointSize;
+	uint16_t Timeout    = CDCInterfaceInfo->Config.TxFlushTimeoutMS;
+	uint16_t Tail       = CDCInterfaceInfo->State.Tx.Tail;
+	uint16_t Pending    = CDCInterfaceInfo->State.Tx.Count;
+	uint16_t Length;
+
+	if (CDCInterfaceInfo->State.Tx.Busy)
+	  return;
+
+	if (!(Pending) && !(CDCInterfaceInfo->State.Tx.ZeroLength))
+	{
+		CDCInterfaceInfo->State.Tx.Waiting = false;
+		return;
+	}
+
+	Length = CDCInterfaceInfo->Config.TxRingSize - Tail;
+	if (Length > Pending)
+	  Length = Pending;
+
+	if (Length >= PacketSize)
+	{
+		Length -= Length % PacketSize;
+		if (Length > CDC_DEVICE_MAX_TRANSFER)
+		  Length = CDC_DEVICE_MAX_TRANSFER;
+	}
+	else if (Length == Pending)
+	{
+		/* Partial packet, or the zero length packet closing a transfer, at the head:
+		   hold it back so following writes can fill the packet */
+		if (Timeout)
+		{
+			if (!(CDCInterfaceInfo->State.Tx.Waiting))
+			{
+				CDCInterfaceInfo->State.Tx.Waiting    = true;
+				CDCInterfaceInfo->State.Tx.FirstFrame = CDC_Device_Frame(CDCInterfaceInfo->Config.PortNumber);
+				return;
+			}
+
+			if (((CDC_Device_Frame(CDCInterfaceInfo->Config.PortNumber) - CDCInterfaceInfo->State.Tx.FirstFrame)
+			     & CDC_DEVICE_FRAME_MASK) < Timeout)
+			  return;
+
+			CDCInterfaceInfo->State.Stats.TxTimedFlushes++;
+		}
+	}
+	/* else: short run up to the end of the ring, the rest wraps to the start */
+
+	CDCInterfaceInfo->State.Tx.Waiting    = false;
+	CDCInterfaceInfo->State.Tx.ZeroLength = false;
+	CDCInterfaceInfo->State.Tx.InFlight   = Length;
+	CDCInterfaceInfo->State.Tx.Busy       = true;
+	Endpoint_StartTransfer(CDCInterfaceInfo->Config.PortNumber,
+	                       CDCInterfaceInfo->Config.DataINEndpointNumber | ENDPOINT_DIR_IN,
+	                       &CDCInterfaceInfo->Config.TxRingBuffer[Tail], Length);
+}
+
+static bool CDC_Device_RxPrime(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
+{
+	uint16_t PacketSize = CDCInterfaceInfo->Config.DataOUTEndpointSize;
+	uint16_t Size       = CDCInterfaceInfo->Config.RxRingSize;
+	uint16_t Head, Tail, Length;
+
+	if (CDCInterfaceInfo->State.Rx.InFlight)
+	  return true;
+
+	if (!(CDCInterfaceInfo->State.Rx.Count))
+	{
+		/* Empty: restart at the bottom to get the longest possible transfer */
+		CDCInterfaceInfo->State.Rx.Head  = 0;
+		CDCInterfaceInfo->State.Rx.Tail  = 0;
+		CDCInterfaceInfo->State.Rx.Limit = Size;
+	}
+
+	Head = CDCInterfaceInfo->State.Rx.Head;
+	Tail = CDCInterfaceInfo->State.Rx.Tail;
+
+	if ((Head < Tail) || ((Head == Tail) && CDCInterfaceInfo->State.Rx.Count))
+	{
+		Length = Tail - Head;
+	}
+	else
+	{
+		Length = Size - Head;
+		if ((Length < PacketSize) && (Tail >= PacketSize))
+		{
+			/* Not a whole packet left at the top: end the data here and wrap */
+			CDCInterfaceInfo->State.Rx.Limit = Head;
+			CDCInterfaceInfo->State.Rx.Head  = Head = 0;
+			Length = Tail;
+		}
+	}
+
+	if (Length < PacketSize)
+	  return false;
+
+	Length -= Length % PacketSize;
+	if (Length > CDC_DEVICE_MAX_TRANSFER)
+	  Length = CDC_DEVICE_MAX_TRANSFER;
+
+	CDCInterfaceInfo->State.Rx.InFlight = Length;
+	Endpoint_StartTransfer(CDCInterfaceInfo->Config.PortNumber,
+	                       CDCInterfaceInfo->Config.DataOUTEndpointNumber | ENDPOINT_DIR_OUT,
+	                       &CDCInterfaceInfo->Config.RxRingBuffer[Head], Length);
+	return true;
+}
+
+uint16_t CDC_Device_SendBuffer(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+                               const void* const Buffer,
+                               const uint16_t Length)
+{
+	uint8_t  corenum = CDCInterfaceInfo->Config.PortNumber;
+	uint16_t Size    = CDCInterfaceInfo->Config.TxRingSize;
+	uint16_t Head    = CDCInterfaceInfo->State.Tx.Head;
+	uint16_t Accepted, Run;
+
+	if ((USB_DeviceState[corenum] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS) ||
+	    (CDCInterfaceInfo->Config.TxRingBuffer == NULL))
+	  return 0;
+
+	/* The interrupt only ever shrinks Count, so the free space seen here stays valid */
+	Accepted = Size - CDCInterfaceInfo->State.Tx.Count;
+	if (Accepted > Length)
+	  Accepted = Length;
+
+	Run = Size - Head;
+	if (Run > Accepted)
+	  Run = Accepted;
+
+	memcpy(&CDCInterfaceInfo->Config.TxRingBuffer[Head], Buffer, Run);
+	memcpy(CDCInterfaceInfo->Config.TxRingBuffer, (const uint8_t*)Buffer + Run, Accepted - Run);
+
+	HAL_DisableUSBInterrupt(corenum);
+	CDCInterfaceInfo->State.Tx.Head   = (Head + Accepted) % Size;
+	CDCInterfaceInfo->State.Tx.Count += Accepted;
+	CDCInterfaceInfo->State.Stats.TxOverflowBytes += Length - Accepted;
+	CDC_Device_TxKick(CDCInterfaceInfo);
+	HAL_EnableUSBInterrupt(corenum);
+
+	return Accepted;
+}
+
+uint16_t CDC_Device_ReceiveBuffer(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+                                  void* const Buffer,
+                                  const uint16_t Length)
+{
+	uint8_t  corenum = CDCInterfaceInfo->Config.PortNumber;
+	uint16_t Copied  = 0;
+
+	if ((USB_DeviceState[corenum] != DEVICE_STATE_Configured) || (CDCInterfaceInfo->Config.RxRingBuffer == NULL))
+	  return 0;
+
+	while (Copied < Length)
+	{
+		uint16_t Tail = CDCInterfaceInfo->State.Rx.Tail;
+		uint16_t Run  = CDCInterfaceInfo->State.Rx.Limit - Tail;
+
+		/* The interrupt only ever grows Count, so the data seen here stays valid */
+		if (Run > CDCInterfaceInfo->State.Rx.Count)
+		  Run = CDCInterfaceInfo->State.Rx.Count;
+		if (Run > (Length - Copied))
+		  Run = Length - Copied;
+		if (!(Run))
+		  break;
+
+		memcpy((uint8_t*)Buffer + Copied, &CDCInterfaceInfo->Config.RxRingBuffer[Tail], Run);
+		Copied += Run;
+
+		HAL_DisableUSBInterrupt(corenum);
+		Tail += Run;
+		if (Tail == CDCInterfaceInfo->State.Rx.Limit)
+		{
+			Tail = 0;
+			CDCInterfaceInfo->State.Rx.Limit = CDCInterfaceInfo->Config.RxRingSize;
+		}
+		CDCInterfaceInfo->State.Rx.Tail   = Tail;
+		CDCInterfaceInfo->State.Rx.Count -= Run;
+		HAL_EnableUSBInterrupt(corenum);
+	}
+
+	if (Copied)
+	{
+		HAL_DisableUSBInterrupt(corenum);
+		CDC_Device_RxPrime(CDCInterfaceInfo);
+		HAL_EnableUSBInterrupt(corenum);
+	}
+
+	return Copied;
+}
+
+uint16_t CDC_Device_SendSpace(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
+{
+	if (CDCInterfaceInfo->Config.TxRingBuffer == NULL)
+	  return 0;
+
+	return CDCInterfaceInfo->Config.TxRingSize - CDCInterfaceInfo->State.Tx.Count;
+}
+
+bool CDC_Device_TransferComplete(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+                                 const int logicalEP,
+                                 const int xfer_in)
+{
+	if (xfer_in)
+	{
+		uint16_t Length = CDCInterfaceInfo->State.Tx.InFlight;
+		uint16_t Tail;
+
+		if ((logicalEP != CDCInterfaceInfo->Config.DataINEndpointNumber) || (CDCInterfaceInfo->Config.TxRingBuffer == NULL) ||
+		    !(CDCInterfaceInfo->State.Tx.Busy))
+		  return false;
+
+		Tail = CDCInterfaceInfo->State.Tx.Tail + Length;
+		if (Tail >= CDCInterfaceInfo->Config.TxRingSize)
+		  Tail -= CDCInterfaceInfo->Config.TxRingSize;
+
+		CDCInterfaceInfo->State.Tx.Tail   = Tail;
+		CDCInterfaceInfo->State.Tx.Count -= Length;
+		CDCInterfaceInfo->State.Tx.InFlight = 0;
+		CDCInterfaceInfo->State.Tx.Busy     = false;
+		CDCInterfaceInfo->State.Stats.TxBytes += Length;
+		CDCInterfaceInfo->State.Stats.TxTransfers++;
+
+		/* A transfer ending on a packet boundary needs a zero length packet to end the
+		   host read, unless more data follows */
+		CDCInterfaceInfo->State.Tx.ZeroLength = Length && !(Length % CDCInterfaceInfo->Config.DataINEndpointSize) &&
+		                                        !(CDCInterfaceInfo->State.Tx.Count);
+		CDC_Device_TxKick(CDCInterfaceInfo);
+	}
+	else
+	{
+		uint16_t Length;
+		uint16_t Head;
+
+		if ((logicalEP != CDCInterfaceInfo->Config.DataOUTEndpointNumber) || (CDCInterfaceInfo->Config.RxRingBuffer == NULL) ||
+		    !(CDCInterfaceInfo->State.Rx.InFlight))
+		  return false;
+
+		Length = Endpoint_GetTransferLength(CDCInterfaceInfo->Config.PortNumber,
+		                                    CDCInterfaceInfo->Config.DataOUTEndpointNumber | ENDPOINT_DIR_OUT);
+		if (Length > CDCInterfaceInfo->State.Rx.InFlight)
+		  Length = CDCInterfaceInfo->State.Rx.InFlight;
+
+		Head = CDCInterfaceInfo->State.Rx.Head + Length;
+		if (Head >= CDCInterfaceInfo->Config.RxRingSize)
+		  Head = 0;
+
+		CDCInterfaceInfo->State.Rx.Head   = Head;
+		CDCInterfaceInfo->State.Rx.Count += Length;
+		CDCInterfaceInfo->State.Rx.InFlight = 0;
+		CDCInterfaceInfo->State.Stats.RxBytes += Length;
+		CDCInterfaceInfo->State.Stats.RxTransfers++;
+
+		if (!(CDC_Device_RxPrime(CDCInterfaceInfo)))
+		{
+			/* Left NAKing until CDC_Device_ReceiveBuffer() makes room */
+			CDCInterfaceInfo->State.Stats.RxStalls++;
+		}
+	}
+
+	return true;
+}
+
+void CDC_Device_SOF(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
+{
+	if (CDCInterfaceInfo->State.Tx.Waiting)
+	  CDC_Device_TxKick(CDCInterfaceInfo);
+}
+
+void CDC_Device_GetStats(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+                         CDC_Device_Stats_t* const Stats)
+{
+	HAL_DisableUSBInterrupt(CDCInterfaceInfo->Config.PortNumber);
+	*Stats = CDCInterfaceInfo->State.Stats;
+	HAL_EnableUSBInterrupt(CDCInterfaceInfo->Config.PortNumber);
+}
+#endif
+
 void CDC_Device_ProcessControlRequest(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
 {
 	if (!(Endpoint_IsSETUPReceived(CDCInterfaceInfo->Config.PortNumber)))
@@ -155,6 +446,17 @@ bool CDC_Device_ConfigureEndpoints(USB_ClassInfo_CDC_Device_t* const CDCInterfac
 		}
 	}
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	CDCInterfaceInfo->State.Rx.Limit = CDCInterfaceInfo->Config.RxRingSize;
+
+	if (CDCInterfaceInfo->Config.RxRingBuffer != NULL)
+	{
+		HAL_DisableUSBInterrupt(CDCInterfaceInfo->Config.PortNumber);
+		CDC_Device_RxPrime(CDCInterfaceInfo);
+		HAL_EnableUSBInterrupt(CDCInterfaceInfo->Config.PortNumber);
+	}
+	#endif
+
 	return true;
 }
 
@@ -163,6 +465,12 @@ void CDC_Device_USBTask(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
 	if ((USB_DeviceState[CDCInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
 	  return;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	/* Partial packets in the transmit ring are flushed by CDC_Device_SOF() */
+	if (CDCInterfaceInfo->Config.TxRingBuffer != NULL)
+	  return;
+	#endif
+
 	#if !defined(NO_CLASS_DRIVER_AUTOFLUSH)
 	CDC_Device_Flush(CDCInterfaceInfo);
 	#endif
@@ -174,6 +482,16 @@ uint8_t CDC_Device_SendString(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo
 	if ((USB_DeviceState[CDCInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
 	  return ENDPOINT_RWSTREAM_DeviceDisconnected;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.TxRingBuffer != NULL)
+	{
+		uint16_t Count = strlen(String);
+
+		return (CDC_Device_SendBuffer(CDCInterfaceInfo, String, Count) == Count) ? ENDPOINT_RWSTREAM_NoError
+		                                                                          : ENDPOINT_RWSTREAM_IncompleteTransfer;
+	}
+	#endif
+
 	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataINEndpointNumber);
 	Endpoint_Write_Stream_LE(CDCInterfaceInfo->Config.PortNumber, String, strlen(String), NULL);
 	Endpoint_ClearIN(CDCInterfaceInfo->Config.PortNumber);
@@ -187,6 +505,16 @@ uint8_t CDC_Device_SendData(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
 	if ((USB_DeviceState[CDCInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
 	  return ENDPOINT_RWSTREAM_DeviceDisconnected;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.TxRingBuffer != NULL)
+	{
+		uint16_t Count = Length;
+
+		return (CDC_Device_SendBuffer(CDCInterfaceInfo, Buffer, Count) == Count) ? ENDPOINT_RWSTREAM_NoError
+		                                                                          : ENDPOINT_RWSTREAM_IncompleteTransfer;
+	}
+	#endif
+
 	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataINEndpointNumber);
 	Endpoint_Write_Stream_LE(CDCInterfaceInfo->Config.PortNumber, Buffer, Length, NULL);
 	Endpoint_ClearIN(CDCInterfaceInfo->Config.PortNumber);
@@ -199,6 +527,11 @@ uint8_t CDC_Device_SendByte(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
 	if ((USB_DeviceState[CDCInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
 	  return ENDPOINT_RWSTREAM_DeviceDisconnected;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.TxRingBuffer != NULL)
+	  return CDC_Device_SendBuffer(CDCInterfaceInfo, &Data, 1) ? ENDPOINT_READYWAIT_NoError : ENDPOINT_READYWAIT_Timeout;
+	#endif
+
 	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataINEndpointNumber);
 
 	if (!(Endpoint_IsReadWriteAllowed(CDCInterfaceInfo->Config.PortNumber)))
@@ -222,6 +555,23 @@ uint8_t CDC_Device_Flush(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
 
 	uint8_t ErrorCode;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.TxRingBuffer != NULL)
+	{
+		/* Send any partial packet now instead of at the flush timeout */
+		HAL_DisableUSBInterrupt(CDCInterfaceInfo->Config.PortNumber);
+		if (!(CDCInterfaceInfo->State.Tx.Busy) && (CDCInterfaceInfo->State.Tx.Count || CDCInterfaceInfo->State.Tx.ZeroLength))
+		{
+			CDCInterfaceInfo->State.Tx.Waiting    = true;
+			CDCInterfaceInfo->State.Tx.FirstFrame = CDC_Device_Frame(CDCInterfaceInfo->Config.PortNumber)
+			                                        - CDCInterfaceInfo->Config.TxFlushTimeoutMS;
+			CDC_Device_TxKick(CDCInterfaceInfo);
+		}
+		HAL_EnableUSBInterrupt(CDCInterfaceInfo->Config.PortNumber);
+		return ENDPOINT_READYWAIT_NoError;
+	}
+	#endif
+
 	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataINEndpointNumber);
 
 	if (!(Endpoint_BytesInEndpoint(CDCInterfaceInfo->Config.PortNumber)))
@@ -247,6 +597,11 @@ uint16_t CDC_Device_BytesReceived(USB_ClassInfo_CDC_Device_t* const CDCInterface
 	if ((USB_DeviceState[CDCInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
 	  return 0;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.RxRingBuffer != NULL)
+	  return CDCInterfaceInfo->State.Rx.Count;
+	#endif
+
 	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataOUTEndpointNumber);
 
 	if (Endpoint_IsOUTReceived(CDCInterfaceInfo->Config.PortNumber))
@@ -274,6 +629,18 @@ int16_t CDC_Device_ReceiveByte(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInf
 
 	int16_t ReceivedByte = -1;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.RxRingBuffer != NULL)
+	{
+		uint8_t Data;
+
+		if (CDC_Device_ReceiveBuffer(CDCInterfaceInfo, &Data, 1))
+		  ReceivedByte = Data;
+
+		return ReceivedByte;
+	}
+	#endif
+
 	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataOUTEndpointNumber);
 
 	if (Endpoint_IsOUTReceived(CDCInterfaceInfo->Config.PortNumber))
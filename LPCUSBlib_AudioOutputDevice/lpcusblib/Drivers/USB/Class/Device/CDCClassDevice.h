@@ -80,7 +80,27 @@
 		#endif
 
 	/* Public Interface - May be used in end-application: */
+		/* Macros: */
+			#if defined(__LPC18XX__) || defined(__LPC43XX__)
+			/** Largest single DMA transfer queued by the ring engine, one dTD covers five 4 KB pages. */
+			#define CDC_DEVICE_MAX_TRANSFER        16384
+			#endif
+
 		/* Type Defines: */
+			/** @brief CDC ring engine counters, read with @ref CDC_Device_GetStats(). All counters restart
+			 *  from zero each time the interface is configured.
+			 */
+			typedef struct
+			{
+				uint32_t TxBytes;         /**< Bytes completed on the IN endpoint. */
+				uint32_t RxBytes;         /**< Bytes completed on the OUT endpoint. */
+				uint32_t TxTransfers;     /**< IN DMA transfers completed. */
+				uint32_t RxTransfers;     /**< OUT DMA transfers completed. */
+				uint32_t TxTimedFlushes;  /**< IN transfers ending in a short packet because the flush timeout expired. */
+				uint32_t TxOverflowBytes; /**< Bytes refused by @ref CDC_Device_SendBuffer() for lack of ring space. */
+				uint32_t RxStalls;        /**< Times the OUT endpoint was left NAKing because the receive ring was full. */
+			} CDC_Device_Stats_t;
+
 			/** @brief CDC Class Device Mode Configuration and State Structure.
 			 *
 			 *  Class state structure. An instance of this structure should be made for each CDC interface
@@ -105,6 +125,16 @@
 					uint16_t NotificationEndpointSize;  /**< Size in bytes of the CDC interface's IN notification endpoint, if used. */
 					bool     NotificationEndpointDoubleBank; /**< Indicates if the CDC interface's notification endpoint should use double banking. */
 					uint8_t  PortNumber;				/**< Port number that this interface is running.*/
+
+					uint8_t* TxRingBuffer;     /**< Transmit ring, or \c NULL to write the IN endpoint directly. The ring is
+					                            *   drained by DMA straight from this memory, so it must be USB accessible.
+					                            */
+					uint16_t TxRingSize;       /**< Size of \c TxRingBuffer in bytes, a multiple of DataINEndpointSize. */
+					uint8_t* RxRingBuffer;     /**< Receive ring, or \c NULL to read the OUT endpoint directly. */
+					uint16_t RxRingSize;       /**< Size of \c RxRingBuffer in bytes, a multiple of DataOUTEndpointSize. */
+					uint16_t TxFlushTimeoutMS; /**< Time a partial packet may wait in the transmit ring for more data before
+					                            *   it is sent as a short packet, 0 sends partial packets immediately.
+					                            */
 				} Config; /**< Config data for the USB class interface within the device. All elements in this section
 				           *   <b>must</b> be set or the interface will fail to enumerate and operate correctly.
 				           */
@@ -125,6 +155,29 @@
 					                                  *  This is generally only used if the virtual serial port data is to be
 					                                  *  reconstructed on a physical UART.
 					                                  */
+
+					struct
+					{
+						volatile uint16_t Head;       /**< Next byte written by the application. */
+						volatile uint16_t Tail;       /**< First byte not yet handed to the controller. */
+						volatile uint16_t Count;      /**< Bytes in the ring, including the transfer in flight. */
+						volatile uint16_t InFlight;   /**< Length of the transfer the controller owns. */
+						volatile bool     Busy;       /**< The controller owns a transfer, which may be zero length. */
+						uint16_t          FirstFrame; /**< Frame number when the oldest partial packet was queued. */
+						volatile bool     Waiting;    /**< A partial packet is held back for more data. */
+						bool              ZeroLength; /**< The last transfer ended on a packet boundary with the ring empty. */
+					} Tx; /**< Transmit ring state, used when \c Config.TxRingBuffer is set. */
+
+					struct
+					{
+						volatile uint16_t Head;       /**< Next byte written by the controller. */
+						volatile uint16_t Tail;       /**< Next byte read by the application. */
+						volatile uint16_t Count;      /**< Bytes waiting to be read. */
+						volatile uint16_t Limit;      /**< End of valid data when the writer wrapped early, else the ring size. */
+						volatile uint16_t InFlight;   /**< Length of the transfer the controller owns, 0 when idle. */
+					} Rx; /**< Receive ring state, used when \c Config.RxRingBuffer is set. */
+
+					CDC_Device_Stats_t Stats; /**< Ring engine counters. */
 				} State; /**< State data for the USB class interface within the device. All elements in this section
 				          *   are reset to their defaults when the interface is enumerated.
 				          */
@@ -297,6 +350,75 @@
 			 * @return	Nothing
 			 */
 			void CDC_Device_SendControlLineStateChange(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
+
+		#if defined(__LPC18XX__) || defined(__LPC43XX__)
+			/**
+			 * @brief	Copies as much of a buffer as fits into the transmit ring and starts the IN DMA if it is idle. Whole
+			 *  packets are sent as soon as they are complete; a trailing partial packet is held until more data arrives or
+			 *  \c Config.TxFlushTimeoutMS expires (see @ref CDC_Device_SOF()). Never blocks.
+			 *
+			 * @param	CDCInterfaceInfo	: Pointer to a structure containing a CDC Class configuration and state.
+			 * @param   Buffer              : Data to send.
+			 * @param   Length              : Number of bytes to send.
+			 * @return	Number of bytes accepted, anything short of \c Length is counted in \c TxOverflowBytes.
+			 */
+			uint16_t CDC_Device_SendBuffer(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+			                               const void* const Buffer,
+			                               const uint16_t Length) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+
+			/**
+			 * @brief	Copies received data out of the receive ring and re-arms the OUT DMA once room is available. Never blocks.
+			 *
+			 * @param	CDCInterfaceInfo	: Pointer to a structure containing a CDC Class configuration and state.
+			 * @param   Buffer              : Destination for the data.
+			 * @param   Length              : Room in \c Buffer.
+			 * @return	Number of bytes copied.
+			 */
+			uint16_t CDC_Device_ReceiveBuffer(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+			                                  void* const Buffer,
+			                                  const uint16_t Length) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+
+			/**
+			 * @brief	Returns the free space of the transmit ring.
+			 *
+			 * @param	CDCInterfaceInfo	: Pointer to a structure containing a CDC Class configuration and state.
+			 * @return	Bytes @ref CDC_Device_SendBuffer() accepts without overflowing.
+			 */
+			uint16_t CDC_Device_SendSpace(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
+
+			/**
+			 * @brief	Ring engine completion handler. Call it from @ref EVENT_USB_Device_PortTransferComplete() for
+			 *  every completion on the port; completions on other endpoints are ignored.
+			 *
+			 * @param	CDCInterfaceInfo	: Pointer to a structure containing a CDC Class configuration and state.
+			 * @param   logicalEP           : Logical endpoint number from the event.
+			 * @param   xfer_in             : Non zero for an IN completion.
+			 * @return	Boolean \c true if the completion belonged to this interface.
+			 */
+			bool CDC_Device_TransferComplete(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+			                                 const int logicalEP,
+			                                 const int xfer_in) ATTR_NON_NULL_PTR_ARG(1);
+
+			/**
+			 * @brief	Ring engine timer. Call it from the port start of frame event so partial packets are flushed once
+			 *  \c Config.TxFlushTimeoutMS has elapsed.
+			 *
+			 * @param	CDCInterfaceInfo	: Pointer to a structure containing a CDC Class configuration and state.
+			 * @return	Nothing
+			 */
+			void CDC_Device_SOF(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
+
+			/**
+			 * @brief	Takes a consistent copy of the ring engine counters.
+			 *
+			 * @param	CDCInterfaceInfo	: Pointer to a structure containing a CDC Class configuration and state.
+			 * @param   Stats               : Where the counters are copied.
+			 * @return	Nothing
+			 */
+			void CDC_Device_GetStats(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+			                         CDC_Device_Stats_t* const Stats) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+		#endif
+
 	#if (!defined(__IAR_SYSTEMS_ICC__) || (_DLIB_FILE_DESCRIPTOR == 1))
 			/**
 			 * @brief	Creates a standard character stream for the given CDC Device instance so that it can be used with all the regular
@@ -40,9 +40,195 @@
 #define  __INCLUDE_FROM_MIDI_DEVICE_C
 #include "MIDIClassDevice.h"
 
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/* Event engine. Both queues are single producer, single consumer rings with
+   free running indexes, so neither side masks interrupts to move events; only
+   priming the OUT endpoint from the application masks the port interrupt. */
+
+#define MIDI_DEVICE_EVENT_SIZE  sizeof(MIDI_EventPacket_t)
+
+static bool MIDI_Device_RxPrime(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo)
+{
+	uint16_t Used = MIDIInterfaceInfo->State.Rx.Head - MIDIInterfaceInfo->State.Rx.Tail;
+
+	if (MIDIInterfaceInfo->State.Rx.Busy)
+	  return true;
+
+	/* Only arm when a full packet of events is guaranteed to fit */
+	if ((MIDIInterfaceInfo->Config.RxQueueSize - Used) < (MIDIInterfaceInfo->Config.DataOUTEndpointSize / MIDI_DEVICE_EVENT_SIZE))
+	  return false;
+
+	MIDIInterfaceInfo->State.Rx.Busy = true;
+	Endpoint_StartTransfer(MIDIInterfaceInfo->Config.PortNumber,
+						   MIDIInterfaceInfo->Config.DataOUTEndpointNumber | ENDPOINT_DIR_OUT,
+						   MIDIInterfaceInfo->Config.RxPacketBuffer, MIDIInterfaceInfo->Config.DataOUTEndpointSize);
+	return true;
+}
+
+bool MIDI_Device_QueueEvent(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo,
+							const MIDI_EventPacket_t *const Event,
+							const uint32_t Timestamp)
+{
+	uint16_t Head = MIDIInterfaceInfo->State.Tx.Head;
+	MIDI_Device_TimedEvent_t *Entry;
+
+	if ((USB_DeviceState[MIDIInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) ||
+		(MIDIInterfaceInfo->Config.TxQueue == NULL))
+	  return false;
+
+	if ((uint16_t)(Head - MIDIInterfaceInfo->State.Tx.Tail) >= MIDIInterfaceInfo->Config.TxQueueSize)
+	{
+		MIDIInterfaceInfo->State.Stats.TxDropped++;
+		return false;
+	}
+
+	Entry = &MIDIInterfaceInfo->Config.TxQueue[Head & (MIDIInterfaceInfo->Config.TxQueueSize - 1)];
+	Entry->Event     = *Event;
+	Entry->Timestamp = Timestamp;
+
+	/* Publish the entry only after it is complete */
+	__DMB();
+	MIDIInterfaceInfo->State.Tx.Head = Head + 1;
+	return true;
+}
+
+bool MIDI_Device_DequeueEvent(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo,
+							  MIDI_Device_TimedEvent_t *const Event)
+{
+	uint16_t Tail = MIDIInterfaceInfo->State.Rx.Tail;
+
+	if ((MIDIInterfaceInfo->Config.RxQueue == NULL) || (Tail == MIDIInterfaceInfo->State.Rx.Head))
+	  return false;
+
+	*Event = MIDIInterfaceInfo->Config.RxQueue[Tail & (MIDIInterfaceInfo->Config.RxQueueSize - 1)];
+	__DMB();
+	MIDIInterfaceInfo->State.Rx.Tail = Tail + 1;
+
+	if (!(MIDIInterfaceInfo->State.Rx.Busy) &&
+		(USB_DeviceState[MIDIInterfaceInfo->Config.PortNumber] == DEVICE_STATE_Configured))
+	{
+		HAL_DisableUSBInterrupt(MIDIInterfaceInfo->Config.PortNumber);
+		MIDI_Device_RxPrime(MIDIInterfaceInfo);
+		HAL_EnableUSBInterrupt(MIDIInterfaceInfo->Config.PortNumber);
+	}
+
+	return true;
+}
+
+void MIDI_Device_SOF(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo)
+{
+	uint16_t Tail   = MIDIInterfaceInfo->State.Tx.Tail;
+	uint16_t Queued = MIDIInterfaceInfo->State.Tx.Head - Tail;
+	uint16_t Mask   = MIDIInterfaceInfo->Config.TxQueueSize - 1;
+	uint16_t Count, i;
+	uint32_t Now;
+	MIDI_EventPacket_t *Packet = (MIDI_EventPacket_t *) MIDIInterfaceInfo->Config.TxPacketBuffer;
+
+	if ((MIDIInterfaceInfo->Config.TxQueue == NULL) || MIDIInterfaceInfo->State.Tx.Busy || !(Queued) ||
+		(USB_DeviceState[MIDIInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured))
+	  return;
+
+	Count = MIDIInterfaceInfo->Config.DataINEndpointSize / MIDI_DEVICE_EVENT_SIZE;
+	if (Count > Queued)
+	  Count = Queued;
+
+	Now = DWT->CYCCNT;
+	for (i = 0; i < Count; i++)
+	{
+		const MIDI_Device_TimedEvent_t *Entry = &MIDIInterfaceInfo->Config.TxQueue[(uint16_t)(Tail + i) & Mask];
+		uint32_t Latency = Now - Entry->Timestamp;
+
+		Packet[i] = Entry->Event;
+		if ((Latency < MIDIInterfaceInfo->State.Stats.TxLatencyMin) || !(MIDIInterfaceInfo->State.Stats.TxEvents + i))
+		  MIDIInterfaceInfo->State.Stats.TxLatencyMin = Latency;
+		if (Latency > MIDIInterfaceInfo->State.Stats.TxLatencyMax)
+		  MIDIInterfaceInfo->State.Stats.TxLatencyMax = Latency;
+		MIDIInterfaceInfo->State.Stats.TxLatencyTotal += Latency;
+	}
+	MIDIInterfaceInfo->State.Tx.Tail = Tail + Count;
+	MIDIInterfaceInfo->State.Stats.TxEvents += Count;
+
+	MIDIInterfaceInfo->State.Tx.Busy = true;
+	Endpoint_StartTransfer(MIDIInterfaceInfo->Config.PortNumber,
+						   MIDIInterfaceInfo->Config.DataINEndpointNumber | ENDPOINT_DIR_IN,
+						   MIDIInterfaceInfo->Config.TxPacketBuffer, Count * MIDI_DEVICE_EVENT_SIZE);
+}
+
+bool MIDI_Device_TransferComplete(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo,
+								  const int logicalEP,
+								  const int xfer_in)
+{
+	if (xfer_in)
+	{
+		if ((logicalEP != MIDIInterfaceInfo->Config.DataINEndpointNumber) || (MIDIInterfaceInfo->Config.TxQueue == NULL) ||
+			!(MIDIInterfaceInfo->State.Tx.Busy))
+		  return false;
+
+		MIDIInterfaceInfo->State.Tx.Busy = false;
+		MIDIInterfaceInfo->State.Stats.TxPackets++;
+	}
+	else
+	{
+		const MIDI_EventPacket_t *Packet = (const MIDI_EventPacket_t *) MIDIInterfaceInfo->Config.RxPacketBuffer;
+		uint16_t Head = MIDIInterfaceInfo->State.Rx.Head;
+		uint16_t Mask = MIDIInterfaceInfo->Config.RxQueueSize - 1;
+		uint16_t Count, i;
+		uint32_t Now = DWT->CYCCNT;
+
+		if ((logicalEP != MIDIInterfaceInfo->Config.DataOUTEndpointNumber) || (MIDIInterfaceInfo->Config.RxQueue == NULL) ||
+			!(MIDIInterfaceInfo->State.Rx.Busy))
+		  return false;
+
+		Count = Endpoint_GetTransferLength(MIDIInterfaceInfo->Config.PortNumber,
+										   MIDIInterfaceInfo->Config.DataOUTEndpointNumber | ENDPOINT_DIR_OUT)
+				/ MIDI_DEVICE_EVENT_SIZE;
+
+		/* RxPrime() only armed the endpoint with room for a full packet */
+		for (i = 0; i < Count; i++)
+		{
+			MIDI_Device_TimedEvent_t *Entry;
+
+			/* Hosts pad packets with all zero events */
+			if (!(Packet[i].Command) && !(Packet[i].CableNumber) && !(Packet[i].Data1))
+			  continue;
+
+			Entry = &MIDIInterfaceInfo->Config.RxQueue[Head & Mask];
+			Entry->Event     = Packet[i];
+			Entry->Timestamp = Now;
+			Head++;
+			MIDIInterfaceInfo->State.Stats.RxEvents++;
+		}
+		__DMB();
+		MIDIInterfaceInfo->State.Rx.Head = Head;
+		MIDIInterfaceInfo->State.Rx.Busy = false;
+		MIDIInterfaceInfo->State.Stats.RxPackets++;
+
+		if (!(MIDI_Device_RxPrime(MIDIInterfaceInfo)))
+		{
+			/* Left NAKing until MIDI_Device_DequeueEvent() makes room */
+			MIDIInterfaceInfo->State.Stats.RxStalls++;
+		}
+	}
+
+	return true;
+}
+
+void MIDI_Device_GetStats(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo,
+						  MIDI_Device_Stats_t *const Stats)
+{
+	HAL_DisableUSBInterrupt(MIDIInterfaceInfo->Config.PortNumber);
+	*Stats = MIDIInterfaceInfo->State.Stats;
+	HAL_EnableUSBInterrupt(MIDIInterfaceInfo->Config.PortNumber);
+}
+#endif
+
 bool MIDI_Device_ConfigureEndpoints(USB_ClassInfo_MIDI_Device_t* const MIDIInterfaceInfo)
 {
-	// memset(&MIDIInterfaceInfo->State, 0x00, sizeof(MIDIInterfaceInfo->State));
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	HAL_DisableUSBInterrupt(MIDIInterfaceInfo->Config.PortNumber);
+	memset(&MIDIInterfaceInfo->State, 0x00, sizeof(MIDIInterfaceInfo->State));
+	HAL_EnableUSBInterrupt(MIDIInterfaceInfo->Config.PortNumber);
+#endif
 
 	for (uint8_t EndpointNum = 1; EndpointNum < ENDPOINT_TOTAL_ENDPOINTS(MIDIInterfaceInfo->Config.PortNumber); EndpointNum++)
 	{
@@ -77,6 +263,15 @@ bool MIDI_Device_ConfigureEndpoints(USB_ClassInfo_MIDI_Device_t* const MIDIInter
 		}
 	}
 
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (MIDIInterfaceInfo->Config.RxQueue != NULL)
+	{
+		HAL_DisableUSBInterrupt(MIDIInterfaceInfo->Config.PortNumber);
+		MIDI_Device_RxPrime(MIDIInterfaceInfo);
+		HAL_EnableUSBInterrupt(MIDIInterfaceInfo->Config.PortNumber);
+	}
+#endif
+
 	return true;
 }
 
@@ -85,6 +280,12 @@ void MIDI_Device_USBTask(USB_ClassInfo_MIDI_Device_t* const MIDIInterfaceInfo)
 	if (USB_DeviceState[MIDIInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured)
 	  return;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	/* Queued events are flushed by MIDI_Device_SOF() */
+	if (MIDIInterfaceInfo->Config.TxQueue != NULL)
+	  return;
+	#endif
+
 	#if !defined(NO_CLASS_DRIVER_AUTOFLUSH)
 	MIDI_Device_Flush(MIDIInterfaceInfo);
 	#endif
@@ -98,6 +299,12 @@ uint8_t MIDI_Device_SendEventPacket(USB_ClassInfo_MIDI_Device_t* const MIDIInter
 
 	uint8_t ErrorCode;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (MIDIInterfaceInfo->Config.TxQueue != NULL)
+	  return MIDI_Device_QueueEvent(MIDIInterfaceInfo, Event, DWT->CYCCNT) ? ENDPOINT_RWSTREAM_NoError
+	                                                                        : ENDPOINT_RWSTREAM_IncompleteTransfer;
+	#endif
+
 	Endpoint_SelectEndpoint(MIDIInterfaceInfo->Config.PortNumber, MIDIInterfaceInfo->Config.DataINEndpointNumber);
 
 	if ((ErrorCode = Endpoint_Write_Stream_LE(MIDIInterfaceInfo->Config.PortNumber, Event, sizeof(MIDI_EventPacket_t), NULL)) != ENDPOINT_RWSTREAM_NoError)
@@ -116,6 +323,12 @@ uint8_t MIDI_Device_Flush(USB_ClassInfo_MIDI_Device_t* const MIDIInterfaceInfo)
 
 	uint8_t ErrorCode;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	/* The next start of frame sends whatever is queued */
+	if (MIDIInterfaceInfo->Config.TxQueue != NULL)
+	  return ENDPOINT_READYWAIT_NoError;
+	#endif
+
 	Endpoint_SelectEndpoint(MIDIInterfaceInfo->Config.PortNumber, MIDIInterfaceInfo->Config.DataINEndpointNumber);
 
 	if (Endpoint_BytesInEndpoint(MIDIInterfaceInfo->Config.PortNumber))
@@ -135,6 +348,19 @@ bool MIDI_Device_ReceiveEventPacket(USB_ClassInfo_MIDI_Device_t* const MIDIInter
 	if (USB_DeviceState[MIDIInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured)
 	  return false;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (MIDIInterfaceInfo->Config.RxQueue != NULL)
+	{
+		MIDI_Device_TimedEvent_t Entry;
+
+		if (!(MIDI_Device_DequeueEvent(MIDIInterfaceInfo, &Entry)))
+		  return false;
+
+		*Event = Entry.Event;
+		return true;
+	}
+	#endif
+
 	Endpoint_SelectEndpoint(MIDIInterfaceInfo->Config.PortNumber, MIDIInterfaceInfo->Config.DataOUTEndpointNumber);
 
 	if (!(Endpoint_IsReadWriteAllowed(MIDIInterfaceInfo->Config.PortNumber)))
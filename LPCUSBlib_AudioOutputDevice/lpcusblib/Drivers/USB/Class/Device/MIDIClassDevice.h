@@ -62,6 +62,32 @@ extern "C" {
 
 /* Public Interface - May be used in end-application: */
 /* Type Define: */
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/**
+ * @brief Timestamped MIDI event, the element type of the event queues.
+ */
+typedef struct {
+	MIDI_EventPacket_t Event;		/**< USB-MIDI event packet. */
+	uint32_t Timestamp;				/**< DWT cycle count when the event was queued for the host, or received from it. */
+} MIDI_Device_TimedEvent_t;
+
+/**
+ * @brief MIDI event engine counters, read with @ref MIDI_Device_GetStats(). All counters restart from zero
+ *  each time the interface is configured.
+ */
+typedef struct {
+	uint32_t TxEvents;				/**< Events sent to the host. */
+	uint32_t RxEvents;				/**< Events received from the host. */
+	uint32_t TxPackets;				/**< IN packets sent, each carrying every event queued at the frame start. */
+	uint32_t RxPackets;				/**< OUT packets received. */
+	uint32_t TxDropped;				/**< Events refused because the transmit queue was full. */
+	uint32_t RxStalls;				/**< Times the OUT endpoint was left NAKing because the receive queue was full. */
+	uint32_t TxLatencyMin;			/**< Shortest time from queueing to the start of the IN transfer, in DWT cycles. */
+	uint32_t TxLatencyMax;			/**< Longest time from queueing to the start of the IN transfer, in DWT cycles. */
+	uint64_t TxLatencyTotal;		/**< Sum of all queueing latencies, divide by TxEvents for the mean. */
+} MIDI_Device_Stats_t;
+#endif
+
 /**
  * @brief MIDI Class Device Mode Configuration and State Structure.
  *
@@ -81,17 +107,37 @@ typedef struct {
 		uint16_t DataOUTEndpointSize;				/**< Size in bytes of the outgoing MIDI OUT data endpoint, if available (zero if unused). */
 		bool     DataOUTEndpointDoubleBank;				/**< Indicates if the MIDI interface's OUT data endpoint should use double banking. */
 		uint8_t  PortNumber;				/**< Port number that this interface is running.*/
+
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+		MIDI_Device_TimedEvent_t *TxQueue;	/**< Events waiting for the next frame, or \c NULL to write the IN endpoint directly. */
+		uint16_t TxQueueSize;				/**< Number of entries in \c TxQueue, a power of 2. */
+		MIDI_Device_TimedEvent_t *RxQueue;	/**< Events received from the host, or \c NULL to read the OUT endpoint directly. */
+		uint16_t RxQueueSize;				/**< Number of entries in \c RxQueue, a power of 2 of at least two packets of events. */
+		uint8_t *TxPacketBuffer;			/**< USB accessible buffer of DataINEndpointSize bytes the IN packet is built in. */
+		uint8_t *RxPacketBuffer;			/**< USB accessible buffer of DataOUTEndpointSize bytes the OUT packet lands in. */
+#endif
 	} Config;				/**< Config data for the USB class interface within the device. All elements in this section
 							 *   <b>must</b> be set or the interface will fail to enumerate and operate correctly.
 							 */
 
-#if 0
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
 	struct {
-		// No state information for this class
+		struct {
+			volatile uint16_t Head;		/**< Free running write index, owned by the application. */
+			volatile uint16_t Tail;		/**< Free running read index, owned by @ref MIDI_Device_SOF(). */
+			volatile bool     Busy;		/**< An IN packet is owned by the controller. */
+		} Tx;						/**< Transmit queue state. */
+
+		struct {
+			volatile uint16_t Head;		/**< Free running write index, owned by the completion handler. */
+			volatile uint16_t Tail;		/**< Free running read index, owned by the application. */
+			volatile bool     Busy;		/**< The OUT endpoint is primed. */
+		} Rx;						/**< Receive queue state. */
+
+		MIDI_Device_Stats_t Stats;	/**< Event engine counters. */
 	} State;			/**< State data for the USB class interface within the device. All elements in this section
 						 *   are reset to their defaults when the interface is enumerated.
 						 */
-
 #endif
 } USB_ClassInfo_MIDI_Device_t;
 
@@ -158,6 +204,69 @@ uint8_t MIDI_Device_Flush(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo)
 bool MIDI_Device_ReceiveEventPacket(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo,
 									MIDI_EventPacket_t *const Event) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
 
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/**
+ * @brief	Queues a MIDI event for the host without blocking. Queued events are packed into a single IN packet at the next
+ *  start of frame, see @ref MIDI_Device_SOF(). Lock free: one producer context may call this while the USB interrupt drains
+ *  the queue.
+ *
+ * @param	MIDIInterfaceInfo	: Pointer to a structure containing a MIDI Class configuration and state.
+ * @param	Event	: Event to send.
+ * @param	Timestamp	: DWT cycle count the latency statistics are measured from, normally DWT->CYCCNT or the receive
+ *                        timestamp of the event being forwarded.
+ *
+ * @return	Boolean \c true if queued, \c false if the queue was full or the host is not connected.
+ */
+bool MIDI_Device_QueueEvent(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo,
+							const MIDI_EventPacket_t *const Event,
+							const uint32_t Timestamp) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+
+/**
+ * @brief	Takes the oldest event received from the host, with its receive timestamp, without blocking. The OUT endpoint is
+ *  re-armed here if the queue had filled up.
+ *
+ * @param	MIDIInterfaceInfo	: Pointer to a structure containing a MIDI Class configuration and state.
+ * @param	Event	: Where the event is copied.
+ *
+ * @return	Boolean \c true if an event was returned.
+ */
+bool MIDI_Device_DequeueEvent(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo,
+							  MIDI_Device_TimedEvent_t *const Event) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+
+/**
+ * @brief	Event engine flush, call it from the port start of frame event. Packs as many queued events as fit into one
+ *  IN packet and starts it, unless the previous packet is still waiting for the host.
+ *
+ * @param	MIDIInterfaceInfo	: Pointer to a structure containing a MIDI Class configuration and state.
+ * @return	Nothing
+ */
+void MIDI_Device_SOF(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
+
+/**
+ * @brief	Event engine completion handler, call it from @ref EVENT_USB_Device_PortTransferComplete() for every completion
+ *  on the port. Received packets are unpacked and timestamped here.
+ *
+ * @param	MIDIInterfaceInfo	: Pointer to a structure containing a MIDI Class configuration and state.
+ * @param	logicalEP	: Logical endpoint number from the event.
+ * @param	xfer_in	: Non zero for an IN completion.
+ *
+ * @return	Boolean \c true if the completion belonged to this interface.
+ */
+bool MIDI_Device_TransferComplete(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo,
+								  const int logicalEP,
+								  const int xfer_in) ATTR_NON_NULL_PTR_ARG(1);
+
+/**
+ * @brief	Takes a consistent copy of the event engine counters.
+ *
+ * @param	MIDIInterfaceInfo	: Pointer to a structure containing a MIDI Class configuration and state.
+ * @param	Stats	: Where the counters are copied.
+ * @return	Nothing
+ */
+void MIDI_Device_GetStats(USB_ClassInfo_MIDI_Device_t *const MIDIInterfaceInfo,
+						  MIDI_Device_Stats_t *const Stats) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+#endif
+
 /* Inline Functions: */
 /**
  * @brief	Processes incoming control requests from the host, that are directed to the given MIDI class interface. This should be
@@ -40,6 +40,421 @@
 #define  __INCLUDE_FROM_MASSSTORAGE_DEVICE_C
 #include "MassStorageClassDevice.h"
 
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/* Pipelined data phase. The controller moves one sector buffer per transfer
+   descriptor while MS_Device_USBTask() runs the backing store on the others.
+   Buffer ownership follows three free running counters: Stored is advanced by
+   the main loop, Queued and Transferred by the USB interrupt or by the main
+   loop with the port interrupt masked. The CBW and CSW go through buffer 0,
+   which is never in use outside the data phase. */
+
+static uint8_t *MS_Device_Buffer(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo, const uint8_t Index)
+{
+	return &MSInterfaceInfo->Config.DataBuffers[(Index & (MSInterfaceInfo->Config.BufferCount - 1)) *
+												MSInterfaceInfo->Config.BufferSize];
+}
+
+static void MS_Device_PrimeCommand(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	MSInterfaceInfo->State.Pipe.Stage = MS_STAGE_Command;
+	MSInterfaceInfo->State.Pipe.Busy  = true;
+	Endpoint_StartTransfer(MSInterfaceInfo->Config.PortNumber,
+						   MSInterfaceInfo->Config.DataOUTEndpointNumber | ENDPOINT_DIR_OUT,
+						   MSInterfaceInfo->Config.DataBuffers, MSInterfaceInfo->Config.DataOUTEndpointSize);
+}
+
+/* Puts the next buffer on the wire if the endpoint is idle. USB interrupt, or port interrupt masked */
+static void MS_Device_Kick(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	uint8_t  Index = MSInterfaceInfo->State.Pipe.Queued;
+	uint32_t Length;
+
+	if (MSInterfaceInfo->State.Pipe.Busy)
+	  return;
+
+	if (MSInterfaceInfo->State.Pipe.Stage == MS_STAGE_DataIN)
+	{
+		if (Index == MSInterfaceInfo->State.Pipe.Stored)
+		  return;
+
+		MSInterfaceInfo->State.Pipe.Busy   = true;
+		MSInterfaceInfo->State.Pipe.Queued = Index + 1;
+		Endpoint_StartTransfer(MSInterfaceInfo->Config.PortNumber,
+							   MSInterfaceInfo->Config.DataINEndpointNumber | ENDPOINT_DIR_IN,
+							   MS_Device_Buffer(MSInterfaceInfo, Index),
+							   MSInterfaceInfo->State.Pipe.Length[Index & (MSInterfaceInfo->Config.BufferCount - 1)]);
+	}
+	else if (MSInterfaceInfo->State.Pipe.Stage == MS_STAGE_DataOUT)
+	{
+		if (!(MSInterfaceInfo->State.Pipe.Bytes) ||
+			((uint8_t) (Index - MSInterfaceInfo->State.Pipe.Stored) >= MSInterfaceInfo->Config.BufferCount))
+		  return;
+
+		Length = MSInterfaceInfo->State.Pipe.Bytes;
+		if (Length > MSInterfaceInfo->Config.BufferSize)
+		  Length = MSInterfaceInfo->Config.BufferSize;
+
+		MSInterfaceInfo->State.Pipe.Length[Index & (MSInterfaceInfo->Config.BufferCount - 1)] = Length;
+		MSInterfaceInfo->State.Pipe.Bytes -= Length;
+		MSInterfaceInfo->State.Pipe.Busy   = true;
+		MSInterfaceInfo->State.Pipe.Queued = Index + 1;
+		Endpoint_StartTransfer(MSInterfaceInfo->Config.PortNumber,
+							   MSInterfaceInfo->Config.DataOUTEndpointNumber | ENDPOINT_DIR_OUT,
+							   MS_Device_Buffer(MSInterfaceInfo, Index), Length);
+	}
+}
+
+/* Ends the data phase once every buffer went through both sides. Port interrupt masked */
+static void MS_Device_CheckDataDone(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	if (MSInterfaceInfo->State.Pipe.Busy ||
+		(MSInterfaceInfo->State.Pipe.Stored != MSInterfaceInfo->State.Pipe.Transferred))
+	  return;
+
+	if (((MSInterfaceInfo->State.Pipe.Stage == MS_STAGE_DataIN)  && !(MSInterfaceInfo->State.Pipe.Blocks)) ||
+		((MSInterfaceInfo->State.Pipe.Stage == MS_STAGE_DataOUT) && !(MSInterfaceInfo->State.Pipe.Bytes)))
+	{
+		MSInterfaceInfo->State.Pipe.Stage = MS_STAGE_Status;
+	}
+}
+
+static void MS_Device_ProcessCommand(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	MS_CommandBlockWrapper_t *const CommandBlock = &MSInterfaceInfo->State.CommandBlock;
+
+	if (MSInterfaceInfo->State.Pipe.Length[0] != sizeof(MS_CommandBlockWrapper_t))
+	  CommandBlock->Signature = 0;
+	else
+	  memcpy(CommandBlock, MSInterfaceInfo->Config.DataBuffers, sizeof(MS_CommandBlockWrapper_t));
+
+	if ((CommandBlock->Signature         != CPU_TO_LE32(MS_CBW_SIGNATURE))     ||
+	    (CommandBlock->LUN               >= MSInterfaceInfo->Config.TotalLUNs) ||
+		(CommandBlock->Flags              & 0x1F)                              ||
+		(CommandBlock->SCSICommandLength == 0)                                 ||
+		(CommandBlock->SCSICommandLength >  16))
+	{
+		/* Both endpoints stay stalled until the host does a reset recovery */
+		MSInterfaceInfo->State.Pipe.Stage = MS_STAGE_Error;
+		Endpoint_SelectEndpoint(MSInterfaceInfo->Config.PortNumber, MSInterfaceInfo->Config.DataOUTEndpointNumber);
+		Endpoint_StallTransaction(MSInterfaceInfo->Config.PortNumber);
+		Endpoint_SelectEndpoint(MSInterfaceInfo->Config.PortNumber, MSInterfaceInfo->Config.DataINEndpointNumber);
+		Endpoint_StallTransaction(MSInterfaceInfo->Config.PortNumber);
+		return;
+	}
+
+	MSInterfaceInfo->State.Stats.Commands++;
+	MSInterfaceInfo->State.Pipe.Failed      = false;
+	MSInterfaceInfo->State.Pipe.Blocks      = 0;
+	MSInterfaceInfo->State.Pipe.Bytes       = 0;
+	MSInterfaceInfo->State.Pipe.Stored      = 0;
+	MSInterfaceInfo->State.Pipe.Queued      = 0;
+	MSInterfaceInfo->State.Pipe.Transferred = 0;
+
+	/* The callback hands a data phase over with MS_Device_QueueBlocks() or MS_Device_QueueResponse() */
+	MSInterfaceInfo->State.Pipe.Result = CALLBACK_MS_Device_SCSICommandReceived(MSInterfaceInfo);
+
+	if (MSInterfaceInfo->State.Pipe.Stage == MS_STAGE_Process)
+	  MSInterfaceInfo->State.Pipe.Stage = MS_STAGE_Status;
+}
+
+/* Reads blocks into every free buffer, the wire drains them meanwhile */
+static void MS_Device_FillBuffers(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	uint32_t PerBuffer = MSInterfaceInfo->Config.BufferSize / MSInterfaceInfo->State.Pipe.BlockSize;
+
+	while (MSInterfaceInfo->State.Pipe.Blocks &&
+		   ((uint8_t) (MSInterfaceInfo->State.Pipe.Stored - MSInterfaceInfo->State.Pipe.Transferred) <
+			MSInterfaceInfo->Config.BufferCount))
+	{
+		uint8_t  Index  = MSInterfaceInfo->State.Pipe.Stored;
+		uint32_t Blocks = MSInterfaceInfo->State.Pipe.Blocks;
+		uint32_t Start  = DWT->CYCCNT;
+		bool     Success;
+
+		if (Blocks > PerBuffer)
+		  Blocks = PerBuffer;
+
+		Success = CALLBACK_MS_Device_ReadBlocks(MSInterfaceInfo, MSInterfaceInfo->State.Pipe.LBA, Blocks,
+												MS_Device_Buffer(MSInterfaceInfo, Index));
+		MSInterfaceInfo->State.Stats.StorageCycles += DWT->CYCCNT - Start;
+
+		HAL_DisableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+		if (Success)
+		{
+			MSInterfaceInfo->State.Pipe.Length[Index & (MSInterfaceInfo->Config.BufferCount - 1)] =
+				Blocks * MSInterfaceInfo->State.Pipe.BlockSize;
+			MSInterfaceInfo->State.Pipe.LBA    += Blocks;
+			MSInterfaceInfo->State.Pipe.Blocks -= Blocks;
+			MSInterfaceInfo->State.Pipe.Stored  = Index + 1;
+			MS_Device_Kick(MSInterfaceInfo);
+		}
+		else
+		{
+			/* Send what was read, the residue tells the host the rest is missing */
+			MSInterfaceInfo->State.Stats.StorageErrors++;
+			MSInterfaceInfo->State.Pipe.Failed = true;
+			MSInterfaceInfo->State.Pipe.Blocks = 0;
+		}
+		MS_Device_CheckDataDone(MSInterfaceInfo);
+		HAL_EnableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+	}
+}
+
+/* Writes every received buffer out and hands it back to the wire */
+static void MS_Device_DrainBuffers(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	while (MSInterfaceInfo->State.Pipe.Stored != MSInterfaceInfo->State.Pipe.Transferred)
+	{
+		uint8_t  Index  = MSInterfaceInfo->State.Pipe.Stored;
+		uint32_t Blocks = MSInterfaceInfo->State.Pipe.Length[Index & (MSInterfaceInfo->Config.BufferCount - 1)] /
+						  MSInterfaceInfo->State.Pipe.BlockSize;
+
+		/* After a failure the host data is still taken in, then the command fails */
+		if (Blocks && !(MSInterfaceInfo->State.Pipe.Failed))
+		{
+			uint32_t Start = DWT->CYCCNT;
+
+			if (!(CALLBACK_MS_Device_WriteBlocks(MSInterfaceInfo, MSInterfaceInfo->State.Pipe.LBA, Blocks,
+												 MS_Device_Buffer(MSInterfaceInfo, Index))))
+			{
+				MSInterfaceInfo->State.Stats.StorageErrors++;
+				MSInterfaceInfo->State.Pipe.Failed = true;
+			}
+			MSInterfaceInfo->State.Stats.StorageCycles += DWT->CYCCNT - Start;
+		}
+		MSInterfaceInfo->State.Pipe.LBA += Blocks;
+
+		HAL_DisableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+		MSInterfaceInfo->State.Pipe.Stored = Index + 1;
+		MS_Device_Kick(MSInterfaceInfo);
+		MS_Device_CheckDataDone(MSInterfaceInfo);
+		HAL_EnableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+	}
+
+	HAL_DisableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+	MS_Device_CheckDataDone(MSInterfaceInfo);
+	HAL_EnableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+}
+
+static void MS_Device_BuildStatus(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	bool Result = MSInterfaceInfo->State.Pipe.Result && !(MSInterfaceInfo->State.Pipe.Failed);
+
+	MSInterfaceInfo->State.CommandStatus.Status              = (Result) ? MS_SCSI_COMMAND_Pass : MS_SCSI_COMMAND_Fail;
+	MSInterfaceInfo->State.CommandStatus.Signature           = CPU_TO_LE32(MS_CSW_SIGNATURE);
+	MSInterfaceInfo->State.CommandStatus.Tag                 = MSInterfaceInfo->State.CommandBlock.Tag;
+	MSInterfaceInfo->State.CommandStatus.DataTransferResidue = MSInterfaceInfo->State.CommandBlock.DataTransferLength;
+
+	if (!(Result) && (le32_to_cpu(MSInterfaceInfo->State.CommandStatus.DataTransferResidue)))
+	{
+		Endpoint_SelectEndpoint(MSInterfaceInfo->Config.PortNumber,
+								(MSInterfaceInfo->State.CommandBlock.Flags & MS_COMMAND_DIR_DATA_IN) ?
+								MSInterfaceInfo->Config.DataINEndpointNumber : MSInterfaceInfo->Config.DataOUTEndpointNumber);
+		Endpoint_StallTransaction(MSInterfaceInfo->Config.PortNumber);
+	}
+
+	MSInterfaceInfo->State.Pipe.Stage = MS_STAGE_StatusWait;
+}
+
+static void MS_Device_SendStatus(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	Endpoint_SelectEndpoint(MSInterfaceInfo->Config.PortNumber, MSInterfaceInfo->Config.DataOUTEndpointNumber);
+	if (Endpoint_IsStalled(MSInterfaceInfo->Config.PortNumber))
+	  return;
+
+	Endpoint_SelectEndpoint(MSInterfaceInfo->Config.PortNumber, MSInterfaceInfo->Config.DataINEndpointNumber);
+	if (Endpoint_IsStalled(MSInterfaceInfo->Config.PortNumber))
+	  return;
+
+	memcpy(MSInterfaceInfo->Config.DataBuffers, &MSInterfaceInfo->State.CommandStatus, sizeof(MS_CommandStatusWrapper_t));
+
+	HAL_DisableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+	MSInterfaceInfo->State.Pipe.Stage = MS_STAGE_StatusSent;
+	MSInterfaceInfo->State.Pipe.Busy  = true;
+	Endpoint_StartTransfer(MSInterfaceInfo->Config.PortNumber,
+						   MSInterfaceInfo->Config.DataINEndpointNumber | ENDPOINT_DIR_IN,
+						   MSInterfaceInfo->Config.DataBuffers, sizeof(MS_CommandStatusWrapper_t));
+	HAL_EnableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+}
+
+static void MS_Device_PipeTask(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	/* Stages only move forward here, so one pass can run several of them */
+	if (MSInterfaceInfo->State.Pipe.Stage == MS_STAGE_Process)
+	  MS_Device_ProcessCommand(MSInterfaceInfo);
+
+	if (MSInterfaceInfo->State.Pipe.Stage == MS_STAGE_DataIN)
+	  MS_Device_FillBuffers(MSInterfaceInfo);
+	else if (MSInterfaceInfo->State.Pipe.Stage == MS_STAGE_DataOUT)
+	  MS_Device_DrainBuffers(MSInterfaceInfo);
+
+	if (MSInterfaceInfo->State.Pipe.Stage == MS_STAGE_Status)
+	  MS_Device_BuildStatus(MSInterfaceInfo);
+
+	if (MSInterfaceInfo->State.Pipe.Stage == MS_STAGE_StatusWait)
+	  MS_Device_SendStatus(MSInterfaceInfo);
+}
+
+static void MS_Device_PipeReset(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	HAL_DisableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+	Endpoint_AbortTransfer(MSInterfaceInfo->Config.PortNumber, MSInterfaceInfo->Config.DataINEndpointNumber | ENDPOINT_DIR_IN);
+	Endpoint_AbortTransfer(MSInterfaceInfo->Config.PortNumber, MSInterfaceInfo->Config.DataOUTEndpointNumber | ENDPOINT_DIR_OUT);
+	MSInterfaceInfo->State.Pipe.Busy = false;
+	MS_Device_PrimeCommand(MSInterfaceInfo);
+	HAL_EnableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+}
+
+bool MS_Device_QueueBlocks(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+						   const uint32_t BlockAddress,
+						   const uint32_t TotalBlocks,
+						   const uint16_t BlockSize)
+{
+	uint32_t Blocks;
+
+	if ((MSInterfaceInfo->Config.DataBuffers == NULL) || (MSInterfaceInfo->State.Pipe.Stage != MS_STAGE_Process) ||
+		!(BlockSize))
+	  return false;
+
+	Blocks = le32_to_cpu(MSInterfaceInfo->State.CommandBlock.DataTransferLength) / BlockSize;
+	if (Blocks > TotalBlocks)
+	  Blocks = TotalBlocks;
+	if (!(Blocks))
+	  return true;
+
+	MSInterfaceInfo->State.Pipe.LBA       = BlockAddress;
+	MSInterfaceInfo->State.Pipe.Blocks    = Blocks;
+	MSInterfaceInfo->State.Pipe.BlockSize = BlockSize;
+
+	HAL_DisableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+	if (MSInterfaceInfo->State.CommandBlock.Flags & MS_COMMAND_DIR_DATA_IN)
+	{
+		/* MS_Device_FillBuffers() starts the wire once the first buffer is read */
+		MSInterfaceInfo->State.Pipe.Stage = MS_STAGE_DataIN;
+	}
+	else
+	{
+		/* Receive into every buffer straight away */
+		MSInterfaceInfo->State.Pipe.Bytes = Blocks * BlockSize;
+		MSInterfaceInfo->State.Pipe.Stage = MS_STAGE_DataOUT;
+		MS_Device_Kick(MSInterfaceInfo);
+	}
+	HAL_EnableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+
+	return true;
+}
+
+bool MS_Device_QueueResponse(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+							 const void *const Data,
+							 const uint16_t Length)
+{
+	uint32_t Size = Length;
+
+	if ((MSInterfaceInfo->Config.DataBuffers == NULL) || (MSInterfaceInfo->State.Pipe.Stage != MS_STAGE_Process) ||
+		!(MSInterfaceInfo->State.CommandBlock.Flags & MS_COMMAND_DIR_DATA_IN))
+	  return false;
+
+	if (Size > le32_to_cpu(MSInterfaceInfo->State.CommandBlock.DataTransferLength))
+	  Size = le32_to_cpu(MSInterfaceInfo->State.CommandBlock.DataTransferLength);
+	if (Size > MSInterfaceInfo->Config.BufferSize)
+	  Size = MSInterfaceInfo->Config.BufferSize;
+	if (!(Size))
+	  return true;
+
+	memcpy(MSInterfaceInfo->Config.DataBuffers, Data, Size);
+
+	HAL_DisableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+	MSInterfaceInfo->State.Pipe.Length[0] = Size;
+	MSInterfaceInfo->State.Pipe.Stored    = 1;
+	MSInterfaceInfo->State.Pipe.Stage     = MS_STAGE_DataIN;
+	MS_Device_Kick(MSInterfaceInfo);
+	HAL_EnableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+
+	return true;
+}
+
+bool MS_Device_TransferComplete(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+								const int logicalEP,
+								const int xfer_in)
+{
+	uint32_t Length;
+	uint8_t  Index;
+
+	if ((MSInterfaceInfo->Config.DataBuffers == NULL) || !(MSInterfaceInfo->State.Pipe.Busy) ||
+		(logicalEP != (xfer_in ? MSInterfaceInfo->Config.DataINEndpointNumber : MSInterfaceInfo->Config.DataOUTEndpointNumber)))
+	  return false;
+
+	Length = Endpoint_GetTransferLength(MSInterfaceInfo->Config.PortNumber,
+										logicalEP | (xfer_in ? ENDPOINT_DIR_IN : ENDPOINT_DIR_OUT));
+	MSInterfaceInfo->State.Pipe.Busy = false;
+
+	switch (MSInterfaceInfo->State.Pipe.Stage)
+	{
+		case MS_STAGE_Command:
+			MSInterfaceInfo->State.Pipe.Length[0] = Length;
+			MSInterfaceInfo->State.Pipe.Stage     = MS_STAGE_Process;
+			break;
+		case MS_STAGE_DataIN:
+			MSInterfaceInfo->State.CommandBlock.DataTransferLength -= Length;
+			MSInterfaceInfo->State.Stats.BytesIn += Length;
+			MSInterfaceInfo->State.Stats.Transfers++;
+			MSInterfaceInfo->State.Pipe.Transferred++;
+
+			if ((MSInterfaceInfo->State.Pipe.Transferred == MSInterfaceInfo->State.Pipe.Stored) &&
+				MSInterfaceInfo->State.Pipe.Blocks)
+			  MSInterfaceInfo->State.Stats.WireIdle++;
+
+			MS_Device_Kick(MSInterfaceInfo);
+			MS_Device_CheckDataDone(MSInterfaceInfo);
+			break;
+		case MS_STAGE_DataOUT:
+			Index = MSInterfaceInfo->State.Pipe.Transferred & (MSInterfaceInfo->Config.BufferCount - 1);
+
+			/* A short packet ends the host data early */
+			if (Length < MSInterfaceInfo->State.Pipe.Length[Index])
+			  MSInterfaceInfo->State.Pipe.Bytes = 0;
+
+			MSInterfaceInfo->State.Pipe.Length[Index] = Length;
+			MSInterfaceInfo->State.CommandBlock.DataTransferLength -= Length;
+			MSInterfaceInfo->State.Stats.BytesOut += Length;
+			MSInterfaceInfo->State.Stats.Transfers++;
+			MSInterfaceInfo->State.Pipe.Transferred++;
+
+			MS_Device_Kick(MSInterfaceInfo);
+			if (!(MSInterfaceInfo->State.Pipe.Busy) && MSInterfaceInfo->State.Pipe.Bytes)
+			  MSInterfaceInfo->State.Stats.BufferStalls++;
+			break;
+		case MS_STAGE_StatusSent:
+			MS_Device_PrimeCommand(MSInterfaceInfo);
+			break;
+		default:
+			break;
+	}
+
+	return true;
+}
+
+void MS_Device_GetStats(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+						MS_Device_Stats_t *const Stats)
+{
+	HAL_DisableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+	*Stats = MSInterfaceInfo->State.Stats;
+	HAL_EnableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+}
+
+bool MS_Device_ReadBlocks_Stub(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo, const uint32_t BlockAddress,
+							   const uint32_t TotalBlocks, uint8_t *const Buffer)
+{
+	return false;
+}
+
+bool MS_Device_WriteBlocks_Stub(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo, const uint32_t BlockAddress,
+								const uint32_t TotalBlocks, const uint8_t *const Buffer)
+{
+	return false;
+}
+#endif
+
 void MS_Device_ProcessControlRequest(USB_ClassInfo_MS_Device_t* const MSInterfaceInfo)
 {
 	if (!(Endpoint_IsSETUPReceived(MSInterfaceInfo->Config.PortNumber)))
@@ -75,7 +490,13 @@ void MS_Device_ProcessControlRequest(USB_ClassInfo_MS_Device_t* const MSInterfac
 
 bool MS_Device_ConfigureEndpoints(USB_ClassInfo_MS_Device_t* const MSInterfaceInfo)
 {
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	HAL_DisableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+	memset(&MSInterfaceInfo->State, 0x00, sizeof(MSInterfaceInfo->State));
+	HAL_EnableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+#else
 	memset(&MSInterfaceInfo->State, 0x00, sizeof(MSInterfaceInfo->State));
+#endif
 
 	for (uint8_t EndpointNum = 1; EndpointNum < ENDPOINT_TOTAL_ENDPOINTS(MSInterfaceInfo->Config.PortNumber); EndpointNum++)
 	{
@@ -110,6 +531,15 @@ bool MS_Device_ConfigureEndpoints(USB_ClassInfo_MS_Device_t* const MSInterfaceIn
 		}
 	}
 
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (MSInterfaceInfo->Config.DataBuffers != NULL)
+	{
+		HAL_DisableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+		MS_Device_PrimeCommand(MSInterfaceInfo);
+		HAL_EnableUSBInterrupt(MSInterfaceInfo->Config.PortNumber);
+	}
+#endif
+
 	return true;
 }
 
@@ -118,6 +548,27 @@ void MS_Device_USBTask(USB_ClassInfo_MS_Device_t* const MSInterfaceInfo)
 	if (USB_DeviceState[MSInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured)
 	  return;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (MSInterfaceInfo->Config.DataBuffers != NULL)
+	{
+		if (MSInterfaceInfo->State.IsMassStoreReset)
+		{
+			Endpoint_SelectEndpoint(MSInterfaceInfo->Config.PortNumber, MSInterfaceInfo->Config.DataOUTEndpointNumber);
+			Endpoint_ClearStall(MSInterfaceInfo->Config.PortNumber);
+			Endpoint_ResetDataToggle(MSInterfaceInfo->Config.PortNumber);
+			Endpoint_SelectEndpoint(MSInterfaceInfo->Config.PortNumber, MSInterfaceInfo->Config.DataINEndpointNumber);
+			Endpoint_ClearStall(MSInterfaceInfo->Config.PortNumber);
+			Endpoint_ResetDataToggle(MSInterfaceInfo->Config.PortNumber);
+
+			MSInterfaceInfo->State.IsMassStoreReset = false;
+			MS_Device_PipeReset(MSInterfaceInfo);
+		}
+
+		MS_Device_PipeTask(MSInterfaceInfo);
+		return;
+	}
+	#endif
+
 	Endpoint_SelectEndpoint(MSInterfaceInfo->Config.PortNumber, MSInterfaceInfo->Config.DataOUTEndpointNumber);
 
 	if (Endpoint_IsReadWriteAllowed(MSInterfaceInfo->Config.PortNumber))
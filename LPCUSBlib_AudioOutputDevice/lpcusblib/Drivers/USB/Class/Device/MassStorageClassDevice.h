@@ -61,7 +61,49 @@ extern "C" {
 		#endif
 
 /* Public Interface - May be used in end-application: */
+/* Macros: */
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/** Largest number of sector buffers the pipelined data phase cycles through. */
+#define MS_DEVICE_MAX_BUFFERS   4
+/** Largest sector buffer, the data phase engine moves one buffer per transfer descriptor. */
+#define MS_DEVICE_MAX_TRANSFER  16384
+#endif
+
+/* Enums: */
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/**
+ * @brief Bulk-only transport stages of the pipelined command engine.
+ */
+enum MS_Device_Stages_t {
+	MS_STAGE_Command = 0,		/**< CBW transfer primed, waiting for the host. */
+	MS_STAGE_Process,			/**< CBW received, waiting for @ref MS_Device_USBTask() to run the SCSI callback. */
+	MS_STAGE_DataIN,			/**< Blocks or a response are moving to the host. */
+	MS_STAGE_DataOUT,			/**< Blocks are moving from the host to the backing store. */
+	MS_STAGE_Status,			/**< Data phase over, the CSW is built and failed data phases stall their endpoint. */
+	MS_STAGE_StatusWait,		/**< CSW waits for the host to clear the endpoint stalls. */
+	MS_STAGE_StatusSent,		/**< CSW transfer primed. */
+	MS_STAGE_Error,				/**< Invalid CBW, both endpoints stay stalled until reset recovery. */
+};
+#endif
+
 /* Type Defines: */
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/**
+ * @brief Data phase engine counters, read with @ref MS_Device_GetStats(). All counters restart from zero
+ *  when the interface is configured.
+ */
+typedef struct {
+	uint32_t Commands;			/**< CBWs accepted. */
+	uint32_t BytesIn;			/**< Data phase bytes sent to the host. */
+	uint32_t BytesOut;			/**< Data phase bytes received from the host. */
+	uint32_t Transfers;			/**< Data phase transfers, one per sector buffer. */
+	uint32_t WireIdle;			/**< IN endpoint went idle waiting for the backing store. */
+	uint32_t BufferStalls;		/**< OUT endpoint left NAKing waiting for a free sector buffer. */
+	uint32_t StorageErrors;		/**< Block callbacks that returned \c false. */
+	uint32_t StorageCycles;		/**< Core cycles spent in the block callbacks. */
+} MS_Device_Stats_t;
+#endif
+
 /**
  * @brief Mass Storage Class Device Mode Configuration and State Structure.
  *
@@ -83,6 +125,15 @@ typedef struct {
 
 		uint8_t  TotalLUNs;				/**< Total number of logical drives in the Mass Storage interface. */
 		uint8_t  PortNumber;				/**< Port number that this interface is running.*/
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+		uint8_t  *DataBuffers;				/**< \c BufferCount sector buffers back to back, word aligned, or \c NULL to stream
+											 *   the data phase from the SCSI callback.
+											 */
+		uint32_t BufferSize;				/**< Size of one sector buffer, a multiple of the block size and of the endpoint
+											 *   sizes, at most @ref MS_DEVICE_MAX_TRANSFER.
+											 */
+		uint8_t  BufferCount;				/**< Number of sector buffers, 2 or @ref MS_DEVICE_MAX_BUFFERS. */
+#endif
 	} Config;				/**< Config data for the USB class interface within the device. All elements in this section
 							 *   <b>must</b> be set or the interface will fail to enumerate and operate correctly.
 							 */
@@ -97,6 +148,23 @@ typedef struct {
 		volatile bool IsMassStoreReset;				/**< Flag indicating that the host has requested that the Mass Storage interface be reset
 													 *   and that all current Mass Storage operations should immediately abort.
 													 */
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+		struct {
+			volatile uint8_t Stage;			/**< Current @ref MS_Device_Stages_t value. */
+			volatile bool    Busy;			/**< A transfer is queued on one of the data endpoints. */
+			bool     Result;				/**< Return value of the SCSI callback. */
+			bool     Failed;				/**< A block callback failed, the data phase ends short. */
+			uint32_t LBA;					/**< Next block handed to the backing store. */
+			uint32_t Blocks;				/**< Blocks still to pass through the backing store. */
+			uint32_t Bytes;					/**< OUT bytes not yet asked from the controller. */
+			uint16_t BlockSize;				/**< Block size of the current data phase. */
+			volatile uint8_t Stored;		/**< Buffers filled (IN) or emptied (OUT) by the backing store, main loop owned. */
+			volatile uint8_t Queued;		/**< Buffers handed to the controller. */
+			volatile uint8_t Transferred;	/**< Buffers the controller is done with, interrupt owned. */
+			uint32_t Length[MS_DEVICE_MAX_BUFFERS];	/**< Bytes held by each buffer. */
+		} Pipe;							/**< Pipelined data phase state, used when \c DataBuffers is set. */
+		MS_Device_Stats_t Stats;		/**< Data phase engine counters. */
+#endif
 	} State;			/**< State data for the USB class interface within the device. All elements in this section
 						 *   are reset to their defaults when the interface is enumerated.
 						 */
@@ -145,6 +213,98 @@ void MS_Device_USBTask(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo) ATTR_NO
  */
 bool CALLBACK_MS_Device_SCSICommandReceived(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
 
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/**
+ * @brief	Hands a READ or WRITE data phase to the pipelined engine. Call it from
+ *  @ref CALLBACK_MS_Device_SCSICommandReceived() instead of streaming the blocks, then return \c true. The
+ *  direction comes from the CBW. While one sector buffer is on the wire the next one is read from or written
+ *  to the backing store through @ref CALLBACK_MS_Device_ReadBlocks() and @ref CALLBACK_MS_Device_WriteBlocks(),
+ *  and the CSW follows the last buffer.
+ *
+ * @param	MSInterfaceInfo	: Pointer to a structure containing a Mass Storage Class configuration and state.
+ * @param	BlockAddress	: First block of the transfer.
+ * @param	TotalBlocks		: Number of blocks, clipped to the CBW data length.
+ * @param	BlockSize		: Block size in bytes, must divide \c BufferSize.
+ *
+ * @return	Boolean \c false if the interface has no sector buffers.
+ */
+bool MS_Device_QueueBlocks(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+						   const uint32_t BlockAddress,
+						   const uint32_t TotalBlocks,
+						   const uint16_t BlockSize) ATTR_NON_NULL_PTR_ARG(1);
+
+/**
+ * @brief	Queues a short data IN response such as INQUIRY or READ CAPACITY data. Call it from
+ *  @ref CALLBACK_MS_Device_SCSICommandReceived() in place of writing the IN endpoint.
+ *
+ * @param	MSInterfaceInfo	: Pointer to a structure containing a Mass Storage Class configuration and state.
+ * @param	Data			: Response, copied before the function returns.
+ * @param	Length			: Response length, clipped to the CBW data length and \c BufferSize.
+ *
+ * @return	Boolean \c false if the interface has no sector buffers.
+ */
+bool MS_Device_QueueResponse(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+							 const void *const Data,
+							 const uint16_t Length) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+
+/**
+ * @brief	Data phase engine completion handler, call it from @ref EVENT_USB_Device_PortTransferComplete() for every
+ *  completion on the interface's port. Keeps the wire busy with the next ready buffer without waiting for the
+ *  main loop.
+ *
+ * @param	MSInterfaceInfo	: Pointer to a structure containing a Mass Storage Class configuration and state.
+ * @param	logicalEP		: Logical endpoint number of the completion.
+ * @param	xfer_in			: Non zero for an IN completion.
+ *
+ * @return	Boolean \c true if the completion belonged to the interface, @ref MS_Device_USBTask() then has work to do.
+ */
+bool MS_Device_TransferComplete(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+								const int logicalEP,
+								const int xfer_in) ATTR_NON_NULL_PTR_ARG(1);
+
+/**
+ * @brief	Copies the data phase engine counters.
+ *
+ * @param	MSInterfaceInfo	: Pointer to a structure containing a Mass Storage Class configuration and state.
+ * @param	Stats			: Where the counters are copied.
+ * @return	Nothing
+ */
+void MS_Device_GetStats(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+						MS_Device_Stats_t *const Stats) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+
+/**
+ * @brief	Mass Storage class driver callback reading blocks from the backing store into a sector buffer. Runs from
+ *  @ref MS_Device_USBTask() while the previous buffer is on the wire.
+ *
+ * @param	MSInterfaceInfo	: Pointer to a structure containing a Mass Storage Class configuration and state.
+ * @param	BlockAddress	: First block to read.
+ * @param	TotalBlocks		: Number of blocks to read.
+ * @param	Buffer			: Destination sector buffer.
+ *
+ * @return	Boolean \c true on success, \c false ends the data phase and fails the command.
+ */
+bool CALLBACK_MS_Device_ReadBlocks(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+								   const uint32_t BlockAddress,
+								   const uint32_t TotalBlocks,
+								   uint8_t *const Buffer);
+
+/**
+ * @brief	Mass Storage class driver callback writing blocks of a sector buffer to the backing store. Runs from
+ *  @ref MS_Device_USBTask() while the next buffer is being received.
+ *
+ * @param	MSInterfaceInfo	: Pointer to a structure containing a Mass Storage Class configuration and state.
+ * @param	BlockAddress	: First block to write.
+ * @param	TotalBlocks		: Number of blocks to write.
+ * @param	Buffer			: Source sector buffer.
+ *
+ * @return	Boolean \c true on success, \c false fails the command once the host has sent its data.
+ */
+bool CALLBACK_MS_Device_WriteBlocks(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+									const uint32_t BlockAddress,
+									const uint32_t TotalBlocks,
+									const uint8_t *const Buffer);
+#endif
+
 /* Private Interface - For use in library only: */
 	#if !defined(__DOXYGEN__)
 /* Function Prototypes: */
@@ -153,6 +313,24 @@ static void MS_Device_ReturnCommandStatus(USB_ClassInfo_MS_Device_t *const MSInt
 
 static bool MS_Device_ReadInCommandBlock(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
 
+				#if defined(__LPC18XX__) || defined(__LPC43XX__)
+bool MS_Device_ReadBlocks_Stub(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo, const uint32_t BlockAddress,
+							   const uint32_t TotalBlocks, uint8_t *const Buffer);
+bool MS_Device_WriteBlocks_Stub(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo, const uint32_t BlockAddress,
+								const uint32_t TotalBlocks, const uint8_t *const Buffer);
+
+PRAGMA_WEAK(CALLBACK_MS_Device_ReadBlocks,MS_Device_ReadBlocks_Stub)
+bool CALLBACK_MS_Device_ReadBlocks(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+								   const uint32_t BlockAddress,
+								   const uint32_t TotalBlocks,
+								   uint8_t *const Buffer) ATTR_WEAK ATTR_ALIAS(MS_Device_ReadBlocks_Stub);
+PRAGMA_WEAK(CALLBACK_MS_Device_WriteBlocks,MS_Device_WriteBlocks_Stub)
+bool CALLBACK_MS_Device_WriteBlocks(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+									const uint32_t BlockAddress,
+									const uint32_t TotalBlocks,
+									const uint8_t *const Buffer) ATTR_WEAK ATTR_ALIAS(MS_Device_WriteBlocks_Stub);
+				#endif
+
 			#endif
 
 	#endif
@@ -70,6 +70,281 @@ static uint32_t PROGMEM AdapterSupportedOIDList[]  =
 		CPU_TO_LE32(OID_802_3_XMIT_MORE_COLLISIONS),
 	};
 
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/* Frame engine. Every pool slot has one descriptor and is owned by the
+   engine (OUT endpoint, receive queue, transmit queue), by the application or
+   by nobody (free stack). The OUT endpoint always receives a whole packet
+   message into a free slot and the header is stripped by moving Offset past
+   it; frames to the host get their header written into the headroom in front
+   of them. The USB interrupt moves slots between the endpoints and the queues,
+   the main loop side runs with the port interrupt masked. */
+
+#define RNDIS_FRAME_FREE    0
+#define RNDIS_FRAME_ENGINE  1
+#define RNDIS_FRAME_APP     2
+
+static RNDIS_Device_Frame_t *RNDIS_Device_PopFree(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo)
+{
+	RNDIS_Device_Frame_t *Frame;
+
+	if (!(RNDISInterfaceInfo->State.Queue.FreeCount))
+	  return NULL;
+
+	Frame = &RNDISInterfaceInfo->State.Queue.Frames[RNDISInterfaceInfo->State.Queue.Free[--RNDISInterfaceInfo->State.Queue.FreeCount]];
+
+	if (RNDISInterfaceInfo->State.Queue.FreeCount < RNDISInterfaceInfo->State.Stats.PoolLow)
+	  RNDISInterfaceInfo->State.Stats.PoolLow = RNDISInterfaceInfo->State.Queue.FreeCount;
+
+	Frame->Offset = RNDIS_DEVICE_FRAME_HEADROOM;
+	Frame->Length = 0;
+	return Frame;
+}
+
+/* Queues a free slot on the OUT endpoint if it is idle. USB interrupt, or port interrupt masked */
+static void RNDIS_Device_PrimeRx(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo)
+{
+	RNDIS_Device_Frame_t *Frame;
+
+	if (RNDISInterfaceInfo->State.Queue.RxBusy)
+	  return;
+
+	if ((Frame = RNDIS_Device_PopFree(RNDISInterfaceInfo)) == NULL)
+	{
+		if (!(RNDISInterfaceInfo->State.Queue.RxStarved))
+		  RNDISInterfaceInfo->State.Stats.RxStarved++;
+
+		RNDISInterfaceInfo->State.Queue.RxStarved = true;
+		return;
+	}
+
+	Frame->Owner = RNDIS_FRAME_ENGINE;
+	RNDISInterfaceInfo->State.Queue.RxStarved = false;
+	RNDISInterfaceInfo->State.Queue.RxBusy    = true;
+	RNDISInterfaceInfo->State.Queue.RxFrame   = Frame - RNDISInterfaceInfo->State.Queue.Frames;
+	Endpoint_StartTransfer(RNDISInterfaceInfo->Config.PortNumber,
+						   RNDISInterfaceInfo->Config.DataOUTEndpointNumber | ENDPOINT_DIR_OUT,
+						   Frame->Buffer, RNDIS_DEVICE_FRAME_SIZE);
+}
+
+static void RNDIS_Device_PushFree(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo,
+								  RNDIS_Device_Frame_t *const Frame)
+{
+	Frame->Owner = RNDIS_FRAME_FREE;
+	RNDISInterfaceInfo->State.Queue.Free[RNDISInterfaceInfo->State.Queue.FreeCount++] =
+		Frame - RNDISInterfaceInfo->State.Queue.Frames;
+
+	if (RNDISInterfaceInfo->State.Queue.RxStarved)
+	  RNDIS_Device_PrimeRx(RNDISInterfaceInfo);
+}
+
+/* Puts the next queued frame on the IN endpoint if it is idle. USB interrupt, or port interrupt masked */
+static void RNDIS_Device_KickTx(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo)
+{
+	RNDIS_Device_Frame_t *Frame;
+	uint32_t Length;
+
+	if (RNDISInterfaceInfo->State.Queue.TxBusy ||
+		(RNDISInterfaceInfo->State.Queue.TxHead == RNDISInterfaceInfo->State.Queue.TxTail))
+	  return;
+
+	Frame  = &RNDISInterfaceInfo->State.Queue.Frames[RNDISInterfaceInfo->State.Queue.Tx[RNDISInterfaceInfo->State.Queue.TxTail &
+																						  (RNDIS_DEVICE_MAX_FRAMES - 1)]];
+	Length = le32_to_cpu(((RNDIS_Packet_Message_t *) &Frame->Buffer[Frame->Offset - RNDIS_DEVICE_FRAME_HEADROOM])->MessageLength);
+
+	RNDISInterfaceInfo->State.Queue.TxBusy = true;
+	Endpoint_StartTransfer(RNDISInterfaceInfo->Config.PortNumber,
+						   RNDISInterfaceInfo->Config.DataINEndpointNumber | ENDPOINT_DIR_IN,
+						   &Frame->Buffer[Frame->Offset - RNDIS_DEVICE_FRAME_HEADROOM], Length);
+}
+
+/* Checks a packet message received into Frame and strips its header in place */
+static bool RNDIS_Device_StripHeader(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo,
+									 RNDIS_Device_Frame_t *const Frame,
+									 const uint32_t Received)
+{
+	RNDIS_Packet_Message_t *Header = (RNDIS_Packet_Message_t *) Frame->Buffer;
+	uint32_t DataOffset;
+	uint32_t DataLength;
+
+	if ((RNDISInterfaceInfo->State.CurrRNDISState != RNDIS_Data_Initialized) ||
+		(Received < sizeof(RNDIS_Packet_Message_t)) ||
+		(le32_to_cpu(Header->MessageType) != REMOTE_NDIS_PACKET_MSG))
+	{
+		return false;
+	}
+
+	DataOffset = le32_to_cpu(Header->DataOffset) + sizeof(RNDIS_Message_Header_t);
+	DataLength = le32_to_cpu(Header->DataLength);
+
+	if (!(DataLength) || (DataLength > ETHERNET_FRAME_SIZE_MAX) || (DataOffset > Received) ||
+		(DataLength > (Received - DataOffset)))
+	{
+		return false;
+	}
+
+	Frame->Offset = DataOffset;
+	Frame->Length = DataLength;
+	return true;
+}
+
+RNDIS_Device_Frame_t *RNDIS_Device_AllocFrame(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo)
+{
+	RNDIS_Device_Frame_t *Frame;
+
+	if (RNDISInterfaceInfo->Config.FramePool == NULL)
+	  return NULL;
+
+	HAL_DisableUSBInterrupt(RNDISInterfaceInfo->Config.PortNumber);
+	if ((Frame = RNDIS_Device_PopFree(RNDISInterfaceInfo)) != NULL)
+	  Frame->Owner = RNDIS_FRAME_APP;
+	HAL_EnableUSBInterrupt(RNDISInterfaceInfo->Config.PortNumber);
+
+	return Frame;
+}
+
+void RNDIS_Device_FreeFrame(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo,
+							RNDIS_Device_Frame_t *const Frame)
+{
+	HAL_DisableUSBInterrupt(RNDISInterfaceInfo->Config.PortNumber);
+	if (Frame->Owner == RNDIS_FRAME_APP)
+	  RNDIS_Device_PushFree(RNDISInterfaceInfo, Frame);
+	HAL_EnableUSBInterrupt(RNDISInterfaceInfo->Config.PortNumber);
+}
+
+RNDIS_Device_Frame_t *RNDIS_Device_ReceiveFrame(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo)
+{
+	RNDIS_Device_Frame_t *Frame;
+	uint8_t Tail = RNDISInterfaceInfo->State.Queue.RxTail;
+
+	if ((RNDISInterfaceInfo->Config.FramePool == NULL) || (Tail == RNDISInterfaceInfo->State.Queue.RxHead))
+	  return NULL;
+
+	Frame = &RNDISInterfaceInfo->State.Queue.Frames[RNDISInterfaceInfo->State.Queue.Rx[Tail & (RNDIS_DEVICE_MAX_FRAMES - 1)]];
+	Frame->Owner = RNDIS_FRAME_APP;
+	RNDISInterfaceInfo->State.Queue.RxTail = Tail + 1;
+
+	return Frame;
+}
+
+bool RNDIS_Device_SendFrame(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo,
+							RNDIS_Device_Frame_t *const Frame)
+{
+	RNDIS_Packet_Message_t *Header;
+	uint32_t Length = RNDIS_DEVICE_FRAME_HEADROOM + Frame->Length;
+
+	/* A transfer ending on a packet boundary gets a pad byte, RNDIS hosts take it in place of a ZLP */
+	if (!(Length % RNDISInterfaceInfo->Config.DataINEndpointSize))
+	  Length++;
+
+	if ((Frame->Owner != RNDIS_FRAME_APP) ||
+		(USB_DeviceState[RNDISInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) ||
+		(RNDISInterfaceInfo->State.CurrRNDISState != RNDIS_Data_Initialized) ||
+		!(Frame->Length) || (Frame->Length > ETHERNET_FRAME_SIZE_MAX) ||
+		(Frame->Offset < RNDIS_DEVICE_FRAME_HEADROOM) ||
+		((Frame->Offset - RNDIS_DEVICE_FRAME_HEADROOM + Length) > RNDIS_DEVICE_FRAME_SIZE))
+	{
+		RNDISInterfaceInfo->State.Stats.TxRejected++;
+		return false;
+	}
+
+	Header = (RNDIS_Packet_Message_t *) &Frame->Buffer[Frame->Offset - RNDIS_DEVICE_FRAME_HEADROOM];
+	memset(Header, 0, sizeof(RNDIS_Packet_Message_t));
+	Header->MessageType   = CPU_TO_LE32(REMOTE_NDIS_PACKET_MSG);
+	Header->MessageLength = cpu_to_le32(Length);
+	Header->DataOffset    = CPU_TO_LE32(sizeof(RNDIS_Packet_Message_t) - sizeof(RNDIS_Message_Header_t));
+	Header->DataLength    = cpu_to_le32(Frame->Length);
+
+	HAL_DisableUSBInterrupt(RNDISInterfaceInfo->Config.PortNumber);
+	Frame->Owner = RNDIS_FRAME_ENGINE;
+	RNDISInterfaceInfo->State.Queue.Tx[RNDISInterfaceInfo->State.Queue.TxHead & (RNDIS_DEVICE_MAX_FRAMES - 1)] =
+		Frame - RNDISInterfaceInfo->State.Queue.Frames;
+	RNDISInterfaceInfo->State.Queue.TxHead++;
+	RNDIS_Device_KickTx(RNDISInterfaceInfo);
+	HAL_EnableUSBInterrupt(RNDISInterfaceInfo->Config.PortNumber);
+
+	return true;
+}
+
+bool RNDIS_Device_TransferComplete(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo,
+								   const int logicalEP,
+								   const int xfer_in)
+{
+	RNDIS_Device_Frame_t *Frame;
+	uint32_t Length;
+
+	if (RNDISInterfaceInfo->Config.FramePool == NULL)
+	  return false;
+
+	if (xfer_in && (logicalEP == RNDISInterfaceInfo->Config.DataINEndpointNumber) &&
+		RNDISInterfaceInfo->State.Queue.TxBusy)
+	{
+		Frame = &RNDISInterfaceInfo->State.Queue.Frames[RNDISInterfaceInfo->State.Queue.Tx[RNDISInterfaceInfo->State.Queue.TxTail &
+																							 (RNDIS_DEVICE_MAX_FRAMES - 1)]];
+		RNDISInterfaceInfo->State.Queue.TxBusy = false;
+		RNDISInterfaceInfo->State.Queue.TxTail++;
+		RNDISInterfaceInfo->State.Stats.TxFrames++;
+		RNDISInterfaceInfo->State.Stats.TxBytes += Frame->Length;
+
+		RNDIS_Device_PushFree(RNDISInterfaceInfo, Frame);
+		RNDIS_Device_KickTx(RNDISInterfaceInfo);
+		return true;
+	}
+
+	if (!(xfer_in) && (logicalEP == RNDISInterfaceInfo->Config.DataOUTEndpointNumber) &&
+		RNDISInterfaceInfo->State.Queue.RxBusy)
+	{
+		Frame  = &RNDISInterfaceInfo->State.Queue.Frames[RNDISInterfaceInfo->State.Queue.RxFrame];
+		Length = Endpoint_GetTransferLength(RNDISInterfaceInfo->Config.PortNumber,
+											logicalEP | ENDPOINT_DIR_OUT);
+		RNDISInterfaceInfo->State.Queue.RxBusy = false;
+
+		if (RNDIS_Device_StripHeader(RNDISInterfaceInfo, Frame, Length))
+		{
+			RNDISInterfaceInfo->State.Queue.Rx[RNDISInterfaceInfo->State.Queue.RxHead & (RNDIS_DEVICE_MAX_FRAMES - 1)] =
+				RNDISInterfaceInfo->State.Queue.RxFrame;
+			RNDISInterfaceInfo->State.Queue.RxHead++;
+			RNDISInterfaceInfo->State.Stats.RxFrames++;
+			RNDISInterfaceInfo->State.Stats.RxBytes += Frame->Length;
+			RNDIS_Device_PrimeRx(RNDISInterfaceInfo);
+		}
+		else
+		{
+			RNDISInterfaceInfo->State.Stats.RxErrors++;
+			RNDIS_Device_PushFree(RNDISInterfaceInfo, Frame);
+			RNDIS_Device_PrimeRx(RNDISInterfaceInfo);
+		}
+		return true;
+	}
+
+	return false;
+}
+
+void RNDIS_Device_GetStats(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo,
+						   RNDIS_Device_Stats_t *const Stats)
+{
+	HAL_DisableUSBInterrupt(RNDISInterfaceInfo->Config.PortNumber);
+	*Stats = RNDISInterfaceInfo->State.Stats;
+	HAL_EnableUSBInterrupt(RNDISInterfaceInfo->Config.PortNumber);
+}
+
+static void RNDIS_Device_InitQueue(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo)
+{
+	uint8_t Count = RNDISInterfaceInfo->Config.FrameCount;
+
+	if (Count > RNDIS_DEVICE_MAX_FRAMES)
+	  Count = RNDIS_DEVICE_MAX_FRAMES;
+
+	for (uint8_t Index = 0; Index < Count; Index++)
+	{
+		RNDISInterfaceInfo->State.Queue.Frames[Index].Buffer = &RNDISInterfaceInfo->Config.FramePool[Index * RNDIS_DEVICE_FRAME_SIZE];
+		RNDISInterfaceInfo->State.Queue.Free[Index]          = Count - 1 - Index;
+	}
+
+	RNDISInterfaceInfo->State.Queue.FreeCount = Count;
+	RNDISInterfaceInfo->State.Stats.PoolLow   = Count;
+}
+#endif
+
 void RNDIS_Device_ProcessControlRequest(USB_ClassInfo_RNDIS_Device_t* const RNDISInterfaceInfo)
 {
 	if (!(Endpoint_IsSETUPReceived(RNDISInterfaceInfo->Config.PortNumber)))
@@ -115,7 +390,15 @@ void RNDIS_Device_ProcessControlRequest(USB_ClassInfo_RNDIS_Device_t* const RNDI
 
 bool RNDIS_Device_ConfigureEndpoints(USB_ClassInfo_RNDIS_Device_t* const RNDISInterfaceInfo)
 {
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	HAL_DisableUSBInterrupt(RNDISInterfaceInfo->Config.PortNumber);
 	memset(&RNDISInterfaceInfo->State, 0x00, sizeof(RNDISInterfaceInfo->State));
+	if (RNDISInterfaceInfo->Config.FramePool != NULL)
+	  RNDIS_Device_InitQueue(RNDISInterfaceInfo);
+	HAL_EnableUSBInterrupt(RNDISInterfaceInfo->Config.PortNumber);
+#else
+	memset(&RNDISInterfaceInfo->State, 0x00, sizeof(RNDISInterfaceInfo->State));
+#endif
 
 	for (uint8_t EndpointNum = 1; EndpointNum < ENDPOINT_TOTAL_ENDPOINTS(RNDISInterfaceInfo->Config.PortNumber); EndpointNum++)
 	{
@@ -157,6 +440,16 @@ bool RNDIS_Device_ConfigureEndpoints(USB_ClassInfo_RNDIS_Device_t* const RNDISIn
 		}
 	}
 
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	/* The OUT endpoint receives into the pool from now on */
+	if (RNDISInterfaceInfo->Config.FramePool != NULL)
+	{
+		HAL_DisableUSBInterrupt(RNDISInterfaceInfo->Config.PortNumber);
+		RNDIS_Device_PrimeRx(RNDISInterfaceInfo);
+		HAL_EnableUSBInterrupt(RNDISInterfaceInfo->Config.PortNumber);
+	}
+#endif
+
 	return true;
 }
 
@@ -61,7 +61,47 @@ extern "C" {
 		#endif
 
 /* Public Interface - May be used in end-application: */
+/* Macros: */
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/** Largest number of frames in the frame pool of an interface. */
+#define RNDIS_DEVICE_MAX_FRAMES        16
+/** Room kept in front of every frame for the RNDIS packet message header, which is written there in place. */
+#define RNDIS_DEVICE_FRAME_HEADROOM    sizeof(RNDIS_Packet_Message_t)
+/** Size of one frame pool slot: the header, the largest frame and a short packet pad byte, rounded up. */
+#define RNDIS_DEVICE_FRAME_SIZE        1600
+#endif
+
 /* Type Defines: */
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/**
+ * @brief Frame descriptor. Frames live in pool slots and are passed between the class driver, the application
+ *  and other DMA masters (such as the Ethernet MAC) by descriptor, the frame bytes never move.
+ */
+typedef struct {
+	uint8_t  *Buffer;				/**< Pool slot holding the frame, @ref RNDIS_DEVICE_FRAME_SIZE bytes, set by the class driver. */
+	uint16_t Offset;				/**< Start of the Ethernet frame in \c Buffer, at least @ref RNDIS_DEVICE_FRAME_HEADROOM for
+									 *   frames handed to @ref RNDIS_Device_SendFrame().
+									 */
+	uint16_t Length;				/**< Ethernet frame length in bytes. */
+	uint8_t  Owner;					/**< Current holder, used internally by the class driver. */
+} RNDIS_Device_Frame_t;
+
+/**
+ * @brief Frame engine counters, read with @ref RNDIS_Device_GetStats(). All counters restart from zero when the
+ *  interface is configured.
+ */
+typedef struct {
+	uint32_t RxFrames;				/**< Frames received from the host and queued for the application. */
+	uint32_t RxBytes;				/**< Ethernet bytes of those frames. */
+	uint32_t RxErrors;				/**< Malformed packet messages, or packets sent before the packet filter was set. */
+	uint32_t RxStarved;				/**< OUT endpoint left NAKing because the pool was empty. */
+	uint32_t TxFrames;				/**< Frames sent to the host. */
+	uint32_t TxBytes;				/**< Ethernet bytes of those frames. */
+	uint32_t TxRejected;			/**< Frames refused by @ref RNDIS_Device_SendFrame(). */
+	uint8_t  PoolLow;				/**< Fewest free frames seen in the pool. */
+} RNDIS_Device_Stats_t;
+#endif
+
 /**
  * @brief	RNDIS Class Device Mode Configuration and State Structure.
  *
@@ -88,6 +128,13 @@ typedef struct {
 		char *AdapterVendorDescription;						/**< String description of the adapter vendor. */
 		MAC_Address_t AdapterMACAddress;			/**< MAC address of the adapter. */
 		uint8_t  PortNumber;				/**< Port number that this interface is running.*/
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+		uint8_t  *FramePool;				/**< \c FrameCount slots of @ref RNDIS_DEVICE_FRAME_SIZE bytes back to back, word
+											 *   aligned, or \c NULL to use @ref RNDIS_Device_ReadPacket() and
+											 *   @ref RNDIS_Device_SendPacket().
+											 */
+		uint8_t  FrameCount;				/**< Number of pool slots, at most @ref RNDIS_DEVICE_MAX_FRAMES. */
+#endif
 	} Config;				/**< Config data for the USB class interface within the device. All elements in this section
 							 *   <b>must</b> be set or the interface will fail to enumerate and operate correctly.
 							 */
@@ -99,6 +146,24 @@ typedef struct {
 		bool     ResponseReady;				/**< Internal flag indicating if a RNDIS message is waiting to be returned to the host. */
 		uint8_t  CurrRNDISState;			/**< Current RNDIS state of the adapter, a value from the @ref RNDIS_States_t enum. */
 		uint32_t CurrPacketFilter;				/**< Current packet filter mode, used internally by the class driver. */
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+		struct {
+			RNDIS_Device_Frame_t Frames[RNDIS_DEVICE_MAX_FRAMES];	/**< One descriptor per pool slot. */
+			uint8_t  Free[RNDIS_DEVICE_MAX_FRAMES];	/**< Stack of free frame indexes. */
+			uint8_t  FreeCount;				/**< Entries in \c Free. */
+			uint8_t  Rx[RNDIS_DEVICE_MAX_FRAMES];	/**< Received frames waiting for the application. */
+			volatile uint8_t RxHead;		/**< Frames queued in \c Rx, interrupt owned. */
+			volatile uint8_t RxTail;		/**< Frames taken from \c Rx, main loop owned. */
+			uint8_t  Tx[RNDIS_DEVICE_MAX_FRAMES];	/**< Frames waiting for or on the IN endpoint. */
+			volatile uint8_t TxHead;		/**< Frames queued in \c Tx. */
+			volatile uint8_t TxTail;		/**< Frames sent from \c Tx. */
+			volatile bool RxBusy;			/**< A pool slot is queued on the OUT endpoint. */
+			volatile bool TxBusy;			/**< The frame at \c TxTail is queued on the IN endpoint. */
+			bool     RxStarved;				/**< The OUT endpoint waits for a free slot. */
+			uint8_t  RxFrame;				/**< Index of the slot queued on the OUT endpoint. */
+		} Queue;					/**< Frame engine state, used when \c FramePool is set. */
+		RNDIS_Device_Stats_t Stats;		/**< Frame engine counters. */
+#endif
 	} State;			/**< State data for the USB class interface within the device. All elements in this section
 						 *   are reset to their defaults when the interface is enumerated.
 						 */
@@ -180,6 +245,92 @@ uint8_t RNDIS_Device_SendPacket(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfa
 								void *Buffer,
 								const uint16_t PacketLength);
 
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/**
+ * @brief	Returns the start of the Ethernet frame held by a frame descriptor.
+ *
+ *  @param	Frame	: Frame descriptor.
+ *
+ *  @return	Pointer to the first byte of the Ethernet header.
+ */
+static inline uint8_t *RNDIS_Device_FrameData(const RNDIS_Device_Frame_t *const Frame)
+{
+	return &Frame->Buffer[Frame->Offset];
+}
+
+/**
+ * @brief	Takes a frame from the pool, for example to receive into from another interface or to build a reply.
+ *  The frame comes with \c Offset set to @ref RNDIS_DEVICE_FRAME_HEADROOM and \c Length set to zero. Main loop only.
+ *
+ *  @param	RNDISInterfaceInfo	: Pointer to a structure containing an RNDIS Class configuration and state.
+ *
+ *  @return	Frame descriptor, or \c NULL if every frame is in flight.
+ */
+RNDIS_Device_Frame_t *RNDIS_Device_AllocFrame(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
+
+/**
+ * @brief	Returns a frame obtained from @ref RNDIS_Device_AllocFrame() or @ref RNDIS_Device_ReceiveFrame() to the
+ *  pool. Frames of a previous configuration are ignored, the pool took them back when the interface was
+ *  configured again. Main loop only.
+ *
+ *  @param	RNDISInterfaceInfo	: Pointer to a structure containing an RNDIS Class configuration and state.
+ *  @param	Frame	: Frame descriptor.
+ *  @return	Nothing
+ */
+void RNDIS_Device_FreeFrame(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo,
+							RNDIS_Device_Frame_t *const Frame) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+
+/**
+ * @brief	Takes the next frame received from the host. The RNDIS header was stripped in place, \c Offset and
+ *  \c Length describe the Ethernet frame inside the slot the controller received into. The caller owns the frame
+ *  until it passes it to @ref RNDIS_Device_SendFrame() or @ref RNDIS_Device_FreeFrame(). Main loop only.
+ *
+ *  @param	RNDISInterfaceInfo	: Pointer to a structure containing an RNDIS Class configuration and state.
+ *
+ *  @return	Frame descriptor, or \c NULL if no frame is waiting.
+ */
+RNDIS_Device_Frame_t *RNDIS_Device_ReceiveFrame(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
+
+/**
+ * @brief	Queues a frame for the host. The RNDIS packet message header is written in place into the headroom in
+ *  front of the frame and the controller sends header and frame from the slot in one transfer. The frame returns
+ *  to the pool once sent. Main loop only.
+ *
+ *  @param	RNDISInterfaceInfo	: Pointer to a structure containing an RNDIS Class configuration and state.
+ *  @param	Frame	: Frame descriptor, \c Offset must leave @ref RNDIS_DEVICE_FRAME_HEADROOM bytes in front.
+ *
+ *  @return	Boolean \c true if the frame was queued, \c false if the host has not set a packet filter yet or the frame
+ *  does not fit, the caller then still owns the frame.
+ */
+bool RNDIS_Device_SendFrame(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo,
+							RNDIS_Device_Frame_t *const Frame) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+
+/**
+ * @brief	Frame engine completion handler, call it from @ref EVENT_USB_Device_PortTransferComplete() for every
+ *  completion on the interface's port. Queues the next pool slot on the OUT endpoint and the next frame on the
+ *  IN endpoint without waiting for the main loop.
+ *
+ *  @param	RNDISInterfaceInfo	: Pointer to a structure containing an RNDIS Class configuration and state.
+ *  @param	logicalEP	: Logical endpoint number of the completion.
+ *  @param	xfer_in	: Non zero for an IN completion.
+ *
+ *  @return	Boolean \c true if the completion belonged to the interface.
+ */
+bool RNDIS_Device_TransferComplete(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo,
+								   const int logicalEP,
+								   const int xfer_in) ATTR_NON_NULL_PTR_ARG(1);
+
+/**
+ * @brief	Copies the frame engine counters.
+ *
+ *  @param	RNDISInterfaceInfo	: Pointer to a structure containing an RNDIS Class configuration and state.
+ *  @param	Stats	: Where the counters are copied.
+ *  @return	Nothing
+ */
+void RNDIS_Device_GetStats(USB_ClassInfo_RNDIS_Device_t *const RNDISInterfaceInfo,
+						   RNDIS_Device_Stats_t *const Stats) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+#endif
+
 /* Private Interface - For use in library only: */
 	#if !defined(__DOXYGEN__)
 /* Function Prototypes: */
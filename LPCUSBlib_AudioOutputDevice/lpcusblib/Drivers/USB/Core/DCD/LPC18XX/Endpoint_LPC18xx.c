@@ -85,16 +85,48 @@ typedef struct {
 
 static STREAM_VAR_t Stream_Variable[LPC18_43_MAX_USB_CORE];
 
+volatile USB_ControlLatency_t USB_ControlLatency[LPC18_43_MAX_USB_CORE];
+
+/* SETUP packet already reported to the application, until Endpoint_ClearSETUP() */
+volatile bool USB_SetupLatched[LPC18_43_MAX_USB_CORE];
+
+/* Endpoints driven through Endpoint_StartTransfer(), as ENDPTCOMPLETE bit positions */
+static uint32_t DirectEndpoints[LPC18_43_MAX_USB_CORE];
+
 PRAGMA_WEAK(CALLBACK_HAL_GetISOBufferAddress, Dummy_EPGetISOAddress)
 uint32_t CALLBACK_HAL_GetISOBufferAddress(const uint32_t EPNum, uint32_t *last_packet_size) ATTR_WEAK ATTR_ALIAS(
 	Dummy_EPGetISOAddress);
 
+/* Port aware ISO buffer callback
+ * Defaults to CALLBACK_HAL_GetISOBufferAddress, override it when both controllers stream.
+ * EPNum carries ENDPOINT_DIR_IN for IN endpoints, so both directions of one endpoint number
+ * can stream. For OUT endpoints last_packet_size is the length received, for IN endpoints the
+ * callback returns the length to send in it.
+ */
+PRAGMA_WEAK(CALLBACK_HAL_GetPortISOBufferAddress, Dummy_EPGetPortISOAddress)
+uint32_t CALLBACK_HAL_GetPortISOBufferAddress(uint8_t corenum, const uint32_t EPNum,
+											  uint32_t *last_packet_size) ATTR_WEAK ATTR_ALIAS(Dummy_EPGetPortISOAddress);
+
 /* Device transfer completed event
  * Event is required for using the device stack with any RTOS
  */
 PRAGMA_WEAK(EVENT_USB_Device_TransferComplete,Dummy_EVENT_USB_Device_TransferComplete)
 void EVENT_USB_Device_TransferComplete(int logicalEP, int xfer_in) ATTR_WEAK ATTR_ALIAS(Dummy_EVENT_USB_Device_TransferComplete);
 
+/* Device SETUP packet received event
+ * Lets an event driven application run the control request handling only when needed
+ */
+PRAGMA_WEAK(EVENT_USB_Device_SetupReceived,Dummy_EVENT_USB_Device_SetupReceived)
+void EVENT_USB_Device_SetupReceived(uint8_t corenum) ATTR_WEAK ATTR_ALIAS(Dummy_EVENT_USB_Device_SetupReceived);
+
+/* Port aware transfer complete and start of frame events
+ * Default to the port less events above
+ */
+PRAGMA_WEAK(EVENT_USB_Device_PortTransferComplete,Dummy_EVENT_USB_Device_PortTransferComplete)
+void EVENT_USB_Device_PortTransferComplete(uint8_t corenum, int logicalEP, int xfer_in) ATTR_WEAK ATTR_ALIAS(Dummy_EVENT_USB_Device_PortTransferComplete);
+PRAGMA_WEAK(EVENT_USB_Device_PortStartOfFrame,Dummy_EVENT_USB_Device_PortStartOfFrame)
+void EVENT_USB_Device_PortStartOfFrame(uint8_t corenum) ATTR_WEAK ATTR_ALIAS(Dummy_EVENT_USB_Device_PortStartOfFrame);
+
 void DcdInsertTD(uint32_t head, uint32_t newtd);
 
 void DcdPrepareTD(DeviceTransferDescriptor *pDTD, uint8_t *pData, uint32_t length, uint8_t IOC);
@@ -120,6 +152,7 @@ void HAL_Reset(uint8_t corenum)
 	USB_Reg->ENDPTNAKEN       = 0;
 	USB_Reg->USBSTS_D     = 0xFFFFFFFF;
 	USB_Reg->ENDPTSETUPSTAT   = USB_Reg->ENDPTSETUPSTAT;
+	USB_SetupLatched[corenum] = false;
 	USB_Reg->ENDPTCOMPLETE    = USB_Reg->ENDPTCOMPLETE;
 	while (USB_Reg->ENDPTPRIME) ;				/* Wait until all bits are 0 */
 	USB_Reg->ENDPTFLUSH = 0xFFFFFFFF;
@@ -153,6 +186,7 @@ void HAL_Reset(uint8_t corenum)
 	// usb_data_buffer_IN_size = 0;
 	usb_data_buffer_IN_index[corenum] = 0;
 	Stream_Variable[corenum].stream_total_packets = 0;
+	DirectEndpoints[corenum] = 0;
 }
 
 bool Endpoint_ConfigureEndpoint(uint8_t corenum, const uint8_t Number, const uint8_t Type,
@@ -166,6 +200,7 @@ bool Endpoint_ConfigureEndpoint(uint8_t corenum, const uint8_t Number, const uin
 	
 	pdQueueHead = &(dQueueHead[corenum][PhyEP]);
 	memset((void *) pdQueueHead, 0, sizeof(DeviceQueueHead) );
+	DirectEndpoints[corenum] &= ~_BIT(EP_Physical2BitPosition(PhyEP));
 	
 	pdQueueHead->MaxPacketSize = Size & 0x3ff;
 	pdQueueHead->IntOnSetup = 1;
@@ -178,7 +213,7 @@ bool Endpoint_ConfigureEndpoint(uint8_t corenum, const uint8_t Number, const uin
 		if (Type == EP_TYPE_ISOCHRONOUS) {
 			uint32_t size = 0;
 			*pEndPointCtrl = (Type << 2);					// TODO dummy to let DcdDataTransfer() knows iso transfer
-			ISO_Address = (uint8_t *) CALLBACK_HAL_GetISOBufferAddress(Number, &size);
+			ISO_Address = (uint8_t *) CALLBACK_HAL_GetPortISOBufferAddress(corenum, Number, &size);
 			DcdDataTransfer(corenum, PhyEP, ISO_Address, USB_DATA_BUFFER_TEM_LENGTH);
 		}
 		else {
@@ -191,7 +226,7 @@ bool Endpoint_ConfigureEndpoint(uint8_t corenum, const uint8_t Number, const uin
 		if (Type == EP_TYPE_ISOCHRONOUS) {
 			uint32_t size = 0;
 			*pEndPointCtrl = (Type << 18);					// TODO dummy to let DcdDataTransfer() knows iso transfer
-			ISO_Address = (uint8_t *) CALLBACK_HAL_GetISOBufferAddress(Number, &size);
+			ISO_Address = (uint8_t *) CALLBACK_HAL_GetPortISOBufferAddress(corenum, Number | ENDPOINT_DIR_IN, &size);
 			DcdDataTransfer(corenum, PhyEP, ISO_Address, size);
 		}
 	}
@@ -294,7 +329,7 @@ void DcdPrepareTD(DeviceTransferDescriptor *pDTD, uint8_t *pData, uint32_t lengt
 	//	pDTD->BufferPage[4] = ((uint32_t) pData + 0x4000) & 0xfffff000;
 }
 
-void DcdDataTransfer(uint8_t corenum, uint8_t PhyEP, uint8_t *pData, uint32_t length)
+USB_RAMFUNC void DcdDataTransfer(uint8_t corenum, uint8_t PhyEP, uint8_t *pData, uint32_t length)
 {
 	DeviceTransferDescriptor * pDTD = (DeviceTransferDescriptor *) &dTransferDescriptor[corenum][PhyEP];
 	volatile DeviceQueueHead * pdQueueHead = &(dQueueHead[corenum][PhyEP]);
@@ -336,12 +371,53 @@ void DcdDataTransfer(uint8_t corenum, uint8_t PhyEP, uint8_t *pData, uint32_t le
 	USB_REG(corenum)->ENDPTPRIME |= _BIT(EP_Physical2BitPosition(PhyEP) );
 }
 
-void TransferCompleteISR(uint8_t corenum)
+void Endpoint_StartTransfer(uint8_t corenum, uint8_t EndpointAddress, uint8_t *Buffer, uint32_t Length)
+{
+	uint8_t PhyEP = 2 * (EndpointAddress & ENDPOINT_EPNUM_MASK) + ((EndpointAddress & ENDPOINT_DIR_IN) ? 1 : 0);
+	uint32_t bit = _BIT(EP_Physical2BitPosition(PhyEP));
+
+	if (!(EndpointAddress & ENDPOINT_DIR_IN)) {
+		USB_REG(corenum)->ENDPTNAKEN &= ~bit;
+	}
+	DirectEndpoints[corenum] |= bit;
+	DcdDataTransfer(corenum, PhyEP, Buffer, Length);
+}
+
+bool Endpoint_IsTransferActive(uint8_t corenum, uint8_t EndpointAddress)
+{
+	uint8_t PhyEP = 2 * (EndpointAddress & ENDPOINT_EPNUM_MASK) + ((EndpointAddress & ENDPOINT_DIR_IN) ? 1 : 0);
+	uint32_t bit = _BIT(EP_Physical2BitPosition(PhyEP));
+
+	return ((USB_REG(corenum)->ENDPTPRIME | USB_REG(corenum)->ENDPTSTAT) & bit) != 0;
+}
+
+uint32_t Endpoint_GetTransferLength(uint8_t corenum, uint8_t EndpointAddress)
+{
+	uint8_t PhyEP = 2 * (EndpointAddress & ENDPOINT_EPNUM_MASK) + ((EndpointAddress & ENDPOINT_DIR_IN) ? 1 : 0);
+
+	return dQueueHead[corenum][PhyEP].TransferCount - dQueueHead[corenum][PhyEP].overlay.TotalBytes;
+}
+
+void Endpoint_AbortTransfer(uint8_t corenum, uint8_t EndpointAddress)
+{
+	uint8_t PhyEP = 2 * (EndpointAddress & ENDPOINT_EPNUM_MASK) + ((EndpointAddress & ENDPOINT_DIR_IN) ? 1 : 0);
+	uint32_t bit = _BIT(EP_Physical2BitPosition(PhyEP));
+
+	do {
+		USB_REG(corenum)->ENDPTFLUSH = bit;
+		while (USB_REG(corenum)->ENDPTFLUSH & bit) ;
+	} while (USB_REG(corenum)->ENDPTSTAT & bit);	/* a prime can race the flush */
+	USB_REG(corenum)->ENDPTCOMPLETE = bit;
+	dQueueHead[corenum][PhyEP].overlay.Active = 0;
+}
+
+USB_RAMFUNC void TransferCompleteISR(uint8_t corenum)
 {
 	uint8_t * ISO_Address;
  	LPC_USBHS_T *	USB_Reg = USB_REG(corenum);
 	STREAM_VAR_t * current_stream = &Stream_Variable[corenum];
 	uint32_t ENDPTCOMPLETE = USB_Reg->ENDPTCOMPLETE;
+	TRACE_PROBE_ENTER(USB_TRACE_TRANSFER_COMPLETE, corenum);
 	USB_Reg->ENDPTCOMPLETE = ENDPTCOMPLETE;
 	if (ENDPTCOMPLETE) {
 		uint8_t n;
@@ -351,9 +427,12 @@ void TransferCompleteISR(uint8_t corenum)
 					uint32_t size = dQueueHead[corenum][2 * n].TransferCount;
                                         size -= dQueueHead[corenum][2 * n].overlay.TotalBytes;
 					// copy to share buffer
-					ISO_Address = (uint8_t *) CALLBACK_HAL_GetISOBufferAddress(n, &size);
+					ISO_Address = (uint8_t *) CALLBACK_HAL_GetPortISOBufferAddress(corenum, n, &size);
 					DcdDataTransfer(corenum, 2 * n, ISO_Address, USB_DATA_BUFFER_TEM_LENGTH);
 				}
+				else if (DirectEndpoints[corenum] & _BIT(n)) {
+					/* Owner reads the length with Endpoint_GetTransferLength() */
+				}
 				else {
 					
 					uint32_t tem = dQueueHead[corenum][2 * n].overlay.TotalBytes;
@@ -384,14 +463,17 @@ void TransferCompleteISR(uint8_t corenum)
 						usb_data_buffer_OUT_size[corenum] = dQueueHead[corenum][2 * n].TransferCount;
 					}
 				}
-				EVENT_USB_Device_TransferComplete(n, 0);
+				EVENT_USB_Device_PortTransferComplete(corenum, n, 0);
 			}
 			if ( ENDPTCOMPLETE & _BIT( (n + 16) ) ) {	/* IN */
 				if (((ENDPTCTRL_REG(corenum, n) >> 18) & EP_TYPE_MASK) == EP_TYPE_ISOCHRONOUS) {	// iso in endpoint
-					uint32_t size;
-					ISO_Address = (uint8_t *) CALLBACK_HAL_GetISOBufferAddress(n, &size);
+					uint32_t size = 0;
+					ISO_Address = (uint8_t *) CALLBACK_HAL_GetPortISOBufferAddress(corenum, n | ENDPOINT_DIR_IN, &size);
 					DcdDataTransfer(corenum, 2 * n + 1, ISO_Address, size);
 				}
+				else if (DirectEndpoints[corenum] & _BIT(n + 16)) {
+					/* Owner reads the length with Endpoint_GetTransferLength() */
+				}
 				else {
 					if (current_stream->stream_remain_packets > 0) {
 						uint32_t cnt = dQueueHead[corenum][2 * n].TransferCount;
@@ -405,10 +487,11 @@ void TransferCompleteISR(uint8_t corenum)
 						current_stream->stream_total_packets = 0;
 					}
 				}
-				EVENT_USB_Device_TransferComplete(n, 1);
+				EVENT_USB_Device_PortTransferComplete(corenum, n, 1);
 			}
 		}
 	}
+	TRACE_PROBE_EXIT(USB_TRACE_TRANSFER_COMPLETE, corenum);
 }
 
 void Endpoint_GetSetupPackage(uint8_t corenum, uint8_t *pData)
@@ -426,7 +509,7 @@ void Endpoint_GetSetupPackage(uint8_t corenum, uint8_t *pData)
 	}
 }
 
-void DcdIrqHandler(uint8_t corenum)
+USB_RAMFUNC void DcdIrqHandler(uint8_t corenum)
 {
 	uint32_t USBSTS_D;
 	LPC_USBHS_T *	USB_Reg = USB_REG(corenum);
@@ -437,13 +520,21 @@ void DcdIrqHandler(uint8_t corenum)
 		return;
 	}
 
+	TRACE_PROBE_ENTER(USB_TRACE_DCD_IRQ, corenum);
 	USB_Reg->USBSTS_D = USBSTS_D;	/* Acknowledge Interrupt */
 
 	/* Process Interrupt Sources */
 	if (USBSTS_D & USBSTS_D_UsbInt) {
+		/* ENDPTSETUPSTAT stays set until Endpoint_ClearSETUP, report each SETUP only once */
 		if (USB_Reg->ENDPTSETUPSTAT) {
 			//			memcpy(SetupPackage, dQueueHead[0].SetupPackage, 8);
-			/* Will be cleared by Endpoint_ClearSETUP */
+			if (!USB_SetupLatched[corenum]) {
+				/* Stamp the arrival only, not later interrupts while it waits */
+				USB_ControlLatency[corenum].SetupCycle = DWT->CYCCNT;
+				USB_SetupLatched[corenum] = true;
+				TRACE_PROBE_POINT(USB_TRACE_SETUP, corenum);
+				EVENT_USB_Device_SetupReceived(corenum);
+			}
 		}
 
 		if (USB_Reg->ENDPTCOMPLETE) {
@@ -486,7 +577,7 @@ void DcdIrqHandler(uint8_t corenum)
 	}
 
 	if (USBSTS_D & USBSTS_D_SofReceived) {					/* Start of Frame Interrupt */
-		EVENT_USB_Device_StartOfFrame();
+		EVENT_USB_Device_PortStartOfFrame(corenum);
 	}
 
 	if (USBSTS_D & USBSTS_D_ResetReceived) {					/* Reset */
@@ -517,6 +608,7 @@ void DcdIrqHandler(uint8_t corenum)
 	if (USBSTS_D & USBSTS_D_UsbErrorInt) {					/* Error Interrupt */
 		// while(1){}
 	}
+	TRACE_PROBE_EXIT(USB_TRACE_DCD_IRQ, corenum);
 }
 
 uint32_t Dummy_EPGetISOAddress(uint32_t EPNum, uint32_t *last_packet_size)
@@ -524,6 +616,12 @@ uint32_t Dummy_EPGetISOAddress(uint32_t EPNum, uint32_t *last_packet_size)
 	return (uint32_t) iso_buffer;
 }
 
+uint32_t Dummy_EPGetPortISOAddress(uint8_t corenum, uint32_t EPNum, uint32_t *last_packet_size)
+{
+	/* Single port callbacks take the plain endpoint number, without the IN direction bit */
+	return CALLBACK_HAL_GetISOBufferAddress(EPNum & ENDPOINT_EPNUM_MASK, last_packet_size);
+}
+
 /*********************************************************************//**
  * @brief		Dummy USB device transfer complete event
  * @param[in]   logicalEP Logical endpoint number
@@ -540,6 +638,42 @@ void Dummy_EVENT_USB_Device_TransferComplete(int logicalEP, int xfer_in)
 	 * else ep is IN.
 	 **/
 }
+
+/*********************************************************************//**
+ * @brief		Dummy USB device SETUP received event
+ * @param[in]   corenum USB port number
+ * @note		The SETUP packet stays in the queue head until the
+ *      		device task processes it, polled applications need nothing here
+ * @return	 	None
+ **********************************************************************/
+void Dummy_EVENT_USB_Device_SetupReceived(uint8_t corenum)
+{
+	/**
+	 * This is a dummy function
+	 **/
+}
+
+/*********************************************************************//**
+ * @brief		Dummy port aware transfer complete event
+ * @param[in]   corenum USB port number
+ * @param[in]   logicalEP Logical endpoint number
+ * @param[in]	xfer_in If this argument is 0 then xfer type is out, else in
+ * @return	 	None
+ **********************************************************************/
+void Dummy_EVENT_USB_Device_PortTransferComplete(uint8_t corenum, int logicalEP, int xfer_in)
+{
+	EVENT_USB_Device_TransferComplete(logicalEP, xfer_in);
+}
+
+/*********************************************************************//**
+ * @brief		Dummy port aware start of frame event
+ * @param[in]   corenum USB port number
+ * @return	 	None
+ **********************************************************************/
+void Dummy_EVENT_USB_Device_PortStartOfFrame(uint8_t corenum)
+{
+	EVENT_USB_Device_StartOfFrame();
+}
 // #endif
 
 #endif /*__LPC18XX__*/
@@ -66,6 +66,7 @@
 #define __ENDPOINT_LPC18XX_H__
 
 	#include "../EndpointCommon.h"
+	#include "trace_probe.h"
 
 /* Enable C linkage for C++ Compilers: */
 		#if defined(__cplusplus)
@@ -274,6 +275,30 @@ typedef struct {
 extern volatile DeviceQueueHead * const dQueueHead[];
 extern DeviceTransferDescriptor * const dTransferDescriptor[];
 
+/*---------- Control request latency ----------*/
+/* Timing of control requests on one port, in CPU cycles from the DWT cycle counter */
+typedef struct {
+	uint32_t SetupCycle;				/* Cycle count latched by the SETUP interrupt */
+	uint32_t Requests;					/* Number of control requests processed */
+	uint32_t LastQueueCycles;			/* SETUP interrupt to start of processing */
+	uint32_t MaxQueueCycles;
+	uint32_t LastServiceCycles;			/* Processing time including data and status stages */
+	uint32_t MaxServiceCycles;
+} USB_ControlLatency_t;
+
+extern volatile USB_ControlLatency_t USB_ControlLatency[];
+
+/* Set by the SETUP interrupt once it has reported the pending SETUP, cleared by Endpoint_ClearSETUP() */
+extern volatile bool USB_SetupLatched[];
+
+/*---------- Trace probes ----------*/
+/* Probe IDs of the device stack, see trace_probe.h. Spans carry the port number. */
+#define USB_TRACE_DCD_IRQ           (TRACE_PROBE_ID_USB_BASE + 0)	/* Span: DcdIrqHandler() */
+#define USB_TRACE_TRANSFER_COMPLETE (TRACE_PROBE_ID_USB_BASE + 1)	/* Span: TransferCompleteISR() */
+#define USB_TRACE_SETUP             (TRACE_PROBE_ID_USB_BASE + 2)	/* Point: SETUP packet received, Arg = port */
+#define USB_TRACE_CONTROL           (TRACE_PROBE_ID_USB_BASE + 3)	/* Span: control request processing */
+#define USB_TRACE_REQUEST           (TRACE_PROBE_ID_USB_BASE + 4)	/* Point: request processed, Arg = bmRequestType << 8 | bRequest */
+
 void DcdDataTransfer(uint8_t corenum, uint8_t EPNum, uint8_t *pData, uint32_t cnt);
 
 void Endpoint_Streaming(uint8_t corenum, uint8_t *buffer, uint16_t packetsize,
@@ -319,6 +344,47 @@ bool Endpoint_ConfigureEndpoint_Prv(uint8_t corenum,
 												   const uint16_t Size,
 												   const uint8_t Banks)	/*ATTR_ALWAYS_INLINE*/;
 
+/**
+ * @brief  Queues one DMA transfer of up to 16 KB directly from or into a caller buffer.
+ *  The endpoint is taken out of the shared usb_data_buffer path: OUT endpoints are no
+ *  longer primed on NAK and their completions do not touch the Endpoint_Read_* state,
+ *  until the endpoint is configured again. Completion is signalled through
+ *  EVENT_USB_Device_PortTransferComplete().
+ * @param  corenum         : ID Number of USB Core to be processed.
+ * @param  EndpointAddress : Endpoint number ORed with @ref ENDPOINT_DIR_IN or @ref ENDPOINT_DIR_OUT.
+ * @param  Buffer          : Data to send or room to receive into, must stay valid until completion.
+ * @param  Length          : Transfer length in bytes. OUT transfers should be a multiple of the
+ *                           endpoint size, a short packet ends them early.
+ * @return Nothing.
+ * @note   The endpoint must be idle, see @ref Endpoint_IsTransferActive.
+ */
+void Endpoint_StartTransfer(uint8_t corenum, uint8_t EndpointAddress, uint8_t *Buffer, uint32_t Length);
+
+/**
+ * @brief  Tells whether a transfer queued by @ref Endpoint_StartTransfer is still pending.
+ * @param  corenum         : ID Number of USB Core to be processed.
+ * @param  EndpointAddress : Endpoint number ORed with the direction.
+ * @return Boolean \c true while the endpoint is primed.
+ */
+bool Endpoint_IsTransferActive(uint8_t corenum, uint8_t EndpointAddress);
+
+/**
+ * @brief  Returns the number of bytes moved by the last completed transfer.
+ * @param  corenum         : ID Number of USB Core to be processed.
+ * @param  EndpointAddress : Endpoint number ORed with the direction.
+ * @return Transferred byte count.
+ */
+uint32_t Endpoint_GetTransferLength(uint8_t corenum, uint8_t EndpointAddress);
+
+/**
+ * @brief  Cancels a transfer queued by @ref Endpoint_StartTransfer. No completion event
+ *  follows for it.
+ * @param  corenum         : ID Number of USB Core to be processed.
+ * @param  EndpointAddress : Endpoint number ORed with the direction.
+ * @return Nothing.
+ */
+void Endpoint_AbortTransfer(uint8_t corenum, uint8_t EndpointAddress);
+
 //          static inline bool Endpoint_ConfigureEndpoint(const uint8_t Number,
 //                                                        const uint8_t Type,
 //                                                        const uint8_t Direction,
@@ -531,7 +597,13 @@ static inline void Endpoint_ClearSETUP(uint8_t corenum) ATTR_ALWAYS_INLINE;
 static inline void Endpoint_ClearSETUP(uint8_t corenum)
 {
 	LPC_USBHS_T * USB_Reg = USB_REG(corenum);
+	uint_reg_t CurrentGlobalInt = GetGlobalInterruptMask();
+
+	/* A SETUP arriving after the acknowledge is reported once the interrupt is enabled again */
+	GlobalInterruptDisable();
 	USB_Reg->ENDPTSETUPSTAT = USB_Reg->ENDPTSETUPSTAT;
+	USB_SetupLatched[corenum] = false;
+	SetGlobalInterruptMask(CurrentGlobalInt);
 	usb_data_buffer_index[corenum] = 0;
 	USB_Reg->ENDPTNAKEN |= (1 << 0);
 }
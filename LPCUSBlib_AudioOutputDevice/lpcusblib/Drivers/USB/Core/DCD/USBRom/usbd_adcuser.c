@@ -38,6 +38,7 @@
 #include "../../../Class/AudioClass.h"
 #include "usbd_adcuser.h"
 
+#ifndef USB_AUDIO_2DOT0
 /** Internal definition */
 #define AUDIO_MAX_SAMPLE_FREQ 48000
 
@@ -45,25 +46,75 @@
 #define VOLUME_MIN          0x0000
 #define VOLUME_MAX          0x003F
 #define VOLUME_RES          0x0001
+#endif
+
+/* The Audio 2.0 descriptors declare the explicit feedback IN endpoint, the Audio 1.0 ones do not */
+#ifdef USB_AUDIO_2DOT0
+#define USBD_ADC_FEEDBACK   1
+#else
+#define USBD_ADC_FEEDBACK   0
+#endif
+
+/* Number of device transfer descriptors in each ISO ring, must be a power of 2 */
+#define ROM_ISO_DTDS        4
+
+/* PORTSC1_D port speed field, reports the negotiated bus speed */
+#define PORTSC1_D_PSPD_MASK (3 << 26)
+#define PORTSC1_D_PSPD_HS   (2 << 26)
 
 uint32_t ISO_packet_size = 0;
 
-/* Device Transfer Descriptor used in Custom ROM mode */
-DeviceTransferDescriptor Rom_dTD ATTR_ALIGNED(32);
+/* ISO data descriptor ring state, one per direction of the streaming endpoint */
+typedef struct {
+	DeviceTransferDescriptor *Tail;		/* Last queued descriptor, NULL when the list is empty */
+	uint32_t Length[ROM_ISO_DTDS];		/* Requested length of each descriptor */
+	uint8_t Next;						/* Descriptor used by the next queue operation */
+	uint8_t Done;						/* Oldest descriptor not yet retired */
+} ROM_ISO_RING_T;
+
+/* Device Transfer Descriptor rings used in Custom ROM mode, [0] OUT data, [1] IN feedback */
+PRAGMA_ALIGN_32
+DeviceTransferDescriptor Rom_ISO_dTD[2][ROM_ISO_DTDS] ATTR_ALIGNED(32) __BSS(USBRAM_SECTION);
+#if (USBD_ADC_FEEDBACK)
+/* Explicit feedback values, one per IN descriptor so a queued value is never overwritten */
+PRAGMA_ALIGN_4
+uint32_t Rom_Feedback[ROM_ISO_DTDS] ATTR_ALIGNED(4) __BSS(USBRAM_SECTION);
+#endif
+static ROM_ISO_RING_T Rom_ISO_Ring[2];
 /* external Audio Sample Frequency variable */
 extern uint32_t CurrentAudioSampleFrequency;
+#ifndef USB_AUDIO_2DOT0
 /* Current Volume */
 uint32_t curr_vol;
+#else
+/* Class request data stage, RANGE replies outgrow EP0Buf */
+PRAGMA_ALIGN_4
+static uint8_t Adc_ControlBuffer[AUDIO_CONTROL_BUFFER_SIZE] ATTR_ALIGNED(4);
+/* Audio function whose entities answer the class requests */
+static USB_ClassInfo_Audio_Device_t* AdcInterface;
+#endif
 static uint8_t ISOEndpointNumber;
 static uint8_t StreamInterfaceNumber;
 static uint8_t ControlInterfaceNumber;
 static uint8_t USBPort;
+static uint16_t ISOMaxPacketSize;
 
 extern uint32_t sample_buffer_size;
 
 extern uint32_t CALLBACK_HAL_GetISOBufferAddress(const uint32_t EPNum, uint32_t* last_packet_size);
 extern void Audio_Reset_Data_Buffer(void);
-extern void Audio_Init (uint32_t samplefreq);
+#ifndef USB_AUDIO_2DOT0
+extern bool Audio_Init (uint32_t samplefreq);
+#endif
+
+PRAGMA_WEAK(CALLBACK_UsbdAdc_GetFeedbackValue, UsbdAdc_Dummy_GetFeedbackValue)
+uint32_t CALLBACK_UsbdAdc_GetFeedbackValue(uint32_t Nominal) ATTR_WEAK ATTR_ALIAS(UsbdAdc_Dummy_GetFeedbackValue);
+
+/* Default feedback, report the nominal rate unchanged */
+uint32_t UsbdAdc_Dummy_GetFeedbackValue(uint32_t Nominal)
+{
+	return Nominal;
+}
 
 /* inline functions */
 static INLINE DeviceQueueHead* Usbd_GetEpQH(USB_CORE_CTRL_T* pCtrl, uint8_t ep)
@@ -77,92 +128,156 @@ static INLINE DeviceQueueHead* Usbd_GetEpQH(USB_CORE_CTRL_T* pCtrl, uint8_t ep)
     return &ep_QH[ep_idx];
 }
 
-/** Get Transfer packet size */
-static INLINE uint32_t Usbd_GetTransferSize(USB_CORE_CTRL_T *pCtrl, uint8_t ep)
+/* Ring full, the oldest descriptor is still owned by the controller */
+static INLINE bool UsbdDcdISOFull(uint8_t dir)
 {
-	DeviceQueueHead *ep_QH = Usbd_GetEpQH(pCtrl, ep);
-	return ep_QH->TransferCount - ep_QH->overlay.TotalBytes;
+	return (uint8_t) (Rom_ISO_Ring[dir].Next - Rom_ISO_Ring[dir].Done) >= ROM_ISO_DTDS;
 }
 
-static void UsbdDcdDataTransfer(uint8_t EPNum, uint8_t *pData, uint32_t length)
+/* Append a descriptor to the ISO endpoint list without waiting for the endpoint
+ * to go idle. The descriptor is linked behind the current tail; the Add dTD
+ * tripwire tells whether the controller already ran off the end of the list,
+ * in which case the endpoint is re-primed from the queue head.
+ */
+static void UsbdDcdQueueISO(uint8_t EPNum, uint8_t *pData, uint32_t length)
 {
-	uint8_t PhyEP = (EPNum<<1) | (EPNum>>7); /* Rotate left without carry */
-	DeviceQueueHead* ep_QH = Usbd_GetEpQH((USB_CORE_CTRL_T*) UsbHandle, EPNum);
-	DeviceTransferDescriptor*  pDTD = (DeviceTransferDescriptor*) &Rom_dTD;
-	LPC_USBHS_T * USB_Reg;
-	USB_Reg = USB_REG(USBPort);
-
-	while ( USB_Reg->ENDPTSTAT & _BIT( EP_Physical2BitPosition(PhyEP) ) )	/* Endpoint is already primed */
-	{
+	uint8_t dir = (EPNum & 0x80) ? 1 : 0;
+	uint32_t bit = _BIT((EPNum & 0x0F) + (dir ? 16 : 0));
+	ROM_ISO_RING_T *ring = &Rom_ISO_Ring[dir];
+	uint8_t idx = ring->Next & (ROM_ISO_DTDS - 1);
+	DeviceQueueHead *ep_QH = Usbd_GetEpQH((USB_CORE_CTRL_T *) UsbHandle, EPNum);
+	DeviceTransferDescriptor *pDTD = &Rom_ISO_dTD[dir][idx];
+	LPC_USBHS_T *USB_Reg = USB_REG(USBPort);
+
+	if (UsbdDcdISOFull(dir)) {
+		return;
 	}
+	ring->Length[idx] = length;
+	ring->Next++;
 
-	/* Zero out the device transfer descriptors */
-	memset((void*)pDTD, 0, sizeof(DeviceTransferDescriptor));
-
-	if(((ENDPTCTRL_REG(USBPort, PhyEP/2)>>2)&EP_TYPE_MASK)==EP_TYPE_ISOCHRONOUS)	// iso out endpoint
-	{
-		uint32_t mult = (USB_DATA_BUFFER_TEM_LENGTH + 1024) / 1024;
-		pDTD->NextTD = LINK_TERMINATE ;
-		ep_QH->Mult = mult;
-	}
-	else if(((ENDPTCTRL_REG(USBPort, PhyEP/2)>>18)&EP_TYPE_MASK)==EP_TYPE_ISOCHRONOUS)// iso in endpoint
-	{
-		uint32_t mult = (USB_DATA_BUFFER_TEM_LENGTH + 1024) / 1024;
-		pDTD->NextTD = LINK_TERMINATE;
-		ep_QH->Mult = mult;
-	}
-	else {																		// other endpoint types
-		pDTD->NextTD = LINK_TERMINATE;	/* The next DTD pointer is INVALID */
-	}
-	
+	memset((void *) pDTD, 0, sizeof(DeviceTransferDescriptor));
+	pDTD->NextTD = LINK_TERMINATE;
 	pDTD->TotalBytes = length;
 	pDTD->IntOnComplete = 1;
 	pDTD->Active = 1;
 	pDTD->MultiplierOverride = 1;
-
 	pDTD->BufferPage[0] = (uint32_t) pData;
 	pDTD->BufferPage[1] = ((uint32_t) pData + 0x1000) & 0xfffff000;
-	pDTD->BufferPage[2] = ((uint32_t) pData + 0x2000) & 0xfffff000;
-	pDTD->BufferPage[3] = ((uint32_t) pData + 0x3000) & 0xfffff000;
-	pDTD->BufferPage[4] = ((uint32_t) pData + 0x4000) & 0xfffff000;
 
+	if (ring->Tail != NULL) {
+		uint32_t primed;
+
+		ring->Tail->NextTD = (uint32_t) pDTD;
+		ring->Tail = pDTD;
+		if (USB_Reg->ENDPTPRIME & bit) {
+			return;
+		}
+		do {
+			USB_Reg->USBCMD_D |= USBCMD_D_AddTDTripWire;
+			primed = USB_Reg->ENDPTSTAT & bit;
+		} while (!(USB_Reg->USBCMD_D & USBCMD_D_AddTDTripWire));
+		USB_Reg->USBCMD_D &= ~USBCMD_D_AddTDTripWire;
+		if (primed) {
+			return;
+		}
+	}
+	ring->Tail = pDTD;
+
+	/* Endpoint idle, start the list from this descriptor */
 	ep_QH->Mult = 1;
-	ep_QH->MaxPacketSize = 512;
+	ep_QH->MaxPacketSize = ISOMaxPacketSize;
+	ep_QH->overlay.Halted = 0;
+	ep_QH->overlay.Active = 0;
 	ep_QH->overlay.NextTD = (uint32_t) pDTD;
 	ep_QH->TransferCount = length;
+	USB_Reg->ENDPTPRIME |= bit;
+}
 
-	/* prime the endpoint for transmit */
-	USB_Reg->ENDPTPRIME |= _BIT( EP_Physical2BitPosition(PhyEP) ) ;
+/* Retire the oldest completed descriptor of a direction and return the byte count it moved,
+ * or -1 if the oldest descriptor is still active.
+ */
+static int32_t UsbdDcdRetireISO(uint8_t dir)
+{
+	ROM_ISO_RING_T *ring = &Rom_ISO_Ring[dir];
+	uint8_t idx = ring->Done & (ROM_ISO_DTDS - 1);
+	DeviceTransferDescriptor *pDTD = &Rom_ISO_dTD[dir][idx];
+
+	if ((ring->Done == ring->Next) || pDTD->Active) {
+		return -1;
+	}
+	ring->Done++;
+	if (ring->Done == ring->Next) {
+		ring->Tail = NULL;
+	}
+	return (int32_t) (ring->Length[idx] - pDTD->TotalBytes);
 }
 
+#if (USBD_ADC_FEEDBACK)
+/* Nominal feedback for the current rate: 16.16 samples per microframe at high
+ * speed, 10.14 samples per frame at full speed.
+ */
+static uint32_t UsbdAdc_NominalFeedback(void)
+{
+	if ((USB_REG(USBPort)->PORTSC1_D & PORTSC1_D_PSPD_MASK) == PORTSC1_D_PSPD_HS) {
+		return (uint32_t) (((uint64_t) CurrentAudioSampleFrequency << 16) / 8000);
+	}
+	return (uint32_t) (((uint64_t) CurrentAudioSampleFrequency << 14) / 1000);
+}
+
+/* Queue the next explicit feedback packet */
+static void UsbdAdc_QueueFeedback(void)
+{
+	uint32_t *pValue = &Rom_Feedback[Rom_ISO_Ring[1].Next & (ROM_ISO_DTDS - 1)];
+
+	if (UsbdDcdISOFull(1)) {
+		return;
+	}
+	*pValue = CALLBACK_UsbdAdc_GetFeedbackValue(UsbdAdc_NominalFeedback());
+	UsbdDcdQueueISO(USB_ENDPOINT_IN(ISOEndpointNumber), (uint8_t *) pValue,
+					((USB_REG(USBPort)->PORTSC1_D & PORTSC1_D_PSPD_MASK) == PORTSC1_D_PSPD_HS) ? 4 : 3);
+}
+#endif
+
 /** Initialize USBD ADC driver */
 void UsbdAdc_Init(USB_ClassInfo_Audio_Device_t* AudioInterface)
 {
 	uint32_t ep_indx;
+#if (USB_FORCED_FULLSPEED)
 	USBD_API->hw->ForceFullSpeed(UsbHandle,1);
+#endif
 
 	/* register ep0 handler */
 	USBD_API->core->RegisterClassHandler(UsbHandle, UsbdAdc_ep0_hdlr, NULL);
 	
+#ifdef USB_AUDIO_2DOT0
+	AdcInterface = AudioInterface;
+#endif
 	StreamInterfaceNumber = AudioInterface->Config.StreamingInterfaceNumber;
 	ControlInterfaceNumber = AudioInterface->Config.ControlInterfaceNumber;
 	USBPort = AudioInterface->Config.PortNumber;
-	/* register ISO OUT endpoint interrupt handler */
+	/* register ISO OUT endpoint interrupt handler, with Audio 2.0 the IN side of
+	   the same endpoint number carries the explicit feedback */
 	if(AudioInterface->Config.DataOUTEndpointNumber)
 	{
 		ISOEndpointNumber = AudioInterface->Config.DataOUTEndpointNumber;
+		ISOMaxPacketSize = AudioInterface->Config.DataOUTEndpointSize;
 		ep_indx = ((ISOEndpointNumber & 0x0F) << 1);
 		USBD_API->core->RegisterEpHandler (UsbHandle, ep_indx, UsbdAdc_ISO_Hdlr, NULL);
+#if (USBD_ADC_FEEDBACK)
+		USBD_API->core->RegisterEpHandler (UsbHandle, ep_indx + 1, UsbdAdc_ISO_Hdlr, NULL);
+#endif
 	}
 	else if(AudioInterface->Config.DataINEndpointNumber)
 	{
 		ISOEndpointNumber = AudioInterface->Config.DataINEndpointNumber;
+		ISOMaxPacketSize = AudioInterface->Config.DataINEndpointSize;
 		ep_indx = ((ISOEndpointNumber & 0x0F) << 1) + 1;
 		USBD_API->core->RegisterEpHandler (UsbHandle, ep_indx, UsbdAdc_ISO_Hdlr, NULL);
 	}
 
 }
 
+#ifndef USB_AUDIO_2DOT0
 /**----------------------------------------------------------------------------
   ADC_IF_GetRequest: Audio Device Class Interface Get Request Callback
     Called automatically on ADC Interface Get Request
@@ -315,11 +430,10 @@ ErrorCode_t ADC_EP_SetRequest (USB_CORE_CTRL_T* pCtrl)
             if (pCtrl->SetupPacket.wValue.WB.H == AUDIO_CONTROL_SAMPLING_FREQ) {
                 rate = pCtrl->EP0Buf[0] | (pCtrl->EP0Buf[1] << 8) | (pCtrl->EP0Buf[2] << 16);
                 if (pCtrl->SetupPacket.bRequest == AUDIO_REQUEST_SET_CUR) {
-                	CurrentAudioSampleFrequency = rate;
-                	if(CurrentAudioSampleFrequency <= AUDIO_MAX_SAMPLE_FREQ)
-                	{
-				Audio_Init(CurrentAudioSampleFrequency);
-                      ret = LPC_OK;
+                    /* rates the I2S clock cannot reach are stalled */
+                    if (Audio_Init(rate)) {
+                        CurrentAudioSampleFrequency = rate;
+                        ret = LPC_OK;
                     }
                 }
             }
@@ -327,6 +441,7 @@ ErrorCode_t ADC_EP_SetRequest (USB_CORE_CTRL_T* pCtrl)
     }
     return (ret);  /* Not Supported */
 }
+#endif
 
 /**----------------------------------------------------------------------------
   Override standard Interface Event
@@ -363,6 +478,7 @@ uint32_t TransferDelayidx=0;
 volatile uint8_t Event_store[128];
 #endif
 
+#ifndef USB_AUDIO_2DOT0
 /**----------------------------------------------------------------------------
   Audio Class handler
  *----------------------------------------------------------------------------*/
@@ -462,6 +578,77 @@ ErrorCode_t UsbdAdc_ep0_hdlr(USBD_HANDLE_T hUsb, void* data, uint32_t event)
     }  
     return ret;
 }
+#else
+/**----------------------------------------------------------------------------
+  Audio Class handler, Audio 2.0
+    CUR and RANGE requests go to the entities of the control interface: the
+    clock sources, the clock selector and the feature unit. They are answered
+    by CALLBACK_Audio_Device_GetSetProperty(), the callback the LPCUSBlib
+    class driver uses, so both stacks present the same controls.
+ *----------------------------------------------------------------------------*/
+ErrorCode_t UsbdAdc_ep0_hdlr(USBD_HANDLE_T hUsb, void* data, uint32_t event)
+{
+    USB_CORE_CTRL_T* pCtrl = (USB_CORE_CTRL_T*)hUsb;
+    uint8_t RequestType = pCtrl->SetupPacket.bmRequestType.B;
+    uint8_t Request = pCtrl->SetupPacket.bRequest;
+    uint8_t EntityID = pCtrl->SetupPacket.wIndex.WB.H;
+    uint8_t Control = pCtrl->SetupPacket.wValue.WB.H;
+    uint16_t Length;
+
+    if ((pCtrl->SetupPacket.bmRequestType.BM.Type != REQUEST_CLASS) ||
+        (pCtrl->SetupPacket.bmRequestType.BM.Recipient != REQUEST_TO_INTERFACE) ||
+        (pCtrl->SetupPacket.wIndex.WB.L != ControlInterfaceNumber)) {
+        return ERR_USBD_UNHANDLED;
+    }
+    /* MEM is not supported */
+    if ((Request != AUDIO_REQUEST_CUR) && (Request != AUDIO_REQUEST_RANGE)) {
+        return ERR_USBD_INVALID_REQ;
+    }
+
+    switch (event) {
+    case USB_EVT_SETUP:
+        if (pCtrl->SetupPacket.bmRequestType.BM.Dir) {
+            /* Length holds the buffer capacity on entry to the callback and the reply length on return */
+            Length = MIN(pCtrl->SetupPacket.wLength, sizeof(Adc_ControlBuffer));
+            if (!CALLBACK_Audio_Device_GetSetProperty(AdcInterface, RequestType, Request, EntityID, Control,
+                                                      &Length, Adc_ControlBuffer)) {
+                return ERR_USBD_INVALID_REQ;
+            }
+            pCtrl->EP0Data.pData = Adc_ControlBuffer;                      /* point to data to be sent */
+            pCtrl->EP0Data.Count = MIN(Length, pCtrl->SetupPacket.wLength);
+            USBD_API->core->DataInStage(pCtrl);                             /* send requested data */
+        }
+        else {
+            /* Only check the control is supported, the value arrives with USB_EVT_OUT */
+            if ((pCtrl->SetupPacket.wLength > sizeof(Adc_ControlBuffer)) ||
+                !CALLBACK_Audio_Device_GetSetProperty(AdcInterface, RequestType, Request, EntityID, Control,
+                                                      NULL, NULL)) {
+                return ERR_USBD_INVALID_REQ;
+            }
+            pCtrl->EP0Data.pData = Adc_ControlBuffer;                      /* data to be received */
+        }
+        return LPC_OK;
+
+    case USB_EVT_OUT:
+        /* The status stage of a GET is left to the core */
+        if (pCtrl->SetupPacket.bmRequestType.BM.Dir) {
+            break;
+        }
+        Length = pCtrl->SetupPacket.wLength;
+        /* A value the application rejects stalls the status stage */
+        if (!CALLBACK_Audio_Device_GetSetProperty(AdcInterface, RequestType, Request, EntityID, Control,
+                                                  &Length, Adc_ControlBuffer)) {
+            return ERR_USBD_INVALID_REQ;
+        }
+        USBD_API->core->StatusInStage(pCtrl);                               /* send Acknowledge */
+        return LPC_OK;
+
+    default:
+        break;
+    }
+    return ERR_USBD_UNHANDLED;
+}
+#endif
 
 /**----------------------------------------------------------------------------
   Audio Start Transfer Callback
@@ -472,13 +659,19 @@ void UsbdAdc_start_xfr(void)
 	uint32_t ISO_buffer_address;
 	/* reset audio buffer */
 	Audio_Reset_Data_Buffer();
-	ISO_buffer_address = CALLBACK_HAL_GetISOBufferAddress(USB_ENDPOINT_IN(ISOEndpointNumber), &ISO_packet_size);
-	if(ISO_buffer_address != 0)
-		UsbdDcdDataTransfer(USB_ENDPOINT_IN(ISOEndpointNumber), (uint8_t*)ISO_buffer_address, ISO_packet_size);
+	memset(Rom_ISO_Ring, 0, sizeof(Rom_ISO_Ring));
 
+#if (USBD_ADC_FEEDBACK)
+	/* Keep two feedback packets queued so one is always ready for the host */
+	UsbdAdc_QueueFeedback();
+	UsbdAdc_QueueFeedback();
+#endif
+
+	/* Data goes straight into the audio ring. Only one OUT descriptor is in flight
+	   because the next write address depends on the size of the packet received. */
 	ISO_buffer_address = CALLBACK_HAL_GetISOBufferAddress(ISOEndpointNumber, &ISO_packet_size);
 	if(ISO_buffer_address != 0)
-		UsbdDcdDataTransfer(ISOEndpointNumber, (uint8_t*)ISO_buffer_address, 512);
+		UsbdDcdQueueISO(ISOEndpointNumber, (uint8_t*)ISO_buffer_address, USB_DATA_BUFFER_TEM_LENGTH);
 }
 
 /**----------------------------------------------------------------------------
@@ -490,7 +683,10 @@ void UsbdAdc_stop_xfr(void)
 	/* reset audio buffer */
 	Audio_Reset_Data_Buffer();
 	USBD_API->hw->ResetEP(UsbHandle, ISOEndpointNumber);
+#if (USBD_ADC_FEEDBACK)
 	USBD_API->hw->ResetEP(UsbHandle, USB_ENDPOINT_IN(ISOEndpointNumber));
+#endif
+	memset(Rom_ISO_Ring, 0, sizeof(Rom_ISO_Ring));
 }
 
 
@@ -500,23 +696,25 @@ void UsbdAdc_stop_xfr(void)
 ErrorCode_t UsbdAdc_ISO_Hdlr (USBD_HANDLE_T hUsb, void* data, uint32_t event)
 {
 	uint32_t ISO_buffer_address;
+	int32_t size;
 
 	if (event == USB_EVT_OUT) {
-		ISO_packet_size = Usbd_GetTransferSize((USB_CORE_CTRL_T *) hUsb, ISOEndpointNumber);
-		if (ISO_packet_size != 0) {
-			ISO_packet_size = ISO_packet_size;
+		while ((size = UsbdDcdRetireISO(0)) >= 0) {
+			ISO_packet_size = (uint32_t) size;
+			/* Hand the received bytes over and queue the next zero-copy buffer */
+			ISO_buffer_address = CALLBACK_HAL_GetISOBufferAddress(ISOEndpointNumber, &ISO_packet_size);
+			UsbdDcdQueueISO(ISOEndpointNumber, (uint8_t *) ISO_buffer_address, USB_DATA_BUFFER_TEM_LENGTH);
 		}
-		/* Send DMA request */
-		ISO_buffer_address = CALLBACK_HAL_GetISOBufferAddress(ISOEndpointNumber, &ISO_packet_size);
-		UsbdDcdDataTransfer(ISOEndpointNumber, (uint8_t *) ISO_buffer_address, 512);
 	}
 
+#if (USBD_ADC_FEEDBACK)
 	if (event == USB_EVT_IN)
 	{
-		/* Send DMA request */
-		ISO_buffer_address = CALLBACK_HAL_GetISOBufferAddress(USB_ENDPOINT_IN(ISOEndpointNumber), &ISO_packet_size);
-		UsbdDcdDataTransfer(USB_ENDPOINT_IN(ISOEndpointNumber), (uint8_t*)ISO_buffer_address, ISO_packet_size);
+		while (UsbdDcdRetireISO(1) >= 0) {
+			UsbdAdc_QueueFeedback();
+		}
 	}
+#endif
 
     return LPC_OK;
 }
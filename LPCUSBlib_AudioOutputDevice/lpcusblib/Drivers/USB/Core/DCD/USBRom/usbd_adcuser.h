@@ -89,6 +89,16 @@ extern ErrorCode_t UsbdAdc_ISO_Hdlr (USBD_HANDLE_T hUsb, void* data, uint32_t ev
  */
 extern ErrorCode_t UsbdAdc_ep0_hdlr(USBD_HANDLE_T hUsb, void* data, uint32_t event);
 
+/**
+ * @brief	Explicit feedback value callback, called from the ISO IN handler
+ * @param	Nominal		: Feedback for the current sample rate, 16.16 samples per
+ *						  microframe at high speed or 10.14 samples per frame at full speed
+ * @return	Feedback value to send to the host, in the same format as Nominal
+ * @note	The default implementation returns Nominal. The application overrides it
+ *			to steer the host by the fill level of its audio buffer.
+ */
+extern uint32_t CALLBACK_UsbdAdc_GetFeedbackValue(uint32_t Nominal);
+
 /**
  * @}
  */
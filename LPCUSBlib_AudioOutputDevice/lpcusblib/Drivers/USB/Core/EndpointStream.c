@@ -127,8 +127,37 @@ uint8_t Endpoint_Read_Stream_BE(void *const Buffer,
 uint8_t Endpoint_Write_Control_Stream_LE(uint8_t corenum, const void *const Buffer,
 										 uint16_t Length)
 {
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	const uint8_t *Data = (const uint8_t *) Buffer;
+	uint16_t Sent = MIN(Length, USB_ControlRequest.wLength);
+	uint16_t Remaining = Sent;
+
+	/* Copy the data stage through the EP0 DMA buffer a buffer at a time. Each chunk is
+	   queued as one transfer descriptor which the controller splits into packets, so
+	   descriptors longer than the buffer no longer overrun it. */
+	do {
+		uint16_t Chunk = MIN(Remaining, USB_DATA_BUFFER_TEM_LENGTH);
+
+		while (!Endpoint_IsINReady(corenum)) ;
+		memcpy(usb_data_buffer[corenum], Data, Chunk);
+		usb_data_buffer_index[corenum] = Chunk;
+		Endpoint_ClearIN(corenum);
+
+		Data      += Chunk;
+		Remaining -= Chunk;
+	} while (Remaining);
+
+	/* A short reply ending on a full packet is terminated with a zero length packet,
+	   otherwise the host keeps waiting for the rest of wLength */
+	if (Sent && (Sent < USB_ControlRequest.wLength) && !(Sent % USB_Device_ControlEndpointSize)) {
+		while (!Endpoint_IsINReady(corenum)) ;
+		usb_data_buffer_index[corenum] = 0;
+		Endpoint_ClearIN(corenum);
+	}
+#else
 	Endpoint_Write_Stream_LE(corenum, (uint8_t *) Buffer, MIN(Length, USB_ControlRequest.wLength), NULL);
 	Endpoint_ClearIN(corenum);
+#endif
 	//  while (!(Endpoint_IsOUTReceived()))
 	//  {
 	//  }
@@ -144,9 +173,33 @@ uint8_t Endpoint_Write_Control_Stream_BE(const void *const Buffer,
 uint8_t Endpoint_Read_Control_Stream_LE(uint8_t corenum, void *const Buffer,
 										uint16_t Length)
 {
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	uint8_t *Data = (uint8_t *) Buffer;
+	uint16_t Remaining = MIN(Length, USB_ControlRequest.wLength);
+	uint16_t Chunk;
+
+	/* Copy the data stage out of the EP0 DMA buffer a buffer at a time. The first chunk
+	   lands in the descriptor the NAK interrupt queued, each further one is queued here
+	   as one transfer descriptor of exactly its length, so it also completes when the
+	   data stage ends on a full packet. */
+	do {
+		while (!Endpoint_IsOUTReceived(corenum)) ;
+		Chunk = MIN(Remaining, usb_data_buffer_size[corenum]);
+		memcpy(Data, usb_data_buffer[corenum], Chunk);
+		Endpoint_ClearOUT(corenum);
+
+		Data      += Chunk;
+		Remaining -= Chunk;
+		if (Remaining && Chunk) {
+			usb_data_buffer_size[corenum] = 0;
+			DcdDataTransfer(corenum, 0, usb_data_buffer[corenum], MIN(Remaining, USB_DATA_BUFFER_TEM_LENGTH));
+		}
+	} while (Remaining && Chunk);		/* A short data stage ends early */
+#else
 	while (!Endpoint_IsOUTReceived(corenum)) ;	// FIXME: this safe checking is fine for LPC18xx
 	Endpoint_Read_Stream_LE(corenum, Buffer, Length, NULL);		// but hangs LPC17xx --> comment out
 	Endpoint_ClearOUT(corenum);
+#endif
 	return ENDPOINT_RWCSTREAM_NoError;
 }
 
@@ -105,6 +105,10 @@ void HAL_USBInit(uint8_t corenum)
 		coreEnabled[corenum] = true;
 	}
 
+	/* Cycle counter used to time control requests */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
 #if defined(USB_CAN_BE_DEVICE) && (!defined(USB_DEVICE_ROM_DRIVER))
 	/* reset the controller */
 	USB_REG(corenum)->USBCMD_D = USBCMD_D_Reset;
@@ -184,7 +188,7 @@ void HAL_DisableUSBInterrupt(uint8_t corenum)
 	NVIC_DisableIRQ((corenum) ? USB1_IRQn : USB0_IRQn);	//  disable USB interrupts
 }
 
-void USB0_IRQHandler(void)
+USB_RAMFUNC void USB0_IRQHandler(void)
 {
 	if (USB_CurrentMode[0] == USB_MODE_Host) {
 		#ifdef USB_CAN_BE_HOST
@@ -202,7 +206,7 @@ void USB0_IRQHandler(void)
 	}
 }
 
-void USB1_IRQHandler(void)
+USB_RAMFUNC void USB1_IRQHandler(void)
 {
 	if (USB_CurrentMode[1] == USB_MODE_Host) {
 		#ifdef USB_CAN_BE_HOST
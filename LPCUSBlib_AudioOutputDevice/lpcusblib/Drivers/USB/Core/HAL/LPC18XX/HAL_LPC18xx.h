@@ -42,13 +42,29 @@
 #define  __INCLUDE_FROM_USB_DRIVER
 #include "../../USBMode.h"
 
+/* Bank of the queue heads, transfer descriptors and stack buffers */
+#ifndef USBRAM_SECTION
 #define USBRAM_SECTION  RAM2
+#endif
 
 #if defined(__ICCARM__)
 	#define __BSS(x)       @ ".ahb_sram1"
 #elif defined(__CC_ARM)
 	#define __BSS(x)
 #endif
+
+/* Placement of the device interrupt path: local SRAM by default, fetched on the
+   I-code bus without the flash accelerator wait states. Define USB_RAMFUNC
+   empty to keep it in flash. */
+#ifndef USB_RAMFUNC
+#if defined(__ICCARM__)
+	#define USB_RAMFUNC    __ramfunc
+#elif defined(__CC_ARM)
+	#define USB_RAMFUNC
+#else
+	#define USB_RAMFUNC    __RAMFUNC(RAM)
+#endif
+#endif
 /* bit defines for DEVICEADDR register. */
 #define USBDEV_ADDR_AD  (1 << 24)
 #define USBDEV_ADDR(n)  (((n) & 0x7F) << 25)
@@ -73,7 +73,36 @@ static void USB_DeviceTask(uint8_t corenum)
 		Endpoint_SelectEndpoint(corenum, ENDPOINT_CONTROLEP);
 
 		if (Endpoint_IsSETUPReceived(corenum))
-		  USB_Device_ProcessControlRequest(corenum);
+		{
+		#if defined(__LPC18XX__) || defined(__LPC43XX__)
+			volatile USB_ControlLatency_t* Latency = &USB_ControlLatency[corenum];
+			uint32_t Start = DWT->CYCCNT;
+			uint32_t Cycles;
+
+			/* Before the request releases the SETUP latch and a new SETUP restamps it */
+			Cycles = Start - Latency->SetupCycle;
+			Latency->LastQueueCycles = Cycles;
+			if (Cycles > Latency->MaxQueueCycles)
+			  Latency->MaxQueueCycles = Cycles;
+
+			TRACE_PROBE_ENTER(USB_TRACE_CONTROL, corenum);
+			USB_Device_ProcessControlRequest(corenum);
+			TRACE_PROBE_EXIT(USB_TRACE_CONTROL, corenum);
+			TRACE_PROBE_POINT(USB_TRACE_REQUEST, (USB_ControlRequest.bmRequestType << 8) | USB_ControlRequest.bRequest);
+
+			/* Left pending by every handler: let the next interrupt report it again */
+			if (Endpoint_IsSETUPReceived(corenum))
+			  USB_SetupLatched[corenum] = false;
+
+			Cycles = DWT->CYCCNT - Start;
+			Latency->LastServiceCycles = Cycles;
+			if (Cycles > Latency->MaxServiceCycles)
+			  Latency->MaxServiceCycles = Cycles;
+			Latency->Requests++;
+		#else
+			USB_Device_ProcessControlRequest(corenum);
+		#endif
+		}
 
 		Endpoint_SelectEndpoint(corenum, PrevEndpoint);
 	}
@@ -240,12 +240,44 @@ uint8_t Joystick_GetStatus(void);
 uint32_t Buttons_GetStatus (void);
 
 /**
- * @brief	Initialize I2S interface for the board and UDA1380
+ * @brief Audio output found by the codec bring-up
+ */
+typedef enum {
+	BOARD_AUDIO_CODEC_NONE,			/*!< Bring-up not started */
+	BOARD_AUDIO_CODEC_PENDING,		/*!< Bring-up running, keep calling Board_Audio_CodecPoll() */
+	BOARD_AUDIO_CODEC_WM8904,		/*!< WM8904 codec set up over I2C */
+	BOARD_AUDIO_CODEC_MAX98357A,	/*!< No codec answered, MAX98357A amps only */
+	BOARD_AUDIO_CODEC_FAILED,		/*!< A WM8904 answered but its set up failed */
+} BOARD_AUDIO_CODEC_T;
+
+/**
+ * @brief	Initialize I2S interface for the board and start the codec bring-up
  * @param	pI2S	: Pointer to I2S register interface used on this board
  * @return	Nothing
+ * @note	Does not wait for the codec, see Board_Audio_CodecPoll().
  */
 void Board_Audio_Init(LPC_I2S_T *pI2S);
 
+/**
+ * @brief	Start the codec bring-up, once, does nothing when already started
+ * @return	Nothing
+ */
+void Board_Audio_CodecStart(void);
+
+/**
+ * @brief	Advance the codec bring-up
+ * @return	BOARD_AUDIO_CODEC_PENDING while it runs, then the codec found
+ * @note	Bounded: at most one I2C transfer with a timeout per call. Keep calling
+ *			it from the main loop afterwards, it times out stuck codec control.
+ */
+BOARD_AUDIO_CODEC_T Board_Audio_CodecPoll(void);
+
+/**
+ * @brief	Get the codec found by the bring-up
+ * @return	A BOARD_AUDIO_CODEC_T value
+ */
+BOARD_AUDIO_CODEC_T Board_Audio_GetCodec(void);
+
 /**
  * @brief	Initialize DAC
  * @param	pDAC	: Pointer to DAC register interface used on this board
@@ -0,0 +1,174 @@
+/*
+ * @brief Memory to memory copies and fills on a GPDMA channel
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+
+#ifndef _DMA_COPY_H
+#define _DMA_COPY_H
+
+#include "chip.h"
+
+/** @defgroup BOARD_COMMON_DMA_COPY BOARD: DMA memory copy service
+ * @ingroup BOARD_Common
+ * Runs memcpy() and memset() style moves on a low priority channel from the
+ * DMA manager, so a large move goes on while the core does other work. Each
+ * request is a caller owned handle that lives until the move completes: the
+ * caller either checks or waits on its Status, or gets its Callback from the
+ * DMA interrupt. Requests made while the channel is busy are queued.
+ *
+ * A move shorter than DMA_COPY_THRESHOLD bytes is done by the CPU at once,
+ * before the call returns: programming the channel and taking its interrupt
+ * costs more than the CPU needs for it. So does a move whose addresses are
+ * not word aligned, or any move when no channel could be had. The bytes after
+ * the last whole word are always copied by the CPU, at submission.
+ *
+ * The DMA moves words in bursts of 32, from the source on AHB master 0 to the
+ * destination on AHB master 1, in linked lists of DMA_COPY_ITEMS items of at
+ * most 4095 words; a longer move continues from the interrupt.
+ * @{
+ */
+
+/** Moves shorter than this, in bytes, are done by the CPU */
+#ifndef DMA_COPY_THRESHOLD
+#define DMA_COPY_THRESHOLD          256
+#endif
+/** Linked list items the service takes from the DMA manager pool */
+#ifndef DMA_COPY_ITEMS
+#define DMA_COPY_ITEMS              4
+#endif
+
+/**
+ * @brief Request status
+ */
+typedef enum {
+	DMA_COPY_IDLE,			/*!< Never submitted */
+	DMA_COPY_QUEUED,		/*!< Waiting for the channel */
+	DMA_COPY_BUSY,			/*!< On the channel */
+	DMA_COPY_DONE,			/*!< Destination written */
+	DMA_COPY_FAILED,		/*!< Bus error, the destination is incomplete */
+} DMA_COPY_STATUS_T;
+
+typedef struct DMA_COPY DMA_COPY_T;
+
+/** Completion callback, from the DMA interrupt, or from the submitting call for a CPU move */
+typedef void (*DMA_COPY_CALLBACK_T)(DMA_COPY_T *Copy);
+
+/**
+ * @brief One move
+ */
+struct DMA_COPY {
+	uint32_t Dst;					/*!< Destination address */
+	uint32_t Src;					/*!< Source address, &Pattern for a fill */
+	uint32_t Words;					/*!< Whole words the DMA moves */
+	uint32_t Pattern;				/*!< Fill value, repeated in every byte */
+	DMA_COPY_CALLBACK_T Callback;	/*!< Called on completion, may be NULL */
+	volatile DMA_COPY_STATUS_T Status;
+	uint32_t Done;					/*!< Words moved, owned by the service */
+	DMA_COPY_T *Next;				/*!< Queue link, owned by the service */
+};
+
+/**
+ * @brief Service counters
+ */
+typedef struct {
+	uint32_t DmaMoves;		/*!< Moves run on the DMA */
+	uint32_t DmaBytes;		/*!< Bytes moved by the DMA */
+	uint32_t CpuMoves;		/*!< Moves done by the CPU instead */
+	uint32_t CpuBytes;		/*!< Bytes moved by the CPU, tails included */
+	uint32_t Errors;		/*!< Moves that ended on a bus error */
+} DMA_COPY_STATS_T;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief	Take the channel and list items of the service from the DMA manager
+ * @return	false if none were free, every move is then done by the CPU
+ */
+bool DMA_Copy_Init(void);
+
+/**
+ * @brief	Copy memory, on the DMA when it is worth it
+ * @param	Copy	: Request handle, must live until its Status is DMA_COPY_DONE or DMA_COPY_FAILED
+ * @param	dst		: Destination, must not overlap the source
+ * @param	src		: Source
+ * @param	Bytes	: Bytes to copy
+ * @param	Callback: Called on completion, may be NULL
+ * @return	Nothing
+ */
+void DMA_Memcpy(DMA_COPY_T *Copy, void *dst, const void *src, uint32_t Bytes, DMA_COPY_CALLBACK_T Callback);
+
+/**
+ * @brief	Fill memory with a byte value, on the DMA when it is worth it
+ * @param	Copy	: Request handle, must live until its Status is DMA_COPY_DONE or DMA_COPY_FAILED
+ * @param	dst		: Destination
+ * @param	Value	: Byte value
+ * @param	Bytes	: Bytes to fill
+ * @param	Callback: Called on completion, may be NULL
+ * @return	Nothing
+ */
+void DMA_Memset(DMA_COPY_T *Copy, void *dst, uint8_t Value, uint32_t Bytes, DMA_COPY_CALLBACK_T Callback);
+
+/**
+ * @brief	Check whether a move has ended
+ * @param	Copy	: Request handle
+ * @return	true once the move completed or failed
+ */
+STATIC INLINE bool DMA_Copy_IsDone(const DMA_COPY_T *Copy)
+{
+	return (Copy->Status == DMA_COPY_DONE) || (Copy->Status == DMA_COPY_FAILED);
+}
+
+/**
+ * @brief	Wait for a move, a failed one is redone by the CPU
+ * @param	Copy	: Request handle
+ * @return	Nothing
+ * @note	Needs the DMA interrupt: not for interrupts of its priority or above.
+ */
+void DMA_Copy_Wait(DMA_COPY_T *Copy);
+
+/**
+ * @brief	Copy the service counters
+ * @param	Stats	: Where the counters are copied
+ * @return	Nothing
+ */
+void DMA_Copy_GetStats(DMA_COPY_STATS_T *Stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _DMA_COPY_H */
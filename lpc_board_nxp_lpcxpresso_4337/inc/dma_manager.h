@@ -0,0 +1,224 @@
+/*
+ * @brief GPDMA channel manager
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+
+#ifndef _DMA_MANAGER_H
+#define _DMA_MANAGER_H
+
+#include "chip.h"
+
+/** @defgroup BOARD_COMMON_DMA_MANAGER BOARD: GPDMA channel manager
+ * @ingroup BOARD_Common
+ * Shares the 8 GPDMA channels between the drivers that use them. A channel is
+ * either reserved by number, for a stream that must always get the same one,
+ * or allocated by priority: the controller serves channel 0 first, so a high
+ * priority request gets the lowest free channel and a low priority one (bulk
+ * memory moves) the highest.
+ *
+ * The manager owns DMA_IRQHandler(). It scans the terminal count and error
+ * status of all channels at once and calls the callback of each channel that
+ * interrupted, channel 0 first, from the DMA interrupt. Per channel counters
+ * of transfers, completions, errors and the cycles the channel was running
+ * show how busy the controller is.
+ *
+ * Linked list items for scatter-gather transfers come from a pool of
+ * DMA_MANAGER_DESCRIPTORS aligned descriptors, in contiguous blocks, so no
+ * driver needs its own descriptor array.
+ *
+ * Allocation and the descriptor pool may be used from any context; starting,
+ * stopping and freeing a channel belongs to its owner.
+ * @{
+ */
+
+/** Linked list items in the descriptor pool, at most 32 */
+#ifndef DMA_MANAGER_DESCRIPTORS
+#define DMA_MANAGER_DESCRIPTORS     16
+#endif
+/** Priority of the DMA interrupt that runs the completion callbacks */
+#ifndef DMA_MANAGER_IRQ_PRIORITY
+#define DMA_MANAGER_IRQ_PRIORITY    1
+#endif
+
+/** Returned when no channel could be allocated or reserved */
+#define DMA_MANAGER_NO_CHANNEL      0xFF
+
+/**
+ * @brief Allocation priority
+ */
+typedef enum {
+	DMA_PRIORITY_HIGH,		/*!< Lowest free channel, served first by the controller */
+	DMA_PRIORITY_LOW,		/*!< Highest free channel */
+} DMA_MANAGER_PRIORITY_T;
+
+/**
+ * @brief Event passed to a channel callback
+ */
+typedef enum {
+	DMA_EVENT_COMPLETE,		/*!< Terminal count of an item with its interrupt bit set */
+	DMA_EVENT_ERROR,		/*!< Bus error, the channel was disabled by the controller */
+} DMA_MANAGER_EVENT_T;
+
+/** Channel callback, called from the DMA interrupt */
+typedef void (*DMA_MANAGER_CALLBACK_T)(uint8_t Channel, DMA_MANAGER_EVENT_T Event, void *Arg);
+
+/**
+ * @brief Counters of one channel, they wrap, compare two readings
+ */
+typedef struct {
+	uint32_t Allocations;	/*!< Times the channel was allocated or reserved */
+	uint32_t Transfers;		/*!< Transfers started */
+	uint32_t Completions;	/*!< Terminal count interrupts */
+	uint32_t Errors;		/*!< Error interrupts */
+	uint32_t BusyCycles;	/*!< Core cycles the channel was running */
+} DMA_MANAGER_STATS_T;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief	Initialise the GPDMA controller and the manager, once
+ * @return	Nothing
+ * @note	Later calls return at once, so every driver may call it.
+ */
+void DMA_Manager_Init(void);
+
+/**
+ * @brief	Allocate a free channel by priority
+ * @param	Priority	: DMA_PRIORITY_HIGH or DMA_PRIORITY_LOW
+ * @param	Callback	: Called on completion and error, may be NULL
+ * @param	Arg			: Passed to the callback
+ * @return	Channel number, DMA_MANAGER_NO_CHANNEL when all are in use
+ */
+uint8_t DMA_Manager_Alloc(DMA_MANAGER_PRIORITY_T Priority, DMA_MANAGER_CALLBACK_T Callback, void *Arg);
+
+/**
+ * @brief	Reserve one channel by number
+ * @param	Channel		: Channel number, 0 to 7
+ * @param	Callback	: Called on completion and error, may be NULL
+ * @param	Arg			: Passed to the callback
+ * @return	Channel, DMA_MANAGER_NO_CHANNEL when it is in use
+ */
+uint8_t DMA_Manager_Reserve(uint8_t Channel, DMA_MANAGER_CALLBACK_T Callback, void *Arg);
+
+/**
+ * @brief	Stop a channel and give it back
+ * @param	Channel	: Channel allocated or reserved
+ * @return	Nothing
+ */
+void DMA_Manager_Free(uint8_t Channel);
+
+/**
+ * @brief	Start a single block transfer, see Chip_GPDMA_Transfer()
+ * @param	Channel	: Channel allocated or reserved, not running
+ * @param	src		: Source address or peripheral connection
+ * @param	dst		: Destination address or peripheral connection
+ * @param	Type	: Transfer type and flow control
+ * @param	Size	: Transfer size
+ * @return	SUCCESS, or ERROR when the channel is running
+ */
+Status DMA_Manager_Transfer(uint8_t Channel, uint32_t src, uint32_t dst,
+							GPDMA_FLOW_CONTROL_T Type, uint32_t Size);
+
+/**
+ * @brief	Start a scatter-gather transfer, see Chip_GPDMA_SGTransfer()
+ * @param	Channel	: Channel allocated or reserved, not running
+ * @param	Desc	: First item, its source or destination as a connection for a peripheral
+ * @param	Type	: Transfer type and flow control
+ * @return	SUCCESS, or ERROR when the channel is running
+ */
+Status DMA_Manager_SGTransfer(uint8_t Channel, const DMA_TransferDescriptor_t *Desc,
+							  GPDMA_FLOW_CONTROL_T Type);
+
+/**
+ * @brief	Stop the transfer running on a channel, the channel stays allocated
+ * @param	Channel	: Channel allocated or reserved
+ * @return	Nothing
+ */
+void DMA_Manager_Stop(uint8_t Channel);
+
+/**
+ * @brief	Check whether the transfer of a channel is still running
+ * @param	Channel	: Channel number
+ * @return	true while the controller has the channel enabled
+ */
+STATIC INLINE bool DMA_Manager_IsBusy(uint8_t Channel)
+{
+	return (LPC_GPDMA->ENBLDCHNS & (1 << Channel)) != 0;
+}
+
+/**
+ * @brief	Take a block of contiguous linked list items from the pool
+ * @param	Count	: Items wanted
+ * @return	First item, NULL when the pool has no such block free
+ */
+DMA_TransferDescriptor_t *DMA_Manager_AllocDescriptors(uint32_t Count);
+
+/**
+ * @brief	Give a block of linked list items back to the pool
+ * @param	Desc	: First item, as returned by DMA_Manager_AllocDescriptors()
+ * @param	Count	: Items in the block
+ * @return	Nothing
+ */
+void DMA_Manager_FreeDescriptors(DMA_TransferDescriptor_t *Desc, uint32_t Count);
+
+/**
+ * @brief	Copy the counters of a channel
+ * @param	Channel	: Channel number
+ * @param	Stats	: Where the counters are copied
+ * @return	Nothing
+ * @note	BusyCycles includes the running part of a transfer still in progress.
+ */
+void DMA_Manager_GetStats(uint8_t Channel, DMA_MANAGER_STATS_T *Stats);
+
+/**
+ * @brief	Tell which channels are allocated or reserved
+ * @return	Bit mask, bit n for channel n
+ */
+uint32_t DMA_Manager_InUse(void);
+
+/**
+ * @brief	DMA interrupt service of the manager
+ * @return	Nothing
+ * @note	DMA_IRQHandler() is provided and calls it.
+ */
+void DMA_Manager_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _DMA_MANAGER_H */
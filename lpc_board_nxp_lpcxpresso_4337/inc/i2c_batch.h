@@ -0,0 +1,171 @@
+/*
+ * @brief Interrupt driven I2C register batch engine
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#ifndef _I2C_BATCH_H
+#define _I2C_BATCH_H
+
+#include "chip.h"
+
+/** @defgroup BOARD_COMMON_I2C_BATCH BOARD: I2C register batch engine
+ * @ingroup BOARD_Common
+ * Queues whole register sequences for a device on an I2C bus and runs them
+ * from the I2C interrupt, one register access per transfer, so the caller
+ * never waits on the bus. The engine drives the controller through the I2CM
+ * transfer handler and only keeps its interrupt enabled while a batch is
+ * queued, the blocking LPCOpen I2C calls can use the bus in between once
+ * I2C_Batch_Flush() returned.
+ *
+ * A batch is caller owned memory that lives until the batch completes. Its
+ * completion is signalled by its Status and, from the interrupt, by its
+ * Callback. Submitting a batch that is still queued just lets the values
+ * written meanwhile go out with it; one already on the bus is run once more
+ * after it completes, so the device always ends up with the latest values.
+ *
+ * A transfer that does not complete in I2C_BATCH_TIMEOUT_MS is abandoned by
+ * I2C_Batch_Poll(), to be called from the main loop, and a failed transfer
+ * is retried I2C_BATCH_RETRIES times before its batch fails.
+ * @{
+ */
+
+/** Time one register transfer may take before it is abandoned, in ms */
+#ifndef I2C_BATCH_TIMEOUT_MS
+#define I2C_BATCH_TIMEOUT_MS        2
+#endif
+/** Retries of a failed transfer before its batch fails */
+#ifndef I2C_BATCH_RETRIES
+#define I2C_BATCH_RETRIES           2
+#endif
+
+/** I2C_BATCH_REG_T flag: read the register into Value instead of writing it */
+#define I2C_BATCH_READ              0x01
+
+/**
+ * @brief Batch status
+ */
+typedef enum {
+	I2C_BATCH_IDLE,			/*!< Never submitted */
+	I2C_BATCH_QUEUED,		/*!< Waiting for the bus */
+	I2C_BATCH_BUSY,			/*!< On the bus */
+	I2C_BATCH_DONE,			/*!< Every register access completed */
+	I2C_BATCH_FAILED,		/*!< A register access failed all its retries, Done tells which */
+} I2C_BATCH_STATUS_T;
+
+/**
+ * @brief One register access: 8 bit register address, 16 bit value sent MSB first
+ */
+typedef struct {
+	uint8_t Reg;			/*!< Register address */
+	uint8_t Flags;			/*!< I2C_BATCH_READ or 0 */
+	uint16_t Value;			/*!< Value written, or read */
+} I2C_BATCH_REG_T;
+
+typedef struct I2C_BATCH I2C_BATCH_T;
+
+/** Completion callback, called from the I2C interrupt, or from I2C_Batch_Poll() on a timeout */
+typedef void (*I2C_BATCH_CALLBACK_T)(I2C_BATCH_T *Batch);
+
+/**
+ * @brief Register sequence for one device
+ */
+struct I2C_BATCH {
+	uint8_t SlaveAddr;				/*!< 7-bit slave address */
+	uint8_t Count;					/*!< Entries in Regs */
+	I2C_BATCH_REG_T *Regs;			/*!< Register accesses, in bus order */
+	I2C_BATCH_CALLBACK_T Callback;	/*!< Called on completion, may be NULL */
+	volatile I2C_BATCH_STATUS_T Status;
+	volatile uint8_t Done;			/*!< Entries completed */
+	volatile bool Again;			/*!< Submitted again while on the bus, run once more */
+	I2C_BATCH_T *Next;				/*!< Queue link, owned by the engine */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief	Set up the engine on a bus
+ * @param	id		: I2C bus, already set up by its owner
+ * @return	Nothing
+ * @note	Call it once before the first I2C_Batch_Submit() on the bus.
+ */
+void I2C_Batch_Init(I2C_ID_T id);
+
+/**
+ * @brief	Queue a batch on a bus
+ * @param	id		: I2C bus, already set up by its owner
+ * @param	Batch	: Batch to run
+ * @return	false if the batch has no entries
+ * @note	Returns at once, the batch runs from the interrupt of the bus.
+ *			Safe to call from any interrupt, the queue is updated with interrupts masked.
+ */
+bool I2C_Batch_Submit(I2C_ID_T id, I2C_BATCH_T *Batch);
+
+/**
+ * @brief	Abandon a transfer that went over its time
+ * @param	id		: I2C bus
+ * @return	Nothing
+ * @note	Call it regularly from the main loop while batches may be queued.
+ */
+void I2C_Batch_Poll(I2C_ID_T id);
+
+/**
+ * @brief	Check if a bus still has batches queued
+ * @param	id		: I2C bus
+ * @return	true while a batch is queued or on the bus
+ */
+bool I2C_Batch_Busy(I2C_ID_T id);
+
+/**
+ * @brief	Wait until every batch queued on a bus completed
+ * @param	id		: I2C bus
+ * @return	Nothing
+ * @note	Bounded by the transfer timeout and retries, not for interrupt context.
+ */
+void I2C_Batch_Flush(I2C_ID_T id);
+
+/**
+ * @brief	I2C interrupt service of the engine
+ * @param	id		: I2C bus that interrupted
+ * @return	Nothing
+ * @note	I2C0_IRQHandler() and I2C1_IRQHandler() are provided and call it.
+ */
+void I2C_Batch_IRQHandler(I2C_ID_T id);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _I2C_BATCH_H */
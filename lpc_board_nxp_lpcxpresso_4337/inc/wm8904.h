@@ -36,16 +36,58 @@
  * @ingroup BOARD_Common
  * WM8904 Audio codec interface module, the module registers are accessed
  * using I2C. The board which uses this module must define WM8904_I2C_BUS to I2C0,
- * I2C1, etc, based on which I2C bus is connected to WM8904. All the
- * functions in this modules assumes that the I2C interrupt for WM8904_I2C_BUS
- * is enabled and Chip_I2C_MasterStateHandler(WM8904_I2C_BUS) is called from the
- * ISR. If the functions are to be used in polling mode the caller must replace
- * the event handler to Chip_I2C_EventHandlerPolling(), by using API
- * Chip_I2C_SetMasterEventHandler(). A macro I2CDEV_WM8904_ADDR must be defined
- * to the appropriate slave address of WM8904 audio codec.
+ * I2C1, etc, based on which I2C bus is connected to WM8904. A macro
+ * I2CDEV_WM8904_ADDR must be defined to the appropriate slave address of
+ * WM8904 audio codec.
+ *
+ * Every register transfer polls the bus itself and is abandoned after
+ * WM8904_I2C_TIMEOUT_MS, so a missing codec or a bus without pull-ups costs a
+ * bounded time instead of a hang. The bring-up runs as a state machine:
+ * WM8904_InitStart() then WM8904_InitPoll() until it stops returning
+ * WM8904_INIT_BUSY, each poll doing at most one transfer; the sequencer and
+ * FLL waits are deadlines checked by later polls, and a failed transfer is
+ * retried WM8904_I2C_RETRIES times after a pause.
+ *
+ * Once set up, volume, mute and rate changes are queued as register batches
+ * on the I2C batch engine (i2c_batch.h) and sent from the I2C interrupt, so
+ * they return at once. WM8904_ControlPoll() must then be called regularly.
  * @{
  */
 
+/** Value of WM8904_SW_RESET_AND_ID on a WM8904 */
+#define WM8904_DEVICE_ID                        0x8904
+
+/** I2C bus clock used for the codec */
+#ifndef WM8904_I2C_CLOCK_RATE
+#define WM8904_I2C_CLOCK_RATE                   100000
+#endif
+/** Time one register transfer may take before it is abandoned, in ms */
+#ifndef WM8904_I2C_TIMEOUT_MS
+#define WM8904_I2C_TIMEOUT_MS                   2
+#endif
+/** Retries of a failed transfer before the bring-up gives up */
+#ifndef WM8904_I2C_RETRIES
+#define WM8904_I2C_RETRIES                      3
+#endif
+/** Pause before a retry, in ms */
+#ifndef WM8904_RETRY_DELAY_MS
+#define WM8904_RETRY_DELAY_MS                   5
+#endif
+/** Time the write sequencer may still run after a delay entry, in ms */
+#ifndef WM8904_SEQUENCER_TIMEOUT_MS
+#define WM8904_SEQUENCER_TIMEOUT_MS             200
+#endif
+
+/**
+ * @brief WM8904 bring-up status
+ */
+typedef enum {
+	WM8904_INIT_BUSY,		/*!< Bring-up still running, poll again */
+	WM8904_INIT_DONE,		/*!< Codec set up and clocked */
+	WM8904_INIT_ABSENT,		/*!< No WM8904 answered on the bus */
+	WM8904_INIT_FAILED,		/*!< The codec answered but a step failed or timed out */
+} WM8904_INIT_STATUS_T;
+
 #define WM8904_CLK_MCLK                         1
 #define WM8904_CLK_FLL                          2
 
@@ -185,6 +227,14 @@
 
 #define WM8904_DAC_DIGITAL_1_VALUE              0x0240
 
+/* DAC digital volume: 0 is mute, then 0.375 dB steps up to 0xC0 = 0 dB */
+#define WM8904_DAC_VOL_MUTE                     0x00
+#define WM8904_DAC_VOL_0DB                      0xC0
+#define WM8904_DAC_VOL_MASK                     0xFF
+#define WM8904_DAC_VU                           0x0100	/* Latch both channel volumes */
+#define WM8904_DAC_MUTE                         0x0008	/* Soft mute, ramped by DAC_UNMUTE_RAMP */
+#define WM8904_FLL_ENA                          0x0005	/* FLL_FRACN_ENA=1, FLL_ENA=1 */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -245,9 +295,59 @@ int WM8904_REG_VerifyMult(uint8_t reg, const uint8_t *value, uint8_t *buff, int
  * @param	input	: Audio input source (Must be one of  WM8904_LINE_IN
  *                    or WM8904_MIC_IN_L or WM8904_MIC_IN_LR)
  * @return	1 on Success and 0 on failure
+ * @note	Blocks until WM8904_InitPoll() finishes, which is bounded.
  */
 int WM8904_Init(int input);
 
+/**
+ * @brief	Set up the I2C bus and start the WM8904 bring-up
+ * @param	input	: Audio input source, as for WM8904_Init()
+ * @return	Nothing
+ */
+void WM8904_InitStart(int input);
+
+/**
+ * @brief	Advance the WM8904 bring-up
+ * @return	WM8904_INIT_BUSY until the bring-up finished, then its outcome
+ * @note	Does at most one register transfer, WM8904_I2C_TIMEOUT_MS at worst.
+ */
+WM8904_INIT_STATUS_T WM8904_InitPoll(void);
+
+/**
+ * @brief	Queue the DAC digital volume of both channels
+ * @param	vol		: Volume step, WM8904_DAC_VOL_MUTE to WM8904_DAC_VOL_0DB and above
+ * @return	true when queued
+ * @note	The left value is only latched by the right write, so both change together.
+ */
+bool WM8904_SetVolume(uint8_t vol);
+
+/**
+ * @brief	Queue a DAC soft mute or unmute
+ * @param	mute	: true to mute
+ * @return	true when queued
+ */
+bool WM8904_SetMute(bool mute);
+
+/**
+ * @brief	Queue an FLL retune to the SYSCLK of a sample rate family
+ * @param	rate	: Sample rate, a multiple of 11025 Hz picks the 44.1 kHz family
+ * @return	true when queued
+ * @note	The FLL is stopped while its ratio changes, the DAC is silent meanwhile.
+ */
+bool WM8904_SetRate(uint32_t rate);
+
+/**
+ * @brief	Time out queued control transfers the bus never completed
+ * @return	Nothing
+ */
+void WM8904_ControlPoll(void);
+
+/**
+ * @brief	Check the outcome of the control batches
+ * @return	false if the last batch of a control failed
+ */
+bool WM8904_ControlOk(void);
+
 #ifdef __cplusplus
 }
 #endif
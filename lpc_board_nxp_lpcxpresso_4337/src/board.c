@@ -29,6 +29,7 @@
 
 #include "retarget.h"
 #include "max98357a.h"
+#include "wm8904.h"
 
 /** @ingroup BOARD_NGX_XPLORER_18304330
  * @{
@@ -53,6 +54,9 @@ typedef struct {
 static const io_port_t gpioLEDBits[NUM_LEDS] = {{3, 5}, {0, 7}, {3, 7}, {0, 8}};
 static uint32_t lcd_cfg_val;
 
+/* Outcome of the codec bring-up, BOARD_AUDIO_CODEC_NONE until it is started */
+static BOARD_AUDIO_CODEC_T audioCodec = BOARD_AUDIO_CODEC_NONE;
+
 void Board_UART_Init(LPC_USART_T *pUART)
 {
 	Chip_SCU_PinMuxSet(0x6, 4, (SCU_MODE_INACT | SCU_MODE_FUNC2));					/* P6,4 : UART0_TXD */
@@ -230,15 +234,53 @@ void Board_DAC_Init(LPC_DAC_T *pDAC)
 }
 
 /* Initialize Audio Codec */
-static Status Board_Audio_CodecInit(void)
+/* Start the codec bring-up: the MAX98357A amps only need their shutdown pin,
+   a WM8904 is probed for on I2C and set up by Board_Audio_CodecPoll() */
+void Board_Audio_CodecStart(void)
 {
 	//printf("%s()\r\n", __FUNCTION__);
 
-	if (!MAX98357A_Init()){
-		return ERROR;
+	if (audioCodec != BOARD_AUDIO_CODEC_NONE) {
+		return;
+	}
+	MAX98357A_Init();
+	WM8904_InitStart(0);
+	audioCodec = BOARD_AUDIO_CODEC_PENDING;
+}
+
+/* Advance the codec bring-up by at most one I2C transfer, then keep codec control going */
+BOARD_AUDIO_CODEC_T Board_Audio_CodecPoll(void)
+{
+	if (audioCodec == BOARD_AUDIO_CODEC_WM8904) {
+		WM8904_ControlPoll();
+	}
+	if (audioCodec != BOARD_AUDIO_CODEC_PENDING) {
+		return audioCodec;
+	}
+	switch (WM8904_InitPoll()) {
+	case WM8904_INIT_BUSY:
+		break;
+
+	case WM8904_INIT_DONE:
+		audioCodec = BOARD_AUDIO_CODEC_WM8904;
+		break;
+
+	case WM8904_INIT_ABSENT:
+		/* Nothing on I2C: the board is populated with the amps only */
+		audioCodec = BOARD_AUDIO_CODEC_MAX98357A;
+		break;
+
+	default:
+		audioCodec = BOARD_AUDIO_CODEC_FAILED;
+		break;
 	}
+	return audioCodec;
+}
 
-	return SUCCESS;
+/* Codec found by the bring-up */
+BOARD_AUDIO_CODEC_T Board_Audio_GetCodec(void)
+{
+	return audioCodec;
 }
 
 /* Board Audio initialization */
@@ -267,8 +309,8 @@ void Board_Audio_Init(LPC_I2S_T *pI2S)
 		/* It is a BUG catch it */
 		while(1);
 	}
-	/* Init WM8904 CODEC */
-	while (Board_Audio_CodecInit() != SUCCESS) {}
+	/* Codec bring-up runs once, in the background of Board_Audio_CodecPoll() */
+	Board_Audio_CodecStart();
 }
 
 /* Initialize Pin Muxing for LCD */
@@ -0,0 +1,270 @@
+/*
+ * @brief Memory to memory copies and fills on a GPDMA channel
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+
+#include <string.h>
+#include "board.h"
+#include "dma_manager.h"
+#include "dma_copy.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/* Largest item, the transfer size field is 12 bits */
+#define DMA_COPY_ITEM_WORDS         4095
+
+static uint8_t DMA_Copy_Channel = DMA_MANAGER_NO_CHANNEL;
+static DMA_TransferDescriptor_t *DMA_Copy_Items;
+static DMA_COPY_T *DMA_Copy_Head;			/* Move on the channel, NULL when idle */
+static DMA_COPY_T *DMA_Copy_Tail;
+static DMA_COPY_STATS_T DMA_Copy_Stats;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static bool DMA_Copy_IsFill(const DMA_COPY_T *Copy)
+{
+	return Copy->Src == (uint32_t) &Copy->Pattern;
+}
+
+/* Do the word part of a move on the CPU */
+static void DMA_Copy_Cpu(DMA_COPY_T *Copy)
+{
+	if (DMA_Copy_IsFill(Copy)) {
+		memset((void *) Copy->Dst, Copy->Pattern & 0xFF, Copy->Words * 4);
+	}
+	else {
+		memcpy((void *) Copy->Dst, (const void *) Copy->Src, Copy->Words * 4);
+	}
+}
+
+/* Put the next part of the head move on the channel, interrupts masked */
+static void DMA_Copy_StartPart(void)
+{
+	DMA_COPY_T *copy = DMA_Copy_Head;
+	uint32_t ctrl = GPDMA_DMACCxControl_SBSize(GPDMA_BSIZE_32) | GPDMA_DMACCxControl_DBSize(GPDMA_BSIZE_32) |
+					GPDMA_DMACCxControl_SWidth(GPDMA_WIDTH_WORD) | GPDMA_DMACCxControl_DWidth(GPDMA_WIDTH_WORD) |
+					GPDMA_DMACCxControl_DestTransUseAHBMaster1 | GPDMA_DMACCxControl_DI;
+	uint32_t words = copy->Words - copy->Done;
+	uint32_t src = copy->Src, dst = copy->Dst + copy->Done * 4;
+	uint32_t i, n;
+
+	if (!DMA_Copy_IsFill(copy)) {
+		/* A fill reads the same pattern word over and over */
+		ctrl |= GPDMA_DMACCxControl_SI;
+		src += copy->Done * 4;
+	}
+	for (i = 0; (i < DMA_COPY_ITEMS) && (words > 0); i++) {
+		n = MIN(words, DMA_COPY_ITEM_WORDS);
+		DMA_Copy_Items[i].src = src;
+		DMA_Copy_Items[i].dst = dst;
+		DMA_Copy_Items[i].lli = 0;
+		DMA_Copy_Items[i].ctrl = ctrl | GPDMA_DMACCxControl_TransferSize(n);
+		if (i > 0) {
+			DMA_Copy_Items[i - 1].lli = (uint32_t) &DMA_Copy_Items[i];
+		}
+		if (ctrl & GPDMA_DMACCxControl_SI) {
+			src += n * 4;
+		}
+		dst += n * 4;
+		words -= n;
+	}
+	/* Only the last item interrupts */
+	DMA_Copy_Items[i - 1].ctrl |= GPDMA_DMACCxControl_I;
+	copy->Status = DMA_COPY_BUSY;
+	DMA_Manager_SGTransfer(DMA_Copy_Channel, DMA_Copy_Items, GPDMA_TRANSFERTYPE_M2M_CONTROLLER_DMA);
+}
+
+/* Words the part on the channel moves */
+static uint32_t DMA_Copy_PartWords(const DMA_COPY_T *Copy)
+{
+	return MIN(Copy->Words - Copy->Done, DMA_COPY_ITEMS * DMA_COPY_ITEM_WORDS);
+}
+
+/* End of a part: go on with the move, or finish it and start the next one */
+static void DMA_Copy_Complete(uint8_t Channel, DMA_MANAGER_EVENT_T Event, void *Arg)
+{
+	DMA_COPY_T *copy = DMA_Copy_Head;
+
+	if ((copy == NULL) || DMA_Manager_IsBusy(Channel)) {
+		return;
+	}
+	if (Event == DMA_EVENT_COMPLETE) {
+		copy->Done += DMA_Copy_PartWords(copy);
+		if (copy->Done < copy->Words) {
+			DMA_Copy_StartPart();
+			return;
+		}
+		DMA_Copy_Stats.DmaMoves++;
+		DMA_Copy_Stats.DmaBytes += copy->Words * 4;
+	}
+	else {
+		DMA_Copy_Stats.Errors++;
+	}
+
+	DMA_Copy_Head = copy->Next;
+	if (DMA_Copy_Head == NULL) {
+		DMA_Copy_Tail = NULL;
+	}
+	copy->Status = (Event == DMA_EVENT_COMPLETE) ? DMA_COPY_DONE : DMA_COPY_FAILED;
+	/* The next move goes first, so the callback may submit again */
+	if (DMA_Copy_Head != NULL) {
+		DMA_Copy_StartPart();
+	}
+	if (copy->Callback != NULL) {
+		copy->Callback(copy);
+	}
+}
+
+/* Run a move on the DMA, or at once on the CPU */
+static void DMA_Copy_Submit(DMA_COPY_T *Copy, uint32_t Bytes)
+{
+	uint32_t primask, whole;
+
+	Copy->Words = Bytes / 4;
+	Copy->Done = 0;
+	Copy->Next = NULL;
+
+	/* The DMA only moves whole words, the bytes after them are done here */
+	whole = Copy->Words * 4;
+	if (DMA_Copy_IsFill(Copy)) {
+		memset((void *) (Copy->Dst + whole), Copy->Pattern & 0xFF, Bytes - whole);
+	}
+	else {
+		memcpy((void *) (Copy->Dst + whole), (const void *) (Copy->Src + whole), Bytes - whole);
+	}
+
+	if ((Bytes < DMA_COPY_THRESHOLD) || (DMA_Copy_Channel == DMA_MANAGER_NO_CHANNEL) ||
+		((Copy->Dst | Copy->Src) & 3)) {
+		DMA_Copy_Cpu(Copy);
+		DMA_Copy_Stats.CpuMoves++;
+		DMA_Copy_Stats.CpuBytes += Bytes;
+		Copy->Status = DMA_COPY_DONE;
+		if (Copy->Callback != NULL) {
+			Copy->Callback(Copy);
+		}
+		return;
+	}
+	DMA_Copy_Stats.CpuBytes += Bytes - whole;
+	Copy->Status = DMA_COPY_QUEUED;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (DMA_Copy_Tail != NULL) {
+		DMA_Copy_Tail->Next = Copy;
+	}
+	else {
+		DMA_Copy_Head = Copy;
+	}
+	DMA_Copy_Tail = Copy;
+	if (DMA_Copy_Head == Copy) {
+		DMA_Copy_StartPart();
+	}
+	__set_PRIMASK(primask);
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Take the channel and list items of the service */
+bool DMA_Copy_Init(void)
+{
+	if (DMA_Copy_Channel != DMA_MANAGER_NO_CHANNEL) {
+		return true;
+	}
+	DMA_Manager_Init();
+	DMA_Copy_Items = DMA_Manager_AllocDescriptors(DMA_COPY_ITEMS);
+	if (DMA_Copy_Items == NULL) {
+		return false;
+	}
+	/* Bulk moves give way to every stream, so the channel is served last */
+	DMA_Copy_Channel = DMA_Manager_Alloc(DMA_PRIORITY_LOW, DMA_Copy_Complete, NULL);
+	if (DMA_Copy_Channel == DMA_MANAGER_NO_CHANNEL) {
+		DMA_Manager_FreeDescriptors(DMA_Copy_Items, DMA_COPY_ITEMS);
+		DMA_Copy_Items = NULL;
+		return false;
+	}
+	return true;
+}
+
+/* Copy memory */
+void DMA_Memcpy(DMA_COPY_T *Copy, void *dst, const void *src, uint32_t Bytes, DMA_COPY_CALLBACK_T Callback)
+{
+	Copy->Dst = (uint32_t) dst;
+	Copy->Src = (uint32_t) src;
+	Copy->Callback = Callback;
+	DMA_Copy_Submit(Copy, Bytes);
+}
+
+/* Fill memory with a byte value */
+void DMA_Memset(DMA_COPY_T *Copy, void *dst, uint8_t Value, uint32_t Bytes, DMA_COPY_CALLBACK_T Callback)
+{
+	Copy->Dst = (uint32_t) dst;
+	Copy->Src = (uint32_t) &Copy->Pattern;
+	Copy->Pattern = Value * 0x01010101UL;
+	Copy->Callback = Callback;
+	DMA_Copy_Submit(Copy, Bytes);
+}
+
+/* Wait for a move, a failed one is redone by the CPU */
+void DMA_Copy_Wait(DMA_COPY_T *Copy)
+{
+	while (!DMA_Copy_IsDone(Copy)) {}
+
+	if (Copy->Status == DMA_COPY_FAILED) {
+		DMA_Copy_Cpu(Copy);
+		DMA_Copy_Stats.CpuMoves++;
+		DMA_Copy_Stats.CpuBytes += Copy->Words * 4;
+		Copy->Status = DMA_COPY_DONE;
+	}
+}
+
+/* Copy the service counters */
+void DMA_Copy_GetStats(DMA_COPY_STATS_T *Stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*Stats = DMA_Copy_Stats;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @}
+ */
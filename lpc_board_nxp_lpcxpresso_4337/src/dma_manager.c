@@ -0,0 +1,319 @@
+/*
+ * @brief GPDMA channel manager
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+
+#include "board.h"
+#include "dma_manager.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#if (DMA_MANAGER_DESCRIPTORS < 1) || (DMA_MANAGER_DESCRIPTORS > 32)
+#error DMA_MANAGER_DESCRIPTORS must be 1 to 32
+#endif
+
+/* State of one channel */
+typedef struct {
+	DMA_MANAGER_CALLBACK_T Callback;
+	void *Arg;
+	bool Running;					/* Started, busy time not accounted up to its end yet */
+	uint32_t StartCycle;			/* Cycle count busy time was accounted up to */
+	DMA_MANAGER_STATS_T Stats;
+} DMA_MANAGER_CHANNEL_T;
+
+static DMA_MANAGER_CHANNEL_T DMA_Manager_Channel[GPDMA_NUMBER_CHANNELS];
+static uint32_t DMA_Manager_Used;			/* Bit n: channel n allocated or reserved */
+static uint32_t DMA_Manager_DescUsed;		/* Bit n: pool item n taken */
+static bool DMA_Manager_Ready;
+
+/* Linked list items must be word aligned, 16 keeps each one in a single burst */
+static DMA_TransferDescriptor_t DMA_Manager_Pool[DMA_MANAGER_DESCRIPTORS] __attribute__ ((aligned(16)));
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Claim a channel, interrupts masked */
+static uint8_t DMA_Manager_Take(uint8_t Channel, DMA_MANAGER_CALLBACK_T Callback, void *Arg)
+{
+	DMA_MANAGER_CHANNEL_T *ch = &DMA_Manager_Channel[Channel];
+
+	DMA_Manager_Used |= 1 << Channel;
+	ch->Callback = Callback;
+	ch->Arg = Arg;
+	ch->Running = false;
+	ch->Stats.Allocations++;
+	return Channel;
+}
+
+/* A channel is free when nobody holds it and nothing started it behind the manager */
+static bool DMA_Manager_IsFree(uint8_t Channel)
+{
+	return ((DMA_Manager_Used & (1 << Channel)) == 0) && !DMA_Manager_IsBusy(Channel);
+}
+
+/* Add the busy time up to now, the transfer ends there when the channel is idle */
+static void DMA_Manager_Account(DMA_MANAGER_CHANNEL_T *ch, uint8_t Channel, uint32_t Now)
+{
+	if (ch->Running) {
+		ch->Stats.BusyCycles += Now - ch->StartCycle;
+		ch->StartCycle = Now;
+		ch->Running = DMA_Manager_IsBusy(Channel);
+	}
+}
+
+/* Count a transfer that is about to start, before the channel may interrupt */
+static void DMA_Manager_Starting(uint8_t Channel)
+{
+	DMA_MANAGER_CHANNEL_T *ch = &DMA_Manager_Channel[Channel];
+
+	ch->StartCycle = DWT->CYCCNT;
+	ch->Running = true;
+	ch->Stats.Transfers++;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Initialise the GPDMA controller and the manager, once */
+void DMA_Manager_Init(void)
+{
+	if (DMA_Manager_Ready) {
+		return;
+	}
+	Chip_GPDMA_Init(LPC_GPDMA);
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	/* Below the USB and I2S interrupts, the callbacks run after them */
+	NVIC_SetPriority(DMA_IRQn, DMA_MANAGER_IRQ_PRIORITY);
+	NVIC_EnableIRQ(DMA_IRQn);
+	DMA_Manager_Ready = true;
+}
+
+/* Allocate a free channel by priority */
+uint8_t DMA_Manager_Alloc(DMA_MANAGER_PRIORITY_T Priority, DMA_MANAGER_CALLBACK_T Callback, void *Arg)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint8_t channel = DMA_MANAGER_NO_CHANNEL;
+	int i;
+
+	__disable_irq();
+	for (i = 0; i < GPDMA_NUMBER_CHANNELS; i++) {
+		uint8_t n = (Priority == DMA_PRIORITY_HIGH) ? i : (GPDMA_NUMBER_CHANNELS - 1 - i);
+
+		if (DMA_Manager_IsFree(n)) {
+			channel = DMA_Manager_Take(n, Callback, Arg);
+			break;
+		}
+	}
+	__set_PRIMASK(primask);
+	return channel;
+}
+
+/* Reserve one channel by number */
+uint8_t DMA_Manager_Reserve(uint8_t Channel, DMA_MANAGER_CALLBACK_T Callback, void *Arg)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint8_t channel = DMA_MANAGER_NO_CHANNEL;
+
+	if (Channel >= GPDMA_NUMBER_CHANNELS) {
+		return DMA_MANAGER_NO_CHANNEL;
+	}
+	__disable_irq();
+	if (DMA_Manager_IsFree(Channel)) {
+		channel = DMA_Manager_Take(Channel, Callback, Arg);
+	}
+	__set_PRIMASK(primask);
+	return channel;
+}
+
+/* Stop a channel and give it back */
+void DMA_Manager_Free(uint8_t Channel)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	if (Channel >= GPDMA_NUMBER_CHANNELS) {
+		return;
+	}
+	DMA_Manager_Stop(Channel);
+	__disable_irq();
+	DMA_Manager_Used &= ~(1 << Channel);
+	DMA_Manager_Channel[Channel].Callback = NULL;
+	__set_PRIMASK(primask);
+}
+
+/* Start a single block transfer */
+Status DMA_Manager_Transfer(uint8_t Channel, uint32_t src, uint32_t dst,
+							GPDMA_FLOW_CONTROL_T Type, uint32_t Size)
+{
+	DMA_Manager_Starting(Channel);
+	if (Chip_GPDMA_Transfer(LPC_GPDMA, Channel, src, dst, Type, Size) != SUCCESS) {
+		DMA_Manager_Channel[Channel].Running = false;
+		DMA_Manager_Channel[Channel].Stats.Transfers--;
+		return ERROR;
+	}
+	return SUCCESS;
+}
+
+/* Start a scatter-gather transfer */
+Status DMA_Manager_SGTransfer(uint8_t Channel, const DMA_TransferDescriptor_t *Desc,
+							  GPDMA_FLOW_CONTROL_T Type)
+{
+	DMA_Manager_Starting(Channel);
+	if (Chip_GPDMA_SGTransfer(LPC_GPDMA, Channel, Desc, Type) != SUCCESS) {
+		DMA_Manager_Channel[Channel].Running = false;
+		DMA_Manager_Channel[Channel].Stats.Transfers--;
+		return ERROR;
+	}
+	return SUCCESS;
+}
+
+/* Stop the transfer running on a channel */
+void DMA_Manager_Stop(uint8_t Channel)
+{
+	DMA_MANAGER_CHANNEL_T *ch = &DMA_Manager_Channel[Channel];
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	/* Also drops a completion still pending, its callback does not run */
+	Chip_GPDMA_Stop(LPC_GPDMA, Channel);
+	DMA_Manager_Account(ch, Channel, DWT->CYCCNT);
+	__set_PRIMASK(primask);
+}
+
+/* Take a block of contiguous linked list items from the pool */
+DMA_TransferDescriptor_t *DMA_Manager_AllocDescriptors(uint32_t Count)
+{
+	uint32_t primask = __get_PRIMASK();
+	DMA_TransferDescriptor_t *desc = NULL;
+	uint32_t mask, i;
+
+	if ((Count == 0) || (Count > DMA_MANAGER_DESCRIPTORS)) {
+		return NULL;
+	}
+	mask = (Count == 32) ? 0xFFFFFFFF : ((1UL << Count) - 1);
+
+	__disable_irq();
+	for (i = 0; i + Count <= DMA_MANAGER_DESCRIPTORS; i++) {
+		if ((DMA_Manager_DescUsed & (mask << i)) == 0) {
+			DMA_Manager_DescUsed |= mask << i;
+			desc = &DMA_Manager_Pool[i];
+			break;
+		}
+	}
+	__set_PRIMASK(primask);
+	return desc;
+}
+
+/* Give a block of linked list items back to the pool */
+void DMA_Manager_FreeDescriptors(DMA_TransferDescriptor_t *Desc, uint32_t Count)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint32_t mask, first;
+
+	if ((Desc == NULL) || (Count == 0)) {
+		return;
+	}
+	first = Desc - DMA_Manager_Pool;
+	mask = (Count == 32) ? 0xFFFFFFFF : ((1UL << Count) - 1);
+
+	__disable_irq();
+	DMA_Manager_DescUsed &= ~(mask << first);
+	__set_PRIMASK(primask);
+}
+
+/* Copy the counters of a channel */
+void DMA_Manager_GetStats(uint8_t Channel, DMA_MANAGER_STATS_T *Stats)
+{
+	DMA_MANAGER_CHANNEL_T *ch = &DMA_Manager_Channel[Channel];
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	/* A circular list never completes, so the running part is folded in here */
+	DMA_Manager_Account(ch, Channel, DWT->CYCCNT);
+	*Stats = ch->Stats;
+	__set_PRIMASK(primask);
+}
+
+/* Tell which channels are allocated or reserved */
+uint32_t DMA_Manager_InUse(void)
+{
+	return DMA_Manager_Used;
+}
+
+/* DMA interrupt service of the manager */
+void DMA_Manager_IRQHandler(void)
+{
+	uint32_t tc = LPC_GPDMA->INTTCSTAT & 0xFF;
+	uint32_t err = LPC_GPDMA->INTERRSTAT & 0xFF;
+	uint32_t pending = tc | err;
+	uint32_t now = DWT->CYCCNT;
+
+	/* Cleared first, so a callback that restarts its channel gets the next interrupt */
+	LPC_GPDMA->INTTCCLEAR = tc;
+	LPC_GPDMA->INTERRCLR = err;
+
+	while (pending) {
+		/* Lowest channel first, the order the controller serves them in */
+		uint8_t n = __CLZ(__RBIT(pending));
+		uint32_t bit = 1UL << n;
+		DMA_MANAGER_CHANNEL_T *ch = &DMA_Manager_Channel[n];
+
+		pending &= ~bit;
+		DMA_Manager_Account(ch, n, now);
+		if (tc & bit) {
+			ch->Stats.Completions++;
+		}
+		if (err & bit) {
+			ch->Stats.Errors++;
+		}
+		if (ch->Callback != NULL) {
+			ch->Callback(n, (err & bit) ? DMA_EVENT_ERROR : DMA_EVENT_COMPLETE, ch->Arg);
+		}
+	}
+}
+
+void DMA_IRQHandler(void)
+{
+	DMA_Manager_IRQHandler();
+}
+
+/**
+ * @}
+ */
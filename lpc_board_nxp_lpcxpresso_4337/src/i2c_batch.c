@@ -0,0 +1,294 @@
+/*
+ * @brief Interrupt driven I2C register batch engine
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#include "board.h"
+#include "i2c_batch.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/* Queue and transfer state of one bus */
+typedef struct {
+	I2C_BATCH_T *Head;				/* Batch on the bus, NULL when idle */
+	I2C_BATCH_T *Tail;
+	I2CM_XFER_T Xfer;				/* Transfer of the current entry */
+	uint8_t Tx[3];
+	uint8_t Rx[2];
+	uint8_t Retries;				/* Failed transfers of the current entry */
+	uint32_t Deadline;				/* Cycle count the current transfer is abandoned at */
+} I2C_BATCH_BUS_T;
+
+static I2C_BATCH_BUS_T I2C_Batch_Bus[I2C_NUM_INTERFACE];
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static LPC_I2C_T *I2C_Batch_Regs(I2C_ID_T id)
+{
+	return (id == I2C0) ? LPC_I2C0 : LPC_I2C1;
+}
+
+static IRQn_Type I2C_Batch_IRQ(I2C_ID_T id)
+{
+	return (id == I2C0) ? I2C0_IRQn : I2C1_IRQn;
+}
+
+/* Put the current entry of the head batch on the bus */
+static void I2C_Batch_StartEntry(I2C_ID_T id)
+{
+	I2C_BATCH_BUS_T *bus = &I2C_Batch_Bus[id];
+	I2C_BATCH_T *batch = bus->Head;
+	const I2C_BATCH_REG_T *reg = &batch->Regs[batch->Done];
+	uint16_t val = reg->Value;
+
+	bus->Tx[0] = reg->Reg;
+	bus->Xfer.slaveAddr = batch->SlaveAddr;
+	bus->Xfer.options = 0;
+	bus->Xfer.txBuff = bus->Tx;
+	bus->Xfer.rxBuff = bus->Rx;
+	if (reg->Flags & I2C_BATCH_READ) {
+		bus->Xfer.txSz = 1;
+		bus->Xfer.rxSz = sizeof(bus->Rx);
+	}
+	else {
+		bus->Tx[1] = val >> 8;
+		bus->Tx[2] = val & 0xFF;
+		bus->Xfer.txSz = sizeof(bus->Tx);
+		bus->Xfer.rxSz = 0;
+	}
+	bus->Deadline = DWT->CYCCNT + I2C_BATCH_TIMEOUT_MS * (SystemCoreClock / 1000);
+	Chip_I2CM_Xfer(I2C_Batch_Regs(id), &bus->Xfer);
+}
+
+/* Start the batch at the head of the queue, or let the bus go idle, interrupts masked */
+static void I2C_Batch_StartNext(I2C_ID_T id)
+{
+	I2C_BATCH_BUS_T *bus = &I2C_Batch_Bus[id];
+
+	if (bus->Head == NULL) {
+		NVIC_DisableIRQ(I2C_Batch_IRQ(id));
+		return;
+	}
+	bus->Head->Status = I2C_BATCH_BUSY;
+	bus->Head->Done = 0;
+	bus->Head->Again = false;
+	bus->Retries = 0;
+	I2C_Batch_StartEntry(id);
+}
+
+/* Append a batch, interrupts masked */
+static void I2C_Batch_Append(I2C_BATCH_BUS_T *bus, I2C_BATCH_T *Batch)
+{
+	Batch->Status = I2C_BATCH_QUEUED;
+	Batch->Next = NULL;
+	if (bus->Tail != NULL) {
+		bus->Tail->Next = Batch;
+	}
+	else {
+		bus->Head = Batch;
+	}
+	bus->Tail = Batch;
+}
+
+/* The current transfer ended: go on with the batch, retry, or finish it, interrupts
+   masked. Returns the finished batch, its callback is for the caller to run unmasked. */
+static I2C_BATCH_T *I2C_Batch_EntryDone(I2C_ID_T id, bool ok)
+{
+	I2C_BATCH_BUS_T *bus = &I2C_Batch_Bus[id];
+	I2C_BATCH_T *batch = bus->Head;
+	I2C_BATCH_REG_T *reg = &batch->Regs[batch->Done];
+
+	if (ok) {
+		if (reg->Flags & I2C_BATCH_READ) {
+			reg->Value = (bus->Rx[0] << 8) | bus->Rx[1];
+		}
+		bus->Retries = 0;
+		if (++batch->Done < batch->Count) {
+			I2C_Batch_StartEntry(id);
+			return NULL;
+		}
+	}
+	else if (++bus->Retries <= I2C_BATCH_RETRIES) {
+		I2C_Batch_StartEntry(id);
+		return NULL;
+	}
+
+	bus->Head = batch->Next;
+	if (bus->Head == NULL) {
+		bus->Tail = NULL;
+	}
+	if (batch->Again) {
+		/* Newer values were submitted while it ran */
+		I2C_Batch_Append(bus, batch);
+		I2C_Batch_StartNext(id);
+		return NULL;
+	}
+	batch->Status = ok ? I2C_BATCH_DONE : I2C_BATCH_FAILED;
+	/* The next batch goes first, so the callback may submit again */
+	I2C_Batch_StartNext(id);
+	return batch;
+}
+
+/* Run the callback of a finished batch, interrupts unmasked */
+static void I2C_Batch_Finish(I2C_BATCH_T *batch)
+{
+	if ((batch != NULL) && (batch->Callback != NULL)) {
+		batch->Callback(batch);
+	}
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Set up the engine on a bus */
+void I2C_Batch_Init(I2C_ID_T id)
+{
+	I2C_BATCH_BUS_T *bus = &I2C_Batch_Bus[id];
+	IRQn_Type irq = I2C_Batch_IRQ(id);
+
+	NVIC_DisableIRQ(irq);
+	bus->Head = NULL;
+	bus->Tail = NULL;
+	/* Transfer deadlines run on the cycle counter */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	/* Below the audio interrupts, a register access is never urgent */
+	NVIC_SetPriority(irq, (1 << __NVIC_PRIO_BITS) - 1);
+}
+
+/* Queue a batch on a bus */
+bool I2C_Batch_Submit(I2C_ID_T id, I2C_BATCH_T *Batch)
+{
+	I2C_BATCH_BUS_T *bus = &I2C_Batch_Bus[id];
+	uint32_t primask;
+	bool idle;
+
+	if (Batch->Count == 0) {
+		return false;
+	}
+
+	/* Masking the bus interrupt alone does not hold off a handler this call
+	   preempted, e.g. a submit from the USB interrupt */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (Batch->Status == I2C_BATCH_BUSY) {
+		Batch->Again = true;
+	}
+	else if (Batch->Status != I2C_BATCH_QUEUED) {
+		idle = (bus->Head == NULL);
+		I2C_Batch_Append(bus, Batch);
+		if (idle) {
+			I2C_Batch_StartNext(id);
+		}
+	}
+	NVIC_EnableIRQ(I2C_Batch_IRQ(id));
+	__set_PRIMASK(primask);
+	return true;
+}
+
+/* Abandon a transfer that went over its time */
+void I2C_Batch_Poll(I2C_ID_T id)
+{
+	I2C_BATCH_BUS_T *bus = &I2C_Batch_Bus[id];
+	I2C_BATCH_T *done = NULL;
+	uint32_t primask;
+
+	if (bus->Head == NULL) {
+		return;
+	}
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if ((bus->Head != NULL) && ((int32_t) (DWT->CYCCNT - bus->Deadline) >= 0)) {
+		/* Nobody drives the bus: disabling the controller drops the transfer and releases STO */
+		Chip_I2CM_Disable(I2C_Batch_Regs(id));
+		done = I2C_Batch_EntryDone(id, false);
+	}
+	__set_PRIMASK(primask);
+	I2C_Batch_Finish(done);
+}
+
+/* Check if a bus still has batches queued */
+bool I2C_Batch_Busy(I2C_ID_T id)
+{
+	return I2C_Batch_Bus[id].Head != NULL;
+}
+
+/* Wait until every batch queued on a bus completed */
+void I2C_Batch_Flush(I2C_ID_T id)
+{
+	while (I2C_Batch_Busy(id)) {
+		I2C_Batch_Poll(id);
+	}
+}
+
+/* I2C interrupt service of the engine */
+void I2C_Batch_IRQHandler(I2C_ID_T id)
+{
+	I2C_BATCH_BUS_T *bus = &I2C_Batch_Bus[id];
+	LPC_I2C_T *pI2C = I2C_Batch_Regs(id);
+	I2C_BATCH_T *done = NULL;
+	uint32_t primask;
+
+	/* A submit from a higher priority interrupt must not see the queue half updated */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (bus->Head == NULL) {
+		Chip_I2CM_ClearSI(pI2C);
+		NVIC_DisableIRQ(I2C_Batch_IRQ(id));
+	}
+	else if (Chip_I2CM_XferHandler(pI2C, &bus->Xfer)) {
+		done = I2C_Batch_EntryDone(id, bus->Xfer.status == I2CM_STATUS_OK);
+	}
+	__set_PRIMASK(primask);
+	I2C_Batch_Finish(done);
+}
+
+void I2C0_IRQHandler(void)
+{
+	I2C_Batch_IRQHandler(I2C0);
+}
+
+void I2C1_IRQHandler(void)
+{
+	I2C_Batch_IRQHandler(I2C1);
+}
+
+/**
+ * @}
+ */
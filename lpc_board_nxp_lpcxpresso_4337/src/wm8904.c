@@ -31,6 +31,7 @@
 
 #include "board.h"
 #include "wm8904.h"
+#include "i2c_batch.h"
 
 /*****************************************************************************
  * Private types/enumerations/variables
@@ -39,8 +40,12 @@
 #define WM8904_STATE_OFF            0
 #define WM8904_STATE_ON             1
 
+/* FLL lock wait after the register sequence, in ms */
 #define WM8904_LOCK_TIMEOUT         10
 
+/* Marker entry of g_wm8904[]: wait reg_val ms, then for the write sequencer */
+#define WM8904_SEQ_DELAY            0xFF
+
 typedef struct __WM8904_Init_Seq {
     uint16_t reg_adr;
     uint16_t reg_val;
@@ -66,7 +71,7 @@ const WM8904_Init_Seq_t g_wm8904[] = {
     /* execute default start=up sequence */
     { 0x6C, 0x0100}, // Write Sequencer 0(6CH):  0100  WSEQ_ENA=1, WSEQ_WRITE_INDEX=0_0000
     { 0x6F, 0x0100}, // Write Sequencer 3(6FH):  0100  WSEQ_ABORT=0, WSEQ_START=1, WSEQ_START_INDEX=00_0000
-    { 0xFF, 300}, // insert_delay_ms 500 needs to pause for write sequencer to finish before further writes
+    { WM8904_SEQ_DELAY, 300}, // insert_delay_ms 500 needs to pause for write sequencer to finish before further writes
 
     { 0x21, WM8904_DAC_DIGITAL_1_VALUE}, // DAC Digital 1(21H):      0000  DAC_MONO=0, DAC_SB_FILT=0, DAC_MUTERATE=0, DAC_UNMUTE_RAMP=1, DAC_OSR128=1, DAC_MUTE=0, DEEMPH=00
     { 0x68, 0x0005}, // Class W 0(68H):          0005  CP_DYN_PWR=1
@@ -135,30 +140,187 @@ const WM8904_Init_Seq_t g_wm8904_input_init[] = {
 
 };
 
+/* Bring-up steps, each one does at most one register transfer per poll */
+typedef enum {
+	WM8904_STEP_IDLE,
+	WM8904_STEP_PROBE,				/* Read the device ID */
+	WM8904_STEP_SEQUENCE,			/* Write the next g_wm8904[] entry */
+	WM8904_STEP_DELAY,				/* Fixed wait of a delay entry */
+	WM8904_STEP_SEQUENCER,			/* Wait for the write sequencer to finish */
+	WM8904_STEP_FLL_LOCK,			/* Wait for the FLL lock status */
+	WM8904_STEP_CLOCKS,				/* Switch SYSCLK to the FLL */
+	WM8904_STEP_DONE,
+} WM8904_STEP_T;
+
+/* Bring-up state */
+typedef struct {
+	WM8904_STEP_T Step;
+	WM8904_INIT_STATUS_T Status;
+	uint32_t Index;					/* Next g_wm8904[] entry */
+	uint32_t Retries;				/* Failed transfers of the current step */
+	uint32_t Deadline;				/* Cycle count the current step times out at */
+	uint32_t PauseEnd;				/* Cycle count the current pause ends at */
+	bool Waiting;					/* Pausing before the next transfer */
+	uint32_t CyclesPerMs;
+} WM8904_BRINGUP_T;
+
+static WM8904_BRINGUP_T WM8904_Bringup;
+
+/* Transfer in progress and the cycle count it is abandoned at */
+static I2C_XFER_T WM8904_Xfer;
+static uint32_t WM8904_XferDeadline;
+
+/* Run time controls, each one batch on the I2C batch engine: a control changed
+   again before its batch went out costs no extra transfers */
+static I2C_BATCH_REG_T WM8904_VolumeRegs[2] = {
+	{WM8904_DAC_DIGITAL_VOLUME_LEFT, 0, WM8904_DAC_VOL_0DB},
+	{WM8904_DAC_DIGITAL_VOLUME_RIGHT, 0, WM8904_DAC_VU | WM8904_DAC_VOL_0DB},
+};
+static I2C_BATCH_T WM8904_VolumeBatch = {I2CDEV_WM8904_ADDR, 2, WM8904_VolumeRegs};
+
+static I2C_BATCH_REG_T WM8904_MuteRegs[1] = {
+	{WM8904_DAC_DIGITAL_1, 0, WM8904_DAC_DIGITAL_1_VALUE},
+};
+static I2C_BATCH_T WM8904_MuteBatch = {I2CDEV_WM8904_ADDR, 1, WM8904_MuteRegs};
+
+static I2C_BATCH_REG_T WM8904_RateRegs[4] = {
+	{WM8904_FLL_CONTROL_1, 0, 0x0000},
+	{WM8904_FLL_CONTROL_3, 0, WM8904_FLL_1288MHZ_K},
+	{WM8904_FLL_CONTROL_4, 0, WM8904_FLL_1288MHZ_N},
+	{WM8904_FLL_CONTROL_1, 0, WM8904_FLL_ENA},
+};
+static I2C_BATCH_T WM8904_RateBatch = {I2CDEV_WM8904_ADDR, 4, WM8904_RateRegs};
+
 /*****************************************************************************
  * Public types/enumerations/variables
  ****************************************************************************/
-int WM8904_MultiRegWrite(const WM8904_Init_Seq_t* seq, uint32_t cnt);
 
 /*****************************************************************************
  * Private functions
  ****************************************************************************/
-/* Set the default values to the codec registers */
-static int Audio_Codec_SetDefaultValues(const uint8_t *values, int sz)
+
+static bool WM8904_TimeReached(uint32_t Deadline)
+{
+	return (int32_t) (DWT->CYCCNT - Deadline) >= 0;
+}
+
+static uint32_t WM8904_CyclesPerMs(void)
+{
+	if (WM8904_Bringup.CyclesPerMs == 0) {
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+		WM8904_Bringup.CyclesPerMs = Chip_Clock_GetRate(CLK_MX_MXCORE) / 1000;
+	}
+	return WM8904_Bringup.CyclesPerMs;
+}
+
+/* Polling event handler with a deadline: a bus nobody drives (no pull-ups, no
+   codec) never raises SI, so the transfer is dropped and the controller
+   disabled, which also releases STO for Chip_I2C_MasterTransfer() */
+static void WM8904_EventHandler(I2C_ID_T id, I2C_EVENT_T event)
+{
+	if (event != I2C_EVENT_WAIT) {
+		return;
+	}
+	while (WM8904_Xfer.status == I2C_STATUS_BUSY) {
+		if (Chip_I2C_IsStateChanged(id)) {
+			Chip_I2C_MasterStateHandler(id);
+		}
+		else if (WM8904_TimeReached(WM8904_XferDeadline)) {
+			Chip_I2C_Disable(id);
+			WM8904_Xfer.status = I2C_STATUS_BUSERR;
+		}
+	}
+}
+
+/* One bounded transfer, whatever handler the bus had is put back after it.
+   Queued control batches go first, the engine leaves the bus idle after them. */
+static bool WM8904_Transfer(const uint8_t *tx, int txSz, uint8_t *rx, int rxSz)
+{
+	I2C_EVENTHANDLER_T old;
+
+	I2C_Batch_Flush(WM8904_I2C_BUS);
+	old = Chip_I2C_GetMasterEventHandler(WM8904_I2C_BUS);
+
+	WM8904_Xfer.slaveAddr = I2CDEV_WM8904_ADDR;
+	WM8904_Xfer.txBuff = tx;
+	WM8904_Xfer.txSz = txSz;
+	WM8904_Xfer.rxBuff = rx;
+	WM8904_Xfer.rxSz = rxSz;
+	WM8904_XferDeadline = DWT->CYCCNT + WM8904_I2C_TIMEOUT_MS * WM8904_CyclesPerMs();
+
+	Chip_I2C_SetMasterEventHandler(WM8904_I2C_BUS, WM8904_EventHandler);
+	Chip_I2C_MasterTransfer(WM8904_I2C_BUS, &WM8904_Xfer);
+	Chip_I2C_SetMasterEventHandler(WM8904_I2C_BUS, old);
+
+	return (WM8904_Xfer.status == I2C_STATUS_DONE) && (WM8904_Xfer.txSz == 0) && (WM8904_Xfer.rxSz == 0);
+}
+
+static bool WM8904_Read(uint8_t reg, uint16_t *val)
+{
+	uint8_t rx_data[2];
+
+	if (!WM8904_Transfer(&reg, 1, rx_data, 2)) {
+		return false;
+	}
+	*val = (rx_data[0] << 8) | rx_data[1];
+	return true;
+}
+
+static bool WM8904_Write(uint8_t reg, uint16_t val)
+{
+	uint8_t dat[3];
+
+	dat[0] = reg; dat[1] = val >> 8; dat[2] = val & 0xFF;
+	return WM8904_Transfer(dat, sizeof(dat), NULL, 0);
+}
+
+/* Pause the bring-up for Ms milliseconds */
+static void WM8904_Pause(uint32_t Ms)
+{
+	WM8904_Bringup.PauseEnd = DWT->CYCCNT + Ms * WM8904_CyclesPerMs();
+	WM8904_Bringup.Waiting = true;
+}
+
+/* Give the current step Ms milliseconds to see its status bit */
+static void WM8904_Timeout(uint32_t Ms)
+{
+	WM8904_Bringup.Deadline = DWT->CYCCNT + Ms * WM8904_CyclesPerMs();
+}
+
+static void WM8904_NextStep(WM8904_STEP_T Step)
+{
+	WM8904_Bringup.Step = Step;
+	WM8904_Bringup.Retries = 0;
+	WM8904_Bringup.Waiting = false;
+}
+
+/* A transfer of the current step failed: pause and retry it, or give up */
+static void WM8904_Retry(WM8904_INIT_STATUS_T GiveUp)
 {
-	int ret;
-  uint16_t rd_val = 1;
-
-  /* Set System register's default values */
-	ret = WM8904_MultiRegWrite((const WM8904_Init_Seq_t *)values, sz);
-	rd_val = WM8904_REG_Read(0x7F);
-	while ( (rd_val & 0x4) != 0x4 )
-	{
-		rd_val = WM8904_REG_Read(0x7F);
+	if (++WM8904_Bringup.Retries > WM8904_I2C_RETRIES) {
+		WM8904_Bringup.Status = GiveUp;
+		WM8904_Bringup.Step = WM8904_STEP_IDLE;
+		return;
 	}
-  WM8904_REG_Write(0x16, 0x4006 | 0x8);	
+	WM8904_Pause(WM8904_RETRY_DELAY_MS);
+}
 
-	return ret;
+/* Wait on a status bit until it reads Set, or fail the bring-up at the step deadline */
+static void WM8904_PollBit(uint8_t reg, uint16_t mask, bool Set, WM8904_STEP_T Next)
+{
+	uint16_t val;
+
+	if (!WM8904_Read(reg, &val)) {
+		WM8904_Retry(WM8904_INIT_FAILED);
+	}
+	else if (((val & mask) != 0) == Set) {
+		WM8904_NextStep(Next);
+	}
+	else if (WM8904_TimeReached(WM8904_Bringup.Deadline)) {
+		WM8904_Bringup.Status = WM8904_INIT_FAILED;
+		WM8904_Bringup.Step = WM8904_STEP_IDLE;
+	}
 }
 
 /*****************************************************************************
@@ -167,9 +329,10 @@ static int Audio_Codec_SetDefaultValues(const uint8_t *values, int sz)
 
 /* Read data from UDA register */
 uint16_t WM8904_REG_Read(uint8_t reg) {
-	uint8_t rx_data[2];
-	if (Chip_I2C_MasterCmdRead(WM8904_I2C_BUS, I2CDEV_WM8904_ADDR, reg, rx_data, 2) == 2) {
-		return (rx_data[0] << 8) | rx_data[1];
+	uint16_t val;
+
+	if (WM8904_Read(reg, &val)) {
+		return val;
 	}
 	return 0;
 }
@@ -177,25 +340,22 @@ uint16_t WM8904_REG_Read(uint8_t reg) {
 /* Write data to Codec register */
 void WM8904_REG_Write(uint8_t reg, uint16_t val)
 {
-	uint8_t dat[3];
-	dat[0] = reg; dat[1] = val >> 8; dat[2] = val & 0xFF;
-	Chip_I2C_MasterSend(WM8904_I2C_BUS, I2CDEV_WM8904_ADDR, dat, sizeof(dat));
+	WM8904_Write(reg, val);
 }
 
 /* Write data to codec register and verify the value by reading it back */
 int WM8904_REG_WriteVerify(uint8_t reg, uint16_t val)
 {
 	uint16_t ret;
-	WM8904_REG_Write(reg, val);
-	ret = WM8904_REG_Read(reg);
-	return ret == val;
+
+	return WM8904_Write(reg, val) && WM8904_Read(reg, &ret) && (ret == val);
 }
 
 /* Multiple value verification function */
 int WM8904_REG_VerifyMult(uint8_t reg, const uint8_t *value, uint8_t *buff, int len)
 {
 	int i;
-	if (Chip_I2C_MasterCmdRead(WM8904_I2C_BUS, I2CDEV_WM8904_ADDR, reg, buff, len) != len) {
+	if (!WM8904_Transfer(&reg, 1, buff, len)) {
 		return 0;	/* Partial read */
 
 	}
@@ -209,71 +369,150 @@ int WM8904_REG_VerifyMult(uint8_t reg, const uint8_t *value, uint8_t *buff, int
 	return i == len;
 }
 
-/* WM8904 initialize function */
-int WM8904_Init(int input)
+/* Start the WM8904 bring-up */
+void WM8904_InitStart(int input)
 {
-	I2C_EVENTHANDLER_T old = Chip_I2C_GetMasterEventHandler(WM8904_I2C_BUS);
-	int ret;
-
 	/* Initialize I2C */
 	Board_I2C_Init(WM8904_I2C_BUS);
 	Chip_I2C_Init(WM8904_I2C_BUS);
-	Chip_I2C_SetClockRate(WM8904_I2C_BUS, 100000);
-	Chip_I2C_SetMasterEventHandler(WM8904_I2C_BUS, Chip_I2C_EventHandlerPolling);
+	Chip_I2C_SetClockRate(WM8904_I2C_BUS, WM8904_I2C_CLOCK_RATE);
+	I2C_Batch_Init(WM8904_I2C_BUS);
 
-	/* Initialize the default values */
-	ret = Audio_Codec_SetDefaultValues((void *)&g_wm8904[0], sizeof(g_wm8904)/sizeof(WM8904_Init_Seq_t));
-	
+	WM8904_Bringup.Status = WM8904_INIT_BUSY;
+	WM8904_Bringup.Index = 0;
+	WM8904_NextStep(WM8904_STEP_PROBE);
+}
 
-#if 0
-	if (ret) {
-		ret = Audio_Codec_SetDefaultValues(UDA_interfil_regs_dat, sizeof(UDA_interfil_regs_dat));
-	}
+/* Advance the WM8904 bring-up by at most one register transfer */
+WM8904_INIT_STATUS_T WM8904_InitPoll(void)
+{
+	WM8904_BRINGUP_T *b = &WM8904_Bringup;
+	const WM8904_Init_Seq_t *seq;
+	uint16_t val;
 
-	if (ret) {
-		ret = Audio_Codec_SetDefaultValues(UDA_decimator_regs_dat, sizeof(UDA_decimator_regs_dat));
+	if (b->Status != WM8904_INIT_BUSY) {
+		return b->Status;
+	}
+	if (b->Waiting) {
+		if (!WM8904_TimeReached(b->PauseEnd)) {
+			return b->Status;
+		}
+		b->Waiting = false;
 	}
 
-	if (ret && input) {
-		/* Disable Power On for ADCR, PGAR, PGAL to get mic sound more clearly */
-		ret = UDA1380_REG_WriteVerify(UDA_POWER_CTRL,
-									  UDA1380_REG_PWRCTRL_DEFAULT_VALUE & (~(0x0B)));
+	switch (b->Step) {
+	case WM8904_STEP_PROBE:
+		/* Nothing answering, or something else at the address: no WM8904 on this board */
+		if (!WM8904_Read(WM8904_SW_RESET_AND_ID, &val)) {
+			WM8904_Retry(WM8904_INIT_ABSENT);
+		}
+		else if (val != WM8904_DEVICE_ID) {
+			b->Status = WM8904_INIT_ABSENT;
+		}
+		else {
+			WM8904_NextStep(WM8904_STEP_SEQUENCE);
+		}
+		break;
 
-		if (ret) {
-			ret = UDA1380_REG_WriteVerify(UDA_ADC_CTRL,
-										  UDA1380_REG_ADC_DEFAULT_VALUE | input);
+	case WM8904_STEP_SEQUENCE:
+		if (b->Index >= sizeof(g_wm8904) / sizeof(g_wm8904[0])) {
+			WM8904_NextStep(WM8904_STEP_FLL_LOCK);
+			WM8904_Timeout(WM8904_LOCK_TIMEOUT);
+			break;
 		}
+		seq = &g_wm8904[b->Index];
+		if (seq->reg_adr == WM8904_SEQ_DELAY) {
+			b->Index++;
+			WM8904_NextStep(WM8904_STEP_DELAY);
+			WM8904_Pause(seq->reg_val);
+		}
+		else if (WM8904_Write(seq->reg_adr, seq->reg_val)) {
+			b->Index++;
+			b->Retries = 0;
+		}
+		else {
+			WM8904_Retry(WM8904_INIT_FAILED);
+		}
+		break;
+
+	case WM8904_STEP_DELAY:
+		/* The fixed pause is over, the sequencer gets a bounded extra wait */
+		WM8904_NextStep(WM8904_STEP_SEQUENCER);
+		WM8904_Timeout(WM8904_SEQUENCER_TIMEOUT_MS);
+		break;
+
+	case WM8904_STEP_SEQUENCER:
+		WM8904_PollBit(0x70, 0x0001, false, WM8904_STEP_SEQUENCE);
+		break;
+
+	case WM8904_STEP_FLL_LOCK:
+		WM8904_PollBit(0x7F, 0x0004, true, WM8904_STEP_CLOCKS);
+		break;
+
+	case WM8904_STEP_CLOCKS:
+		if (WM8904_Write(0x16, 0x4006 | 0x8)) {
+			WM8904_NextStep(WM8904_STEP_DONE);
+			b->Status = WM8904_INIT_DONE;
+		}
+		else {
+			WM8904_Retry(WM8904_INIT_FAILED);
+		}
+		break;
+
+	default:
+		break;
 	}
-#endif	
-	Chip_I2C_SetMasterEventHandler(WM8904_I2C_BUS, old);
+	return b->Status;
+}
+
+/* Queue the DAC digital volume of both channels */
+bool WM8904_SetVolume(uint8_t vol)
+{
+	WM8904_VolumeRegs[0].Value = vol;
+	WM8904_VolumeRegs[1].Value = WM8904_DAC_VU | vol;
+	return I2C_Batch_Submit(WM8904_I2C_BUS, &WM8904_VolumeBatch);
+}
+
+/* Queue a DAC soft mute or unmute */
+bool WM8904_SetMute(bool mute)
+{
+	WM8904_MuteRegs[0].Value = WM8904_DAC_DIGITAL_1_VALUE | (mute ? WM8904_DAC_MUTE : 0);
+	return I2C_Batch_Submit(WM8904_I2C_BUS, &WM8904_MuteBatch);
+}
+
+/* Queue an FLL retune to the SYSCLK of a sample rate family */
+bool WM8904_SetRate(uint32_t rate)
+{
+	const Codec_Cfg_t *cfg = &g_CodecCfgs[(rate % 11025) == 0 ? 1 : 0];
+
+	WM8904_RateRegs[1].Value = cfg->fll_k;
+	WM8904_RateRegs[2].Value = cfg->fll_n;
+	return I2C_Batch_Submit(WM8904_I2C_BUS, &WM8904_RateBatch);
+}
 
-	return ret;
+/* Time out control transfers the bus never completed */
+void WM8904_ControlPoll(void)
+{
+	I2C_Batch_Poll(WM8904_I2C_BUS);
 }
 
-static void delay(uint32_t i) {
-	while (i--) {}
+/* Check that the last batch of every control reached the codec */
+bool WM8904_ControlOk(void)
+{
+	return (WM8904_VolumeBatch.Status != I2C_BATCH_FAILED) &&
+		   (WM8904_MuteBatch.Status != I2C_BATCH_FAILED) &&
+		   (WM8904_RateBatch.Status != I2C_BATCH_FAILED);
 }
 
-/* Write multiple registers in one go */
-int WM8904_MultiRegWrite(const WM8904_Init_Seq_t* seq, uint32_t cnt)
+/* WM8904 initialize function */
+int WM8904_Init(int input)
 {
-    uint16_t rd_val = 1;
-    uint32_t i;
-    
-    for (i = 0; i < cnt; i++) {
-        /* check if it is delay register */
-        if (seq[i].reg_adr == 0xFF) {
-            
-            delay(seq[i].reg_val * 1000);
-						do { 
-				       rd_val = WM8904_REG_Read(0x70);
-            } while (rd_val & 1);
-        } else {
-            WM8904_REG_Write(seq[i].reg_adr, seq[i].reg_val);
-						rd_val = WM8904_REG_Read(seq[i].reg_adr);
-        }
-    }
-    return (SUCCESS);
+	WM8904_INIT_STATUS_T status;
+
+	WM8904_InitStart(input);
+	while ((status = WM8904_InitPoll()) == WM8904_INIT_BUSY) {}
+
+	return status == WM8904_INIT_DONE;
 }
 
 /**
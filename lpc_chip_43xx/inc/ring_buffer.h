@@ -36,6 +36,23 @@
 
 /** @defgroup Ring_Buffer CHIP: Simple ring buffer implementation
  * @ingroup CHIP_Common
+ * The item count is a power of 2, so indexes wrap with a mask, and an item
+ * size that is a power of 2 turns the index to offset product into a shift.
+ *
+ * Besides the copying calls there is a zero-copy interface: the producer
+ * gets the contiguous free space at the head with RingBuffer_Reserve(),
+ * fills it in place (CPU, DMA, a USB transfer descriptor) and publishes it
+ * with RingBuffer_Commit(); the consumer gets the contiguous items at the
+ * tail with RingBuffer_PeekRegion() and releases them with
+ * RingBuffer_Consume(). A region stops at the end of the buffer, so a
+ * wrapped range takes two calls.
+ *
+ * ISR safety: one producer and one consumer may run in different contexts,
+ * e.g. an interrupt handler and the main loop, without any locking. The
+ * producer calls (Insert, Reserve/Commit) only write head and the consumer
+ * calls (Pop, Peek, Consume) only write tail, and each index is published
+ * after the data it covers. Several producers, several consumers, and
+ * RingBuffer_Flush() need the caller to serialize them.
  * @{
  */
 
@@ -48,6 +65,7 @@ typedef struct {
 	int itemSz;
 	uint32_t head;
 	uint32_t tail;
+	int itemShift;		/*!< log2(itemSz), -1 when itemSz is not a power of 2 */
 } RINGBUFF_T;
 
 /**
@@ -69,9 +87,12 @@ typedef struct {
  * @param	itemSize	: Size of each buffer item size
  * @param	count		: Size of ring buffer
  * @note	Memory pointed by @a buffer must have correct alignment of
- * 			@a itemSize, and @a count must be a power of 2 and must at
- * 			least be 2 or greater.
- * @return	Nothing
+ * 			@a itemSize. @a count must be a power of 2 and at least 2:
+ * 			the indexes wrap with a mask, there is no modulo path for
+ * 			other sizes. Such a count leaves @a RingBuff uninitialized
+ * 			and returns 0, so check the result.
+ * @return	1 on success, 0 when @a count is not a power of 2, @a count
+ * 			is below 2, or @a itemSize is not positive
  */
 int RingBuffer_Init(RINGBUFF_T *RingBuff, void *buffer, int itemSize, int count);
 
@@ -180,6 +201,88 @@ int RingBuffer_Pop(RINGBUFF_T *RingBuff, void *data);
  */
 int RingBuffer_PopMult(RINGBUFF_T *RingBuff, void *data, int num);
 
+/**
+ * @brief	Copy the oldest item of the ring buffer without removing it
+ * @param	RingBuff	: Pointer to ring buffer
+ * @param	data		: Pointer to memory where the item be stored
+ * @return	1 when an item was copied, 0 when the buffer is empty
+ */
+int RingBuffer_Peek(RINGBUFF_T *RingBuff, void *data);
+
+/**
+ * @brief	Get the contiguous free space at the head of the ring buffer
+ * @param	RingBuff	: Pointer to ring buffer
+ * @param	region		: Pointer to where the start of the free space be stored
+ * @return	Number of items that can be written at @a region, 0 when full
+ * @note	Producer side. Nothing is inserted until RingBuffer_Commit().
+ */
+int RingBuffer_Reserve(RINGBUFF_T *RingBuff, void **region);
+
+/**
+ * @brief	Insert items written in place at the head of the ring buffer
+ * @param	RingBuff	: Pointer to ring buffer
+ * @param	num			: Number of items, at most what RingBuffer_Reserve() returned
+ * @return	Nothing
+ */
+void RingBuffer_Commit(RINGBUFF_T *RingBuff, int num);
+
+/**
+ * @brief	Get the contiguous items at the tail of the ring buffer
+ * @param	RingBuff	: Pointer to ring buffer
+ * @param	region		: Pointer to where the address of the oldest item be stored
+ * @return	Number of items that can be read at @a region, 0 when empty
+ * @note	Consumer side. Nothing is removed until RingBuffer_Consume().
+ */
+int RingBuffer_PeekRegion(RINGBUFF_T *RingBuff, void **region);
+
+/**
+ * @brief	Remove items from the tail of the ring buffer
+ * @param	RingBuff	: Pointer to ring buffer
+ * @param	num			: Number of items, at most what RingBuffer_PeekRegion() returned
+ * @return	Nothing
+ */
+void RingBuffer_Consume(RINGBUFF_T *RingBuff, int num);
+
+/**
+ * @brief	Insert a 32-bit item into a ring buffer of 4 byte items
+ * @param	RingBuff	: Pointer to ring buffer, initialized with an item size of 4
+ * @param	value		: Item to insert
+ * @return	1 when inserted, 0 when the buffer is full
+ */
+STATIC INLINE int RingBuffer_InsertWord(RINGBUFF_T *RingBuff, uint32_t value)
+{
+	uint32_t head = RingBuff->head;
+
+	if ((int) (head - RB_VTAIL(RingBuff)) >= RingBuff->count) {
+		return 0;
+	}
+	((volatile uint32_t *) RingBuff->data)[head & (RingBuff->count - 1)] = value;
+	/* The item must be visible before the index that covers it */
+	__DMB();
+	RB_VHEAD(RingBuff) = head + 1;
+	return 1;
+}
+
+/**
+ * @brief	Pop a 32-bit item from a ring buffer of 4 byte items
+ * @param	RingBuff	: Pointer to ring buffer, initialized with an item size of 4
+ * @param	value		: Pointer to memory where the popped item be stored
+ * @return	1 when an item was popped, 0 when the buffer is empty
+ */
+STATIC INLINE int RingBuffer_PopWord(RINGBUFF_T *RingBuff, uint32_t *value)
+{
+	uint32_t tail = RingBuff->tail;
+
+	if (RB_VHEAD(RingBuff) == tail) {
+		return 0;
+	}
+	*value = ((volatile uint32_t *) RingBuff->data)[tail & (RingBuff->count - 1)];
+	/* The item must be read before the producer may overwrite it */
+	__DMB();
+	RB_VTAIL(RingBuff) = tail + 1;
+	return 1;
+}
+
 
 /**
  * @}
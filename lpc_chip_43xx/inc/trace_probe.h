@@ -0,0 +1,190 @@
+/*
+ * @brief Cycle stamped trace probes recording into a RAM ring
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2013
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#ifndef __TRACE_PROBE_H_
+#define __TRACE_PROBE_H_
+
+#include "cmsis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Trace_Probe CHIP: Cycle stamped trace probes
+ * @ingroup CHIP_Common
+ * A probe records its ID, an argument and the DWT cycle count into a ring of
+ * events in RAM. The ring keeps the newest TRACE_PROBE_EVENTS events and is
+ * read back after the fact, so probes can sit in interrupt handlers of any
+ * priority: recording takes about a dozen cycles and never blocks.
+ *
+ * A slot is claimed with LDREX/STREX on the event counter, and the cycle count
+ * is read inside that loop. An interrupt between the two clears the exclusive
+ * monitor, so the claim is retried with a fresh stamp and events stay in time
+ * order in the ring even when the probes of several priorities interleave.
+ *
+ * TRACE_PROBE_ENTER/TRACE_PROBE_EXIT bracket a span and carry the same
+ * argument, a host decoder pairs them by ID and argument. TRACE_PROBE_POINT
+ * marks a single instant. With TRACE_PROBES 0 (the default) the macros and
+ * their arguments compile to nothing.
+ *
+ * IDs are 8 bits, each layer of a project numbers its probes from its own
+ * base below so they never collide.
+ * @{
+ */
+
+/** Build with TRACE_PROBES=1 to record probes */
+#ifndef TRACE_PROBES
+#define TRACE_PROBES            0
+#endif
+
+/** Events kept in the ring, a power of 2 */
+#ifndef TRACE_PROBE_EVENTS
+#define TRACE_PROBE_EVENTS      1024
+#endif
+
+/** First probe ID of the USB stack */
+#define TRACE_PROBE_ID_USB_BASE 0x10
+/** First probe ID of the application */
+#define TRACE_PROBE_ID_APP_BASE 0x40
+
+/**
+ * @brief What a recorded event marks
+ */
+typedef enum {
+	TRACE_PROBE_KIND_POINT = 0,	/*!< A single instant */
+	TRACE_PROBE_KIND_ENTER,		/*!< Start of a span */
+	TRACE_PROBE_KIND_EXIT,		/*!< End of the span with the same ID and argument */
+} TRACE_PROBE_KIND_T;
+
+/**
+ * @brief One recorded event, 8 bytes
+ */
+typedef struct {
+	uint32_t Cycle;				/*!< DWT cycle count */
+	uint8_t  Id;				/*!< Probe ID */
+	uint8_t  Kind;				/*!< TRACE_PROBE_KIND_T */
+	uint16_t Arg;				/*!< Probe specific argument */
+} TRACE_PROBE_EVENT_T;
+
+#if (TRACE_PROBES)
+
+/* Ring and counters, only for TraceProbe_Record() */
+extern TRACE_PROBE_EVENT_T TraceProbe_Ring[TRACE_PROBE_EVENTS];
+extern volatile uint32_t TraceProbe_Count;
+extern volatile uint32_t TraceProbe_Paused;
+
+/**
+ * @brief	Record one event
+ * @param	Id		: Probe ID
+ * @param	Kind	: TRACE_PROBE_KIND_T
+ * @param	Arg		: Probe specific argument
+ * @return	Nothing
+ * @note	Safe from any context, use the TRACE_PROBE_* macros instead.
+ */
+STATIC INLINE void TraceProbe_Record(uint8_t Id, uint8_t Kind, uint16_t Arg)
+{
+	TRACE_PROBE_EVENT_T *Event;
+	uint32_t index, cycle;
+
+	if (TraceProbe_Paused) {
+		return;
+	}
+	do {
+		index = __LDREXW(&TraceProbe_Count);
+		cycle = DWT->CYCCNT;
+	} while (__STREXW(index + 1, &TraceProbe_Count) != 0);
+
+	Event = &TraceProbe_Ring[index & (TRACE_PROBE_EVENTS - 1)];
+	Event->Cycle = cycle;
+	Event->Id = Id;
+	Event->Kind = Kind;
+	Event->Arg = Arg;
+}
+
+#define TRACE_PROBE_POINT(Id, Arg)  TraceProbe_Record((Id), TRACE_PROBE_KIND_POINT, (uint16_t) (Arg))
+#define TRACE_PROBE_ENTER(Id, Arg)  TraceProbe_Record((Id), TRACE_PROBE_KIND_ENTER, (uint16_t) (Arg))
+#define TRACE_PROBE_EXIT(Id, Arg)   TraceProbe_Record((Id), TRACE_PROBE_KIND_EXIT, (uint16_t) (Arg))
+
+#else
+
+#define TRACE_PROBE_POINT(Id, Arg)  ((void) 0)
+#define TRACE_PROBE_ENTER(Id, Arg)  ((void) 0)
+#define TRACE_PROBE_EXIT(Id, Arg)   ((void) 0)
+
+#endif /* TRACE_PROBES */
+
+/**
+ * @brief	Stop or restart recording, the ring keeps its contents
+ * @param	Pause	: true to stop recording
+ * @return	Nothing
+ * @note	Pause before reading the ring so probes do not overwrite it.
+ */
+void TraceProbe_Pause(bool Pause);
+
+/**
+ * @brief	Drop all recorded events
+ * @return	Nothing
+ * @note	Not while a probe of the main loop context may be recording.
+ */
+void TraceProbe_Clear(void);
+
+/**
+ * @brief	Number of events recorded since the last clear
+ * @return	Event count, the ring holds the last TRACE_PROBE_EVENTS of them
+ */
+uint32_t TraceProbe_GetCount(void);
+
+/**
+ * @brief	Index of the oldest event still in the ring
+ * @return	Event index, counted like TraceProbe_GetCount()
+ */
+uint32_t TraceProbe_GetOldest(void);
+
+/**
+ * @brief	Copy recorded events out of the ring
+ * @param	Index	: Index of the first event, counted like TraceProbe_GetCount()
+ * @param	Events	: Where the events are copied
+ * @param	Count	: Maximum number of events to copy
+ * @return	Number of events copied, fewer than Count at the end of the recording
+ * @note	Nothing is copied from an index already overwritten, see TraceProbe_GetOldest().
+ */
+uint32_t TraceProbe_Read(uint32_t Index, TRACE_PROBE_EVENT_T *Events, uint32_t Count);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRACE_PROBE_H_ */
@@ -30,6 +30,7 @@
  */
 
 #include <string.h>
+#include "chip.h"
 #include "ring_buffer.h"
 
 /*****************************************************************************
@@ -39,6 +40,13 @@
 #define RB_INDH(rb)                ((rb)->head & ((rb)->count - 1))
 #define RB_INDT(rb)                ((rb)->tail & ((rb)->count - 1))
 
+/* Byte offset of n items, a shift for power of 2 item sizes */
+#define RB_OFFSET(rb, n)           ((rb)->itemShift >= 0 ? (uint32_t) (n) << (rb)->itemShift : \
+									(uint32_t) (n) * (rb)->itemSz)
+
+/* Address of the item at a masked index */
+#define RB_ITEM(rb, ind)           ((uint8_t *) (rb)->data + RB_OFFSET(rb, ind))
+
 /*****************************************************************************
  * Public types/enumerations/variables
  ****************************************************************************/
@@ -47,6 +55,28 @@
  * Private functions
  ****************************************************************************/
 
+/* Copy one item, without a library call for the common small sizes */
+STATIC INLINE void RB_CopyItem(RINGBUFF_T *RingBuff, void *dst, const void *src)
+{
+	switch (RingBuff->itemSz) {
+	case 1:
+		*(uint8_t *) dst = *(const uint8_t *) src;
+		break;
+
+	case 2:
+		*(uint16_t *) dst = *(const uint16_t *) src;
+		break;
+
+	case 4:
+		*(uint32_t *) dst = *(const uint32_t *) src;
+		break;
+
+	default:
+		memcpy(dst, src, RingBuff->itemSz);
+		break;
+	}
+}
+
 /*****************************************************************************
  * Public functions
  ****************************************************************************/
@@ -54,120 +84,156 @@
 /* Initialize ring buffer */
 int RingBuffer_Init(RINGBUFF_T *RingBuff, void *buffer, int itemSize, int count)
 {
+	int shift;
+
+	/* Indexes wrap with a mask, so the size must be a power of 2 */
+	if ((count < 2) || ((count & (count - 1)) != 0) || (itemSize <= 0)) {
+		return 0;
+	}
+
 	RingBuff->data = buffer;
 	RingBuff->count = count;
 	RingBuff->itemSz = itemSize;
 	RingBuff->head = RingBuff->tail = 0;
 
+	shift = -1;
+	if ((itemSize & (itemSize - 1)) == 0) {
+		for (shift = 0; (1 << shift) != itemSize; shift++) {}
+	}
+	RingBuff->itemShift = shift;
+
 	return 1;
 }
 
-/* Insert a single item into Ring Buffer */
-int RingBuffer_Insert(RINGBUFF_T *RingBuff, const void *data)
+/* Get the contiguous free space at the head */
+int RingBuffer_Reserve(RINGBUFF_T *RingBuff, void **region)
 {
-	uint8_t *ptr = RingBuff->data;
+	uint32_t ind = RB_INDH(RingBuff);
+	int cnt = RingBuffer_GetFree(RingBuff);
 
-	/* We cannot insert when queue is full */
-	if (RingBuffer_IsFull(RingBuff))
-		return 0;
+	if (cnt > (int) (RingBuff->count - ind)) {
+		cnt = RingBuff->count - ind;
+	}
+	*region = RB_ITEM(RingBuff, ind);
 
-	ptr += RB_INDH(RingBuff) * RingBuff->itemSz;
-	memcpy(ptr, data, RingBuff->itemSz);
-	RingBuff->head++;
+	return cnt;
+}
 
-	return 1;
+/* Publish items written at the head */
+void RingBuffer_Commit(RINGBUFF_T *RingBuff, int num)
+{
+	/* The items must be visible before the index that covers them */
+	__DMB();
+	RB_VHEAD(RingBuff) = RingBuff->head + num;
 }
 
-/* Insert multiple items into Ring Buffer */
-int RingBuffer_InsertMult(RINGBUFF_T *RingBuff, const void *data, int num)
+/* Get the contiguous items at the tail */
+int RingBuffer_PeekRegion(RINGBUFF_T *RingBuff, void **region)
 {
-	uint8_t *ptr = RingBuff->data;
-	int cnt1, cnt2;
+	uint32_t ind = RB_INDT(RingBuff);
+	int cnt = RingBuffer_GetCount(RingBuff);
 
-	/* We cannot insert when queue is full */
-	if (RingBuffer_IsFull(RingBuff))
-		return 0;
+	if (cnt > (int) (RingBuff->count - ind)) {
+		cnt = RingBuff->count - ind;
+	}
+	*region = RB_ITEM(RingBuff, ind);
 
-	/* Calculate the segment lengths */
-	cnt1 = cnt2 = RingBuffer_GetFree(RingBuff);
-	if (RB_INDH(RingBuff) + cnt1 >= RingBuff->count)
-		cnt1 = RingBuff->count - RB_INDH(RingBuff);
-	cnt2 -= cnt1;
+	/* Do not read the items ahead of the index checked above */
+	__DMB();
+	return cnt;
+}
 
-	cnt1 = MIN(cnt1, num);
-	num -= cnt1;
+/* Release items read at the tail */
+void RingBuffer_Consume(RINGBUFF_T *RingBuff, int num)
+{
+	/* The items must be read before the producer may overwrite them */
+	__DMB();
+	RB_VTAIL(RingBuff) = RingBuff->tail + num;
+}
 
-	cnt2 = MIN(cnt2, num);
-	num -= cnt2;
+/* Insert a single item into Ring Buffer */
+int RingBuffer_Insert(RINGBUFF_T *RingBuff, const void *data)
+{
+	/* We cannot insert when queue is full */
+	if (RingBuffer_IsFull(RingBuff))
+		return 0;
 
-	/* Write segment 1 */
-	ptr += RB_INDH(RingBuff) * RingBuff->itemSz;
-	memcpy(ptr, data, cnt1 * RingBuff->itemSz);
-	RingBuff->head += cnt1;
+	RB_CopyItem(RingBuff, RB_ITEM(RingBuff, RB_INDH(RingBuff)), data);
+	RingBuffer_Commit(RingBuff, 1);
 
-	/* Write segment 2 */
-	ptr = (uint8_t *) RingBuff->data + RB_INDH(RingBuff) * RingBuff->itemSz;
-	data = (const uint8_t *) data + cnt1 * RingBuff->itemSz;
-	memcpy(ptr, data, cnt2 * RingBuff->itemSz);
-	RingBuff->head += cnt2;
+	return 1;
+}
 
-	return cnt1 + cnt2;
+/* Insert multiple items into Ring Buffer */
+int RingBuffer_InsertMult(RINGBUFF_T *RingBuff, const void *data, int num)
+{
+	void *region;
+	int cnt, total = 0;
+
+	/* At most two segments, up to the end of the buffer and from its start */
+	while (num > 0) {
+		cnt = RingBuffer_Reserve(RingBuff, &region);
+		if (cnt == 0) {
+			break;
+		}
+		cnt = MIN(cnt, num);
+
+		memcpy(region, data, RB_OFFSET(RingBuff, cnt));
+		RingBuffer_Commit(RingBuff, cnt);
+
+		data = (const uint8_t *) data + RB_OFFSET(RingBuff, cnt);
+		num -= cnt;
+		total += cnt;
+	}
+
+	return total;
 }
 
 /* Pop single item from Ring Buffer */
 int RingBuffer_Pop(RINGBUFF_T *RingBuff, void *data)
 {
-	uint8_t *ptr = RingBuff->data;
-
-	/* We cannot pop when queue is empty */
-	if (RingBuffer_IsEmpty(RingBuff))
+	if (!RingBuffer_Peek(RingBuff, data)) {
 		return 0;
-
-	ptr += RB_INDT(RingBuff) * RingBuff->itemSz;
-	memcpy(data, ptr, RingBuff->itemSz);
-	RingBuff->tail++;
+	}
+	RingBuffer_Consume(RingBuff, 1);
 
 	return 1;
 }
 
-/* Pop multiple items from Ring buffer */
-int RingBuffer_PopMult(RINGBUFF_T *RingBuff, void *data, int num)
+/* Copy the oldest item without removing it */
+int RingBuffer_Peek(RINGBUFF_T *RingBuff, void *data)
 {
-	uint8_t *ptr = RingBuff->data;
-	int cnt1, cnt2;
-
-	/* We cannot insert when queue is empty */
+	/* We cannot peek when queue is empty */
 	if (RingBuffer_IsEmpty(RingBuff))
 		return 0;
 
-	/* Calculate the segment lengths */
-	cnt1 = cnt2 = RingBuffer_GetCount(RingBuff);
-	if (RB_INDT(RingBuff) + cnt1 >= RingBuff->count)
-		cnt1 = RingBuff->count - RB_INDT(RingBuff);
-	cnt2 -= cnt1;
+	__DMB();
+	RB_CopyItem(RingBuff, data, RB_ITEM(RingBuff, RB_INDT(RingBuff)));
 
-	cnt1 = MIN(cnt1, num);
-	num -= cnt1;
-
-	cnt2 = MIN(cnt2, num);
-	num -= cnt2;
-
-	/* Write segment 1 */
-	ptr += RB_INDT(RingBuff) * RingBuff->itemSz;
-	memcpy(data, ptr, cnt1 * RingBuff->itemSz);
-	RingBuff->tail += cnt1;
-
-	/* Write segment 2 */
-	ptr = (uint8_t *) RingBuff->data + RB_INDT(RingBuff) * RingBuff->itemSz;
-	data = (uint8_t *) data + cnt1 * RingBuff->itemSz;
-	memcpy(data, ptr, cnt2 * RingBuff->itemSz);
-	RingBuff->tail += cnt2;
-
-	return cnt1 + cnt2;
+	return 1;
 }
 
-
-
-
-
-
+/* Pop multiple items from Ring buffer */
+int RingBuffer_PopMult(RINGBUFF_T *RingBuff, void *data, int num)
+{
+	void *region;
+	int cnt, total = 0;
+
+	/* At most two segments, up to the end of the buffer and from its start */
+	while (num > 0) {
+		cnt = RingBuffer_PeekRegion(RingBuff, &region);
+		if (cnt == 0) {
+			break;
+		}
+		cnt = MIN(cnt, num);
+
+		memcpy(data, region, RB_OFFSET(RingBuff, cnt));
+		RingBuffer_Consume(RingBuff, cnt);
+
+		data = (uint8_t *) data + RB_OFFSET(RingBuff, cnt);
+		num -= cnt;
+		total += cnt;
+	}
+
+	return total;
+}
@@ -0,0 +1,113 @@
+/*
+ * @brief Cycle stamped trace probes recording into a RAM ring
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2014
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+#include "chip.h"
+#include "trace_probe.h"
+
+#if (TRACE_PROBES)
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#if (TRACE_PROBE_EVENTS & (TRACE_PROBE_EVENTS - 1))
+#error "TRACE_PROBE_EVENTS must be a power of 2"
+#endif
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+TRACE_PROBE_EVENT_T TraceProbe_Ring[TRACE_PROBE_EVENTS];
+volatile uint32_t TraceProbe_Count;
+volatile uint32_t TraceProbe_Paused;
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Stop or restart recording */
+void TraceProbe_Pause(bool Pause)
+{
+	TraceProbe_Paused = Pause ? 1 : 0;
+	__DMB();
+}
+
+/* Drop all recorded events */
+void TraceProbe_Clear(void)
+{
+	uint32_t paused = TraceProbe_Paused;
+
+	TraceProbe_Paused = 1;
+	__DMB();
+	TraceProbe_Count = 0;
+	__DMB();
+	TraceProbe_Paused = paused;
+}
+
+/* Number of events recorded since the last clear */
+uint32_t TraceProbe_GetCount(void)
+{
+	return TraceProbe_Count;
+}
+
+/* Index of the oldest event still in the ring */
+uint32_t TraceProbe_GetOldest(void)
+{
+	uint32_t count = TraceProbe_Count;
+
+	return (count > TRACE_PROBE_EVENTS) ? count - TRACE_PROBE_EVENTS : 0;
+}
+
+/* Copy recorded events out of the ring */
+uint32_t TraceProbe_Read(uint32_t Index, TRACE_PROBE_EVENT_T *Events, uint32_t Count)
+{
+	uint32_t end = TraceProbe_Count;
+	uint32_t i;
+
+	if ((Index < TraceProbe_GetOldest()) || (Index >= end)) {
+		return 0;
+	}
+	if (Count > end - Index) {
+		Count = end - Index;
+	}
+	for (i = 0; i < Count; i++) {
+		Events[i] = TraceProbe_Ring[(Index + i) & (TRACE_PROBE_EVENTS - 1)];
+	}
+	return Count;
+}
+
+#endif /* TRACE_PROBES */
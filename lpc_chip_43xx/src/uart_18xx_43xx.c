@@ -247,22 +247,48 @@ uint32_t Chip_UART_SetBaud(LPC_USART_T *pUART, uint32_t baudrate)
 /* UART receive-only interrupt handler for ring buffers */
 void Chip_UART_RXIntHandlerRB(LPC_USART_T *pUART, RINGBUFF_T *pRB)
 {
-	/* New data will be ignored if data not popped in time */
+	void *region;
+	uint8_t *p8;
+	int cnt, num;
+
+	/* Read straight into the free space of the ring buffer, publishing it once per segment */
 	while (Chip_UART_ReadLineStatus(pUART) & UART_LSR_RDR) {
-		uint8_t ch = Chip_UART_ReadByte(pUART);
-		RingBuffer_Insert(pRB, &ch);
+		cnt = RingBuffer_Reserve(pRB, &region);
+		if (cnt == 0) {
+			/* New data will be ignored if data not popped in time */
+			Chip_UART_ReadByte(pUART);
+			continue;
+		}
+
+		p8 = (uint8_t *) region;
+		num = 0;
+		while ((num < cnt) && (Chip_UART_ReadLineStatus(pUART) & UART_LSR_RDR)) {
+			p8[num++] = Chip_UART_ReadByte(pUART);
+		}
+		RingBuffer_Commit(pRB, num);
 	}
 }
 
 /* UART transmit-only interrupt handler for ring buffers */
 void Chip_UART_TXIntHandlerRB(LPC_USART_T *pUART, RINGBUFF_T *pRB)
 {
-	uint8_t ch;
+	void *region;
+	const uint8_t *p8;
+	int cnt, num;
+
+	/* Fill FIFO until full or until TX ring buffer is empty, sending from the ring buffer in place */
+	while ((Chip_UART_ReadLineStatus(pUART) & UART_LSR_THRE) != 0) {
+		cnt = RingBuffer_PeekRegion(pRB, &region);
+		if (cnt == 0) {
+			break;
+		}
 
-	/* Fill FIFO until full or until TX ring buffer is empty */
-	while ((Chip_UART_ReadLineStatus(pUART) & UART_LSR_THRE) != 0 &&
-		   RingBuffer_Pop(pRB, &ch)) {
-		Chip_UART_SendByte(pUART, ch);
+		p8 = (const uint8_t *) region;
+		num = 0;
+		while ((num < cnt) && (Chip_UART_ReadLineStatus(pUART) & UART_LSR_THRE) != 0) {
+			Chip_UART_SendByte(pUART, p8[num++]);
+		}
+		RingBuffer_Consume(pRB, num);
 	}
 
 	/* Turn off interrupt if the ring buffer is empty */
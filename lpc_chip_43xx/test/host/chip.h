@@ -0,0 +1,15 @@
+/*
+ * @brief Host stand-in for chip.h, for the ring buffer host test
+ *
+ * Provides what ring_buffer.c takes from the chip headers: the LPCOpen
+ * types and a data memory barrier.
+ */
+
+#ifndef __CHIP_H_
+#define __CHIP_H_
+
+#include "lpc_types.h"
+
+#define __DMB()                   __sync_synchronize()
+
+#endif /* __CHIP_H_ */
@@ -0,0 +1,192 @@
+/*
+ * @brief Host test of the ring buffer
+ *
+ * Runs the copying and the zero-copy calls of ring_buffer.c across the
+ * wrap of the buffer, on the build host. From the repository root:
+ *
+ *   gcc -std=gnu99 -Wall -Ilpc_chip_43xx/test/host -Ilpc_chip_43xx/inc \
+ *       lpc_chip_43xx/test/ring_buffer_test.c lpc_chip_43xx/src/ring_buffer.c \
+ *       -o ring_buffer_test && ./ring_buffer_test
+ *
+ * Prints the failed checks and exits with 1 on a failure.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "chip.h"
+#include "ring_buffer.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define TEST_COUNT          8
+
+static int Test_Failures;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: %s failed\n", __FILE__, __LINE__, # cond); \
+			Test_Failures++; \
+		} \
+	} while (0)
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Only power of 2 counts of at least 2 are taken */
+static void Test_Init(void)
+{
+	RINGBUFF_T rb;
+	uint8_t buf[TEST_COUNT * 3];
+
+	CHECK(RingBuffer_Init(&rb, buf, 1, 0) == 0);
+	CHECK(RingBuffer_Init(&rb, buf, 1, 1) == 0);
+	CHECK(RingBuffer_Init(&rb, buf, 1, 6) == 0);
+	CHECK(RingBuffer_Init(&rb, buf, 0, TEST_COUNT) == 0);
+	CHECK(RingBuffer_Init(&rb, buf, 1, TEST_COUNT) == 1);
+	CHECK(RingBuffer_Init(&rb, buf, 3, TEST_COUNT) == 1);
+	CHECK(RingBuffer_IsEmpty(&rb));
+	CHECK(RingBuffer_GetFree(&rb) == TEST_COUNT);
+}
+
+/* Reserve and peek stop at the end of the buffer and go on from its start */
+static void Test_RegionWrap(void)
+{
+	RINGBUFF_T rb;
+	uint16_t buf[TEST_COUNT];
+	uint16_t *p16;
+	void *region;
+	int cnt, i;
+
+	CHECK(RingBuffer_Init(&rb, buf, sizeof(buf[0]), TEST_COUNT));
+
+	/* Move head and tail to 6 */
+	cnt = RingBuffer_Reserve(&rb, &region);
+	CHECK(cnt == TEST_COUNT);
+	CHECK(region == &buf[0]);
+	RingBuffer_Commit(&rb, 6);
+	CHECK(RingBuffer_PeekRegion(&rb, &region) == 6);
+	RingBuffer_Consume(&rb, 6);
+	CHECK(RingBuffer_IsEmpty(&rb));
+
+	/* Free space is 8 items, only 2 of them contiguous at the head */
+	cnt = RingBuffer_Reserve(&rb, &region);
+	CHECK(cnt == 2);
+	CHECK(region == &buf[6]);
+	p16 = region;
+	p16[0] = 100;
+	p16[1] = 101;
+	RingBuffer_Commit(&rb, 2);
+
+	cnt = RingBuffer_Reserve(&rb, &region);
+	CHECK(cnt == TEST_COUNT - 2);
+	CHECK(region == &buf[0]);
+	p16 = region;
+	for (i = 0; i < 3; i++) {
+		p16[i] = 102 + i;
+	}
+	RingBuffer_Commit(&rb, 3);
+	CHECK(RingBuffer_GetCount(&rb) == 5);
+
+	/* Items too come in two regions, the first up to the end of the buffer */
+	cnt = RingBuffer_PeekRegion(&rb, &region);
+	CHECK(cnt == 2);
+	CHECK(region == &buf[6]);
+	p16 = region;
+	CHECK((p16[0] == 100) && (p16[1] == 101));
+	RingBuffer_Consume(&rb, 2);
+
+	cnt = RingBuffer_PeekRegion(&rb, &region);
+	CHECK(cnt == 3);
+	CHECK(region == &buf[0]);
+	p16 = region;
+	CHECK((p16[0] == 102) && (p16[1] == 103) && (p16[2] == 104));
+	RingBuffer_Consume(&rb, 3);
+	CHECK(RingBuffer_IsEmpty(&rb));
+	CHECK(RingBuffer_PeekRegion(&rb, &region) == 0);
+
+	/* A full buffer has no space to reserve */
+	for (i = 0; i < TEST_COUNT; i++) {
+		CHECK(RingBuffer_Insert(&rb, &buf[0]));
+	}
+	CHECK(RingBuffer_IsFull(&rb));
+	CHECK(RingBuffer_Reserve(&rb, &region) == 0);
+	CHECK(RingBuffer_Insert(&rb, &buf[0]) == 0);
+}
+
+/* The copying calls keep the order across many wraps, for any chunk size */
+static void Test_CopyWrap(void)
+{
+	RINGBUFF_T rb;
+	uint8_t buf[TEST_COUNT * 3];
+	uint8_t in[TEST_COUNT * 3], out[TEST_COUNT * 3];
+	uint8_t next_in = 0, next_out = 0;
+	int round, num, free, cnt, i, j;
+
+	CHECK(RingBuffer_Init(&rb, buf, 3, TEST_COUNT));
+
+	for (round = 0; round < 100; round++) {
+		num = (round % TEST_COUNT) + 1;
+		for (i = 0; i < num * 3; i++) {
+			in[i] = next_in + i / 3;
+		}
+		free = RingBuffer_GetFree(&rb);
+		cnt = RingBuffer_InsertMult(&rb, in, num);
+		CHECK(cnt == MIN(num, free));
+		next_in += cnt;
+
+		cnt = RingBuffer_PopMult(&rb, out, (round % 3) + 1);
+		for (i = 0; i < cnt; i++) {
+			for (j = 0; j < 3; j++) {
+				CHECK(out[i * 3 + j] == next_out);
+			}
+			next_out++;
+		}
+	}
+	while ((cnt = RingBuffer_PopMult(&rb, out, TEST_COUNT)) != 0) {
+		for (i = 0; i < cnt; i++) {
+			CHECK(out[i * 3] == next_out);
+			next_out++;
+		}
+	}
+	CHECK(next_out == next_in);
+}
+
+/* The word calls share the indexes of the others */
+static void Test_Word(void)
+{
+	RINGBUFF_T rb;
+	uint32_t buf[TEST_COUNT];
+	uint32_t value, i;
+
+	CHECK(RingBuffer_Init(&rb, buf, sizeof(buf[0]), TEST_COUNT));
+	for (i = 0; i < 3 * TEST_COUNT; i++) {
+		CHECK(RingBuffer_InsertWord(&rb, 0xA5000000 | i));
+		CHECK(RingBuffer_InsertWord(&rb, 0x5A000000 | i));
+		CHECK(RingBuffer_Pop(&rb, &value) && (value == (0xA5000000 | i)));
+		CHECK(RingBuffer_PopWord(&rb, &value) && (value == (0x5A000000 | i)));
+	}
+	CHECK(RingBuffer_PopWord(&rb, &value) == 0);
+	for (i = 0; i < TEST_COUNT; i++) {
+		CHECK(RingBuffer_InsertWord(&rb, i));
+	}
+	CHECK(RingBuffer_InsertWord(&rb, 0) == 0);
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+int main(void)
+{
+	Test_Init();
+	Test_RegionWrap();
+	Test_CopyWrap();
+	Test_Word();
+
+	printf("ring_buffer_test: %s\n", Test_Failures ? "FAILED" : "passed");
+	return Test_Failures ? 1 : 0;
+}